@@ -43,6 +43,7 @@
 #define INCLUDE_APML_H_
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include <linux/amd-apml.h>
 #include "apml_err.h"
@@ -56,6 +57,22 @@
  *  APIs prototype of the APIs exported by the APML library.
  *  Description of the API, arguments and return values.
  *  The Error codes returned by the API.
+ *
+ *  @par Thread safety
+ *  All functions can be called concurrently from any number of threads, on
+ *  the same or on different sockets, with the following rules:
+ *  - Transactions on one interface of a socket are serialised on its bus;
+ *    transactions on different sockets or interfaces run in parallel.
+ *  - Values the library reads once from a socket, such as the processor
+ *    info and the RAPL units, are kept per socket and read without locks.
+ *  - The global settings (apml_set_transport(), apml_set_hooks(), ...)
+ *    apply to the transactions started after they return.
+ *  - The settings of a handle (apml_set_call_opts(), apml_set_priority(),
+ *    apml_set_retry_policy(), ...) must not be changed while another
+ *    thread issues on the same handle. A handle must not be used after
+ *    apml_close().
+ *  - Multi-step operations such as the read-modify-write setters are not
+ *    atomic with respect to other writers of the same register.
  */
 
 typedef enum {
@@ -90,6 +107,962 @@ typedef enum {
 #define SBRMI		"sbrmi"
 #define SBTSI		"sbtsi"
 
+/**
+ * @brief Opaque handle to one socket, see apml_open()
+ */
+struct apml_handle;
+
+/**
+ * @brief Keep the device nodes of the socket open while the handle is open
+ */
+#define APML_OPEN_PERSISTENT	(1 << 0)
+/**
+ * @brief Enable apml_submit() on the handle, see apml_get_event_fd()
+ */
+#define APML_OPEN_ASYNC		(1 << 1)
+/**
+ * @brief All flags accepted by apml_open()
+ */
+#define APML_OPEN_FLAGS		(APML_OPEN_PERSISTENT | APML_OPEN_ASYNC)
+
+/**
+ * @brief Completion callback of apml_submit()
+ *
+ * @details Invoked from apml_process_completions() on the thread calling
+ * it, with the submitted message holding the output data and the status
+ * of the transaction.
+ */
+typedef void (*apml_callback_t)(struct apml_handle *handle,
+				struct apml_message *msg,
+				oob_status_t status, void *ctx);
+
+/**
+ * @brief Maximum number of sockets whose APML device nodes the library
+ * keeps track of. Sockets beyond this index are always accessed by
+ * opening and closing the device node per transaction.
+ */
+#define APML_MAX_SOCKETS	8
+
+/**
+ *  @brief Keep the APML device nodes open across transactions.
+ *
+ *  @details By default every transaction opens /dev/sbrmiN or /dev/sbtsiN,
+ *  issues the ioctl and closes the device again. When enabled, the library
+ *  opens each device node once per socket and interface on first use and
+ *  reuses the file descriptor for all subsequent transactions. A descriptor
+ *  that no longer refers to a live device (e.g. the apml module was
+ *  reloaded) is reopened transparently. Disabling the mode closes all
+ *  cached descriptors.
+ *
+ *  @param[in] enable true to keep the device nodes open, false to open and
+ *  close them on every transaction.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *
+ */
+oob_status_t apml_set_persistent_fd(bool enable);
+
+/**
+ *  @brief Open a handle to a socket.
+ *
+ *  @details The handle carries the socket index together with the
+ *  library state kept for the socket, so that the handle based (_h)
+ *  functions do not need to look it up per call. The socket index based
+ *  functions operate on an internal default handle of the socket.
+ *  Handles of the same socket share the per-socket state.
+ *
+ *  @param[in] soc_num Socket index, less than ::APML_MAX_SOCKETS.
+ *
+ *  @param[in] flags Bitwise OR of APML_OPEN_* flags.
+ *
+ *  @param[out] handle Newly allocated handle, to be released with
+ *  apml_close().
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_open(uint8_t soc_num, uint32_t flags,
+		       struct apml_handle **handle);
+
+/**
+ *  @brief Close a handle returned by apml_open().
+ *
+ *  @details Closing the last ::APML_OPEN_PERSISTENT handle of a socket
+ *  closes its device nodes unless apml_set_persistent_fd() is enabled.
+ *
+ *  @param[in] handle Handle to close.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_close(struct apml_handle *handle);
+
+/**
+ *  @brief Drop the values the library cached for a socket.
+ *
+ *  @details Static facts of a socket, such as its processor info and
+ *  SB-RMI revision, are read once and kept per socket. They are dropped
+ *  automatically on a warm reset or when the device node is reopened;
+ *  call this after any other change of the processor behind the socket.
+ *  The record of the socket in the apml_set_disk_cache() file is dropped
+ *  as well.
+ *
+ *  @param[in] soc_num Socket index, less than ::APML_MAX_SOCKETS.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval ::OOB_INVALID_INPUT @p soc_num is out of range.
+ *
+ */
+oob_status_t apml_invalidate_socket_cache(uint8_t soc_num);
+
+/**
+ * @brief Default file of apml_set_disk_cache(), emptied on boot
+ */
+#define APML_DISK_CACHE_PATH	"/run/apml/cache"
+
+/**
+ *  @brief Share the static facts of the sockets with later processes.
+ *
+ *  @details The values cached per socket (processor info, thread and core
+ *  counts, vendor, SB-RMI revision, RAPL units, max power limit, min/max
+ *  cTDP, socket frequency range, base frequency and mailbox command
+ *  support) are also written to a small mapped file, so a short-lived tool
+ *  starts from the values read by the previous ones instead of issuing
+ *  their transactions again. A record holds the values of one host reset
+ *  generation: it is dropped when a transaction reports a warm reset and
+ *  the file is emptied on boot. It is used without a transaction; only
+ *  when a value missing from it has to be read are the SB-RMI revision
+ *  and the CPUID signature of the socket checked against it, and the
+ *  record started over when they differ. A socket whose signature cannot be read
+ *  is cached in memory only until apml_invalidate_socket_cache(). Disabled
+ *  by default.
+ *
+ *  @param[in] path cache file, ::APML_DISK_CACHE_PATH normally, its
+ *  directory is created when missing. NULL disables the on-disk cache.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned when the file cannot be opened or mapped.
+ *
+ */
+oob_status_t apml_set_disk_cache(const char *path);
+
+/*****************************************************************************/
+/** @defgroup TransportAccess Transport backends
+ *  The messages of the SB-RMI and SB-TSI interfaces are issued through a
+ *  transport backend selected per interface at runtime. Each backend
+ *  reports the message types it can carry; a message the selected backend
+ *  cannot carry fails with ::OOB_NOT_SUPPORTED.
+ *  @{
+ */
+
+/**
+ * @brief Transport backends
+ */
+typedef enum {
+	APML_TRANSPORT_MODULE = 0,	//!< ioctl on the apml_modules device,
+					//!< /dev/sbrmiN and /dev/sbtsiN
+	APML_TRANSPORT_I2C_DEV,		//!< I2C_RDWR on /dev/i2c-N, register
+					//!< access only
+	APML_TRANSPORT_EMUL,		//!< In-process device emulator, see
+					//!< apml_emul.h
+	APML_TRANSPORT_MAX
+} apml_transport_t;
+
+#define APML_CAP_REG		(1 << 0)	//!< Register read/write
+#define APML_CAP_MAILBOX	(1 << 1)	//!< Mailbox messages
+#define APML_CAP_CPUID		(1 << 2)	//!< CPUID protocol
+#define APML_CAP_MCA_MSR	(1 << 3)	//!< MCA MSR protocol
+
+/**
+ *  @brief Select the transport backend of an interface.
+ *
+ *  @details Takes effect for all sockets from their next transaction on
+ *  the interface. The default is ::APML_TRANSPORT_MODULE.
+ *
+ *  @param[in] file_name ::SBRMI or ::SBTSI.
+ *
+ *  @param[in] transport backend to use.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_set_transport(char *file_name, apml_transport_t transport);
+
+/**
+ *  @brief Get the capabilities of a transport backend.
+ *
+ *  @param[in] transport backend to query.
+ *
+ *  @param[out] caps bitwise OR of the APML_CAP_* message types the backend
+ *  can carry.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_get_transport_caps(apml_transport_t transport,
+				     uint32_t *caps);
+
+/**
+ *  @brief Set the I2C adapter and target address of an interface.
+ *
+ *  @details Used by ::APML_TRANSPORT_I2C_DEV. The adapter must be set for
+ *  every socket; the target address defaults to 0x3c (SB-RMI) and 0x4c
+ *  (SB-TSI) for socket 0 and to 0x38 and 0x48 for socket 1. Changing
+ *  the device reopens the cached device node of the interface and drops
+ *  the values cached for the socket.
+ *
+ *  @param[in] soc_num Socket index, less than ::APML_MAX_SOCKETS.
+ *
+ *  @param[in] file_name ::SBRMI or ::SBTSI.
+ *
+ *  @param[in] bus N of the /dev/i2c-N adapter the socket is wired to.
+ *
+ *  @param[in] addr 7-bit target address.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_set_i2c_device(uint8_t soc_num, char *file_name,
+				 uint32_t bus, uint8_t addr);
+
+/** @} */  // end of TransportAccess
+
+/*****************************************************************************/
+/** @defgroup TraceAccess Transaction trace record and replay
+ *  Every transaction issued on a transport can be recorded to a binary
+ *  trace file holding the request, the response, the start time, the
+ *  duration and the firmware return code. A recorded workload can then be
+ *  replayed, at its original timing or faster, e.g. against the device
+ *  emulator of apml_emul.h.
+ *  @{
+ */
+
+/**
+ * @brief Configure the emulator latencies from the trace before replaying
+ */
+#define APML_REPLAY_EMUL_TIMING	(1 << 0)
+/**
+ * @brief Also replay the writes on a transport other than the emulator
+ */
+#define APML_REPLAY_WRITES	(1 << 1)
+/**
+ * @brief All flags accepted by apml_trace_replay()
+ */
+#define APML_REPLAY_FLAGS	(APML_REPLAY_EMUL_TIMING | APML_REPLAY_WRITES)
+
+/**
+ * @brief Result of apml_trace_replay()
+ */
+struct apml_replay_stats {
+	uint64_t transactions;	//!< Transactions replayed
+	uint64_t mismatches;	//!< Transactions whose outcome or output
+				//!< differs from the recording
+	uint64_t skipped;	//!< Writes of the trace not replayed, and
+				//!< requests of sockets from
+				//!< ::APML_MAX_SOCKETS on
+	uint64_t recorded_ns;	//!< Time span of the recording, from the
+				//!< earliest start to the latest end
+	uint64_t elapsed_ns;	//!< Wall time of the replay
+};
+
+/**
+ *  @brief Start recording the transactions to a trace file.
+ *
+ *  @param[in] path trace file to create, truncated if it exists.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval ::OOB_TRY_AGAIN a trace is already being recorded.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_trace_start(const char *path);
+
+/**
+ *  @brief Stop recording and close the trace file.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_trace_stop(void);
+
+/**
+ *  @brief Replay a recorded trace.
+ *
+ *  @details The requests of the trace are issued again, in order, on the
+ *  transports currently selected with apml_set_transport(). With @p speed
+ *  1.0 they keep the spacing of the recording, 2.0 replays twice as fast
+ *  and 0 issues them back to back. The trace holds the requests in
+ *  completion order; one started before the request replayed last, e.g.
+ *  a slow request of another socket, is issued at once. Each request is issued once on a
+ *  handle of the replay, without the read cache, retries or coalescing
+ *  set up for the calls of the process.
+ *  The writes of the trace are only issued on an interface using the
+ *  emulator transport, unless ::APML_REPLAY_WRITES is set, so that a
+ *  replay never changes the settings of real hardware by accident. The
+ *  writes not issued are counted in apml_replay_stats::skipped.
+ *
+ *  @param[in] path trace file written by apml_trace_start(). Traces of
+ *  earlier versions of the library fail with ::OOB_INVALID_INPUT.
+ *
+ *  @param[in] speed time scale of the replay, 0 for no pacing.
+ *
+ *  @param[in] flags bitwise OR of APML_REPLAY_* flags.
+ *
+ *  @param[out] stats outcome of the replay, may be NULL.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_trace_replay(const char *path, double speed,
+			       uint32_t flags,
+			       struct apml_replay_stats *stats);
+
+/** @} */  // end of TraceAccess
+
+/*****************************************************************************/
+
+/*****************************************************************************/
+/** @defgroup StatsAccess Per-command transaction statistics
+ *  The library counts, per socket and per command, the transactions issued
+ *  on the transports, their failures by status, the payload bytes and the
+ *  distribution of the time spent in the transport (the ioctl for the apml
+ *  module). Counters are updated without locks and read with
+ *  apml_get_stats(), which is not an atomic snapshot of all of them.
+ *  Mailbox commands are identified by their command id, the other messages
+ *  by the APML_STATS_CMD_* values below.
+ *  @{
+ */
+
+#define APML_STATS_CMD_CPUID	0x100	//!< CPUID reads
+#define APML_STATS_CMD_MCA_MSR	0x101	//!< MCA MSR reads
+#define APML_STATS_CMD_SBRMI_REG 0x102	//!< SB-RMI register accesses
+#define APML_STATS_CMD_SBTSI_REG 0x103	//!< SB-TSI register accesses
+#define APML_STATS_MAX_CMD	0x104	//!< Number of command slots
+
+/**
+ * @brief Number of latency buckets, bucket i counts the transactions that
+ * took [2^i, 2^(i+1)) ns, the last one also all the longer ones.
+ */
+#define APML_STATS_LAT_BUCKETS	32
+
+/**
+ * @brief Number of error slots, see apml_stats_err_status()
+ */
+#define APML_STATS_ERR_SLOTS	28
+
+/**
+ * @brief Counters of one command on one socket
+ */
+struct apml_cmd_stats {
+	uint64_t calls;			//!< Transactions issued
+	uint64_t errors;		//!< Transactions that failed
+	uint64_t bytes;			//!< Request and response payload bytes
+	uint64_t total_ns;		//!< Time spent in the transport
+	uint64_t retries;		//!< Transactions re-issued by the
+					//!< retry policy, also in calls
+	uint64_t coalesced;		//!< Reads served by an identical
+					//!< read of another caller, not in
+					//!< calls
+	uint64_t cached;		//!< Reads served by the read cache,
+					//!< not in calls
+	uint64_t err_count[APML_STATS_ERR_SLOTS];	//!< Failures by status
+	uint64_t latency[APML_STATS_LAT_BUCKETS];	//!< log2 ns histogram
+};
+
+/**
+ *  @brief Read the counters of a command.
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[in] cmd mailbox command id or APML_STATS_CMD_* value.
+ *
+ *  @param[out] stats counters of @p cmd on @p soc_num.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval ::OOB_INVALID_INPUT @p soc_num or @p cmd is out of range.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_get_stats(uint8_t soc_num, uint32_t cmd,
+			    struct apml_cmd_stats *stats);
+
+/**
+ *  @brief Reset the counters of all the commands of a socket.
+ *
+ *  @details Transactions completing concurrently may be lost or kept.
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval ::OOB_INVALID_INPUT @p soc_num is out of range.
+ *
+ */
+oob_status_t apml_reset_stats(uint8_t soc_num);
+
+/**
+ *  @brief Get the status counted in an error slot.
+ *
+ *  @details Slots up to ::OOB_INVALID_MSGSIZE hold the status of the same
+ *  value, the following ones the known firmware errors. Firmware errors
+ *  without a slot of their own are counted under ::OOB_CPUID_MSR_ERR_START
+ *  and ::OOB_MAILBOX_ERR_START.
+ *
+ *  @param[in] slot index in apml_cmd_stats::err_count.
+ *
+ *  @retval Status counted in @p slot, ::OOB_SUCCESS for slots out of range.
+ *
+ */
+oob_status_t apml_stats_err_status(unsigned int slot);
+
+/** @} */  // end of StatsAccess
+
+/*****************************************************************************/
+
+/*****************************************************************************/
+/** @defgroup HookAccess Transaction hooks
+ *  Callers can observe every transaction issued on a transport through a
+ *  pre and a post hook. Without hooks set a transaction pays a single
+ *  branch. The same points are exposed as the USDT probes apml:xfer__start
+ *  (socket, interface, cmd, data_in) and apml:xfer__done (socket,
+ *  interface, cmd, data_out, fw_ret_code, status, duration in ns) when the
+ *  library is built with sys/sdt.h, the interface being 0 for SB-RMI, 1
+ *  for SB-TSI and -1 for other device files.
+ *  @{
+ */
+
+/**
+ * @brief Transaction passed to the hooks
+ */
+struct apml_xfer_info {
+	uint8_t soc_num;		//!< Socket index
+	char *file_name;		//!< SBRMI, SBTSI or NULL for other
+					//!< device files
+	const struct apml_message *msg;	//!< Request, and in the post hook
+					//!< the response and fw_ret_code
+	oob_status_t status;		//!< Outcome, post hook only
+	uint64_t dur_ns;		//!< Time spent in the transport,
+					//!< post hook only
+};
+
+/**
+ * @brief Hook called around each transaction
+ */
+typedef void (*apml_hook_t)(const struct apml_xfer_info *info, void *ctx);
+
+/**
+ * @brief Hooks set with apml_set_hooks()
+ */
+struct apml_hooks {
+	apml_hook_t pre;	//!< Called before the transaction, may be NULL
+	apml_hook_t post;	//!< Called after the transaction, may be NULL
+	void *ctx;		//!< Passed to both hooks
+};
+
+/**
+ *  @brief Set the hooks called around each transaction.
+ *
+ *  @details The hooks run in the thread issuing the transaction, possibly
+ *  with the device of the socket locked, and must not call back into the
+ *  library.
+ *  @p hooks is referenced, not copied: it must stay valid until it is
+ *  replaced and the transactions that may have seen it have completed.
+ *
+ *  @param[in] hooks hooks to call, NULL to remove them.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *
+ */
+oob_status_t apml_set_hooks(const struct apml_hooks *hooks);
+
+/** @} */  // end of HookAccess
+
+/*****************************************************************************/
+
+/*****************************************************************************/
+/** @defgroup RetryAccess Retry policy
+ *  Transient failures (bus arbitration lost, firmware busy or aborting a
+ *  command) can be retried by the library instead of every caller. A
+ *  policy is set per handle and optionally overridden per command; by
+ *  default no transaction is retried. When a member of a batch fails with
+ *  a status its policy retries, the whole batch is re-issued in order,
+ *  after an exponential backoff with jitter, without holding the device
+ *  lock while waiting. The policy of the first such member decides the
+ *  number of attempts and the backoff. Retries are counted in
+ *  apml_cmd_stats::retries, for every member re-issued.
+ *  @{
+ */
+
+/**
+ * @brief Maximum number of statuses in apml_retry_policy::retry_on
+ */
+#define APML_RETRY_MAX_CODES	8
+
+/**
+ * @brief Retry policy of a handle or of one of its commands
+ */
+struct apml_retry_policy {
+	uint32_t max_attempts;	//!< Attempts including the first one, 0 or
+				//!< 1 for none. 0 in a per-command policy
+				//!< falls back to the policy of the handle
+	uint32_t base_delay_us;	//!< Backoff before the first retry, doubled
+				//!< for each further retry
+	uint32_t max_delay_us;	//!< Upper bound of the backoff, 0 for none
+	uint32_t budget_us;	//!< Bound on the time spent in a call
+				//!< including its retries, 0 for none
+	uint32_t n_retry_on;	//!< Number of statuses in retry_on, 0 to
+				//!< retry on ::OOB_TRY_AGAIN,
+				//!< ::OOB_UNEXPECTED_SIZE,
+				//!< ::OOB_CPUID_MSR_CMD_TIMEOUT and
+				//!< ::OOB_MAILBOX_CMD_ABORTED
+	oob_status_t retry_on[APML_RETRY_MAX_CODES];	//!< Statuses retried
+};
+
+/**
+ *  @brief Set the retry policy of a handle.
+ *
+ *  @details The policy is copied. It must not be changed while other
+ *  threads issue transactions on @p handle.
+ *
+ *  @param[in] handle Handle returned by apml_open().
+ *
+ *  @param[in] policy policy applying to all the commands of @p handle
+ *  without a policy of their own, NULL to disable retries.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval ::OOB_INVALID_INPUT @p policy lists too many statuses.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_set_retry_policy(struct apml_handle *handle,
+				   const struct apml_retry_policy *policy);
+
+/**
+ *  @brief Set the retry policy of one command of a handle.
+ *
+ *  @details Same as apml_set_retry_policy(), for a single command.
+ *
+ *  @param[in] handle Handle returned by apml_open().
+ *
+ *  @param[in] cmd mailbox command id or APML_STATS_CMD_* value.
+ *
+ *  @param[in] policy policy of @p cmd, NULL to fall back to the policy of
+ *  the handle.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval ::OOB_INVALID_INPUT @p cmd is out of range or @p policy lists
+ *  too many statuses.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_set_cmd_retry_policy(struct apml_handle *handle,
+				       uint32_t cmd,
+				       const struct apml_retry_policy *policy);
+
+/** @} */  // end of RetryAccess
+
+/*****************************************************************************/
+
+/*****************************************************************************/
+/** @defgroup DeadlineAccess Deadlines and cancellation
+ *  A deadline set on a handle bounds all the calls made on it, blocking
+ *  or asynchronous. A transaction that cannot start before the deadline,
+ *  including waiting for the device lock, fails with ::OOB_CMD_TIMEOUT
+ *  without reaching the bus, so an operation made of several transactions
+ *  gives up at the first step past the deadline. Retries and the pauses
+ *  between the steps of an operation that would end past the deadline are
+ *  not made either. Each thread needing its own deadline uses its own
+ *  handle.
+ *
+ *  A maximum age set on a handle lets its mailbox telemetry reads (the
+ *  mailbox read commands returning a single value; register, CPUID and
+ *  MCA MSR reads and the RAPL energy counters are read in several parts
+ *  and always issued) be served from the results of the same read, same
+ *  command and same input, issued by any caller of the process on the
+ *  same socket interface at most that long ago. The socket index based
+ *  API uses the maximum age set with apml_set_read_cache_max_age(). The age
+ *  is counted from when the cached read was issued. Any other message
+ *  issued on the interface, a warm reset or a device reopen drops the
+ *  cached results. Results are kept once a maximum age has been used on
+ *  the socket interface.
+ *  @{
+ */
+
+/**
+ * @brief Options applying to the calls made on a handle
+ */
+struct apml_call_opts {
+	uint64_t deadline_ns;	//!< CLOCK_MONOTONIC time in ns after which
+				//!< no transaction is started, 0 for none
+	uint64_t max_age_ns;	//!< Reads are served from the read cache
+				//!< when read at most this many ns ago,
+				//!< 0 to always issue them
+};
+
+/**
+ *  @brief Set the options of the calls made on a handle.
+ *
+ *  @details The options are copied. Asynchronous requests keep the
+ *  options in effect when they were submitted.
+ *
+ *  @param[in] handle Handle returned by apml_open().
+ *
+ *  @param[in] opts options to apply, NULL to clear them.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_set_call_opts(struct apml_handle *handle,
+				const struct apml_call_opts *opts);
+
+/**
+ *  @brief Set the maximum age of the reads of the socket index based API.
+ *
+ *  @details Applies to the calls without a handle, such as read_tdp(),
+ *  as apml_call_opts::max_age_ns does to the calls made on a handle.
+ *
+ *  @param[in] max_age_ns reads are served from the read cache when read
+ *  at most this many ns ago, 0 (the default) to always issue them.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *
+ */
+oob_status_t apml_set_read_cache_max_age(uint64_t max_age_ns);
+
+/**
+ *  @brief Cancel the queued requests of a handle.
+ *
+ *  @details The requests submitted on @p handle that the worker has not
+ *  dispatched yet complete with ::OOB_INTERRUPTED without being issued.
+ *  Their callbacks still run from apml_process_completions().
+ *
+ *  @param[in] handle Handle opened with ::APML_OPEN_ASYNC.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval ::OOB_NOT_INITIALIZED @p handle is not asynchronous.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_cancel(struct apml_handle *handle);
+
+/** @} */  // end of DeadlineAccess
+
+/*****************************************************************************/
+
+/*****************************************************************************/
+/** @defgroup PriorityAccess Priority classes
+ *  The transactions of a socket interface are scheduled in three classes.
+ *  When the bus is released, or when the worker of a socket picks its next
+ *  asynchronous request, the most urgent class waiting goes first, so an
+ *  actuation (e.g. a power cap) does not queue behind a telemetry sweep.
+ *  A class passed over APML_PRIO_AGING consecutive times goes first once,
+ *  which bounds the delay of background sweeps. Priorities apply between
+ *  threads of the calling process and between batches: a batch runs to
+ *  completion once started.
+ *  @{
+ */
+
+/**
+ * @brief Grants to other classes after which a waiting class goes first
+ */
+#define APML_PRIO_AGING		8
+
+/**
+ * @brief Priority class of the transactions of a handle
+ */
+typedef enum {
+	APML_PRIO_CONTROL = 0,	//!< Actuation: power caps, throttling
+	APML_PRIO_INTERACTIVE,	//!< On-demand reads, the default
+	APML_PRIO_BACKGROUND,	//!< Periodic sweeps and dumps
+	APML_PRIO_MAX
+} apml_prio_t;
+
+/**
+ *  @brief Set the priority class of a handle.
+ *
+ *  @details Handles, including the default handles of the socket index
+ *  based API, start in ::APML_PRIO_INTERACTIVE, with their mailbox writes
+ *  in ::APML_PRIO_CONTROL. Once set, the class applies to all the
+ *  transactions of the handle. Asynchronous requests keep the class in
+ *  effect when they were submitted.
+ *
+ *  @param[in] handle Handle returned by apml_open().
+ *
+ *  @param[in] prio class of the subsequent transactions of @p handle.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval ::OOB_INVALID_INPUT @p prio is out of range.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_set_priority(struct apml_handle *handle, apml_prio_t prio);
+
+/** @} */  // end of PriorityAccess
+
+/*****************************************************************************/
+
+/*****************************************************************************/
+/** @defgroup CoalesceAccess Single-flight reads
+ *  When enabled, a read (register, CPUID, MCA MSR or mailbox read command)
+ *  identical to one another thread of the process is waiting to issue on
+ *  the same socket interface, same command and same input, is not issued
+ *  again: the caller waits for that read and gets its result. Only reads
+ *  that have not reached the bus yet are joined, so every caller gets a
+ *  value read after its call started. A caller joins a read of its own
+ *  class or a more urgent one, with a deadline no earlier than its own.
+ *  @{
+ */
+
+/**
+ *  @brief Enable or disable single-flight reads.
+ *
+ *  @details Disabled by default.
+ *
+ *  @param[in] enable true to coalesce identical concurrent reads.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *
+ */
+oob_status_t apml_set_coalescing(bool enable);
+
+/** @} */  // end of CoalesceAccess
+
+/*****************************************************************************/
+/** @defgroup MailboxCapsAccess Mailbox command support
+ *  Older processors answer the newer mailbox commands with
+ *  ::OOB_MAILBOX_CMD_UNKNOWN. The library learns, per socket, which
+ *  commands the firmware recognised and which it reported unknown, from
+ *  the outcome of every mailbox transaction or with apml_probe_mailbox().
+ *  A command reported unknown then fails with ::OOB_MAILBOX_CMD_UNKNOWN
+ *  without a transaction. What was learnt is dropped on a warm reset, and
+ *  kept across processes by apml_set_disk_cache(): a tool run again skips
+ *  the commands its previous runs found unknown, as apml_tool does,
+ *  without issuing them. apml_probe_mailbox() learns the support of all
+ *  the read commands at once.
+ *  @{
+ */
+
+#define APML_MB_MAX_CMD		0x100	//!< Mailbox command ids are below
+
+/**
+ * @brief Support of a mailbox command by the firmware of a socket
+ */
+typedef enum {
+	APML_CMD_UNPROBED = 0,	//!< Not issued successfully yet
+	APML_CMD_SUPPORTED,	//!< Recognised by the firmware
+	APML_CMD_UNSUPPORTED,	//!< Reported unknown by the firmware
+} apml_cmd_support_t;
+
+/**
+ * @brief Bitmaps of the mailbox commands of a socket, bit n of word n / 32
+ * for command id n
+ */
+struct apml_mailbox_caps {
+	uint32_t supported[APML_MB_MAX_CMD / 32];	//!< Recognised
+	uint32_t unsupported[APML_MB_MAX_CMD / 32];	//!< Reported unknown
+};
+
+/**
+ *  @brief Get the support of a mailbox command.
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[in] cmd mailbox command id.
+ *
+ *  @param[out] support what is known of @p cmd on @p soc_num.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval ::OOB_INVALID_INPUT @p soc_num or @p cmd is out of range.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_get_mailbox_support(uint8_t soc_num, uint32_t cmd,
+				      apml_cmd_support_t *support);
+
+/**
+ *  @brief Get the bitmaps of the mailbox commands of a socket.
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[out] caps commands known recognised and known unknown.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval ::OOB_INVALID_INPUT @p soc_num is out of range.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_get_mailbox_caps(uint8_t soc_num,
+				   struct apml_mailbox_caps *caps);
+
+/**
+ *  @brief Probe the mailbox read commands of a socket.
+ *
+ *  @details Issues once, with input 0, each mailbox read command whose
+ *  support is not known yet. Write commands are never probed, their
+ *  support is learnt when they are first issued.
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval ::OOB_INVALID_INPUT @p soc_num is out of range.
+ *  @retval Non-zero status of the first probe failing other than with a
+ *  mailbox error, the probe stops there.
+ *
+ */
+oob_status_t apml_probe_mailbox(uint8_t soc_num);
+
+/** @} */  // end of MailboxCapsAccess
+
+/*****************************************************************************/
+/** @defgroup AsyncAccess Asynchronous submission and socket fan-out
+ *  A handle opened with ::APML_OPEN_ASYNC can queue messages without
+ *  blocking. Each socket has a worker thread, started with the first such
+ *  handle of the socket, which issues the queued messages on the bus of the
+ *  socket one at a time. It keeps one FIFO per priority class and picks
+ *  from them as described in @ref PriorityAccess, so a control write
+ *  overtakes the reads queued before it; messages of the same class are
+ *  issued in submission order. Completions are signalled on an eventfd
+ *  that an event loop can poll, and dispatched by
+ *  apml_process_completions().
+ *
+ *  apml_for_each_socket() runs the same set of calls on all the sockets in
+ *  parallel, one thread per socket bus.
+ *  @{
+ */
+
+/**
+ *  @brief Queue a message for asynchronous transfer
+ *
+ *  @details The message is placed on the lock-free submission queue of the
+ *  socket and the call returns immediately. @p msg must stay valid until
+ *  @p callback is invoked with it.
+ *
+ *  @param[in] handle Handle opened with ::APML_OPEN_ASYNC.
+ *
+ *  @param[in] file_name Character device file name for RMI/TSI I/F
+ *
+ *  @param[inout] msg struct apml_message to transfer.
+ *
+ *  @param[in] callback function invoked with the result.
+ *
+ *  @param[in] ctx opaque pointer passed to @p callback.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval ::OOB_NOT_INITIALIZED the handle was not opened with
+ *  ::APML_OPEN_ASYNC.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_submit(struct apml_handle *handle, char *file_name,
+			 struct apml_message *msg, apml_callback_t callback,
+			 void *ctx);
+
+/**
+ *  @brief Get the completion eventfd of a handle
+ *
+ *  @details The descriptor becomes readable when submitted messages have
+ *  completed. It is owned by the handle and closed by apml_close().
+ *
+ *  @param[in] handle Handle opened with ::APML_OPEN_ASYNC.
+ *
+ *  @param[out] fd non-blocking eventfd to poll for POLLIN.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_get_event_fd(struct apml_handle *handle, int *fd);
+
+/**
+ *  @brief Dispatch the completed messages of a handle
+ *
+ *  @details Clears the eventfd and invokes the callbacks of all the
+ *  messages completed so far, in completion order, on the calling thread.
+ *  Messages of different priority classes may complete in another order
+ *  than they were submitted in.
+ *  Only one thread may process the completions of a handle at a time.
+ *  Messages still outstanding when the handle is closed are waited for and
+ *  dispatched by apml_close().
+ *
+ *  @param[in] handle Handle opened with ::APML_OPEN_ASYNC.
+ *
+ *  @param[out] count number of callbacks invoked, may be NULL.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_process_completions(struct apml_handle *handle,
+				      unsigned int *count);
+
+/**
+ *  @brief Per socket function run by apml_for_each_socket()
+ *
+ *  @details @p handle is the default handle of the socket, @p result its
+ *  slot in the results array and @p arg the argument given to
+ *  apml_for_each_socket().
+ */
+typedef oob_status_t (*apml_socket_fn_t)(struct apml_handle *handle,
+					 void *result, void *arg);
+
+/**
+ *  @brief Run a function on all the sockets in parallel
+ *
+ *  @details Each socket sits on its own APML bus, so the same set of reads
+ *  can be issued on all of them at once instead of one socket after the
+ *  other. @p fn runs once per socket 0 to @p num_sockets - 1, each on its
+ *  own thread, and the call returns when all of them are done. A socket
+ *  whose thread cannot be created is run on the calling thread.
+ *
+ *  For example, a telemetry sweep filling one struct per socket:
+ *  @code
+ *  static oob_status_t sweep(struct apml_handle *h, void *res, void *arg)
+ *  {
+ *	struct telemetry *t = res;
+ *	oob_status_t ret;
+ *
+ *	ret = read_socket_power_h(h, &t->power);
+ *	if (ret)
+ *		return ret;
+ *	return read_tdp_h(h, &t->tdp);
+ *  }
+ *
+ *  struct telemetry t[2];
+ *  apml_for_each_socket(2, sweep, NULL, t, sizeof(t[0]), NULL);
+ *  @endcode
+ *
+ *  @param[in] num_sockets number of sockets to run @p fn on.
+ *
+ *  @param[in] fn function to run per socket.
+ *
+ *  @param[in] arg argument passed to every invocation of @p fn.
+ *
+ *  @param[out] results array of @p num_sockets results of @p result_size
+ *  bytes each, indexed by socket. May be NULL.
+ *
+ *  @param[in] result_size size of one element of @p results.
+ *
+ *  @param[out] status array of @p num_sockets statuses returned by @p fn,
+ *  indexed by socket. May be NULL.
+ *
+ *  @retval ::OOB_SUCCESS is returned when @p fn succeeded on all sockets.
+ *  @retval Non-zero status of the lowest failing socket otherwise.
+ *
+ */
+oob_status_t apml_for_each_socket(uint8_t num_sockets, apml_socket_fn_t fn,
+				  void *arg, void *results, size_t result_size,
+				  oob_status_t *status);
+
+/** @} */  // end of AsyncAccess
+/*****************************************************************************/
+
 /**
  *  @brief Reads data for the given register.
  *
@@ -189,4 +1162,66 @@ oob_status_t esmi_oob_write_mailbox(uint8_t soc_num,
 oob_status_t sbrmi_xfer_msg(uint8_t soc_num, char *file_name,
 			    struct apml_message *msg);
 
+/**
+ *  @brief Transfer a vector of messages to a device file
+ *
+ *  @details This function issues the messages @p msgs[0] to @p msgs[n - 1]
+ *  in order, under a single open of the character device and a single
+ *  acquisition of its lock. Unlike a sequence of sbrmi_xfer_msg() calls
+ *  the transfer does not stop at the first failing message, the status of
+ *  every message is reported in @p status.
+ *
+ *  @param[in] handle Handle returned by apml_open().
+ *
+ *  @param[in] file_name Character device file name for RMI/TSI I/F
+ *
+ *  @param[inout] msgs array of struct apml_message, the output data of each
+ *  message is updated in place.
+ *
+ *  @param[in] n number of messages in @p msgs.
+ *
+ *  @param[out] status array of @p n statuses, one per message. May be NULL
+ *  when @p n is 1.
+ *
+ *  @retval ::OOB_SUCCESS is returned when all the messages succeeded.
+ *  @retval Non-zero status of the first failing message otherwise.
+ *
+ */
+oob_status_t apml_xfer_batch(struct apml_handle *handle, char *file_name,
+			     struct apml_message *msgs, size_t n,
+			     oob_status_t *status);
+
+/**
+ *  @brief Handle based variant of esmi_oob_read_byte().
+ */
+oob_status_t esmi_oob_read_byte_h(struct apml_handle *handle,
+				  uint8_t reg_offset,
+				  char *file_name, uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of esmi_oob_write_byte().
+ */
+oob_status_t esmi_oob_write_byte_h(struct apml_handle *handle,
+				   uint8_t reg_offset,
+				   char *file_name, uint8_t value);
+
+/**
+ *  @brief Handle based variant of esmi_oob_read_mailbox().
+ */
+oob_status_t esmi_oob_read_mailbox_h(struct apml_handle *handle,
+				     uint32_t cmd, uint32_t input,
+				     uint32_t *buffer);
+
+/**
+ *  @brief Handle based variant of esmi_oob_write_mailbox().
+ */
+oob_status_t esmi_oob_write_mailbox_h(struct apml_handle *handle,
+				      uint32_t cmd, uint32_t data);
+
+/**
+ *  @brief Handle based variant of sbrmi_xfer_msg().
+ */
+oob_status_t sbrmi_xfer_msg_h(struct apml_handle *handle, char *file_name,
+			      struct apml_message *msg);
+
 #endif  // INCLUDE_APML_H_
@@ -0,0 +1,238 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+#ifndef INCLUDE_APML_EMUL_H_
+#define INCLUDE_APML_EMUL_H_
+
+#include <stdint.h>
+
+#include "apml_err.h"
+
+/** \file apml_emul.h
+ *  Header file for the in-process APML device emulator.
+ *
+ *  @details The emulator models the SB-RMI and SB-TSI devices of
+ *  ::APML_MAX_SOCKETS sockets without any hardware: the SB-RMI register
+ *  file in its revision 0x10 or 0x20 layout, the SB-TSI register file,
+ *  the mailbox commands of ::esb_mailbox_commmands, and CPUID and MCA MSR
+ *  responders. It is selected per interface as a transport backend:
+ *  @code
+ *  apml_set_transport(SBRMI, APML_TRANSPORT_EMUL);
+ *  apml_set_transport(SBTSI, APML_TRANSPORT_EMUL);
+ *  @endcode
+ *  The defaults describe a 96 core, 192 thread family 19h processor.
+ *  Every command can be given a latency range, so the throughput of the
+ *  library can be measured without hardware.
+ */
+
+/*****************************************************************************/
+/** @defgroup EmulatorConfig APML device emulator configuration
+ *  Below functions configure the state of the emulated devices. The @p cmd
+ *  of a command is the mailbox command, or APML_CPUID, APML_MCA_MSR or
+ *  APML_REG for the other protocols.
+ *  Changing the registers, mailbox or CPUID state of an emulated socket
+ *  drops the values the library cached for the socket, such as its SB-RMI
+ *  revision.
+ *  @{
+ */
+
+/**
+ *  @brief Reset the emulated devices and latencies to their defaults.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *
+ */
+oob_status_t apml_emul_reset(void);
+
+/**
+ *  @brief Select the SB-RMI register layout of a socket.
+ *
+ *  @details Reinitialises the SB-RMI register file of the socket in the
+ *  layout of the given APML revision.
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[in] revision 0x10 or 0x20.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_emul_set_rmi_revision(uint8_t soc_num, uint8_t revision);
+
+/**
+ *  @brief Set an emulated register.
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[in] file_name ::SBRMI or ::SBTSI.
+ *
+ *  @param[in] reg register offset.
+ *
+ *  @param[in] value register value.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_emul_set_reg(uint8_t soc_num, char *file_name,
+			       uint8_t reg, uint8_t value);
+
+/**
+ *  @brief Get an emulated register.
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[in] file_name ::SBRMI or ::SBTSI.
+ *
+ *  @param[in] reg register offset.
+ *
+ *  @param[out] value register value.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_emul_get_reg(uint8_t soc_num, char *file_name,
+			       uint8_t reg, uint8_t *value);
+
+/**
+ *  @brief Set the response of a mailbox command.
+ *
+ *  @details Write commands update the response of their read counterpart,
+ *  e.g. WRITE_PACKAGE_POWER_LIMIT that of READ_PACKAGE_POWER_LIMIT. The
+ *  RAPL energy counters are not affected, they advance with time.
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[in] cmd mailbox command.
+ *
+ *  @param[in] value response placed in the output of the command.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_emul_set_mailbox(uint8_t soc_num, uint32_t cmd,
+				   uint32_t value);
+
+/**
+ *  @brief Set the response of a CPUID function.
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[in] fn_eax cpuid function.
+ *
+ *  @param[in] fn_ecx cpuid extended function, 0 to 15.
+ *
+ *  @param[in] eax eax value returned.
+ *
+ *  @param[in] ebx ebx value returned.
+ *
+ *  @param[in] ecx ecx value returned.
+ *
+ *  @param[in] edx edx value returned.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_emul_set_cpuid(uint8_t soc_num, uint32_t fn_eax,
+				 uint32_t fn_ecx, uint32_t eax, uint32_t ebx,
+				 uint32_t ecx, uint32_t edx);
+
+/**
+ *  @brief Set the value of an MCA MSR.
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[in] msraddr MCA MSR address.
+ *
+ *  @param[in] value value returned for all threads.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_emul_set_msr(uint8_t soc_num, uint32_t msraddr,
+			       uint64_t value);
+
+/**
+ *  @brief Set the latency of a command.
+ *
+ *  @details Each transaction of @p cmd on any socket takes a time drawn
+ *  uniformly from [@p min_ns, @p max_ns]. Both 0, the default, completes
+ *  immediately.
+ *
+ *  @param[in] cmd command.
+ *
+ *  @param[in] min_ns minimum latency in nanoseconds.
+ *
+ *  @param[in] max_ns maximum latency in nanoseconds.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_emul_set_latency(uint32_t cmd, uint32_t min_ns,
+				   uint32_t max_ns);
+
+/**
+ *  @brief Make a command fail with a firmware error.
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[in] cmd command.
+ *
+ *  @param[in] fw_ret_code firmware return code reported for @p cmd, 0 to
+ *  make it succeed again.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ *
+ */
+oob_status_t apml_emul_set_fw_error(uint8_t soc_num, uint32_t cmd,
+				    uint8_t fw_ret_code);
+
+/** @} */  // end of EmulatorConfig
+/*****************************************************************************/
+
+#endif  // INCLUDE_APML_EMUL_H_
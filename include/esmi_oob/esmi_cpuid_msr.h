@@ -41,8 +41,12 @@
 #ifndef INCLUDE_APML_CPUID_MSR_H_
 #define INCLUDE_APML_CPUID_MSR_H_
 
+#include <stdbool.h>
+
 #include "apml_err.h"
 
+struct apml_handle;
+
 /** \file esmi_cpuid_msr.h
  *  Header file for the APML library cpuid and msr read functions.
  *  All required function, structure, enum and protocol specific data etc.
@@ -76,14 +80,24 @@ struct processor_info {
 };
 
 /**
- * @brief Platform Info instance
+ * @brief Static facts of the processor of a socket
  */
-extern struct processor_info plat_info[1];
+struct processor_static_info {
+	struct processor_info info;	//!< Family, model and stepping
+	uint32_t threads_per_socket;	//!< Threads in the socket
+	uint32_t threads_per_core;	//!< Threads per core
+	uint32_t logical_cores_per_socket;	//!< Logical cores in the socket
+	char vendor_id[13];		//!< Vendor string, NUL terminated
+};
 
 /** @defgroup PROCESSOR_INFO using CPUID Register Access
  *  Below function provide interface to read the processor info using
  *  CPUID register.
  *  output from commmand will be written into the buffer.
+ *  The values do not change while the system runs: each is read once per
+ *  socket and served without bus transactions afterwards, until a warm
+ *  reset is reported, the device node is reopened or
+ *  apml_invalidate_socket_cache() is called.
  *  @{
  */
 
@@ -161,6 +175,21 @@ oob_status_t esmi_get_threads_per_socket(uint8_t soc_num,
 oob_status_t esmi_get_threads_per_core(uint8_t soc_num,
 				       uint32_t *threads_per_core);
 
+/**
+ *  @brief Get the static facts of the processor of a socket.
+ *
+ *  @details Get the family, model, stepping, thread and core counts and
+ *  the vendor string at once.
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[out] info static facts of the processor.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval None-zero is returned upon failure.
+ */
+oob_status_t esmi_get_processor_static_info(uint8_t soc_num,
+					    struct processor_static_info *info);
 
 /** @} */  // end of PROCESSOR_INFO
 
@@ -325,8 +354,117 @@ oob_status_t esmi_oob_cpuid_edx(uint8_t soc_num,
 				uint32_t thread, uint32_t fn_eax,
 				uint32_t fn_ecx, uint32_t *edx);
 
+/**
+ *  @brief Cache CPUID results per socket and thread.
+ *
+ *  @details Each CPUID transaction returns two registers, EAX and EBX or
+ *  ECX and EDX, so esmi_oob_cpuid() takes two transactions. When enabled,
+ *  the results are also kept per socket, thread, function and extended
+ *  function, and served without bus transactions until a warm reset is
+ *  reported, the device node is reopened or apml_invalidate_socket_cache()
+ *  is called. Only enable it when the leaves read are static, which holds
+ *  for the topology and identification leaves. Disabled by default.
+ *
+ *  @param[in] enable true to cache the CPUID results.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *
+ */
+oob_status_t apml_set_cpuid_cache(bool enable);
+
 /** @} */  // end of cpuidAccess
 
 /*****************************************************************************/
+/*****************************************************************************/
+/** @defgroup CpuidMsrAccessHandle CPUID and MSR access (handle based)
+ *  Variants of the functions above taking a handle returned by apml_open()
+ *  instead of the socket index. Arguments and return values are the same
+ *  as those of the socket index based function.
+ *  @{
+ */
+
+/**
+ *  @brief Handle based variant of esmi_get_vendor_id().
+ */
+oob_status_t esmi_get_vendor_id_h(struct apml_handle *handle,
+				  char *vendor_id);
+
+/**
+ *  @brief Handle based variant of esmi_get_processor_info().
+ */
+oob_status_t esmi_get_processor_info_h(struct apml_handle *handle,
+				       struct processor_info *proc_info);
+
+/**
+ *  @brief Handle based variant of esmi_get_threads_per_socket().
+ */
+oob_status_t esmi_get_threads_per_socket_h(struct apml_handle *handle,
+					   uint32_t *threads_per_socket);
+
+/**
+ *  @brief Handle based variant of esmi_get_threads_per_core().
+ */
+oob_status_t esmi_get_threads_per_core_h(struct apml_handle *handle,
+					 uint32_t *threads_per_core);
+
+/**
+ *  @brief Handle based variant of esmi_get_logical_cores_per_socket().
+ */
+oob_status_t
+esmi_get_logical_cores_per_socket_h(struct apml_handle *handle,
+				    uint32_t *logical_cores_per_socket);
+
+/**
+ *  @brief Handle based variant of esmi_get_processor_static_info().
+ */
+oob_status_t
+esmi_get_processor_static_info_h(struct apml_handle *handle,
+				 struct processor_static_info *info);
+
+/**
+ *  @brief Handle based variant of esmi_oob_read_msr().
+ */
+oob_status_t esmi_oob_read_msr_h(struct apml_handle *handle,
+				 uint32_t thread, uint32_t msraddr,
+				 uint64_t *buffer);
+
+/**
+ *  @brief Handle based variant of esmi_oob_cpuid().
+ */
+oob_status_t esmi_oob_cpuid_h(struct apml_handle *handle, uint32_t thread,
+			      uint32_t *eax, uint32_t *ebx,
+			      uint32_t *ecx, uint32_t *edx);
+
+/**
+ *  @brief Handle based variant of esmi_oob_cpuid_eax().
+ */
+oob_status_t esmi_oob_cpuid_eax_h(struct apml_handle *handle,
+				  uint32_t thread, uint32_t fn_eax,
+				  uint32_t fn_ecx, uint32_t *eax);
+
+/**
+ *  @brief Handle based variant of esmi_oob_cpuid_ebx().
+ */
+oob_status_t esmi_oob_cpuid_ebx_h(struct apml_handle *handle,
+				  uint32_t thread, uint32_t fn_eax,
+				  uint32_t fn_ecx, uint32_t *ebx);
+
+/**
+ *  @brief Handle based variant of esmi_oob_cpuid_ecx().
+ */
+oob_status_t esmi_oob_cpuid_ecx_h(struct apml_handle *handle,
+				  uint32_t thread, uint32_t fn_eax,
+				  uint32_t fn_ecx, uint32_t *ecx);
+
+/**
+ *  @brief Handle based variant of esmi_oob_cpuid_edx().
+ */
+oob_status_t esmi_oob_cpuid_edx_h(struct apml_handle *handle,
+				  uint32_t thread, uint32_t fn_eax,
+				  uint32_t fn_ecx, uint32_t *edx);
+
+/** @} */  // end of CpuidMsrAccessHandle
+/*****************************************************************************/
+
 #endif  // INCLUDE_APML_CPUID_MSR_H_
 
@@ -44,6 +44,8 @@
 #include "apml_err.h"
 #include "stdbool.h"
 
+struct apml_handle;
+
 #define BIT(N) (1 << N)		//!< Perform left shift operation by N bits //
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0])) //!< Returns the array size //
 
@@ -247,6 +249,25 @@ struct pstate_freq {
 	uint8_t uclk : 1;	//!< UMC clock divider (1 bit data)
 };
 
+/**
+ * @brief Raw RAPL energy counter. The energy is counter / 2^esu Joules.
+ */
+struct rapl_energy {
+	uint64_t counter;	//!< 64-bit energy counter
+	uint8_t esu;		//!< Energy status unit, see read_bmc_rapl_units()
+};
+
+/**
+ * @brief Sample of a RAPL core energy counter taken by
+ * read_rapl_core_energy_all().
+ */
+struct rapl_core_energy {
+	uint64_t counter;	//!< 64-bit energy counter, counter / 2^esu J
+	uint64_t timestamp_ns;	//!< CLOCK_MONOTONIC time of the sample
+	uint32_t core_id;	//!< Core id
+	oob_status_t status;	//!< Status of the read, counter valid if 0
+};
+
 /**
  * @brief frequency limit source names
  */
@@ -261,13 +282,6 @@ static char * const freqlimitsrcnames[] = {
 	"HSMP Agent"
 };
 
-/**
- * @brief energy status multiplier
- * value is 1/2^ESU where ESU is
- * [12:8] bit of the mailbox command 0x55h.
- */
-extern float esu_multiplier;
-
 /*****************************************************************************/
 
 /** @defgroup MailboxMsg SB-RMI Mailbox Service
@@ -1177,6 +1191,7 @@ oob_status_t write_lclk_dpm_level_range(uint8_t soc_num,
  *  @details This function returns the RAPL (Running Average Power Limit)
  *  Units. Energy information (in Joules) is based on the multiplier: 1/(2^ESU).
  *  Time information (in Seconds) is based on the multiplier: 1/(2^TU).
+ *  The units are read once per socket and served from the socket after.
  *
  *  @param[in] soc_num Socket index.
  *
@@ -1267,6 +1282,126 @@ oob_status_t read_rapl_core_energy_counters(uint8_t soc_num,
 oob_status_t read_rapl_pckg_energy_counters(uint8_t soc_num,
 					    double *energy_counters);
 
+/**
+ *  @brief Read the raw RAPL core energy counter.
+ *
+ *  @details Integer variant of read_rapl_core_energy_counters(): returns
+ *  the 64-bit counter and its unit, see rapl_energy_to_uj().
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[in] core_id core id.
+ *
+ *  @param[out] energy counter and energy status unit.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval None-zero is returned upon failure.
+ *
+ */
+oob_status_t read_rapl_core_energy_raw(uint8_t soc_num, uint32_t core_id,
+				       struct rapl_energy *energy);
+
+/**
+ *  @brief Read the raw RAPL package energy counter.
+ *
+ *  @details Integer variant of read_rapl_pckg_energy_counters(): returns
+ *  the 64-bit counter and its unit, see rapl_energy_to_uj().
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[out] energy counter and energy status unit.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval None-zero is returned upon failure.
+ *
+ */
+oob_status_t read_rapl_pckg_energy_raw(uint8_t soc_num,
+				       struct rapl_energy *energy);
+
+/**
+ *  @brief Read the raw RAPL energy counters of all the enabled cores.
+ *
+ *  @details One sweep over the cores whose first thread is enabled in
+ *  the SB-RMI thread enable status registers. The high, low and high
+ *  halves of a counter are read back to back in one vector of messages;
+ *  when the high half moved in between, the low and high halves are read
+ *  again until they agree. Each sample is tagged with the CLOCK_MONOTONIC
+ *  time at which its counter was read, to compute per-core power from two
+ *  sweeps. A core failing does not stop the sweep, see
+ *  rapl_core_energy::status.
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[out] energy array of @p max_cores samples, filled in core order.
+ *
+ *  @param[in] max_cores number of elements of @p energy.
+ *
+ *  @param[out] num_cores number of enabled cores, i.e. of samples taken.
+ *
+ *  @param[out] esu energy status unit of the counters, see
+ *  rapl_energy_to_uj().
+ *
+ *  @retval ::OOB_SUCCESS is returned when all the cores were read.
+ *  @retval ::OOB_INVALID_INPUT @p max_cores is below @p num_cores, nothing
+ *  is read.
+ *  @retval ::OOB_UNEXPECTED_SIZE the processor reported no core.
+ *  @retval ::OOB_TRY_AGAIN the counter of a core kept moving.
+ *  @retval Non-zero status of the first failing core otherwise.
+ *
+ */
+oob_status_t read_rapl_core_energy_all(uint8_t soc_num,
+				       struct rapl_core_energy *energy,
+				       uint32_t max_cores, uint32_t *num_cores,
+				       uint8_t *esu);
+
+/**
+ *  @brief Convert a raw RAPL energy counter to microjoules.
+ *
+ *  @details Exact integer conversion, floor(counter * 10^6 / 2^esu),
+ *  without floating point. The result wraps like the counter, after
+ *  2^64 uJ.
+ *
+ *  @param[in] energy counter and energy status unit.
+ *
+ *  @param[out] energy_uj energy in microjoules.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval ::OOB_INVALID_INPUT the energy status unit is out of range.
+ *  @retval None-zero is returned upon failure.
+ *
+ */
+oob_status_t rapl_energy_to_uj(const struct rapl_energy *energy,
+			       uint64_t *energy_uj);
+
+/**
+ *  @brief Read the RAPL core energy counter in microjoules.
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[in] core_id core id.
+ *
+ *  @param[out] energy_uj core energy in microjoules.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval None-zero is returned upon failure.
+ *
+ */
+oob_status_t read_rapl_core_energy_uj(uint8_t soc_num, uint32_t core_id,
+				      uint64_t *energy_uj);
+
+/**
+ *  @brief Read the RAPL package energy counter in microjoules.
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[out] energy_uj package energy in microjoules.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval None-zero is returned upon failure.
+ *
+ */
+oob_status_t read_rapl_pckg_energy_uj(uint8_t soc_num, uint64_t *energy_uj);
+
 /**
  *  @brief Read RAS last transaction address.
  *
@@ -1347,4 +1482,362 @@ oob_status_t read_lclk_dpm_level_range(uint8_t soc_num,
 /** @} */  // end of MailboxMsg
 /****************************************************************************/
 
+/*****************************************************************************/
+/** @defgroup MailboxMsgHandle Mailbox messages (handle based)
+ *  Variants of the functions above taking a handle returned by apml_open()
+ *  instead of the socket index. Arguments and return values are the same
+ *  as those of the socket index based function.
+ *  @{
+ */
+
+/**
+ *  @brief Handle based variant of read_socket_power().
+ */
+oob_status_t read_socket_power_h(struct apml_handle *handle, uint32_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_socket_power_limit().
+ */
+oob_status_t read_socket_power_limit_h(struct apml_handle *handle,
+				       uint32_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_max_socket_power_limit().
+ */
+oob_status_t read_max_socket_power_limit_h(struct apml_handle *handle,
+					   uint32_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_tdp().
+ */
+oob_status_t read_tdp_h(struct apml_handle *handle, uint32_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_max_tdp().
+ */
+oob_status_t read_max_tdp_h(struct apml_handle *handle, uint32_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_min_tdp().
+ */
+oob_status_t read_min_tdp_h(struct apml_handle *handle, uint32_t *buffer);
+
+/**
+ *  @brief Handle based variant of write_socket_power_limit().
+ */
+oob_status_t write_socket_power_limit_h(struct apml_handle *handle,
+					uint32_t limit);
+
+/**
+ *  @brief Handle based variant of read_bios_boost_fmax().
+ */
+oob_status_t read_bios_boost_fmax_h(struct apml_handle *handle,
+				    uint32_t value, uint32_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_esb_boost_limit().
+ */
+oob_status_t read_esb_boost_limit_h(struct apml_handle *handle,
+				    uint32_t value, uint32_t *buffer);
+
+/**
+ *  @brief Handle based variant of write_esb_boost_limit().
+ */
+oob_status_t write_esb_boost_limit_h(struct apml_handle *handle,
+				     uint32_t cpu_ind, uint32_t limit);
+
+/**
+ *  @brief Handle based variant of write_esb_boost_limit_allcores().
+ */
+oob_status_t write_esb_boost_limit_allcores_h(struct apml_handle *handle,
+					      uint32_t limit);
+
+/**
+ *  @brief Handle based variant of read_dram_throttle().
+ */
+oob_status_t read_dram_throttle_h(struct apml_handle *handle, uint32_t *buffer);
+
+/**
+ *  @brief Handle based variant of write_dram_throttle().
+ */
+oob_status_t write_dram_throttle_h(struct apml_handle *handle, uint32_t limit);
+
+/**
+ *  @brief Handle based variant of read_prochot_status().
+ */
+oob_status_t read_prochot_status_h(struct apml_handle *handle, uint32_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_prochot_residency().
+ */
+oob_status_t read_prochot_residency_h(struct apml_handle *handle, float *buffer);
+
+/**
+ *  @brief Handle based variant of read_nbio_error_logging_register().
+ */
+oob_status_t
+read_nbio_error_logging_register_h(struct apml_handle *handle,
+				   struct nbio_err_log nbio,
+				   uint32_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_iod_bist().
+ */
+oob_status_t read_iod_bist_h(struct apml_handle *handle, uint32_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_ccd_bist_result().
+ */
+oob_status_t read_ccd_bist_result_h(struct apml_handle *handle,
+				    uint32_t input, uint32_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_ccx_bist_result().
+ */
+oob_status_t read_ccx_bist_result_h(struct apml_handle *handle,
+				    uint32_t value, uint32_t *ccx_bist);
+
+/**
+ *  @brief Handle based variant of read_ddr_bandwidth().
+ */
+oob_status_t read_ddr_bandwidth_h(struct apml_handle *handle,
+				  struct max_ddr_bw *max_ddr);
+
+/**
+ *  @brief Handle based variant of write_bmc_report_dimm_power().
+ */
+oob_status_t write_bmc_report_dimm_power_h(struct apml_handle *handle,
+					   struct dimm_power dp_info);
+
+/**
+ *  @brief Handle based variant of write_bmc_report_dimm_thermal_sensor().
+ */
+oob_status_t write_bmc_report_dimm_thermal_sensor_h(struct apml_handle *handle,
+						    struct dimm_thermal dt_info);
+
+/**
+ *  @brief Handle based variant of read_bmc_ras_pcie_config_access().
+ */
+oob_status_t read_bmc_ras_pcie_config_access_h(struct apml_handle *handle,
+					       struct pci_address pci_addr,
+					       uint32_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_bmc_ras_mca_validity_check().
+ */
+oob_status_t read_bmc_ras_mca_validity_check_h(struct apml_handle *handle,
+					       uint16_t *bytes_per_mca,
+					       uint16_t *mca_banks);
+
+/**
+ *  @brief Handle based variant of read_bmc_ras_mca_msr_dump().
+ */
+oob_status_t read_bmc_ras_mca_msr_dump_h(struct apml_handle *handle,
+					 struct mca_bank mca_dump,
+					 uint32_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_bmc_ras_fch_reset_reason().
+ */
+oob_status_t read_bmc_ras_fch_reset_reason_h(struct apml_handle *handle,
+					     uint32_t input,
+					     uint32_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_dimm_temp_range_and_refresh_rate().
+ */
+oob_status_t
+read_dimm_temp_range_and_refresh_rate_h(struct apml_handle *handle,
+					uint32_t dimm_addr,
+					struct temp_refresh_rate *rate);
+
+/**
+ *  @brief Handle based variant of read_dimm_power_consumption().
+ */
+oob_status_t read_dimm_power_consumption_h(struct apml_handle *handle,
+					   uint32_t dimm_addr,
+					   struct dimm_power *dimm_pow);
+
+/**
+ *  @brief Handle based variant of read_dimm_thermal_sensor().
+ */
+oob_status_t read_dimm_thermal_sensor_h(struct apml_handle *handle,
+					uint32_t dimm_addr,
+					struct dimm_thermal *dimm_temp);
+
+/**
+ *  @brief Handle based variant of read_pwr_current_active_freq_limit_socket().
+ */
+oob_status_t
+read_pwr_current_active_freq_limit_socket_h(struct apml_handle *handle,
+					    uint16_t *freq, char **source_type);
+
+/**
+ *  @brief Handle based variant of read_pwr_current_active_freq_limit_core().
+ */
+oob_status_t
+read_pwr_current_active_freq_limit_core_h(struct apml_handle *handle,
+					  uint32_t core_id, uint16_t *base_freq);
+
+/**
+ *  @brief Handle based variant of read_pwr_svi_telemetry_all_rails().
+ */
+oob_status_t read_pwr_svi_telemetry_all_rails_h(struct apml_handle *handle,
+						uint32_t *power);
+
+/**
+ *  @brief Handle based variant of read_socket_freq_range().
+ */
+oob_status_t read_socket_freq_range_h(struct apml_handle *handle,
+				      uint16_t *fmax,
+				      uint16_t *fmin);
+
+/**
+ *  @brief Handle based variant of read_current_io_bandwidth().
+ */
+oob_status_t read_current_io_bandwidth_h(struct apml_handle *handle,
+					 struct link_id_bw_type link,
+					 uint32_t *io_bw);
+
+/**
+ *  @brief Handle based variant of read_current_xgmi_bandwidth().
+ */
+oob_status_t read_current_xgmi_bandwidth_h(struct apml_handle *handle,
+					   struct link_id_bw_type link,
+					   uint32_t *xgmi_bw);
+
+/**
+ *  @brief Handle based variant of write_gmi3_link_width_range().
+ */
+oob_status_t write_gmi3_link_width_range_h(struct apml_handle *handle,
+					   uint8_t min_link_width,
+					   uint8_t max_link_width);
+
+/**
+ *  @brief Handle based variant of write_xgmi_link_width_range().
+ */
+oob_status_t write_xgmi_link_width_range_h(struct apml_handle *handle,
+					   uint8_t min_link_width,
+					   uint8_t max_link_width);
+
+/**
+ *  @brief Handle based variant of write_apb_disable().
+ */
+oob_status_t write_apb_disable_h(struct apml_handle *handle, uint8_t df_pstate,
+				 bool *prochot_asserted);
+
+/**
+ *  @brief Handle based variant of write_apb_enable().
+ */
+oob_status_t write_apb_enable_h(struct apml_handle *handle,
+				bool *prochot_asserted);
+
+/**
+ *  @brief Handle based variant of read_current_dfpstate_frequency().
+ */
+oob_status_t read_current_dfpstate_frequency_h(struct apml_handle *handle,
+					       struct pstate_freq *df_pstate);
+
+/**
+ *  @brief Handle based variant of write_lclk_dpm_level_range().
+ */
+oob_status_t write_lclk_dpm_level_range_h(struct apml_handle *handle,
+					  struct lclk_dpm_level_range lclk);
+
+/**
+ *  @brief Handle based variant of read_bmc_rapl_units().
+ */
+oob_status_t read_bmc_rapl_units_h(struct apml_handle *handle,
+				   uint8_t *tu_value,
+				   uint8_t *esu_value);
+
+/**
+ *  @brief Handle based variant of read_bmc_cpu_base_frequency().
+ */
+oob_status_t read_bmc_cpu_base_frequency_h(struct apml_handle *handle,
+					   uint16_t *base_freq);
+
+/**
+ *  @brief Handle based variant of read_bmc_control_pcie_gen5_rate().
+ */
+oob_status_t read_bmc_control_pcie_gen5_rate_h(struct apml_handle *handle,
+					       uint8_t rate,
+					       uint8_t *mode);
+
+/**
+ *  @brief Handle based variant of write_pwr_efficiency_mode().
+ */
+oob_status_t write_pwr_efficiency_mode_h(struct apml_handle *handle,
+					 uint8_t mode);
+
+/**
+ *  @brief Handle based variant of write_df_pstate_range().
+ */
+oob_status_t write_df_pstate_range_h(struct apml_handle *handle,
+				     uint8_t max_pstate,
+				     uint8_t min_pstate);
+
+/**
+ *  @brief Handle based variant of read_lclk_dpm_level_range().
+ */
+oob_status_t read_lclk_dpm_level_range_h(struct apml_handle *handle,
+					 uint8_t nbio_id,
+					 struct dpm_level *dpm);
+
+/**
+ *  @brief Handle based variant of read_rapl_core_energy_counters().
+ */
+oob_status_t read_rapl_core_energy_counters_h(struct apml_handle *handle,
+					      uint32_t core_id,
+					      double *energy_counters);
+
+/**
+ *  @brief Handle based variant of read_rapl_pckg_energy_counters().
+ */
+oob_status_t read_rapl_pckg_energy_counters_h(struct apml_handle *handle,
+					      double *energy_counters);
+
+/**
+ *  @brief Handle based variant of read_rapl_core_energy_raw().
+ */
+oob_status_t read_rapl_core_energy_raw_h(struct apml_handle *handle,
+					 uint32_t core_id,
+					 struct rapl_energy *energy);
+
+/**
+ *  @brief Handle based variant of read_rapl_pckg_energy_raw().
+ */
+oob_status_t read_rapl_pckg_energy_raw_h(struct apml_handle *handle,
+					 struct rapl_energy *energy);
+
+/**
+ *  @brief Handle based variant of read_rapl_core_energy_all().
+ */
+oob_status_t read_rapl_core_energy_all_h(struct apml_handle *handle,
+					 struct rapl_core_energy *energy,
+					 uint32_t max_cores,
+					 uint32_t *num_cores, uint8_t *esu);
+
+/**
+ *  @brief Handle based variant of read_rapl_core_energy_uj().
+ */
+oob_status_t read_rapl_core_energy_uj_h(struct apml_handle *handle,
+					uint32_t core_id,
+					uint64_t *energy_uj);
+
+/**
+ *  @brief Handle based variant of read_rapl_pckg_energy_uj().
+ */
+oob_status_t read_rapl_pckg_energy_uj_h(struct apml_handle *handle,
+					uint64_t *energy_uj);
+
+/**
+ *  @brief Handle based variant of read_ras_last_transaction_address().
+ */
+oob_status_t read_ras_last_transaction_address_h(struct apml_handle *handle,
+						 uint64_t *transaction_addr);
+
+/** @} */  // end of MailboxMsgHandle
+/*****************************************************************************/
+
 #endif  // INCLUDE_APML_MAILBOX_H_
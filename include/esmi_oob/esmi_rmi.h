@@ -43,6 +43,8 @@
 
 #include "apml_err.h"
 
+struct apml_handle;
+
 /** \file esmi_rmi.h
  *  Header file for the APML library for SB-RMI functionality access.
  *  All required function, structure, enum, etc. definitions should be defined
@@ -162,6 +164,10 @@ extern const uint8_t alert_mask_v20[MAX_ALERT_REG_V20];
 /**
  *  @brief This value specifies the APML specification revision that the
  *  product is compliant to. 0x10 = 1.0x Revision.
+ *
+ *  @details Always reads the register. The functions depending on the
+ *  revision use the value cached per socket, which this call refreshes
+ *  and a warm reset or a reopen of the device drops.
  */
 oob_status_t read_sbrmi_revision(uint8_t soc_num,
 				 uint8_t *buffer);
@@ -261,4 +267,117 @@ oob_status_t read_sbrmi_ras_status(uint8_t soc_num,
 /** @} */  // end of SB-RMI Register access
 /*****************************************************************************/
 
+/*****************************************************************************/
+/** @defgroup SB-RMIRegisterAccessHandle SB-RMI register access (handle based)
+ *  Variants of the functions above taking a handle returned by apml_open()
+ *  instead of the socket index. Arguments and return values are the same
+ *  as those of the socket index based function.
+ *  @{
+ */
+
+/**
+ *  @brief Handle based variant of read_sbrmi_revision().
+ */
+oob_status_t read_sbrmi_revision_h(struct apml_handle *handle,
+				   uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbrmi_control().
+ */
+oob_status_t read_sbrmi_control_h(struct apml_handle *handle,
+				  uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbrmi_status().
+ */
+oob_status_t read_sbrmi_status_h(struct apml_handle *handle,
+				 uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbrmi_readsize().
+ */
+oob_status_t read_sbrmi_readsize_h(struct apml_handle *handle,
+				   uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbrmi_threadenablestatus().
+ */
+oob_status_t read_sbrmi_threadenablestatus_h(struct apml_handle *handle,
+					     uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbrmi_multithreadenablestatus().
+ */
+oob_status_t read_sbrmi_multithreadenablestatus_h(struct apml_handle *handle,
+						  uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbrmi_swinterrupt().
+ */
+oob_status_t read_sbrmi_swinterrupt_h(struct apml_handle *handle,
+				      uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbrmi_threadnumber().
+ */
+oob_status_t read_sbrmi_threadnumber_h(struct apml_handle *handle,
+				       uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbrmi_threadnumberlow().
+ */
+oob_status_t read_sbrmi_threadnumberlow_h(struct apml_handle *handle,
+					  uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbrmi_threadnumberhi().
+ */
+oob_status_t read_sbrmi_threadnumberhi_h(struct apml_handle *handle,
+					 uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbrmi_mp0_msg().
+ */
+oob_status_t read_sbrmi_mp0_msg_h(struct apml_handle *handle,
+				  uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbrmi_alert_status().
+ */
+oob_status_t read_sbrmi_alert_status_h(struct apml_handle *handle,
+				       uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbrmi_alert_mask().
+ */
+oob_status_t read_sbrmi_alert_mask_h(struct apml_handle *handle,
+				     uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbrmi_inbound_msg().
+ */
+oob_status_t read_sbrmi_inbound_msg_h(struct apml_handle *handle,
+				      uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbrmi_outbound_msg().
+ */
+oob_status_t read_sbrmi_outbound_msg_h(struct apml_handle *handle,
+				       uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbrmi_thread_cs().
+ */
+oob_status_t read_sbrmi_thread_cs_h(struct apml_handle *handle,
+				    uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbrmi_ras_status().
+ */
+oob_status_t read_sbrmi_ras_status_h(struct apml_handle *handle,
+				     uint8_t *buffer);
+
+/** @} */  // end of SB-RMIRegisterAccessHandle
+/*****************************************************************************/
+
 #endif  // INCLUDE_APML_RMI_H_
@@ -41,8 +41,12 @@
 #ifndef INCLUDE_APML_TSI_H_
 #define INCLUDE_APML_TSI_H_
 
+#include <stdbool.h>
+
 #include "apml_err.h"
 
+struct apml_handle;
+
 /** \file esmi_tsi.h
  *  Header file for the APML library for SB-TSI functionality access.
  *  All required function, structure, enum, etc. definitions should be defined
@@ -99,6 +103,32 @@ typedef enum {
 	ALERTMASK_MASK = 0x80
 } sbtsi_config_write;
 
+/**
+ * @brief Fields of struct sbtsi_profile applied by sbtsi_apply_profile()
+ */
+typedef enum {
+	SBTSI_PROFILE_HITEMP = 0x1,
+	SBTSI_PROFILE_LOTEMP = 0x2,
+	SBTSI_PROFILE_ALERT_THRESHOLD = 0x4,
+	SBTSI_PROFILE_ALERT_CONFIG = 0x8,
+	SBTSI_PROFILE_TIMEOUT = 0x10,
+	SBTSI_PROFILE_CONFIG = 0x20
+} sbtsi_profile_fields;
+
+/**
+ * @brief SB-TSI threshold and alert settings
+ */
+struct sbtsi_profile {
+	uint32_t fields;	//!< sbtsi_profile_fields to apply
+	float hitemp_thr;	//!< High temperature threshold in degree C
+	float lotemp_thr;	//!< Low temperature threshold in degree C
+	uint8_t alert_samples;	//!< Alert threshold, 1 to 8 samples
+	uint8_t alert_comp;	//!< Alert comparator mode, 0 or 1
+	uint8_t timeout_en;	//!< SMBus timeout support, 0 or 1
+	uint8_t config_mask;	//!< sbtsi_config_write bits to update
+	uint8_t config;		//!< new value of the config_mask bits
+};
+
 /*****************************************************************************/
 /** @defgroup SB-TSIRegisterAccess SBTSI Register Read Byte Protocol
  *  Below functions provide interface to read one byte from the SB-TSI register
@@ -410,6 +440,47 @@ oob_status_t read_sbtsi_revision(uint8_t soc_num, uint8_t *rivision);
  */
 oob_status_t sbtsi_get_cputemp(uint8_t soc_num, float *cpu_temp);
 
+/**
+ *  @brief CPU temperature in units of ::TEMP_INC (0.125 degree C)
+ *
+ *  @details Reads SBTSI::CpuTempInt and SBTSI::CpuTempDec back to back in
+ *  the order given by SBTSI::Config[ReadOrder], the first read latching
+ *  the other byte. The read order is read once per socket and then
+ *  tracked through the writes of ConfigWr by the library; it is read again
+ *  after a warm reset, a device reopen or apml_invalidate_socket_cache().
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[out] cpu_temp temperature, CpuTempInt * 8 + CpuTempDec[7:5].
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *
+ *  @retval None-zero is returned upon failure.
+ */
+oob_status_t sbtsi_get_cputemp_fixed(uint8_t soc_num, uint16_t *cpu_temp);
+
+/**
+ *  @brief CPU temperature of several sockets in units of ::TEMP_INC
+ *
+ *  @details Reads the temperature of the sockets 0 to @p num_sockets - 1
+ *  as sbtsi_get_cputemp_fixed() does, one socket after the other.
+ *
+ *  @param[in] num_sockets number of sockets.
+ *
+ *  @param[out] cpu_temp array of @p num_sockets temperatures, indexed by
+ *  socket.
+ *
+ *  @param[out] status array of @p num_sockets statuses, indexed by socket.
+ *  May be NULL.
+ *
+ *  @retval ::OOB_SUCCESS is returned when all the sockets were read.
+ *
+ *  @retval Non-zero status of the lowest failing socket otherwise.
+ */
+oob_status_t sbtsi_get_cputemp_fixed_sockets(uint8_t num_sockets,
+					     uint16_t *cpu_temp,
+					     oob_status_t *status);
+
 /**
  *  @brief Status register is Read-only, volatile field
  *  If SBTSI::AlertConfig[AlertCompEn] == 0 , the temperature alert is latched
@@ -653,7 +724,264 @@ oob_status_t sbtsi_set_alert_threshold(uint8_t soc_num,
 oob_status_t sbtsi_set_alert_config(uint8_t soc_num,
 				    uint8_t mode);
 
+/**
+ *  @brief Apply a set of threshold and alert settings.
+ *
+ *  @details Validates all the fields selected in @p profile as the
+ *  individual setters do, then writes, in one vector of messages, only the
+ *  registers whose value changes: high, low thresholds, alert threshold,
+ *  alert configuration, timeout configuration and ConfigWr, in that order.
+ *  With apml_set_tsi_shadow() enabled the current values come from the
+ *  shadow, otherwise the registers updated partially are read first.
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[in] profile settings to apply.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval ::OOB_INVALID_INPUT a selected field is out of range, nothing
+ *  is written.
+ *  @retval None-zero is returned upon failure.
+ */
+oob_status_t sbtsi_apply_profile(uint8_t soc_num,
+				 const struct sbtsi_profile *profile);
+
+/**
+ *  @brief Keep a shadow of the SB-TSI configuration registers.
+ *
+ *  @details The threshold, alert and configuration setters update a part
+ *  of a register and read it first. When enabled, the registers they
+ *  update (0x03/0x09, 0x07, 0x08, 0x13, 0x14, 0x22, 0x32 and 0xBF) are
+ *  shadowed per socket: read once, then updated by the writes of the
+ *  process, and a write of the value the register already holds is
+ *  skipped. Only enable it when no other agent writes these registers.
+ *  The shadow is dropped on a warm reset, a device reopen or
+ *  apml_invalidate_socket_cache(). Disabled by default.
+ *
+ *  @param[in] enable true to shadow the registers.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *
+ */
+oob_status_t apml_set_tsi_shadow(bool enable);
+
 /** @} */  // end of SB-TSI Register access
 /*****************************************************************************/
 
+/*****************************************************************************/
+/** @defgroup SB-TSIRegisterAccessHandle SB-TSI register access (handle based)
+ *  Variants of the functions above taking a handle returned by apml_open()
+ *  instead of the socket index. Arguments and return values are the same
+ *  as those of the socket index based function.
+ *  @{
+ */
+
+/**
+ *  @brief Handle based variant of read_sbtsi_cpuinttemp().
+ */
+oob_status_t read_sbtsi_cpuinttemp_h(struct apml_handle *handle,
+				     uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbtsi_status().
+ */
+oob_status_t read_sbtsi_status_h(struct apml_handle *handle,
+				 uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbtsi_config().
+ */
+oob_status_t read_sbtsi_config_h(struct apml_handle *handle,
+				 uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbtsi_updaterate().
+ */
+oob_status_t read_sbtsi_updaterate_h(struct apml_handle *handle,
+				     float *buffer);
+
+/**
+ *  @brief Handle based variant of write_sbtsi_updaterate().
+ */
+oob_status_t write_sbtsi_updaterate_h(struct apml_handle *handle,
+				      float uprate);
+
+/**
+ *  @brief Handle based variant of sbtsi_set_hitemp_threshold().
+ */
+oob_status_t sbtsi_set_hitemp_threshold_h(struct apml_handle *handle,
+					  float hitemp_thr);
+
+/**
+ *  @brief Handle based variant of sbtsi_set_lotemp_threshold().
+ */
+oob_status_t sbtsi_set_lotemp_threshold_h(struct apml_handle *handle,
+					  float lotemp_thr);
+
+/**
+ *  @brief Handle based variant of sbtsi_set_timeout_config().
+ */
+oob_status_t sbtsi_set_timeout_config_h(struct apml_handle *handle,
+					uint8_t mode);
+
+/**
+ *  @brief Handle based variant of sbtsi_set_alert_threshold().
+ */
+oob_status_t sbtsi_set_alert_threshold_h(struct apml_handle *handle,
+					 uint8_t samples);
+
+/**
+ *  @brief Handle based variant of sbtsi_set_alert_config().
+ */
+oob_status_t sbtsi_set_alert_config_h(struct apml_handle *handle,
+				      uint8_t mode);
+
+/**
+ *  @brief Handle based variant of sbtsi_set_configwr().
+ */
+oob_status_t sbtsi_set_configwr_h(struct apml_handle *handle,
+				  uint8_t mode, uint8_t config_mask);
+
+/**
+ *  @brief Handle based variant of sbtsi_apply_profile().
+ */
+oob_status_t sbtsi_apply_profile_h(struct apml_handle *handle,
+				   const struct sbtsi_profile *profile);
+
+/**
+ *  @brief Handle based variant of read_sbtsi_hitempint().
+ */
+oob_status_t read_sbtsi_hitempint_h(struct apml_handle *handle,
+				    uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbtsi_lotempint().
+ */
+oob_status_t read_sbtsi_lotempint_h(struct apml_handle *handle,
+				    uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbtsi_configwrite().
+ */
+oob_status_t read_sbtsi_configwrite_h(struct apml_handle *handle,
+				      uint8_t *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbtsi_cputempdecimal().
+ */
+oob_status_t read_sbtsi_cputempdecimal_h(struct apml_handle *handle,
+					 float *buffer);
+
+/**
+ *  @brief Handle based variant of read_sbtsi_cputempoffint().
+ */
+oob_status_t read_sbtsi_cputempoffint_h(struct apml_handle *handle,
+					uint8_t *temp_int);
+
+/**
+ *  @brief Handle based variant of read_sbtsi_cputempoffdec().
+ */
+oob_status_t read_sbtsi_cputempoffdec_h(struct apml_handle *handle,
+					float *temp_dec);
+
+/**
+ *  @brief Handle based variant of read_sbtsi_hitempdecimal().
+ */
+oob_status_t read_sbtsi_hitempdecimal_h(struct apml_handle *handle,
+					float *temp_dec);
+
+/**
+ *  @brief Handle based variant of read_sbtsi_lotempdecimal().
+ */
+oob_status_t read_sbtsi_lotempdecimal_h(struct apml_handle *handle,
+					float *temp_dec);
+
+/**
+ *  @brief Handle based variant of read_sbtsi_timeoutconfig().
+ */
+oob_status_t read_sbtsi_timeoutconfig_h(struct apml_handle *handle,
+					uint8_t *timeout);
+
+/**
+ *  @brief Handle based variant of read_sbtsi_cputempoffset().
+ */
+oob_status_t read_sbtsi_cputempoffset_h(struct apml_handle *handle,
+					float *temp_offset);
+
+/**
+ *  @brief Handle based variant of write_sbtsi_cputempoffset().
+ */
+oob_status_t write_sbtsi_cputempoffset_h(struct apml_handle *handle,
+					 float temp_offset);
+
+/**
+ *  @brief Handle based variant of read_sbtsi_alertthreshold().
+ */
+oob_status_t read_sbtsi_alertthreshold_h(struct apml_handle *handle,
+					 uint8_t *samples);
+
+/**
+ *  @brief Handle based variant of read_sbtsi_alertconfig().
+ */
+oob_status_t read_sbtsi_alertconfig_h(struct apml_handle *handle,
+				      uint8_t *mode);
+
+/**
+ *  @brief Handle based variant of read_sbtsi_manufid().
+ */
+oob_status_t read_sbtsi_manufid_h(struct apml_handle *handle,
+				  uint8_t *man_id);
+
+/**
+ *  @brief Handle based variant of read_sbtsi_revision().
+ */
+oob_status_t read_sbtsi_revision_h(struct apml_handle *handle,
+				   uint8_t *rivision);
+
+/**
+ *  @brief Handle based variant of sbtsi_get_cputemp().
+ */
+oob_status_t sbtsi_get_cputemp_h(struct apml_handle *handle,
+				 float *cpu_temp);
+
+/**
+ *  @brief Handle based variant of sbtsi_get_cputemp_fixed().
+ */
+oob_status_t sbtsi_get_cputemp_fixed_h(struct apml_handle *handle,
+				       uint16_t *cpu_temp);
+
+/**
+ *  @brief Handle based variant of sbtsi_get_hitemp_threshold().
+ */
+oob_status_t sbtsi_get_hitemp_threshold_h(struct apml_handle *handle,
+					  float *hitemp_thr);
+
+/**
+ *  @brief Handle based variant of sbtsi_get_lotemp_threshold().
+ */
+oob_status_t sbtsi_get_lotemp_threshold_h(struct apml_handle *handle,
+					  float *lotemp_thr);
+
+/**
+ *  @brief Handle based variant of sbtsi_get_temp_status().
+ */
+oob_status_t sbtsi_get_temp_status_h(struct apml_handle *handle,
+				     uint8_t *loalert, uint8_t *hialert);
+
+/**
+ *  @brief Handle based variant of sbtsi_get_config().
+ */
+oob_status_t sbtsi_get_config_h(struct apml_handle *handle,
+				uint8_t *al_mask, uint8_t *run_stop,
+				uint8_t *read_ord, uint8_t *ara);
+
+/**
+ *  @brief Handle based variant of sbtsi_get_timeout().
+ */
+oob_status_t sbtsi_get_timeout_h(struct apml_handle *handle,
+				 uint8_t *timeout_en);
+
+/** @} */  // end of SB-TSIRegisterAccessHandle
+/*****************************************************************************/
+
 #endif  // INCLUDE_APML_TSI_H_
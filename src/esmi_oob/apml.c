@@ -38,59 +38,940 @@
  * DEALINGS WITH THE SOFTWARE.
  *
  */
-#include <sys/ioctl.h>
-#include <fcntl.h>
-#include <unistd.h>
 #include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
-#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#else
+#define DTRACE_PROBE4(provider, name, a1, a2, a3, a4)
+#define DTRACE_PROBE7(provider, name, a1, a2, a3, a4, a5, a6, a7)
+#endif
 
 #include <esmi_oob/apml.h>
+#include <esmi_oob/esmi_mailbox.h>
+
+#include "common.h"
 
 #define SBRMI_CTRL	0x1
 #define SBRMI_STATUS	0x2
 #define SW_ALERT_MASK	0x2
-/* SBRMI DEVICE FILE PATH */
-#define SBRMI_DEV	"/dev/"
 /* READ MODE */
 #define READ_MODE		1
 /*WRITE MODE */
 #define WRITE_MODE		0
 
-oob_status_t sbrmi_xfer_msg(uint8_t socket_num, char *filename, struct apml_message *msg)
+static struct apml_socket apml_sockets[APML_MAX_SOCKETS] = {
+	[0 ... APML_MAX_SOCKETS - 1] = {
+		.dev = {
+			[0 ... APML_INTF_MAX - 1] = {
+				.lock = PTHREAD_MUTEX_INITIALIZER,
+				.cond = PTHREAD_COND_INITIALIZER,
+				.fd = -1,
+			}
+		},
+		.worker_lock = PTHREAD_MUTEX_INITIALIZER,
+	}
+};
+
+/* Default handles used by the socket index based API */
+static struct apml_handle socket_handles[UINT8_MAX + 1];
+static pthread_once_t socket_handles_once = PTHREAD_ONCE_INIT;
+
+static atomic_bool persistent_fd;
+static atomic_bool coalesce_reads;
+/* Maximum age of the cached reads of the socket index API */
+static atomic_uint_least64_t default_max_age;
+
+static void init_socket_handles(void)
 {
-	int fd = 0, ret = 0;
-	char dev_file[12];
+	int i;
+
+	for (i = 0; i <= UINT8_MAX; i++) {
+		socket_handles[i].soc_num = i;
+		socket_handles[i].prio = APML_PRIO_INTERACTIVE;
+		socket_handles[i].is_default = true;
+		if (i < APML_MAX_SOCKETS)
+			socket_handles[i].sock = &apml_sockets[i];
+	}
+}
+
+struct apml_handle *apml_socket_handle(uint8_t soc_num)
+{
+	pthread_once(&socket_handles_once, init_socket_handles);
+
+	return &socket_handles[soc_num];
+}
+
+int apml_intf_index(char *filename)
+{
+	if (!strcmp(filename, SBRMI))
+		return APML_INTF_SBRMI;
+	if (!strcmp(filename, SBTSI))
+		return APML_INTF_SBTSI;
+
+	return -1;
+}
 
-	sprintf(dev_file, "/dev/%s%d", filename, socket_num);
+/*
+ * errno values returned by the ioctl when the cached fd no longer refers
+ * to a live device, e.g. the apml module was reloaded or the device unbound.
+ */
+static bool apml_dev_stale(int err)
+{
+	switch (err) {
+	case EBADF:
+	case ENODEV:
+	case ENXIO:
+	case ESHUTDOWN:
+		return true;
+	default:
+		return false;
+	}
+}
 
-	fd = open(dev_file, O_RDWR);
-	if (fd < 0)
-		return OOB_FILE_ERROR;
+static int apml_bus_acquire(struct apml_dev *dev,
+			    const struct apml_sched *sched,
+			    struct apml_flight *flight);
+static void apml_bus_release(struct apml_dev *dev);
 
-	if (ioctl(fd, SBRMI_IOCTL_CMD, msg) < 0)
-		ret = errno;
+static void apml_dev_close(struct apml_dev *dev)
+{
+	struct apml_sched sched = { .prio = APML_PRIO_CONTROL };
 
-	close(fd);
+	apml_bus_acquire(dev, &sched, NULL);
+	if (dev->fd >= 0) {
+		dev->ops->close(dev->fd);
+		dev->fd = -1;
+	}
+	apml_bus_release(dev);
+}
 
-	if (ret == EPROTOTYPE) {
+/* Map the errno of a transaction to the status of the message */
+static oob_status_t apml_msg_status(struct apml_message *msg, int err)
+{
+	if (err == EPROTOTYPE) {
 		if (msg->cmd == APML_CPUID || msg->cmd == APML_MCA_MSR)
-			ret = OOB_CPUID_MSR_ERR_BASE + msg->fw_ret_code;
+			err = OOB_CPUID_MSR_ERR_BASE + msg->fw_ret_code;
 		else
-			ret = OOB_MAILBOX_ERR_BASE + msg->fw_ret_code;
+			err = OOB_MAILBOX_ERR_BASE + msg->fw_ret_code;
 	}
 
-	return errno_to_oob_status(ret);
+	return errno_to_oob_status(err);
 }
 
-oob_status_t esmi_oob_read_byte(uint8_t soc_num,
-				uint8_t reg_offset,
-				char *file_name,
-				uint8_t *buffer)
+uint64_t apml_monotonic_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Hooks set with apml_set_hooks(), NULL when none */
+static _Atomic(const struct apml_hooks *) xfer_hooks;
+
+/*
+ * Issue one message on the transport and map the outcome to its status.
+ * Every transaction is accounted in the statistics and recorded when
+ * tracing. Return the errno value of the transport.
+ */
+static int apml_issue(const struct apml_transport_ops *ops, int fd,
+		      uint8_t socket_num, int intf, struct apml_message *msg,
+		      oob_status_t *status, uint64_t *dur_ns)
+{
+	uint64_t start, dur;
+	int err;
+
+	DTRACE_PROBE4(apml, xfer__start, socket_num, intf, msg->cmd,
+		      msg->data_in.cpu_msr_in);
+	start = apml_monotonic_ns();
+	err = ops->xfer(fd, socket_num, intf, msg);
+	dur = apml_monotonic_ns() - start;
+
+	*status = err ? apml_msg_status(msg, err) : OOB_SUCCESS;
+	if (__builtin_expect(*status == OOB_CPUID_MSR_CMD_WARM_RESET, 0))
+		apml_socket_invalidate(socket_num, true);
+	else
+		apml_mailbox_learn(socket_num, intf, msg, *status);
+	DTRACE_PROBE7(apml, xfer__done, socket_num, intf, msg->cmd,
+		      msg->data_out.cpu_msr_out, msg->fw_ret_code, *status,
+		      dur);
+	apml_stats_record(socket_num, intf, msg, *status, dur);
+	if (atomic_load_explicit(&apml_tracing, memory_order_relaxed))
+		apml_trace_record(socket_num, intf, msg, start, dur, err);
+
+	*dur_ns = dur;
+	return err;
+}
+
+/* Issue one message with the hooks set with apml_set_hooks() */
+static int apml_hooked_issue(const struct apml_hooks *hooks,
+			     const struct apml_transport_ops *ops, int fd,
+			     uint8_t socket_num, int intf,
+			     struct apml_message *msg, oob_status_t *status)
+{
+	struct apml_xfer_info info = {0};
+	int err;
+
+	info.soc_num = socket_num;
+	if (intf == APML_INTF_SBRMI)
+		info.file_name = SBRMI;
+	else if (intf == APML_INTF_SBTSI)
+		info.file_name = SBTSI;
+	info.msg = msg;
+
+	if (hooks->pre)
+		hooks->pre(&info, hooks->ctx);
+	err = apml_issue(ops, fd, socket_num, intf, msg, status,
+			 &info.dur_ns);
+	info.status = *status;
+	if (hooks->post)
+		hooks->post(&info, hooks->ctx);
+
+	return err;
+}
+
+/* Issue one message on the transport, see apml_issue() */
+static int apml_transport_xfer(const struct apml_transport_ops *ops, int fd,
+			       uint8_t socket_num, int intf,
+			       struct apml_message *msg, oob_status_t *status)
+{
+	const struct apml_hooks *hooks;
+	uint64_t dur;
+
+	hooks = atomic_load_explicit(&xfer_hooks, memory_order_acquire);
+	if (__builtin_expect(hooks != NULL, 0))
+		return apml_hooked_issue(hooks, ops, fd, socket_num, intf,
+					 msg, status);
+
+	return apml_issue(ops, fd, socket_num, intf, msg, status, &dur);
+}
+
+oob_status_t apml_set_hooks(const struct apml_hooks *hooks)
+{
+	atomic_store_explicit(&xfer_hooks, hooks, memory_order_release);
+
+	return OOB_SUCCESS;
+}
+
+/* Check the message against the capabilities of the transport */
+static bool apml_msg_supported(const struct apml_transport_ops *ops,
+			       struct apml_message *msg)
+{
+	uint32_t cap;
+
+	switch (msg->cmd) {
+	case APML_CPUID:
+		cap = APML_CAP_CPUID;
+		break;
+	case APML_MCA_MSR:
+		cap = APML_CAP_MCA_MSR;
+		break;
+	case APML_REG:
+		cap = APML_CAP_REG;
+		break;
+	default:
+		cap = APML_CAP_MAILBOX;
+		break;
+	}
+
+	return ops->caps & cap;
+}
+
+/* Whether a message cannot start any more before the deadline */
+static bool apml_expired(uint64_t deadline_ns)
+{
+	return deadline_ns && apml_monotonic_ns() >= deadline_ns;
+}
+
+/* Convert a CLOCK_MONOTONIC deadline for the CLOCK_REALTIME pthread waits */
+static void apml_realtime_deadline(uint64_t deadline_ns, struct timespec *ts)
+{
+	uint64_t left, now;
+
+	now = apml_monotonic_ns();
+	left = deadline_ns > now ? deadline_ns - now : 0;
+	clock_gettime(CLOCK_REALTIME, ts);
+	left += ts->tv_nsec;
+	ts->tv_sec += left / 1000000000;
+	ts->tv_nsec = left % 1000000000;
+}
+
+/*
+ * Class allowed to take the bus next: a waiting class passed over
+ * APML_PRIO_AGING times first, then the most urgent waiting class.
+ */
+static int apml_bus_next(struct apml_dev *dev)
+{
+	int prio;
+
+	for (prio = 0; prio < APML_PRIO_MAX; prio++)
+		if (dev->waiting[prio] && dev->passed[prio] >= APML_PRIO_AGING)
+			return prio;
+	for (prio = 0; prio < APML_PRIO_MAX; prio++)
+		if (dev->waiting[prio])
+			return prio;
+
+	return -1;
+}
+
+/*
+ * Take the bus of the device for a vector of messages, in priority order
+ * with the other waiters, giving up at the deadline. The flight, if any,
+ * is marked started when the bus is granted.
+ */
+static int apml_bus_acquire(struct apml_dev *dev,
+			    const struct apml_sched *sched,
+			    struct apml_flight *flight)
+{
+	struct timespec ts;
+	int prio = sched->prio;
+	int c, err = 0;
+
+	if (sched->deadline_ns)
+		apml_realtime_deadline(sched->deadline_ns, &ts);
+
+	pthread_mutex_lock(&dev->lock);
+	dev->waiting[prio]++;
+	while (dev->busy || apml_bus_next(dev) != prio) {
+		if (!sched->deadline_ns) {
+			pthread_cond_wait(&dev->cond, &dev->lock);
+			continue;
+		}
+		err = pthread_cond_timedwait(&dev->cond, &dev->lock, &ts);
+		if (err == ETIMEDOUT)
+			break;
+		err = 0;
+	}
+	dev->waiting[prio]--;
+	if (err) {
+		/* The next class may have been waiting behind us */
+		pthread_cond_broadcast(&dev->cond);
+		pthread_mutex_unlock(&dev->lock);
+		return err;
+	}
+
+	dev->busy = true;
+	if (flight)
+		flight->started = true;
+	for (c = 0; c < APML_PRIO_MAX; c++)
+		if (dev->waiting[c])
+			dev->passed[c]++;
+	dev->passed[prio] = 0;
+	pthread_mutex_unlock(&dev->lock);
+
+	return 0;
+}
+
+static void apml_bus_release(struct apml_dev *dev)
+{
+	pthread_mutex_lock(&dev->lock);
+	dev->busy = false;
+	pthread_cond_broadcast(&dev->cond);
+	pthread_mutex_unlock(&dev->lock);
+}
+
+/*
+ * Issue the messages on the cached fd, opening it on first use. A stale fd
+ * is closed and the transaction retried once on a freshly opened device.
+ * The caller owns the bus. Messages that cannot start before the deadline
+ * fail with OOB_CMD_TIMEOUT.
+ */
+static void apml_dev_xfer(struct apml_dev *dev, uint8_t socket_num,
+			  int intf, char *filename, struct apml_message *msgs,
+			  size_t n, oob_status_t *status,
+			  uint64_t deadline_ns)
+{
+	const struct apml_transport_ops *ops = apml_transport_get(intf);
+	size_t i;
+	int attempt, err;
+
+	/* The transport or its device was switched since the fd was opened */
+	if (dev->fd >= 0 && (dev->ops != ops ||
+			     dev->fd_gen != atomic_load(&dev->reopen_gen))) {
+		dev->ops->close(dev->fd);
+		dev->fd = -1;
+	}
+	for (i = 0; i < n; i++) {
+		if (!apml_msg_supported(ops, &msgs[i])) {
+			status[i] = OOB_NOT_SUPPORTED;
+			continue;
+		}
+		if (apml_expired(deadline_ns)) {
+			status[i] = OOB_CMD_TIMEOUT;
+			continue;
+		}
+		for (attempt = 0; attempt < 2; attempt++) {
+			if (dev->fd < 0) {
+				dev->fd_gen = atomic_load(&dev->reopen_gen);
+				dev->fd = ops->open(socket_num, intf, filename);
+				if (dev->fd < 0) {
+					status[i] = OOB_FILE_ERROR;
+					break;
+				}
+				dev->ops = ops;
+			}
+			err = apml_transport_xfer(ops, dev->fd, socket_num,
+						  intf, &msgs[i], &status[i]);
+			if (!err || !apml_dev_stale(err))
+				break;
+			/* The device went away, it may come back different */
+			ops->close(dev->fd);
+			dev->fd = -1;
+			apml_socket_invalidate(socket_num, false);
+		}
+	}
+}
+
+void apml_dev_reopen(uint8_t soc_num, int intf)
+{
+	struct apml_dev *dev;
+
+	if (soc_num >= APML_MAX_SOCKETS || intf < 0 || intf >= APML_INTF_MAX)
+		return;
+
+	dev = &apml_socket_handle(soc_num)->sock->dev[intf];
+	atomic_fetch_add(&dev->reopen_gen, 1);
+}
+
+/* Open the device, issue all the messages and close it again */
+static void apml_oneshot_xfer(uint8_t socket_num, int intf, char *filename,
+			      struct apml_message *msgs, size_t n,
+			      oob_status_t *status, uint64_t deadline_ns)
+{
+	const struct apml_transport_ops *ops = apml_transport_get(intf);
+	size_t i;
+	int fd;
+
+	fd = ops->open(socket_num, intf, filename);
+	for (i = 0; i < n; i++) {
+		if (!apml_msg_supported(ops, &msgs[i])) {
+			status[i] = OOB_NOT_SUPPORTED;
+		} else if (fd < 0) {
+			status[i] = OOB_FILE_ERROR;
+		} else if (apml_expired(deadline_ns)) {
+			status[i] = OOB_CMD_TIMEOUT;
+		} else {
+			apml_transport_xfer(ops, fd, socket_num, intf,
+					    &msgs[i], &status[i]);
+		}
+	}
+
+	if (fd >= 0)
+		ops->close(fd);
+}
+
+static void apml_socket_close(struct apml_socket *sock)
+{
+	int i;
+
+	for (i = 0; i < APML_INTF_MAX; i++)
+		apml_dev_close(&sock->dev[i]);
+}
+
+static bool apml_socket_persistent(struct apml_socket *sock)
+{
+	return atomic_load(&persistent_fd) ||
+	       atomic_load(&sock->persistent_refs) > 0;
+}
+
+oob_status_t apml_set_persistent_fd(bool enable)
+{
+	int i;
+
+	atomic_store(&persistent_fd, enable);
+	if (enable)
+		return OOB_SUCCESS;
+
+	for (i = 0; i < APML_MAX_SOCKETS; i++)
+		if (!apml_socket_persistent(&apml_sockets[i]))
+			apml_socket_close(&apml_sockets[i]);
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_open(uint8_t soc_num, uint32_t flags,
+		       struct apml_handle **handle)
+{
+	struct apml_handle *h;
+	oob_status_t ret;
+
+	if (!handle)
+		return OOB_ARG_PTR_NULL;
+	if (soc_num >= APML_MAX_SOCKETS || flags & ~APML_OPEN_FLAGS)
+		return OOB_INVALID_INPUT;
+
+	h = calloc(1, sizeof(*h));
+	if (!h)
+		return OOB_NO_MEMORY;
+
+	h->soc_num = soc_num;
+	h->sock = &apml_sockets[soc_num];
+	h->flags = flags;
+	h->event_fd = -1;
+	h->prio = APML_PRIO_INTERACTIVE;
+	if (flags & APML_OPEN_ASYNC) {
+		ret = apml_async_attach(h);
+		if (ret) {
+			free(h);
+			return ret;
+		}
+	}
+	if (flags & APML_OPEN_PERSISTENT)
+		atomic_fetch_add(&h->sock->persistent_refs, 1);
+
+	*handle = h;
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_close(struct apml_handle *handle)
+{
+	if (!handle)
+		return OOB_ARG_PTR_NULL;
+
+	if (handle->flags & APML_OPEN_ASYNC)
+		apml_async_detach(handle);
+
+	if (handle->flags & APML_OPEN_PERSISTENT &&
+	    atomic_fetch_sub(&handle->sock->persistent_refs, 1) == 1 &&
+	    !apml_socket_persistent(handle->sock))
+		apml_socket_close(handle->sock);
+
+	free(handle->cmd_retry);
+	free(handle);
+	return OOB_SUCCESS;
+}
+
+/* Issue messages on a socket interface owning its bus meanwhile */
+static void apml_bus_xfer(struct apml_handle *handle, struct apml_dev *dev,
+			  int intf, char *file_name, struct apml_message *msgs,
+			  size_t n, oob_status_t *status,
+			  const struct apml_sched *sched,
+			  struct apml_flight *flight)
+{
+	size_t i;
+
+	if (apml_bus_acquire(dev, sched, flight)) {
+		for (i = 0; i < n; i++)
+			status[i] = OOB_CMD_TIMEOUT;
+		return;
+	}
+	if (apml_socket_persistent(handle->sock))
+		apml_dev_xfer(dev, handle->soc_num, intf, file_name, msgs, n,
+			      status, sched->deadline_ns);
+	else
+		apml_oneshot_xfer(handle->soc_num, intf, file_name, msgs, n,
+				  status, sched->deadline_ns);
+	apml_bus_release(dev);
+}
+
+bool apml_msg_is_read(const struct apml_message *msg)
+{
+	switch (msg->cmd) {
+	case APML_CPUID:
+	case APML_MCA_MSR:
+		return true;
+	case APML_REG:
+		return msg->data_in.reg_in[7] == READ_MODE;
+	case READ_PACKAGE_POWER_CONSUMPTION:
+	case READ_PACKAGE_POWER_LIMIT:
+	case READ_MAX_PACKAGE_POWER_LIMIT:
+	case READ_TDP:
+	case READ_MAX_cTDP:
+	case READ_MIN_cTDP:
+	case READ_BIOS_BOOST_Fmax:
+	case READ_APML_BOOST_LIMIT:
+	case READ_DRAM_THROTTLE:
+	case READ_PROCHOT_STATUS:
+	case READ_PROCHOT_RESIDENCY:
+	case READ_NBIO_ERROR_LOGGING_REGISTER:
+	case READ_IOD_BIST:
+	case READ_CCD_BIST_RESULT:
+	case READ_CCX_BIST_RESULT:
+	case READ_DDR_BANDWIDTH:
+	case READ_BMC_RAS_PCIE_CONFIG_ACCESS:
+	case READ_BMC_RAS_MCA_VALIDITY_CHECK:
+	case READ_BMC_RAS_MCA_MSR_DUMP:
+	case READ_BMC_RAS_FCH_RESET_REASON:
+	case READ_DIMM_TEMP_RANGE_AND_REFRESH_RATE:
+	case READ_DIMM_POWER_CONSUMPTION:
+	case READ_DIMM_THERMAL_SENSOR:
+	case READ_PWR_CURRENT_ACTIVE_FREQ_LIMIT_SOCKET:
+	case READ_PWR_CURRENT_ACTIVE_FREQ_LIMIT_CORE:
+	case READ_PWR_SVI_TELEMETRY_ALL_RAILS:
+	case READ_SOCKET_FREQ_RANGE:
+	case READ_CURRENT_IO_BANDWIDTH:
+	case READ_CURRENT_XGMI_BANDWIDTH:
+	case READ_CURRENT_DFPSTATE_FREQUENCY:
+	case READ_BMC_RAPL_UNITS:
+	case READ_BMC_RAPL_CORE_LO_COUNTER:
+	case READ_BMC_RAPL_CORE_HI_COUNTER:
+	case READ_BMC_RAPL_PKG_COUNTER:
+	case READ_BMC_CPU_BASE_FREQUENCY:
+	case READ_RAS_LAST_TRANSACTION_ADDRESS:
+	case READ_LCLK_DPM_LEVEL_RANGE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Whether the result of a read can be served again later: mailbox
+ * telemetry read as a single value. Register, CPUID and MCA MSR values and
+ * the RAPL counters are read in several parts that must come from the
+ * same moment.
+ */
+static bool apml_msg_cacheable(struct apml_message *msg)
+{
+	switch (msg->cmd) {
+	case READ_PACKAGE_POWER_CONSUMPTION:
+	case READ_PACKAGE_POWER_LIMIT:
+	case READ_MAX_PACKAGE_POWER_LIMIT:
+	case READ_TDP:
+	case READ_MAX_cTDP:
+	case READ_MIN_cTDP:
+	case READ_BIOS_BOOST_Fmax:
+	case READ_APML_BOOST_LIMIT:
+	case READ_DRAM_THROTTLE:
+	case READ_PROCHOT_STATUS:
+	case READ_PROCHOT_RESIDENCY:
+	case READ_DDR_BANDWIDTH:
+	case READ_DIMM_TEMP_RANGE_AND_REFRESH_RATE:
+	case READ_DIMM_POWER_CONSUMPTION:
+	case READ_DIMM_THERMAL_SENSOR:
+	case READ_PWR_CURRENT_ACTIVE_FREQ_LIMIT_SOCKET:
+	case READ_PWR_CURRENT_ACTIVE_FREQ_LIMIT_CORE:
+	case READ_PWR_SVI_TELEMETRY_ALL_RAILS:
+	case READ_SOCKET_FREQ_RANGE:
+	case READ_CURRENT_IO_BANDWIDTH:
+	case READ_CURRENT_XGMI_BANDWIDTH:
+	case READ_CURRENT_DFPSTATE_FREQUENCY:
+	case READ_BMC_RAPL_UNITS:
+	case READ_BMC_CPU_BASE_FREQUENCY:
+	case READ_LCLK_DPM_LEVEL_RANGE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * A flight can be joined until it reaches the bus, by callers of the same
+ * or a lower class whose deadline does not outlast the one of the flight.
+ */
+static bool apml_flight_joinable(struct apml_flight *f,
+				 struct apml_message *msg,
+				 const struct apml_sched *sched)
+{
+	if (f->started || f->msg->cmd != msg->cmd ||
+	    memcmp(&f->msg->data_in, &msg->data_in, sizeof(msg->data_in)))
+		return false;
+	if (f->sched.prio > sched->prio)
+		return false;
+
+	return !f->sched.deadline_ns ||
+	       (sched->deadline_ns && sched->deadline_ns <= f->sched.deadline_ns);
+}
+
+/*
+ * Issue a read, or take the result of an identical read of another thread
+ * that has not reached the bus yet. Either way the value is read after
+ * the call started.
+ */
+static void apml_flight_xfer(struct apml_handle *handle, struct apml_dev *dev,
+			     int intf, char *file_name,
+			     struct apml_message *msg, oob_status_t *status,
+			     const struct apml_sched *sched)
+{
+	struct apml_flight *f, **pp, self = {0};
+	struct timespec ts;
+	bool joined = false;
+	int err = 0;
+
+	pthread_mutex_lock(&dev->lock);
+	for (f = dev->flights; f; f = f->next)
+		if (apml_flight_joinable(f, msg, sched))
+			break;
+	if (f) {
+		f->waiters++;
+		if (sched->deadline_ns)
+			apml_realtime_deadline(sched->deadline_ns, &ts);
+		while (!f->done && !err) {
+			if (sched->deadline_ns)
+				err = pthread_cond_timedwait(&dev->cond,
+							     &dev->lock, &ts);
+			else
+				pthread_cond_wait(&dev->cond, &dev->lock);
+		}
+		if (f->done) {
+			msg->data_out = f->msg->data_out;
+			msg->fw_ret_code = f->msg->fw_ret_code;
+			*status = f->status;
+			joined = true;
+		} else {
+			*status = OOB_CMD_TIMEOUT;
+		}
+		/* The leader waits for its followers before returning */
+		if (!--f->waiters)
+			pthread_cond_broadcast(&dev->cond);
+		pthread_mutex_unlock(&dev->lock);
+		if (joined)
+			apml_stats_coalesced(handle->soc_num, intf, msg);
+		return;
+	}
+	self.msg = msg;
+	self.sched = *sched;
+	self.next = dev->flights;
+	dev->flights = &self;
+	pthread_mutex_unlock(&dev->lock);
+
+	apml_bus_xfer(handle, dev, intf, file_name, msg, 1, status, sched,
+		      &self);
+
+	pthread_mutex_lock(&dev->lock);
+	for (pp = &dev->flights; *pp != &self; pp = &(*pp)->next)
+		;
+	*pp = self.next;
+	self.status = *status;
+	self.done = true;
+	pthread_cond_broadcast(&dev->cond);
+	while (self.waiters)
+		pthread_cond_wait(&dev->cond, &dev->lock);
+	pthread_mutex_unlock(&dev->lock);
+}
+
+void apml_issue_batch(struct apml_handle *handle, int intf, char *file_name,
+		      struct apml_message *msgs, size_t n,
+		      oob_status_t *status, const struct apml_sched *sched)
+{
+	struct apml_dev *dev;
+	unsigned int gen = 0;
+	uint64_t start = 0;
+	size_t i;
+
+	/* Other device files are not scheduled by the library */
+	if (!handle->sock || intf < 0) {
+		apml_oneshot_xfer(handle->soc_num, intf, file_name, msgs, n,
+				  status, sched->deadline_ns);
+		return;
+	}
+
+	/* The firmware will not recognise it any better this time */
+	if (n == 1 && apml_mailbox_unknown(handle, intf, msgs)) {
+		*status = OOB_MAILBOX_CMD_UNKNOWN;
+		return;
+	}
+
+	dev = &handle->sock->dev[intf];
+	if (n == 1 && apml_msg_cacheable(msgs)) {
+		start = apml_monotonic_ns();
+		if (sched->max_age_ns &&
+		    apml_read_cache_get(dev, msgs, sched->max_age_ns, start)) {
+			*status = OOB_SUCCESS;
+			apml_stats_cached(handle->soc_num, intf, msgs);
+			return;
+		}
+		gen = atomic_load_explicit(&dev->read_gen,
+					   memory_order_acquire);
+	}
+
+	if (n == 1 && apml_msg_is_read(msgs) && !handle->no_coalesce &&
+	    atomic_load_explicit(&coalesce_reads, memory_order_relaxed))
+		apml_flight_xfer(handle, dev, intf, file_name, msgs, status,
+				 sched);
+	else
+		apml_bus_xfer(handle, dev, intf, file_name, msgs, n, status,
+			      sched, NULL);
+
+	if (n == 1 && apml_msg_cacheable(msgs)) {
+		if (!*status)
+			apml_read_cache_put(dev, msgs, gen, start);
+		return;
+	}
+	/* Reads issued before the other messages completed are dropped */
+	for (i = 0; i < n; i++)
+		if (!apml_msg_is_read(&msgs[i])) {
+			atomic_fetch_add_explicit(&dev->read_gen, 1,
+						  memory_order_release);
+			break;
+		}
+}
+
+apml_prio_t apml_msgs_prio(const struct apml_handle *handle,
+			   const struct apml_message *msgs, size_t n)
+{
+	size_t i;
+
+	if (handle->prio_set)
+		return handle->prio;
+	for (i = 0; i < n; i++) {
+		switch (msgs[i].cmd) {
+		case APML_CPUID:
+		case APML_MCA_MSR:
+		case APML_REG:
+			continue;
+		}
+		if (!apml_msg_is_read(&msgs[i]))
+			return APML_PRIO_CONTROL;
+	}
+
+	return handle->prio;
+}
+
+oob_status_t apml_set_coalescing(bool enable)
+{
+	atomic_store(&coalesce_reads, enable);
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_probe_mailbox(uint8_t soc_num)
+{
+	struct apml_handle *handle = apml_socket_handle(soc_num);
+	struct apml_message msg = {0};
+	apml_cmd_support_t support;
+	oob_status_t ret;
+	uint32_t cmd, buffer;
+
+	if (soc_num >= APML_MAX_SOCKETS)
+		return OOB_INVALID_INPUT;
+
+	for (cmd = 1; cmd < APML_MB_MAX_CMD; cmd++) {
+		msg.cmd = cmd;
+		if (!apml_msg_is_read(&msg) ||
+		    apml_get_mailbox_support(soc_num, cmd, &support) ||
+		    support != APML_CMD_UNPROBED)
+			continue;
+		/* The outcome is learnt by the transaction itself */
+		ret = esmi_oob_read_mailbox_h(handle, cmd, 0, &buffer);
+		if (ret && !(ret >= OOB_MAILBOX_ERR_START &&
+			     ret <= OOB_MAILBOX_ERR_END))
+			return ret;
+	}
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_xfer_until(struct apml_handle *handle, char *file_name,
+			     struct apml_message *msgs, size_t n,
+			     oob_status_t *status,
+			     const struct apml_sched *sched)
+{
+	oob_status_t one, *st;
+	uint64_t start;
+	size_t i;
+	int intf;
+
+	if (!handle || !file_name || !msgs)
+		return OOB_ARG_PTR_NULL;
+	if (!n)
+		return OOB_SUCCESS;
+	if (n > 1 && !status)
+		return OOB_ARG_PTR_NULL;
+	st = status ? status : &one;
+
+	intf = apml_intf_index(file_name);
+	start = apml_monotonic_ns();
+	apml_issue_batch(handle, intf, file_name, msgs, n, st, sched);
+	if (handle->retry.max_attempts > 1 || handle->cmd_retry)
+		apml_retry_batch(handle, intf, file_name, msgs, n, st, start,
+				 sched);
+
+	for (i = 0; i < n; i++)
+		if (st[i])
+			return st[i];
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_xfer_batch(struct apml_handle *handle, char *file_name,
+			     struct apml_message *msgs, size_t n,
+			     oob_status_t *status)
+{
+	struct apml_sched sched;
+
+	if (!handle || !msgs)
+		return OOB_ARG_PTR_NULL;
+	if (n > 1 && !status)
+		return OOB_ARG_PTR_NULL;
+
+	sched.deadline_ns = handle->opts.deadline_ns;
+	sched.prio = apml_msgs_prio(handle, msgs, n);
+	sched.max_age_ns = handle->opts.max_age_ns;
+	if (handle->is_default)
+		sched.max_age_ns = atomic_load_explicit(&default_max_age,
+							memory_order_relaxed);
+
+	return apml_xfer_until(handle, file_name, msgs, n, status, &sched);
+}
+
+oob_status_t apml_set_call_opts(struct apml_handle *handle,
+				const struct apml_call_opts *opts)
+{
+	if (!handle)
+		return OOB_ARG_PTR_NULL;
+
+	if (opts)
+		handle->opts = *opts;
+	else
+		memset(&handle->opts, 0, sizeof(handle->opts));
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_set_read_cache_max_age(uint64_t max_age_ns)
+{
+	atomic_store(&default_max_age, max_age_ns);
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_set_priority(struct apml_handle *handle, apml_prio_t prio)
+{
+	if (!handle)
+		return OOB_ARG_PTR_NULL;
+	if (prio >= APML_PRIO_MAX)
+		return OOB_INVALID_INPUT;
+
+	handle->prio = prio;
+	handle->prio_set = true;
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_handle_usleep(struct apml_handle *handle,
+				unsigned int usec)
+{
+	uint64_t deadline = handle ? handle->opts.deadline_ns : 0;
+
+	if (deadline && apml_monotonic_ns() + usec * 1000ULL >= deadline)
+		return OOB_CMD_TIMEOUT;
+	usleep(usec);
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t sbrmi_xfer_msg_h(struct apml_handle *handle, char *filename,
+			      struct apml_message *msg)
+{
+	return apml_xfer_batch(handle, filename, msg, 1, NULL);
+}
+
+oob_status_t esmi_oob_read_byte_h(struct apml_handle *handle,
+				  uint8_t reg_offset,
+				  char *file_name,
+				  uint8_t *buffer)
 {
 	struct apml_message msg = {0};
 	oob_status_t ret;
@@ -105,7 +986,7 @@ oob_status_t esmi_oob_read_byte(uint8_t soc_num,
 	/* Assign 1  to the msg.data_in[7] for the read operation */
 	msg.data_in.reg_in[7] = 1;
 
-	ret = sbrmi_xfer_msg(soc_num, file_name, &msg);
+	ret = sbrmi_xfer_msg_h(handle, file_name, &msg);
 	if (ret)
 		return ret;
 
@@ -114,10 +995,10 @@ oob_status_t esmi_oob_read_byte(uint8_t soc_num,
         return OOB_SUCCESS;
 }
 
-oob_status_t esmi_oob_write_byte(uint8_t soc_num,
-				 uint8_t reg_offset,
-				 char *file_name,
-				 uint8_t value)
+oob_status_t esmi_oob_write_byte_h(struct apml_handle *handle,
+				   uint8_t reg_offset,
+				   char *file_name,
+				   uint8_t value)
 {
 	struct apml_message msg = {0};
 
@@ -132,7 +1013,7 @@ oob_status_t esmi_oob_write_byte(uint8_t soc_num,
 	/* Assign 0 to the msg.data_in[7] */
 	msg.data_in.reg_in[7] = 0;
 
-	return sbrmi_xfer_msg(soc_num, file_name, &msg);
+	return sbrmi_xfer_msg_h(handle, file_name, &msg);
 }
 
 /*
@@ -144,8 +1025,8 @@ oob_status_t esmi_oob_write_byte(uint8_t soc_num,
  * written to 0x39.
  * The answer for our mailbox request is placed on registers 0x31-0x34.
  */
-oob_status_t esmi_oob_write_mailbox(uint8_t soc_num,
-                                    uint32_t cmd, uint32_t data)
+oob_status_t esmi_oob_write_mailbox_h(struct apml_handle *handle,
+				      uint32_t cmd, uint32_t data)
 {
 	struct apml_message msg = {0};
 
@@ -154,30 +1035,78 @@ oob_status_t esmi_oob_write_mailbox(uint8_t soc_num,
 
 	msg.data_in.mb_in[1] = (uint32_t)WRITE_MODE << 24;
 
-	return sbrmi_xfer_msg(soc_num, SBRMI, &msg);
+	return sbrmi_xfer_msg_h(handle, SBRMI, &msg);
+}
+
+void apml_mailbox_read_msg(struct apml_message *msg, uint32_t cmd,
+			   uint32_t input)
+{
+	memset(msg, 0, sizeof(*msg));
+	msg->cmd = cmd;
+	msg->data_in.mb_in[0] = input;
+
+	msg->data_in.mb_in[1] = (uint32_t)READ_MODE << 24;
 }
 
 /*
  * The answer for our mailbox request is placed on registers 0x31-0x34
  */
-oob_status_t esmi_oob_read_mailbox(uint8_t soc_num,
-                                   uint32_t cmd, uint32_t input, uint32_t *buffer)
+oob_status_t esmi_oob_read_mailbox_h(struct apml_handle *handle,
+				     uint32_t cmd, uint32_t input,
+				     uint32_t *buffer)
 {
-	struct apml_message msg = {0};
+	struct apml_message msg;
 	oob_status_t ret = 0;
 
 	/* NULL pointer check */
 	if (!buffer)
 		return OOB_ARG_PTR_NULL;
 
-	msg.cmd = cmd;
-	msg.data_in.mb_in[0] = input;
-
-	msg.data_in.mb_in[1] = (uint32_t)READ_MODE << 24;
-	ret = sbrmi_xfer_msg(soc_num, SBRMI, &msg);
+	apml_mailbox_read_msg(&msg, cmd, input);
+	ret = sbrmi_xfer_msg_h(handle, SBRMI, &msg);
 	if (ret)
 		return ret;
 
 	*buffer = msg.data_out.mb_out[0];
 	return OOB_SUCCESS;
 }
+
+/*
+ * Socket index based API, operating on the default handle of the socket
+ */
+oob_status_t sbrmi_xfer_msg(uint8_t socket_num, char *filename,
+			    struct apml_message *msg)
+{
+	return sbrmi_xfer_msg_h(apml_socket_handle(socket_num), filename, msg);
+}
+
+oob_status_t esmi_oob_read_byte(uint8_t soc_num,
+				uint8_t reg_offset,
+				char *file_name,
+				uint8_t *buffer)
+{
+	return esmi_oob_read_byte_h(apml_socket_handle(soc_num), reg_offset,
+				    file_name, buffer);
+}
+
+oob_status_t esmi_oob_write_byte(uint8_t soc_num,
+				 uint8_t reg_offset,
+				 char *file_name,
+				 uint8_t value)
+{
+	return esmi_oob_write_byte_h(apml_socket_handle(soc_num), reg_offset,
+				     file_name, value);
+}
+
+oob_status_t esmi_oob_write_mailbox(uint8_t soc_num,
+                                    uint32_t cmd, uint32_t data)
+{
+	return esmi_oob_write_mailbox_h(apml_socket_handle(soc_num), cmd, data);
+}
+
+oob_status_t esmi_oob_read_mailbox(uint8_t soc_num,
+                                   uint32_t cmd, uint32_t input, uint32_t *buffer)
+{
+	return esmi_oob_read_mailbox_h(apml_socket_handle(soc_num), cmd, input,
+				       buffer);
+}
@@ -0,0 +1,389 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *		AMD Research and AMD Software Development
+ *
+ *		Advanced Micro Devices, Inc.
+ *
+ *		www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+#include <sys/eventfd.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <esmi_oob/apml.h>
+
+#include "common.h"
+
+/* Push onto a lock-free stack, the consumers always take the whole stack */
+static void apml_req_push(_Atomic(struct apml_req *) *head,
+			  struct apml_req *req)
+{
+	req->next = atomic_load(head);
+	while (!atomic_compare_exchange_weak(head, &req->next, req))
+		;
+}
+
+/* Take the whole stack and return it in push order */
+static struct apml_req *apml_req_take_all(_Atomic(struct apml_req *) *head)
+{
+	struct apml_req *req, *next, *fifo = NULL;
+
+	for (req = atomic_exchange(head, NULL); req; req = next) {
+		next = req->next;
+		req->next = fifo;
+		fifo = req;
+	}
+
+	return fifo;
+}
+
+/* Requests taken by the worker, one FIFO per priority class */
+struct apml_runq {
+	struct apml_req *head[APML_PRIO_MAX];
+	struct apml_req **tail[APML_PRIO_MAX];
+	unsigned int passed[APML_PRIO_MAX];	/* picks while waiting */
+	unsigned int len;
+};
+
+static void apml_runq_add(struct apml_runq *rq, struct apml_req *req)
+{
+	struct apml_req *next;
+	int prio;
+
+	for (; req; req = next) {
+		next = req->next;
+		prio = req->sched.prio;
+		req->next = NULL;
+		*rq->tail[prio] = req;
+		rq->tail[prio] = &req->next;
+		rq->len++;
+	}
+}
+
+/* Same policy as the bus: aged class first, then the most urgent one */
+static struct apml_req *apml_runq_pick(struct apml_runq *rq)
+{
+	struct apml_req *req;
+	int prio, c;
+
+	for (prio = 0; prio < APML_PRIO_MAX; prio++)
+		if (rq->head[prio] && rq->passed[prio] >= APML_PRIO_AGING)
+			break;
+	if (prio == APML_PRIO_MAX)
+		for (prio = 0; prio < APML_PRIO_MAX; prio++)
+			if (rq->head[prio])
+				break;
+
+	req = rq->head[prio];
+	rq->head[prio] = req->next;
+	if (!rq->head[prio])
+		rq->tail[prio] = &rq->head[prio];
+	rq->len--;
+
+	for (c = 0; c < APML_PRIO_MAX; c++)
+		if (rq->head[c])
+			rq->passed[c]++;
+	rq->passed[prio] = 0;
+
+	return req;
+}
+
+static void *apml_worker(void *arg)
+{
+	struct apml_socket *sock = arg;
+	struct apml_runq rq = {0};
+	struct apml_req *req;
+	uint64_t one = 1;
+	int prio;
+
+	for (prio = 0; prio < APML_PRIO_MAX; prio++)
+		rq.tail[prio] = &rq.head[prio];
+
+	for (;;) {
+		if (!rq.len)
+			while (sem_wait(&sock->sq_sem) && errno == EINTR)
+				;
+		/* Requests submitted meanwhile compete with the queued ones */
+		apml_runq_add(&rq, apml_req_take_all(&sock->sq));
+		if (!rq.len) {
+			if (atomic_load(&sock->worker_stop))
+				break;
+			continue;
+		}
+
+		req = apml_runq_pick(&rq);
+		if (req->cancel_gen != atomic_load(&req->handle->cancel_gen))
+			req->status = OOB_INTERRUPTED;
+		else
+			req->status = apml_xfer_until(req->handle,
+						      req->file_name,
+						      req->msg, 1, NULL,
+						      &req->sched);
+		apml_req_push(&req->handle->cq, req);
+		if (write(req->handle->event_fd, &one, sizeof(one)) < 0) {
+			/* Counter saturated, already readable */
+		}
+	}
+
+	return NULL;
+}
+
+oob_status_t apml_async_attach(struct apml_handle *handle)
+{
+	struct apml_socket *sock = handle->sock;
+	int ret = 0;
+
+	handle->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (handle->event_fd < 0)
+		return errno_to_oob_status(errno);
+
+	pthread_mutex_lock(&sock->worker_lock);
+	if (!sock->worker_refs) {
+		atomic_store(&sock->worker_stop, false);
+		if (sem_init(&sock->sq_sem, 0, 0))
+			ret = errno;
+		else
+			ret = pthread_create(&sock->worker, NULL,
+					     apml_worker, sock);
+		if (ret)
+			sem_destroy(&sock->sq_sem);
+	}
+	if (!ret)
+		sock->worker_refs++;
+	pthread_mutex_unlock(&sock->worker_lock);
+
+	if (ret) {
+		close(handle->event_fd);
+		handle->event_fd = -1;
+		return errno_to_oob_status(ret);
+	}
+
+	return OOB_SUCCESS;
+}
+
+void apml_async_detach(struct apml_handle *handle)
+{
+	struct apml_socket *sock = handle->sock;
+	struct pollfd pfd = {handle->event_fd, POLLIN, 0};
+
+	while (atomic_load(&handle->inflight)) {
+		if (poll(&pfd, 1, -1) < 0 && errno != EINTR)
+			break;
+		apml_process_completions(handle, NULL);
+	}
+
+	pthread_mutex_lock(&sock->worker_lock);
+	if (!--sock->worker_refs) {
+		atomic_store(&sock->worker_stop, true);
+		sem_post(&sock->sq_sem);
+		pthread_join(sock->worker, NULL);
+		sem_destroy(&sock->sq_sem);
+	}
+	pthread_mutex_unlock(&sock->worker_lock);
+
+	close(handle->event_fd);
+	handle->event_fd = -1;
+}
+
+oob_status_t apml_submit(struct apml_handle *handle, char *file_name,
+			 struct apml_message *msg, apml_callback_t callback,
+			 void *ctx)
+{
+	struct apml_req *req;
+
+	if (!handle || !file_name || !msg || !callback)
+		return OOB_ARG_PTR_NULL;
+	if (!(handle->flags & APML_OPEN_ASYNC))
+		return OOB_NOT_INITIALIZED;
+
+	req = calloc(1, sizeof(*req));
+	if (!req)
+		return OOB_NO_MEMORY;
+
+	/* Keep our own copy of the name, the caller's may not outlive us */
+	if (!strcmp(file_name, SBRMI)) {
+		req->file_name = SBRMI;
+	} else if (!strcmp(file_name, SBTSI)) {
+		req->file_name = SBTSI;
+	} else {
+		free(req);
+		return OOB_INVALID_INPUT;
+	}
+	req->handle = handle;
+	req->msg = msg;
+	req->callback = callback;
+	req->ctx = ctx;
+	req->sched.deadline_ns = handle->opts.deadline_ns;
+	req->sched.prio = apml_msgs_prio(handle, msg, 1);
+	req->sched.max_age_ns = handle->opts.max_age_ns;
+	req->cancel_gen = atomic_load(&handle->cancel_gen);
+
+	atomic_fetch_add(&handle->inflight, 1);
+	apml_req_push(&handle->sock->sq, req);
+	sem_post(&handle->sock->sq_sem);
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_cancel(struct apml_handle *handle)
+{
+	if (!handle)
+		return OOB_ARG_PTR_NULL;
+	if (!(handle->flags & APML_OPEN_ASYNC))
+		return OOB_NOT_INITIALIZED;
+
+	atomic_fetch_add(&handle->cancel_gen, 1);
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_get_event_fd(struct apml_handle *handle, int *fd)
+{
+	if (!handle || !fd)
+		return OOB_ARG_PTR_NULL;
+	if (!(handle->flags & APML_OPEN_ASYNC))
+		return OOB_NOT_INITIALIZED;
+
+	*fd = handle->event_fd;
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_process_completions(struct apml_handle *handle,
+				      unsigned int *count)
+{
+	struct apml_req *req, *next;
+	unsigned int n = 0;
+	uint64_t val;
+
+	if (!handle)
+		return OOB_ARG_PTR_NULL;
+	if (!(handle->flags & APML_OPEN_ASYNC))
+		return OOB_NOT_INITIALIZED;
+
+	/* Clear the eventfd before taking the stack so no wakeup is lost */
+	if (read(handle->event_fd, &val, sizeof(val)) < 0) {
+		/* EAGAIN, nothing signalled since the last call */
+	}
+
+	for (req = apml_req_take_all(&handle->cq); req; req = next) {
+		next = req->next;
+		req->callback(handle, req->msg, req->status, req->ctx);
+		atomic_fetch_sub(&handle->inflight, 1);
+		free(req);
+		n++;
+	}
+
+	if (count)
+		*count = n;
+
+	return OOB_SUCCESS;
+}
+
+/* Work of one socket in apml_for_each_socket() */
+struct apml_fanout {
+	pthread_t thread;
+	bool spawned;
+	struct apml_handle *handle;
+	apml_socket_fn_t fn;
+	void *result;
+	void *arg;
+	oob_status_t status;
+};
+
+static void *apml_fanout_worker(void *arg)
+{
+	struct apml_fanout *f = arg;
+
+	f->status = f->fn(f->handle, f->result, f->arg);
+
+	return NULL;
+}
+
+oob_status_t apml_for_each_socket(uint8_t num_sockets, apml_socket_fn_t fn,
+				  void *arg, void *results, size_t result_size,
+				  oob_status_t *status)
+{
+	struct apml_fanout *f;
+	oob_status_t ret = OOB_SUCCESS;
+	int i;
+
+	if (!fn)
+		return OOB_ARG_PTR_NULL;
+	if (!num_sockets)
+		return OOB_SUCCESS;
+
+	f = calloc(num_sockets, sizeof(*f));
+	if (!f)
+		return OOB_NO_MEMORY;
+
+	for (i = 0; i < num_sockets; i++) {
+		f[i].handle = apml_socket_handle(i);
+		f[i].fn = fn;
+		f[i].result = results ? (char *)results + i * result_size : NULL;
+		f[i].arg = arg;
+	}
+
+	/* One thread per bus, the caller takes socket 0 itself */
+	for (i = 1; i < num_sockets; i++)
+		f[i].spawned = !pthread_create(&f[i].thread, NULL,
+					       apml_fanout_worker, &f[i]);
+	apml_fanout_worker(&f[0]);
+
+	for (i = 1; i < num_sockets; i++) {
+		if (f[i].spawned)
+			pthread_join(f[i].thread, NULL);
+		else
+			apml_fanout_worker(&f[i]);
+	}
+
+	for (i = 0; i < num_sockets; i++) {
+		if (status)
+			status[i] = f[i].status;
+		if (!ret)
+			ret = f[i].status;
+	}
+	free(f);
+
+	return ret;
+}
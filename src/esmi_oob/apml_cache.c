@@ -0,0 +1,638 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *		AMD Research and AMD Software Development
+ *
+ *		Advanced Micro Devices, Inc.
+ *
+ *		www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <esmi_oob/apml.h>
+#include <esmi_oob/esmi_cpuid_msr.h>
+#include <esmi_oob/esmi_rmi.h>
+
+#include "common.h"
+
+#define DISK_MAGIC		0x4c4d5041	/* "APML" */
+#define DISK_VERSION		3
+
+#define READ_CACHE_SLOTS	64
+#define READ_KEY_VALID		(1ULL << 63)
+
+/* disk_state of a socket */
+enum {
+	APML_DISK_UNLOADED = 0,		/* record not merged yet */
+	APML_DISK_LOADING,		/* being merged or checked by one thread */
+	APML_DISK_LOADED,		/* merged, fingerprint not checked yet */
+	APML_DISK_VALID,		/* checked, or started by this process */
+	APML_DISK_FAILED,		/* not readable, cached in memory only */
+};
+
+/*
+ * Cache file layout, in host byte order. A record holds the cache[] words
+ * of struct apml_socket for one host reset generation: it is emptied when
+ * a transaction reports a warm reset, and the file lives in /run, which is
+ * emptied on boot. Its APML_CACHE_RMI_REV and APML_CACHE_CPU_SIG words are
+ * the fingerprint of the processor the values were read from, which
+ * catches the resets no process saw.
+ */
+struct disk_record {
+	uint64_t words[APML_CACHE_MAX];
+};
+
+struct disk_file {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t sockets;		/* APML_MAX_SOCKETS */
+	uint32_t words;			/* APML_CACHE_MAX */
+	struct disk_record rec[APML_MAX_SOCKETS];
+};
+
+struct disk_cache {
+	int fd;
+	struct disk_file *map;
+};
+
+/*
+ * Cache file set by apml_set_disk_cache(). A replaced one is never
+ * unmapped as other threads may still be using it.
+ */
+static _Atomic(struct disk_cache *) disk;
+/* The records are accessed under disk_lock and a flock() of the file */
+static pthread_mutex_t disk_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void disk_lock_acquire(struct disk_cache *d)
+{
+	pthread_mutex_lock(&disk_lock);
+	flock(d->fd, LOCK_EX);
+}
+
+static void disk_lock_release(struct disk_cache *d)
+{
+	flock(d->fd, LOCK_UN);
+	pthread_mutex_unlock(&disk_lock);
+}
+
+static uint64_t cache_word(struct apml_socket *sock, int id)
+{
+	return atomic_load_explicit(&sock->cache[id], memory_order_relaxed);
+}
+
+/*
+ * Merge the record of a socket with the values cached in the process. The
+ * record is trusted until a value it lacks has to be read from the
+ * processor anyway, see disk_check().
+ */
+static void disk_merge(struct apml_handle *handle, struct disk_cache *d)
+{
+	struct apml_socket *sock = handle->sock;
+	uint64_t *words, v;
+	bool empty = true;
+	int i;
+
+	words = d->map->rec[handle->soc_num].words;
+	disk_lock_acquire(d);
+	/* Dropped meanwhile by apml_socket_invalidate() */
+	if (atomic_load(&sock->disk_state) != APML_DISK_LOADING) {
+		disk_lock_release(d);
+		return;
+	}
+	for (i = 0; i < APML_CACHE_MAX; i++) {
+		if (words[i] & APML_CACHED)
+			empty = false;
+		v = cache_word(sock, i);
+		if (v & APML_CACHED)
+			words[i] = v;
+		else if (words[i] & APML_CACHED)
+			atomic_store_explicit(&sock->cache[i], words[i],
+					      memory_order_relaxed);
+	}
+	/* An empty record only holds what this process read */
+	atomic_store(&sock->disk_state,
+		     empty ? APML_DISK_VALID : APML_DISK_LOADED);
+	disk_lock_release(d);
+}
+
+/*
+ * Check the fingerprint of a merged record against the processor. A record
+ * of another processor, or one without a fingerprint, is started over
+ * along with the values taken from it. When the fingerprint cannot be read
+ * the socket is cached in memory only until it is invalidated, instead of
+ * reading it again on every miss.
+ */
+static void disk_check(struct apml_handle *handle, struct disk_cache *d)
+{
+	struct apml_socket *sock = handle->sock;
+	struct processor_info info;
+	int state = APML_DISK_LOADING;
+	uint64_t *words;
+	uint8_t rev;
+	int i;
+
+	/* The revision is always read, the signature once dropped */
+	atomic_store_explicit(&sock->cache[APML_CACHE_CPU_SIG], 0,
+			      memory_order_relaxed);
+	if (read_sbrmi_revision_h(handle, &rev) ||
+	    esmi_get_processor_info_h(handle, &info)) {
+		atomic_compare_exchange_strong(&sock->disk_state, &state,
+					       APML_DISK_FAILED);
+		return;
+	}
+
+	words = d->map->rec[handle->soc_num].words;
+	disk_lock_acquire(d);
+	if (atomic_load(&sock->disk_state) != APML_DISK_LOADING) {
+		disk_lock_release(d);
+		return;
+	}
+	if (words[APML_CACHE_RMI_REV] != cache_word(sock, APML_CACHE_RMI_REV) ||
+	    words[APML_CACHE_CPU_SIG] != cache_word(sock, APML_CACHE_CPU_SIG)) {
+		/* Keep what was just read: the fingerprint transactions */
+		for (i = 0; i < APML_CACHE_MAX; i++)
+			if (i != APML_CACHE_RMI_REV &&
+			    i != APML_CACHE_CPU_SIG &&
+			    i != APML_CACHE_THREADS_PER_SOCKET)
+				atomic_store_explicit(&sock->cache[i], 0,
+						      memory_order_relaxed);
+		for (i = 0; i < APML_CACHE_MAX; i++)
+			words[i] = cache_word(sock, i);
+	}
+	atomic_store(&sock->disk_state, APML_DISK_VALID);
+	disk_lock_release(d);
+}
+
+/*
+ * Look a value up in the record of the socket. With check, the value is
+ * to be read from the processor when missing from the record too.
+ */
+static bool disk_get(struct apml_handle *handle, int id, uint32_t *val,
+		     bool check)
+{
+	struct disk_cache *d = atomic_load_explicit(&disk,
+						    memory_order_acquire);
+	atomic_int *state = &handle->sock->disk_state;
+	int expected = APML_DISK_UNLOADED;
+	uint64_t v;
+
+	if (!d)
+		return false;
+
+	/* Only the first miss after the record was dropped merges it */
+	if (atomic_compare_exchange_strong(state, &expected,
+					   APML_DISK_LOADING))
+		disk_merge(handle, d);
+	v = cache_word(handle->sock, id);
+	if (v & APML_CACHED)
+		goto hit;
+
+	/* The value is read from the processor anyway, check the record */
+	expected = APML_DISK_LOADED;
+	if (!check ||
+	    !atomic_compare_exchange_strong(state, &expected,
+					    APML_DISK_LOADING))
+		return false;
+	disk_check(handle, d);
+	v = cache_word(handle->sock, id);
+	if (!(v & APML_CACHED))
+		return false;
+hit:
+	*val = (uint32_t)v;
+	return true;
+}
+
+bool apml_cache_miss(struct apml_handle *handle, int id, uint32_t *val)
+{
+	return disk_get(handle, id, val, true);
+}
+
+/* Write a word changed in the process to the record of its socket */
+static void disk_write(struct apml_handle *handle, int id)
+{
+	struct apml_socket *sock = handle->sock;
+	struct disk_cache *d;
+	int state;
+
+	d = atomic_load_explicit(&disk, memory_order_acquire);
+	if (!d)
+		return;
+	/* A value learnt first, e.g. the mailbox support, merges the record */
+	state = APML_DISK_UNLOADED;
+	if (atomic_compare_exchange_strong(&sock->disk_state, &state,
+					   APML_DISK_LOADING)) {
+		disk_merge(handle, d);
+		return;
+	}
+	if (state != APML_DISK_LOADED && state != APML_DISK_VALID)
+		return;
+	disk_lock_acquire(d);
+	/* The latest value, whichever of the racing writers gets here last */
+	state = atomic_load(&sock->disk_state);
+	if (state == APML_DISK_LOADED || state == APML_DISK_VALID)
+		d->map->rec[handle->soc_num].words[id] = cache_word(sock, id);
+	disk_lock_release(d);
+}
+
+void apml_cache_set(struct apml_handle *handle, int id, uint32_t val)
+{
+	uint64_t v = val | APML_CACHED;
+
+	if (!handle || !handle->sock)
+		return;
+
+	if (atomic_exchange_explicit(&handle->sock->cache[id], v,
+				     memory_order_relaxed) != v)
+		disk_write(handle, id);
+}
+
+void apml_cache_set_bit(struct apml_handle *handle, int id, unsigned int bit)
+{
+	uint64_t v = APML_CACHED | 1u << bit;
+
+	if (!handle || !handle->sock)
+		return;
+
+	/* Most calls find the bit already set */
+	if ((cache_word(handle->sock, id) & v) == v)
+		return;
+	if ((atomic_fetch_or_explicit(&handle->sock->cache[id], v,
+				      memory_order_relaxed) & v) != v)
+		disk_write(handle, id);
+}
+
+void apml_socket_invalidate(uint8_t soc_num, bool reset)
+{
+	struct apml_socket *sock;
+	struct disk_cache *d;
+	int i;
+
+	if (soc_num >= APML_MAX_SOCKETS)
+		return;
+
+	sock = apml_socket_handle(soc_num)->sock;
+	d = atomic_load_explicit(&disk, memory_order_acquire);
+	if (d)
+		disk_lock_acquire(d);
+	for (i = 0; i < APML_CACHE_MAX; i++)
+		atomic_store_explicit(&sock->cache[i], 0,
+				      memory_order_relaxed);
+	for (i = 0; i < APML_TSI_SHADOW_REGS; i++)
+		atomic_store_explicit(&sock->tsi_shadow[i], 0,
+				      memory_order_relaxed);
+	atomic_store_explicit(&sock->tsi_read_order, 0, memory_order_relaxed);
+	atomic_fetch_add_explicit(&sock->cpuid_gen, 1, memory_order_relaxed);
+	for (i = 0; i < APML_INTF_MAX; i++)
+		atomic_fetch_add_explicit(&sock->dev[i].read_gen, 1,
+					  memory_order_release);
+	/* Merged again on the next miss, unless the host was reset */
+	atomic_store(&sock->disk_state, APML_DISK_UNLOADED);
+	if (d) {
+		if (reset)
+			memset(&d->map->rec[soc_num], 0,
+			       sizeof(struct disk_record));
+		disk_lock_release(d);
+	}
+}
+
+oob_status_t apml_invalidate_socket_cache(uint8_t soc_num)
+{
+	if (soc_num >= APML_MAX_SOCKETS)
+		return OOB_INVALID_INPUT;
+
+	apml_socket_invalidate(soc_num, true);
+	return OOB_SUCCESS;
+}
+
+void apml_mailbox_learn(uint8_t soc_num, int intf, struct apml_message *msg,
+			oob_status_t status)
+{
+	int cmd = apml_cmd_slot(intf, msg);
+	int id;
+
+	if (cmd < 0 || cmd >= APML_MB_MAX_CMD)
+		return;
+
+	/* Any other firmware error still means the command was recognised */
+	if (status == OOB_MAILBOX_CMD_UNKNOWN)
+		id = APML_CACHE_MB_UNKNOWN;
+	else if (status == OOB_SUCCESS ||
+		 (status >= OOB_MAILBOX_ERR_START &&
+		  status <= OOB_MAILBOX_ERR_END))
+		id = APML_CACHE_MB_KNOWN;
+	else
+		return;
+
+	apml_cache_set_bit(apml_socket_handle(soc_num), id + cmd / 32,
+			   cmd % 32);
+}
+
+bool apml_mailbox_unknown(struct apml_handle *handle, int intf,
+			  struct apml_message *msg)
+{
+	int cmd = apml_cmd_slot(intf, msg);
+	uint64_t word;
+
+	if (!handle->sock || cmd < 0 || cmd >= APML_MB_MAX_CMD)
+		return false;
+
+	/* Called on every mailbox access, never loads the on-disk record */
+	word = cache_word(handle->sock, APML_CACHE_MB_UNKNOWN + cmd / 32);
+
+	return word & APML_CACHED && word & 1u << cmd % 32;
+}
+
+static bool mailbox_caps_word(struct apml_handle *handle, int id,
+			      uint32_t *val)
+{
+	uint64_t v = cache_word(handle->sock, id);
+
+	if (!(v & APML_CACHED))
+		return disk_get(handle, id, val, false);
+	*val = (uint32_t)v;
+	return true;
+}
+
+oob_status_t apml_get_mailbox_caps(uint8_t soc_num,
+				   struct apml_mailbox_caps *caps)
+{
+	struct apml_handle *handle = apml_socket_handle(soc_num);
+	int i;
+
+	if (!caps)
+		return OOB_ARG_PTR_NULL;
+	if (soc_num >= APML_MAX_SOCKETS)
+		return OOB_INVALID_INPUT;
+
+	/* Learnt from the replies, a bitmap missing is not read instead */
+	for (i = 0; i < APML_MB_CAP_WORDS; i++) {
+		if (!mailbox_caps_word(handle, APML_CACHE_MB_KNOWN + i,
+				       &caps->supported[i]))
+			caps->supported[i] = 0;
+		if (!mailbox_caps_word(handle, APML_CACHE_MB_UNKNOWN + i,
+				       &caps->unsupported[i]))
+			caps->unsupported[i] = 0;
+	}
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_get_mailbox_support(uint8_t soc_num, uint32_t cmd,
+				      apml_cmd_support_t *support)
+{
+	struct apml_mailbox_caps caps;
+	oob_status_t ret;
+
+	if (!support)
+		return OOB_ARG_PTR_NULL;
+	if (cmd >= APML_MB_MAX_CMD)
+		return OOB_INVALID_INPUT;
+
+	ret = apml_get_mailbox_caps(soc_num, &caps);
+	if (ret)
+		return ret;
+
+	if (caps.unsupported[cmd / 32] & 1u << cmd % 32)
+		*support = APML_CMD_UNSUPPORTED;
+	else if (caps.supported[cmd / 32] & 1u << cmd % 32)
+		*support = APML_CMD_SUPPORTED;
+	else
+		*support = APML_CMD_UNPROBED;
+
+	return OOB_SUCCESS;
+}
+
+/* Map the cache file, starting it over when written by another layout */
+static oob_status_t disk_open(const char *path, struct disk_cache **dp)
+{
+	struct disk_cache *d;
+	struct disk_file *map;
+	struct stat st;
+	char *dir;
+	int fd, err;
+
+	/* /run is emptied on boot, create the directory of the file again */
+	dir = strdup(path);
+	if (!dir)
+		return OOB_NO_MEMORY;
+	mkdir(dirname(dir), 0755);
+	free(dir);
+
+	fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (fd < 0)
+		return errno_to_oob_status(errno);
+
+	flock(fd, LOCK_EX);
+	if (fstat(fd, &st) ||
+	    (st.st_size != sizeof(*map) && ftruncate(fd, sizeof(*map))))
+		goto err;
+	map = mmap(NULL, sizeof(*map), PROT_READ | PROT_WRITE, MAP_SHARED,
+		   fd, 0);
+	if (map == MAP_FAILED)
+		goto err;
+	if (map->magic != DISK_MAGIC || map->version != DISK_VERSION ||
+	    map->sockets != APML_MAX_SOCKETS ||
+	    map->words != APML_CACHE_MAX) {
+		memset(map, 0, sizeof(*map));
+		map->magic = DISK_MAGIC;
+		map->version = DISK_VERSION;
+		map->sockets = APML_MAX_SOCKETS;
+		map->words = APML_CACHE_MAX;
+	}
+	flock(fd, LOCK_UN);
+
+	d = malloc(sizeof(*d));
+	if (!d) {
+		munmap(map, sizeof(*map));
+		close(fd);
+		return OOB_NO_MEMORY;
+	}
+	d->fd = fd;
+	d->map = map;
+	*dp = d;
+	return OOB_SUCCESS;
+
+err:
+	err = errno;
+	close(fd);
+	return errno_to_oob_status(err);
+}
+
+oob_status_t apml_set_disk_cache(const char *path)
+{
+	struct disk_cache *d = NULL;
+	oob_status_t ret;
+	int i;
+
+	if (path) {
+		ret = disk_open(path, &d);
+		if (ret)
+			return ret;
+	}
+
+	pthread_mutex_lock(&disk_lock);
+	atomic_store_explicit(&disk, d, memory_order_release);
+	for (i = 0; i < APML_MAX_SOCKETS; i++)
+		atomic_store(&apml_socket_handle(i)->sock->disk_state,
+			     APML_DISK_UNLOADED);
+	pthread_mutex_unlock(&disk_lock);
+
+	return OOB_SUCCESS;
+}
+
+/*
+ * Result of a read of a device, updated under a sequence count: odd while
+ * written, readers retry elsewhere when it changed under them.
+ */
+struct apml_read_slot {
+	atomic_uint seq;
+	atomic_uint_least64_t key;	/* READ_KEY_VALID | gen << 32 | cmd */
+	atomic_uint_least64_t data_in;
+	atomic_uint_least64_t data_out;
+	atomic_uint_least64_t start_ns;	/* when the read was issued */
+	atomic_uint fw_ret_code;
+};
+
+static uint64_t read_cache_key(unsigned int gen, uint32_t cmd)
+{
+	return READ_KEY_VALID | (uint64_t)(gen & 0x7fffffff) << 32 | cmd;
+}
+
+static struct apml_read_slot *read_cache_slot(struct apml_read_slot *tab,
+					      struct apml_message *msg)
+{
+	/* Fibonacci hashing of the input and the command */
+	return &tab[((msg->data_in.cpu_msr_in ^ msg->cmd) *
+		     0x9E3779B97F4A7C15ULL) >> 56 & (READ_CACHE_SLOTS - 1)];
+}
+
+/* Table of a device, allocated by the first caller asking for a hit */
+static struct apml_read_slot *read_cache_table(struct apml_dev *dev)
+{
+	struct apml_read_slot *tab, *cur = NULL;
+
+	tab = atomic_load_explicit(&dev->reads, memory_order_acquire);
+	if (tab)
+		return tab;
+
+	tab = calloc(READ_CACHE_SLOTS, sizeof(*tab));
+	if (!tab)
+		return NULL;
+	if (!atomic_compare_exchange_strong_explicit(&dev->reads, &cur, tab,
+						     memory_order_acq_rel,
+						     memory_order_acquire)) {
+		free(tab);
+		tab = cur;
+	}
+	return tab;
+}
+
+bool apml_read_cache_get(struct apml_dev *dev, struct apml_message *msg,
+			 uint64_t max_age_ns, uint64_t now_ns)
+{
+	struct apml_read_slot *tab = read_cache_table(dev), *slot;
+	uint64_t key, in, out, start;
+	unsigned int seq, gen, rc;
+
+	if (!tab)
+		return false;
+
+	slot = read_cache_slot(tab, msg);
+	seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+	if (seq & 1)
+		return false;
+	key = atomic_load_explicit(&slot->key, memory_order_relaxed);
+	in = atomic_load_explicit(&slot->data_in, memory_order_relaxed);
+	out = atomic_load_explicit(&slot->data_out, memory_order_relaxed);
+	start = atomic_load_explicit(&slot->start_ns, memory_order_relaxed);
+	rc = atomic_load_explicit(&slot->fw_ret_code, memory_order_relaxed);
+	atomic_thread_fence(memory_order_acquire);
+	if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != seq)
+		return false;
+
+	gen = atomic_load_explicit(&dev->read_gen, memory_order_acquire);
+	if (key != read_cache_key(gen, msg->cmd) ||
+	    in != msg->data_in.cpu_msr_in ||
+	    (now_ns > start && now_ns - start > max_age_ns))
+		return false;
+
+	msg->data_out.cpu_msr_out = out;
+	msg->fw_ret_code = rc;
+	return true;
+}
+
+void apml_read_cache_put(struct apml_dev *dev, struct apml_message *msg,
+			 unsigned int gen, uint64_t start_ns)
+{
+	struct apml_read_slot *tab, *slot;
+	unsigned int seq;
+
+	tab = atomic_load_explicit(&dev->reads, memory_order_acquire);
+	if (!tab)
+		return;
+
+	/* Skip the slot while another thread writes it */
+	slot = read_cache_slot(tab, msg);
+	seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+	if (seq & 1 ||
+	    !atomic_compare_exchange_strong_explicit(&slot->seq, &seq,
+						     seq + 1,
+						     memory_order_relaxed,
+						     memory_order_relaxed))
+		return;
+	atomic_thread_fence(memory_order_release);
+
+	atomic_store_explicit(&slot->key, read_cache_key(gen, msg->cmd),
+			      memory_order_relaxed);
+	atomic_store_explicit(&slot->data_in, msg->data_in.cpu_msr_in,
+			      memory_order_relaxed);
+	atomic_store_explicit(&slot->data_out, msg->data_out.cpu_msr_out,
+			      memory_order_relaxed);
+	atomic_store_explicit(&slot->start_ns, start_ns,
+			      memory_order_relaxed);
+	atomic_store_explicit(&slot->fw_ret_code, msg->fw_ret_code,
+			      memory_order_relaxed);
+	atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+}
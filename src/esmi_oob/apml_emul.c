@@ -0,0 +1,629 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *		AMD Research and AMD Software Development
+ *
+ *		Advanced Micro Devices, Inc.
+ *
+ *		www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <esmi_oob/apml.h>
+#include <esmi_oob/apml_emul.h>
+#include <esmi_oob/esmi_cpuid_msr.h>
+#include <esmi_oob/esmi_mailbox.h>
+#include <esmi_oob/esmi_rmi.h>
+#include <esmi_oob/esmi_tsi.h>
+
+#include "common.h"
+
+/* Register access message layout, see esmi_oob_read_byte() */
+#define REG_OFFSET		0
+#define REG_VALUE		4
+#define REG_READ		7
+
+/* Latency and error keys: mailbox commands, then CPUID, MCA MSR, REG */
+#define EMUL_MB_CMDS		0x100
+#define EMUL_KEY_CPUID		(EMUL_MB_CMDS + 0)
+#define EMUL_KEY_MCA_MSR	(EMUL_MB_CMDS + 1)
+#define EMUL_KEY_REG		(EMUL_MB_CMDS + 2)
+#define EMUL_KEYS		(EMUL_MB_CMDS + 3)
+
+#define EMUL_CPUID_LEAVES	32
+#define EMUL_MSRS		64
+
+/* Emulated processor: 96 cores, 2 threads per core */
+#define EMUL_THREADS		192
+/* RAPL energy status unit 2^-14 J, see READ_BMC_RAPL_UNITS */
+#define EMUL_ESU		14
+#define EMUL_CORE_UNITS_PER_S	(5ULL << EMUL_ESU)	/* 5 W per core */
+#define EMUL_PKG_UNITS_PER_S	(200ULL << EMUL_ESU)	/* 200 W package */
+
+struct emul_cpuid {
+	uint32_t fn_eax;
+	uint32_t fn_ecx;
+	uint32_t reg[4];	/* indexed by cpuid_reg */
+};
+
+struct emul_msr {
+	uint32_t addr;
+	uint64_t value;
+};
+
+struct emul_socket {
+	uint8_t regs[APML_INTF_MAX][UINT8_MAX + 1];
+	uint32_t mailbox[EMUL_MB_CMDS];
+	uint8_t fw_err[EMUL_KEYS];
+	struct emul_cpuid cpuid[EMUL_CPUID_LEAVES];
+	int n_cpuid;
+	struct emul_msr msr[EMUL_MSRS];
+	int n_msr;
+};
+
+struct emul_latency {
+	uint32_t min_ns;
+	uint32_t max_ns;
+};
+
+/*
+ * Mailbox commands known to the emulator with their default response.
+ * A write command updates the response of its read counterpart.
+ */
+struct emul_mb_cmd {
+	bool known;
+	uint8_t store;
+	uint32_t value;
+};
+
+#define MB_RD(cmd, val)	[cmd] = { .known = true, .value = (val) }
+#define MB_WR(cmd, rd)	[cmd] = { .known = true, .store = (rd) }
+
+static const struct emul_mb_cmd emul_mb_cmds[EMUL_MB_CMDS] = {
+	MB_RD(READ_PACKAGE_POWER_CONSUMPTION, 150000),
+	MB_WR(WRITE_PACKAGE_POWER_LIMIT, READ_PACKAGE_POWER_LIMIT),
+	MB_RD(READ_PACKAGE_POWER_LIMIT, 200000),
+	MB_RD(READ_MAX_PACKAGE_POWER_LIMIT, 240000),
+	MB_RD(READ_TDP, 200000),
+	MB_RD(READ_MAX_cTDP, 240000),
+	MB_RD(READ_MIN_cTDP, 200000),
+	MB_RD(READ_BIOS_BOOST_Fmax, 3700),
+	MB_RD(READ_APML_BOOST_LIMIT, 3700),
+	MB_WR(WRITE_APML_BOOST_LIMIT, READ_APML_BOOST_LIMIT),
+	MB_WR(WRITE_APML_BOOST_LIMIT_ALLCORES, READ_APML_BOOST_LIMIT),
+	MB_RD(READ_DRAM_THROTTLE, 0),
+	MB_WR(WRITE_DRAM_THROTTLE, READ_DRAM_THROTTLE),
+	MB_RD(READ_PROCHOT_STATUS, 0),
+	MB_RD(READ_PROCHOT_RESIDENCY, 0),
+	MB_RD(READ_NBIO_ERROR_LOGGING_REGISTER, 0),
+	MB_RD(READ_IOD_BIST, 0),
+	MB_RD(READ_CCD_BIST_RESULT, 0),
+	MB_RD(READ_CCX_BIST_RESULT, 0),
+	/* 460 GB/s max, 92 GB/s used, 20 % */
+	MB_RD(READ_DDR_BANDWIDTH, 460 << 20 | 92 << 8 | 20),
+	MB_WR(WRITE_BMC_REPORT_DIMM_POWER, 0),
+	MB_WR(WRITE_BMC_REPORT_DIMM_THERMAL_SENSOR, 0),
+	MB_RD(READ_BMC_RAS_PCIE_CONFIG_ACCESS, 0),
+	MB_RD(READ_BMC_RAS_MCA_VALIDITY_CHECK, 0),
+	MB_RD(READ_BMC_RAS_MCA_MSR_DUMP, 0),
+	MB_RD(READ_BMC_RAS_FCH_RESET_REASON, 0),
+	MB_RD(READ_DIMM_TEMP_RANGE_AND_REFRESH_RATE, 0),
+	MB_RD(READ_DIMM_POWER_CONSUMPTION, 0),
+	MB_RD(READ_DIMM_THERMAL_SENSOR, 0),
+	MB_RD(READ_PWR_CURRENT_ACTIVE_FREQ_LIMIT_SOCKET, 3700 << 16 | 0x1),
+	MB_RD(READ_PWR_CURRENT_ACTIVE_FREQ_LIMIT_CORE, 3700),
+	MB_RD(READ_PWR_SVI_TELEMETRY_ALL_RAILS, 150000),
+	MB_RD(READ_SOCKET_FREQ_RANGE, 3700 << 16 | 400),
+	MB_RD(READ_CURRENT_IO_BANDWIDTH, 0),
+	MB_RD(READ_CURRENT_XGMI_BANDWIDTH, 0),
+	MB_WR(WRITE_GMI3_LINK_WIDTH_RANGE, 0),
+	MB_WR(WRITE_XGMI_LINK_WIDTH_RANGE, 0),
+	MB_WR(WRITE_APB_DISABLE, 0),
+	MB_WR(WRITE_APB_ENABLE, 0),
+	MB_RD(READ_CURRENT_DFPSTATE_FREQUENCY, 2400 << 16 | 1 << 15 | 2000),
+	MB_WR(WRITE_LCLK_DPM_LEVEL_RANGE, 0),
+	MB_RD(READ_BMC_RAPL_UNITS, 0xA << 16 | EMUL_ESU << 8),
+	MB_RD(READ_BMC_RAPL_CORE_LO_COUNTER, 0),
+	MB_RD(READ_BMC_RAPL_CORE_HI_COUNTER, 0),
+	MB_RD(READ_BMC_RAPL_PKG_COUNTER, 0),
+	MB_RD(READ_BMC_CPU_BASE_FREQUENCY, 2400),
+	MB_RD(READ_BMC_CONTROL_PCIE_GEN5_RATE, 0),
+	MB_RD(READ_RAS_LAST_TRANSACTION_ADDRESS, 0),
+	MB_WR(WRITE_PWR_EFFICIENCY_MODE, 0),
+	MB_WR(WRITE_DF_PSTATE_RANGE, 0),
+	MB_RD(READ_LCLK_DPM_LEVEL_RANGE, 0x0100),
+};
+
+/* Default CPUID leaves: AuthenticAMD, family 19h model 11h stepping 1 */
+static const struct emul_cpuid emul_cpuid_leaves[] = {
+	{ 0x0, 0, { 0x10, 0x68747541, 0x444d4163, 0x69746e65 } },
+	{ 0x1, 0, { 0x00a10f11, EMUL_THREADS << 16 | 0x800,
+		    0x7ef8320b, 0x178bfbff } },
+	{ 0xb, 1, { 0x7, EMUL_THREADS, 0x201, 0 } },
+	{ 0x80000000, 0, { 0x80000028, 0x68747541, 0x444d4163,
+			   0x69746e65 } },
+	{ 0x80000008, 0, { 0x3030, 0, EMUL_THREADS - 1, 0 } },
+	{ 0x8000001e, 0, { 0, 1 << 8, 0, 0 } },
+};
+
+static struct emul_socket emul_sockets[APML_MAX_SOCKETS];
+static struct emul_latency emul_latency[EMUL_KEYS];
+static struct timespec emul_epoch;
+static pthread_mutex_t emul_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t emul_once = PTHREAD_ONCE_INIT;
+
+static int emul_key(uint32_t cmd)
+{
+	switch (cmd) {
+	case APML_CPUID:
+		return EMUL_KEY_CPUID;
+	case APML_MCA_MSR:
+		return EMUL_KEY_MCA_MSR;
+	case APML_REG:
+		return EMUL_KEY_REG;
+	default:
+		return cmd < EMUL_MB_CMDS ? (int)cmd : -1;
+	}
+}
+
+static void emul_set_rmi_layout(struct emul_socket *s, uint8_t revision)
+{
+	uint8_t *regs = s->regs[APML_INTF_SBRMI];
+	const uint8_t *thread_en;
+	size_t i, n;
+
+	memset(regs, 0, UINT8_MAX + 1);
+	regs[SBRMI_REVISION] = revision;
+	if (revision == 0x10) {
+		thread_en = thread_en_reg_v10;
+		n = sizeof(thread_en_reg_v10);
+	} else {
+		thread_en = thread_en_reg_v20;
+		n = sizeof(thread_en_reg_v20);
+	}
+	/* One enable bit per thread */
+	for (i = 0; i < n && i * 8 < EMUL_THREADS; i++)
+		regs[thread_en[i]] = 0xff;
+	regs[SBRMI_THREADNUMBER] = EMUL_THREADS;
+	regs[SBRMI_THREADNUMBERLOW] = EMUL_THREADS & 0xff;
+	regs[SBRMI_THREADNUMBERHIGH] = EMUL_THREADS >> 8;
+}
+
+/* Called with emul_lock held, or from emul_once */
+static void emul_reset_locked(void)
+{
+	struct emul_socket *s;
+	uint8_t *tsi;
+	int i, cmd;
+
+	for (i = 0; i < APML_MAX_SOCKETS; i++) {
+		s = &emul_sockets[i];
+		memset(s, 0, sizeof(*s));
+		emul_set_rmi_layout(s, 0x20);
+
+		tsi = s->regs[APML_INTF_SBTSI];
+		tsi[SBTSI_CPUTEMPINT] = 45;
+		tsi[SBTSI_CPUTEMPDEC] = 0x40;		/* 45.25 C */
+		tsi[SBTSI_UPDATERATE] = 0x8;
+		tsi[SBTSI_HITEMPINT] = 70;
+		tsi[SBTSI_TIMEOUTCONFIG] = 0x80;
+		tsi[SBTSI_REVISION] = 0x4;
+
+		for (cmd = 0; cmd < EMUL_MB_CMDS; cmd++)
+			s->mailbox[cmd] = emul_mb_cmds[cmd].value;
+
+		memcpy(s->cpuid, emul_cpuid_leaves, sizeof(emul_cpuid_leaves));
+		s->n_cpuid = ARRAY_SIZE(emul_cpuid_leaves);
+	}
+	memset(emul_latency, 0, sizeof(emul_latency));
+	clock_gettime(CLOCK_MONOTONIC, &emul_epoch);
+}
+
+static void emul_init(void)
+{
+	emul_reset_locked();
+}
+
+static void emul_lock_state(void)
+{
+	pthread_once(&emul_once, emul_init);
+	pthread_mutex_lock(&emul_lock);
+}
+
+/* RAPL energy counter running at the given rate since the last reset */
+static uint64_t emul_energy(uint64_t units_per_s)
+{
+	struct timespec now;
+	uint64_t ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ns = (now.tv_sec - emul_epoch.tv_sec) * 1000000000ULL +
+	     now.tv_nsec - emul_epoch.tv_nsec;
+
+	return ns / 1000 * units_per_s / 1000000;
+}
+
+static void emul_delay(int key)
+{
+	static __thread uint64_t seed;
+	struct emul_latency lat;
+	struct timespec ts;
+	uint64_t ns;
+
+	pthread_mutex_lock(&emul_lock);
+	lat = emul_latency[key];
+	pthread_mutex_unlock(&emul_lock);
+	if (!lat.max_ns)
+		return;
+
+	ns = lat.min_ns;
+	if (lat.max_ns > lat.min_ns) {
+		/* xorshift64, uniform over [min_ns, max_ns] */
+		if (!seed)
+			seed = (uintptr_t)&seed ^ 0x9e3779b97f4a7c15ULL;
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+		ns += seed % (lat.max_ns - lat.min_ns + 1);
+	}
+
+	ts.tv_sec = ns / 1000000000;
+	ts.tv_nsec = ns % 1000000000;
+	while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR)
+		;
+}
+
+static void emul_reg(struct emul_socket *s, int intf,
+		     struct apml_message *msg)
+{
+	uint8_t *regs = s->regs[intf];
+	uint8_t reg = msg->data_in.reg_in[REG_OFFSET];
+	uint8_t val = msg->data_in.reg_in[REG_VALUE];
+
+	if (msg->data_in.reg_in[REG_READ]) {
+		msg->data_out.reg_out[0] = regs[reg];
+		return;
+	}
+
+	if (intf == APML_INTF_SBRMI && reg == SBRMI_RASSTATUS) {
+		/* Write 1 to clear */
+		regs[reg] &= ~val;
+		return;
+	}
+	regs[reg] = val;
+	if (intf == APML_INTF_SBTSI && reg == SBTSI_CONFIGWR)
+		regs[SBTSI_CONFIGURATION] = val;
+}
+
+static void emul_mailbox(struct emul_socket *s, struct apml_message *msg)
+{
+	const struct emul_mb_cmd *cmd = &emul_mb_cmds[msg->cmd];
+	uint32_t in = msg->data_in.mb_in[0];
+	uint64_t energy;
+
+	switch (msg->cmd) {
+	case READ_BMC_RAPL_CORE_LO_COUNTER:
+	case READ_BMC_RAPL_CORE_HI_COUNTER:
+		/* Cores draw slightly different power to tell them apart */
+		energy = emul_energy(EMUL_CORE_UNITS_PER_S + in);
+		msg->data_out.mb_out[0] =
+			msg->cmd == READ_BMC_RAPL_CORE_LO_COUNTER ?
+			(uint32_t)energy : energy >> 32;
+		return;
+	case READ_BMC_RAPL_PKG_COUNTER:
+		energy = emul_energy(EMUL_PKG_UNITS_PER_S);
+		msg->data_out.mb_out[0] = in ? energy >> 32 : (uint32_t)energy;
+		return;
+	default:
+		break;
+	}
+
+	if (cmd->store)
+		s->mailbox[cmd->store] = in;
+	msg->data_out.mb_out[0] = s->mailbox[msg->cmd];
+}
+
+static void emul_cpuid(struct emul_socket *s, struct apml_message *msg)
+{
+	uint32_t fn_eax = (uint32_t)msg->data_in.cpu_msr_in;
+	uint8_t ext = msg->data_in.cpu_msr_in >> 48;
+	uint32_t fn_ecx = ext >> 4;
+	struct emul_cpuid *leaf;
+	int i;
+
+	msg->data_out.cpu_msr_out = 0;
+	for (i = 0; i < s->n_cpuid; i++) {
+		leaf = &s->cpuid[i];
+		if (leaf->fn_eax != fn_eax || leaf->fn_ecx != fn_ecx)
+			continue;
+		/* Low nibble of the extension byte selects ecx/edx */
+		if (ext & 0xf) {
+			msg->data_out.mb_out[0] = leaf->reg[ECX];
+			msg->data_out.mb_out[1] = leaf->reg[EDX];
+		} else {
+			msg->data_out.mb_out[0] = leaf->reg[EAX];
+			msg->data_out.mb_out[1] = leaf->reg[EBX];
+		}
+		return;
+	}
+}
+
+static void emul_msr(struct emul_socket *s, struct apml_message *msg)
+{
+	uint32_t addr = (uint32_t)msg->data_in.cpu_msr_in;
+	int i;
+
+	msg->data_out.cpu_msr_out = 0;
+	for (i = 0; i < s->n_msr; i++) {
+		if (s->msr[i].addr == addr) {
+			msg->data_out.cpu_msr_out = s->msr[i].value;
+			return;
+		}
+	}
+}
+
+static int emul_open(uint8_t soc_num, int intf,
+		     char *file_name __maybe_unused)
+{
+	if (soc_num >= APML_MAX_SOCKETS || intf < 0) {
+		errno = ENODEV;
+		return -1;
+	}
+	pthread_once(&emul_once, emul_init);
+
+	return 0;
+}
+
+static int emul_xfer(int fd __maybe_unused, uint8_t soc_num, int intf,
+		     struct apml_message *msg)
+{
+	struct emul_socket *s = &emul_sockets[soc_num];
+	int key, ret = 0;
+
+	key = emul_key(msg->cmd);
+	if (key < 0 || (key < EMUL_MB_CMDS && !emul_mb_cmds[key].known)) {
+		/* Firmware rejects unknown mailbox commands */
+		msg->fw_ret_code = 0x2;
+		return EPROTOTYPE;
+	}
+	/* Only register access is available on SB-TSI */
+	if (intf == APML_INTF_SBTSI && key != EMUL_KEY_REG)
+		return EINVAL;
+
+	emul_delay(key);
+
+	pthread_mutex_lock(&emul_lock);
+	if (s->fw_err[key]) {
+		msg->fw_ret_code = s->fw_err[key];
+		ret = EPROTOTYPE;
+	} else if (key == EMUL_KEY_REG) {
+		emul_reg(s, intf, msg);
+	} else if (key == EMUL_KEY_CPUID) {
+		emul_cpuid(s, msg);
+	} else if (key == EMUL_KEY_MCA_MSR) {
+		emul_msr(s, msg);
+	} else {
+		emul_mailbox(s, msg);
+	}
+	pthread_mutex_unlock(&emul_lock);
+
+	return ret;
+}
+
+static void emul_close(int fd __maybe_unused)
+{
+}
+
+const struct apml_transport_ops apml_emul_transport = {
+	.caps = APML_CAP_REG | APML_CAP_MAILBOX | APML_CAP_CPUID |
+		APML_CAP_MCA_MSR,
+	.open = emul_open,
+	.xfer = emul_xfer,
+	.close = emul_close,
+};
+
+oob_status_t apml_emul_reset(void)
+{
+	int i;
+
+	emul_lock_state();
+	emul_reset_locked();
+	pthread_mutex_unlock(&emul_lock);
+	for (i = 0; i < APML_MAX_SOCKETS; i++)
+		apml_socket_invalidate(i, false);
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_emul_set_rmi_revision(uint8_t soc_num, uint8_t revision)
+{
+	if (soc_num >= APML_MAX_SOCKETS ||
+	    (revision != 0x10 && revision != 0x20))
+		return OOB_INVALID_INPUT;
+
+	emul_lock_state();
+	emul_set_rmi_layout(&emul_sockets[soc_num], revision);
+	pthread_mutex_unlock(&emul_lock);
+	apml_socket_invalidate(soc_num, false);
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_emul_set_reg(uint8_t soc_num, char *file_name,
+			       uint8_t reg, uint8_t value)
+{
+	int intf;
+
+	if (!file_name)
+		return OOB_ARG_PTR_NULL;
+	intf = apml_intf_index(file_name);
+	if (soc_num >= APML_MAX_SOCKETS || intf < 0)
+		return OOB_INVALID_INPUT;
+
+	emul_lock_state();
+	emul_sockets[soc_num].regs[intf][reg] = value;
+	pthread_mutex_unlock(&emul_lock);
+	apml_socket_invalidate(soc_num, false);
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_emul_get_reg(uint8_t soc_num, char *file_name,
+			       uint8_t reg, uint8_t *value)
+{
+	int intf;
+
+	if (!file_name || !value)
+		return OOB_ARG_PTR_NULL;
+	intf = apml_intf_index(file_name);
+	if (soc_num >= APML_MAX_SOCKETS || intf < 0)
+		return OOB_INVALID_INPUT;
+
+	emul_lock_state();
+	*value = emul_sockets[soc_num].regs[intf][reg];
+	pthread_mutex_unlock(&emul_lock);
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_emul_set_mailbox(uint8_t soc_num, uint32_t cmd,
+				   uint32_t value)
+{
+	if (soc_num >= APML_MAX_SOCKETS || cmd >= EMUL_MB_CMDS ||
+	    !emul_mb_cmds[cmd].known)
+		return OOB_INVALID_INPUT;
+
+	emul_lock_state();
+	emul_sockets[soc_num].mailbox[cmd] = value;
+	pthread_mutex_unlock(&emul_lock);
+	apml_socket_invalidate(soc_num, false);
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_emul_set_cpuid(uint8_t soc_num, uint32_t fn_eax,
+				 uint32_t fn_ecx, uint32_t eax, uint32_t ebx,
+				 uint32_t ecx, uint32_t edx)
+{
+	struct emul_socket *s;
+	oob_status_t ret = OOB_SUCCESS;
+	int i;
+
+	if (soc_num >= APML_MAX_SOCKETS || fn_ecx > 0xf)
+		return OOB_INVALID_INPUT;
+
+	emul_lock_state();
+	s = &emul_sockets[soc_num];
+	for (i = 0; i < s->n_cpuid; i++)
+		if (s->cpuid[i].fn_eax == fn_eax &&
+		    s->cpuid[i].fn_ecx == fn_ecx)
+			break;
+	if (i == EMUL_CPUID_LEAVES) {
+		ret = OOB_NO_MEMORY;
+	} else {
+		if (i == s->n_cpuid)
+			s->n_cpuid++;
+		s->cpuid[i] = (struct emul_cpuid) {
+			fn_eax, fn_ecx, { eax, ebx, ecx, edx }
+		};
+	}
+	pthread_mutex_unlock(&emul_lock);
+	apml_socket_invalidate(soc_num, false);
+
+	return ret;
+}
+
+oob_status_t apml_emul_set_msr(uint8_t soc_num, uint32_t msraddr,
+			       uint64_t value)
+{
+	struct emul_socket *s;
+	oob_status_t ret = OOB_SUCCESS;
+	int i;
+
+	if (soc_num >= APML_MAX_SOCKETS)
+		return OOB_INVALID_INPUT;
+
+	emul_lock_state();
+	s = &emul_sockets[soc_num];
+	for (i = 0; i < s->n_msr; i++)
+		if (s->msr[i].addr == msraddr)
+			break;
+	if (i == EMUL_MSRS) {
+		ret = OOB_NO_MEMORY;
+	} else {
+		if (i == s->n_msr)
+			s->n_msr++;
+		s->msr[i].addr = msraddr;
+		s->msr[i].value = value;
+	}
+	pthread_mutex_unlock(&emul_lock);
+
+	return ret;
+}
+
+oob_status_t apml_emul_set_latency(uint32_t cmd, uint32_t min_ns,
+				   uint32_t max_ns)
+{
+	int key = emul_key(cmd);
+
+	if (key < 0 || min_ns > max_ns)
+		return OOB_INVALID_INPUT;
+
+	emul_lock_state();
+	emul_latency[key].min_ns = min_ns;
+	emul_latency[key].max_ns = max_ns;
+	pthread_mutex_unlock(&emul_lock);
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_emul_set_fw_error(uint8_t soc_num, uint32_t cmd,
+				    uint8_t fw_ret_code)
+{
+	int key = emul_key(cmd);
+
+	if (soc_num >= APML_MAX_SOCKETS || key < 0)
+		return OOB_INVALID_INPUT;
+
+	emul_lock_state();
+	emul_sockets[soc_num].fw_err[key] = fw_ret_code;
+	pthread_mutex_unlock(&emul_lock);
+
+	return OOB_SUCCESS;
+}
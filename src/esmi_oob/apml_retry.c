@@ -0,0 +1,238 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *		AMD Research and AMD Software Development
+ *
+ *		Advanced Micro Devices, Inc.
+ *
+ *		www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <esmi_oob/apml.h>
+
+#include "common.h"
+
+/* Statuses retried by a policy without its own list */
+static const oob_status_t default_retry_on[] = {
+	OOB_TRY_AGAIN,
+	OOB_UNEXPECTED_SIZE,
+	OOB_CPUID_MSR_CMD_TIMEOUT,
+	OOB_MAILBOX_CMD_ABORTED,
+};
+
+/* Jitter generator, one per thread */
+static __thread uint64_t jitter_state;
+
+static uint32_t jitter(uint32_t range)
+{
+	uint64_t x = jitter_state;
+
+	if (!range)
+		return 0;
+	if (!x)
+		x = apml_monotonic_ns() | 1;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	jitter_state = x;
+
+	return x % range;
+}
+
+static bool retryable(const struct apml_retry_policy *policy,
+		      oob_status_t status)
+{
+	const oob_status_t *codes = policy->retry_on;
+	uint32_t i, n = policy->n_retry_on;
+
+	if (!status)
+		return false;
+	if (!n) {
+		codes = default_retry_on;
+		n = sizeof(default_retry_on) / sizeof(default_retry_on[0]);
+	}
+	for (i = 0; i < n; i++)
+		if (codes[i] == status)
+			return true;
+
+	return false;
+}
+
+/* Backoff before retry number @retry (1 for the first), half of it jitter */
+static uint64_t backoff_ns(const struct apml_retry_policy *policy,
+			   uint32_t retry)
+{
+	uint64_t delay = policy->base_delay_us;
+
+	delay <<= retry - 1 < 31 ? retry - 1 : 31;
+	if (policy->max_delay_us && delay > policy->max_delay_us)
+		delay = policy->max_delay_us;
+	delay = delay / 2 + jitter(delay / 2 + 1);
+
+	return delay * 1000;
+}
+
+static const struct apml_retry_policy *
+retry_policy(struct apml_handle *handle, int intf, struct apml_message *msg)
+{
+	int cmd;
+
+	if (handle->cmd_retry) {
+		cmd = apml_cmd_slot(intf, msg);
+		if (cmd >= 0 && handle->cmd_retry[cmd].max_attempts)
+			return &handle->cmd_retry[cmd];
+	}
+
+	return &handle->retry;
+}
+
+/*
+ * Policy of the first member of a batch failing with a status its policy
+ * retries, if that policy allows one more attempt
+ */
+static const struct apml_retry_policy *
+batch_policy(struct apml_handle *handle, int intf, struct apml_message *msgs,
+	     size_t n, oob_status_t *status, uint32_t attempt)
+{
+	const struct apml_retry_policy *policy;
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		policy = retry_policy(handle, intf, &msgs[i]);
+		if (retryable(policy, status[i]))
+			return attempt < policy->max_attempts ? policy : NULL;
+	}
+
+	return NULL;
+}
+
+void apml_retry_batch(struct apml_handle *handle, int intf, char *file_name,
+		      struct apml_message *msgs, size_t n,
+		      oob_status_t *status, uint64_t start_ns,
+		      const struct apml_sched *sched)
+{
+	const struct apml_retry_policy *policy;
+	struct timespec ts;
+	uint64_t delay, now;
+	uint32_t attempt;
+	size_t i;
+
+	/*
+	 * The members of a batch may be related, e.g. both halves of a
+	 * counter read between two reads of the high half. They are
+	 * re-issued together and in order, never one at a time.
+	 */
+	for (attempt = 1; (policy = batch_policy(handle, intf, msgs, n, status,
+						 attempt)); attempt++) {
+		delay = backoff_ns(policy, attempt);
+		now = apml_monotonic_ns();
+		if (policy->budget_us && now + delay - start_ns >
+		    (uint64_t)policy->budget_us * 1000)
+			break;
+		if (sched->deadline_ns && now + delay >= sched->deadline_ns)
+			break;
+
+		ts.tv_sec = delay / 1000000000;
+		ts.tv_nsec = delay % 1000000000;
+		nanosleep(&ts, NULL);
+
+		for (i = 0; i < n; i++)
+			apml_stats_retry(handle->soc_num, intf, &msgs[i]);
+		apml_issue_batch(handle, intf, file_name, msgs, n, status,
+				 sched);
+	}
+}
+
+static oob_status_t check_policy(const struct apml_retry_policy *policy)
+{
+	if (policy && policy->n_retry_on > APML_RETRY_MAX_CODES)
+		return OOB_INVALID_INPUT;
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_set_retry_policy(struct apml_handle *handle,
+				   const struct apml_retry_policy *policy)
+{
+	oob_status_t ret;
+
+	if (!handle)
+		return OOB_ARG_PTR_NULL;
+	ret = check_policy(policy);
+	if (ret)
+		return ret;
+
+	if (policy)
+		handle->retry = *policy;
+	else
+		memset(&handle->retry, 0, sizeof(handle->retry));
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_set_cmd_retry_policy(struct apml_handle *handle,
+				       uint32_t cmd,
+				       const struct apml_retry_policy *policy)
+{
+	oob_status_t ret;
+
+	if (!handle)
+		return OOB_ARG_PTR_NULL;
+	if (cmd >= APML_STATS_MAX_CMD)
+		return OOB_INVALID_INPUT;
+	ret = check_policy(policy);
+	if (ret)
+		return ret;
+
+	if (!handle->cmd_retry) {
+		if (!policy)
+			return OOB_SUCCESS;
+		handle->cmd_retry = calloc(APML_STATS_MAX_CMD,
+					   sizeof(*handle->cmd_retry));
+		if (!handle->cmd_retry)
+			return OOB_NO_MEMORY;
+	}
+
+	if (policy)
+		handle->cmd_retry[cmd] = *policy;
+	else
+		memset(&handle->cmd_retry[cmd], 0,
+		       sizeof(handle->cmd_retry[cmd]));
+
+	return OOB_SUCCESS;
+}
@@ -0,0 +1,280 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *		AMD Research and AMD Software Development
+ *
+ *		Advanced Micro Devices, Inc.
+ *
+ *		www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <esmi_oob/apml.h>
+#include <esmi_oob/apml_err.h>
+
+#include "common.h"
+
+/* Counters of one command, updated with relaxed atomic increments */
+struct stats_entry {
+	atomic_uint_fast64_t calls;
+	atomic_uint_fast64_t errors;
+	atomic_uint_fast64_t bytes;
+	atomic_uint_fast64_t total_ns;
+	atomic_uint_fast64_t retries;
+	atomic_uint_fast64_t coalesced;
+	atomic_uint_fast64_t cached;
+	atomic_uint_fast64_t err_count[APML_STATS_ERR_SLOTS];
+	atomic_uint_fast64_t latency[APML_STATS_LAT_BUCKETS];
+};
+
+static struct stats_entry stats[APML_MAX_SOCKETS][APML_STATS_MAX_CMD];
+
+/* Status of the error slots following OOB_INVALID_MSGSIZE */
+static const oob_status_t fw_err_slots[] = {
+	OOB_CPUID_MSR_ERR_START,
+	OOB_CPUID_MSR_CMD_TIMEOUT,
+	OOB_CPUID_MSR_CMD_WARM_RESET,
+	OOB_CPUID_MSR_CMD_UNKNOWN_FMT,
+	OOB_CPUID_MSR_CMD_INVAL_RD_LEN,
+	OOB_CPUID_MSR_CMD_EXCESS_DATA_LEN,
+	OOB_CPUID_MSR_CMD_INVAL_THREAD,
+	OOB_CPUID_MSR_CMD_UNSUPP,
+	OOB_CPUID_MSR_CMD_ABORTED,
+	OOB_MAILBOX_ERR_START,
+	OOB_MAILBOX_CMD_ABORTED,
+	OOB_MAILBOX_CMD_UNKNOWN,
+	OOB_MAILBOX_CMD_INVAL_CORE,
+};
+
+#define GENERIC_ERR_SLOTS	(OOB_INVALID_MSGSIZE + 1)
+#define FW_ERR_SLOTS		(sizeof(fw_err_slots) / sizeof(fw_err_slots[0]))
+
+_Static_assert(GENERIC_ERR_SLOTS + FW_ERR_SLOTS == APML_STATS_ERR_SLOTS,
+	       "APML_STATS_ERR_SLOTS out of sync with the error slots");
+
+static unsigned int stats_err_slot(oob_status_t status)
+{
+	unsigned int i;
+
+	if (status < GENERIC_ERR_SLOTS)
+		return status;
+
+	for (i = 0; i < FW_ERR_SLOTS; i++)
+		if (fw_err_slots[i] == status)
+			return GENERIC_ERR_SLOTS + i;
+
+	/* Firmware error without a slot of its own, counted with its base */
+	if (status >= OOB_MAILBOX_ERR_START && status <= OOB_MAILBOX_ERR_END)
+		return stats_err_slot(OOB_MAILBOX_ERR_START);
+	if (status >= OOB_CPUID_MSR_ERR_START &&
+	    status <= OOB_CPUID_MSR_ERR_END)
+		return stats_err_slot(OOB_CPUID_MSR_ERR_START);
+
+	return OOB_UNKNOWN_ERROR;
+}
+
+int apml_cmd_slot(int intf, struct apml_message *msg)
+{
+	switch (msg->cmd) {
+	case APML_CPUID:
+		return APML_STATS_CMD_CPUID;
+	case APML_MCA_MSR:
+		return APML_STATS_CMD_MCA_MSR;
+	case APML_REG:
+		return intf == APML_INTF_SBTSI ? APML_STATS_CMD_SBTSI_REG :
+						 APML_STATS_CMD_SBRMI_REG;
+	default:
+		return msg->cmd < 0x100 ? (int)msg->cmd : -1;
+	}
+}
+
+/* Payload bytes of the request and of the response */
+static unsigned int stats_msg_bytes(struct apml_message *msg)
+{
+	switch (msg->cmd) {
+	case APML_CPUID:
+	case APML_MCA_MSR:
+		return 2 * sizeof(uint64_t);
+	case APML_REG:
+		/* Register offset, then value written or read */
+		return 2;
+	default:
+		return 2 * sizeof(uint32_t);
+	}
+}
+
+static unsigned int stats_lat_bucket(uint64_t ns)
+{
+	unsigned int bucket = 63 - __builtin_clzll(ns | 1);
+
+	return bucket < APML_STATS_LAT_BUCKETS ? bucket :
+						 APML_STATS_LAT_BUCKETS - 1;
+}
+
+void apml_stats_record(uint8_t soc_num, int intf, struct apml_message *msg,
+		       oob_status_t status, uint64_t dur_ns)
+{
+	struct stats_entry *e;
+	int cmd;
+
+	cmd = apml_cmd_slot(intf, msg);
+	if (soc_num >= APML_MAX_SOCKETS || cmd < 0)
+		return;
+
+	e = &stats[soc_num][cmd];
+	atomic_fetch_add_explicit(&e->calls, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&e->bytes, stats_msg_bytes(msg),
+				  memory_order_relaxed);
+	atomic_fetch_add_explicit(&e->total_ns, dur_ns, memory_order_relaxed);
+	atomic_fetch_add_explicit(&e->latency[stats_lat_bucket(dur_ns)], 1,
+				  memory_order_relaxed);
+	if (status) {
+		atomic_fetch_add_explicit(&e->errors, 1, memory_order_relaxed);
+		atomic_fetch_add_explicit(&e->err_count[stats_err_slot(status)],
+					  1, memory_order_relaxed);
+	}
+}
+
+void apml_stats_retry(uint8_t soc_num, int intf, struct apml_message *msg)
+{
+	int cmd;
+
+	cmd = apml_cmd_slot(intf, msg);
+	if (soc_num >= APML_MAX_SOCKETS || cmd < 0)
+		return;
+
+	atomic_fetch_add_explicit(&stats[soc_num][cmd].retries, 1,
+				  memory_order_relaxed);
+}
+
+void apml_stats_coalesced(uint8_t soc_num, int intf,
+			  struct apml_message *msg)
+{
+	int cmd;
+
+	cmd = apml_cmd_slot(intf, msg);
+	if (soc_num >= APML_MAX_SOCKETS || cmd < 0)
+		return;
+
+	atomic_fetch_add_explicit(&stats[soc_num][cmd].coalesced, 1,
+				  memory_order_relaxed);
+}
+
+void apml_stats_cached(uint8_t soc_num, int intf, struct apml_message *msg)
+{
+	int cmd;
+
+	cmd = apml_cmd_slot(intf, msg);
+	if (soc_num >= APML_MAX_SOCKETS || cmd < 0)
+		return;
+
+	atomic_fetch_add_explicit(&stats[soc_num][cmd].cached, 1,
+				  memory_order_relaxed);
+}
+
+oob_status_t apml_get_stats(uint8_t soc_num, uint32_t cmd,
+			    struct apml_cmd_stats *st)
+{
+	struct stats_entry *e;
+	int i;
+
+	if (!st)
+		return OOB_ARG_PTR_NULL;
+	if (soc_num >= APML_MAX_SOCKETS || cmd >= APML_STATS_MAX_CMD)
+		return OOB_INVALID_INPUT;
+
+	e = &stats[soc_num][cmd];
+	st->calls = atomic_load_explicit(&e->calls, memory_order_relaxed);
+	st->errors = atomic_load_explicit(&e->errors, memory_order_relaxed);
+	st->bytes = atomic_load_explicit(&e->bytes, memory_order_relaxed);
+	st->total_ns = atomic_load_explicit(&e->total_ns,
+					    memory_order_relaxed);
+	st->retries = atomic_load_explicit(&e->retries, memory_order_relaxed);
+	st->coalesced = atomic_load_explicit(&e->coalesced,
+					     memory_order_relaxed);
+	st->cached = atomic_load_explicit(&e->cached, memory_order_relaxed);
+	for (i = 0; i < APML_STATS_ERR_SLOTS; i++)
+		st->err_count[i] = atomic_load_explicit(&e->err_count[i],
+							memory_order_relaxed);
+	for (i = 0; i < APML_STATS_LAT_BUCKETS; i++)
+		st->latency[i] = atomic_load_explicit(&e->latency[i],
+						      memory_order_relaxed);
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_reset_stats(uint8_t soc_num)
+{
+	struct stats_entry *e;
+	int cmd, i;
+
+	if (soc_num >= APML_MAX_SOCKETS)
+		return OOB_INVALID_INPUT;
+
+	for (cmd = 0; cmd < APML_STATS_MAX_CMD; cmd++) {
+		e = &stats[soc_num][cmd];
+		/* Leave the pages of commands never issued untouched */
+		if (!atomic_load_explicit(&e->calls, memory_order_relaxed) &&
+		    !atomic_load_explicit(&e->cached, memory_order_relaxed))
+			continue;
+		atomic_store_explicit(&e->calls, 0, memory_order_relaxed);
+		atomic_store_explicit(&e->errors, 0, memory_order_relaxed);
+		atomic_store_explicit(&e->bytes, 0, memory_order_relaxed);
+		atomic_store_explicit(&e->total_ns, 0, memory_order_relaxed);
+		atomic_store_explicit(&e->retries, 0, memory_order_relaxed);
+		atomic_store_explicit(&e->coalesced, 0, memory_order_relaxed);
+		atomic_store_explicit(&e->cached, 0, memory_order_relaxed);
+		for (i = 0; i < APML_STATS_ERR_SLOTS; i++)
+			atomic_store_explicit(&e->err_count[i], 0,
+					      memory_order_relaxed);
+		for (i = 0; i < APML_STATS_LAT_BUCKETS; i++)
+			atomic_store_explicit(&e->latency[i], 0,
+					      memory_order_relaxed);
+	}
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_stats_err_status(unsigned int slot)
+{
+	if (slot < GENERIC_ERR_SLOTS)
+		return slot;
+	slot -= GENERIC_ERR_SLOTS;
+	if (slot < FW_ERR_SLOTS)
+		return fw_err_slots[slot];
+
+	return OOB_SUCCESS;
+}
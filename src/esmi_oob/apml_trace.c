@@ -0,0 +1,352 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *		AMD Research and AMD Software Development
+ *
+ *		Advanced Micro Devices, Inc.
+ *
+ *		www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <esmi_oob/apml.h>
+#include <esmi_oob/apml_emul.h>
+
+#include "common.h"
+
+#define TRACE_MAGIC		"APMLTRC"
+#define TRACE_VERSION		2
+/* Command keys of the per-command replay timing: mailbox, CPUID, MSR, REG */
+#define TRACE_MB_CMDS		0x100
+#define TRACE_KEYS		(TRACE_MB_CMDS + 3)
+
+/*
+ * Trace file layout: one struct trace_header followed by struct
+ * trace_entry records, in host byte order. The entries are written when
+ * their transaction completes, so those of concurrent sockets are not in
+ * the order of their ts_ns.
+ */
+struct trace_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t entry_size;
+} __attribute__((packed));
+
+struct trace_entry {
+	uint64_t ts_ns;		/* CLOCK_MONOTONIC start of the transaction */
+	uint32_t dur_ns;
+	uint32_t cmd;
+	uint64_t data_in;
+	uint64_t data_out;
+	uint8_t soc_num;
+	uint8_t intf;		/* enum apml_intf, 0xff for other devices */
+	uint16_t reserved;
+	uint32_t fw_ret_code;
+	int32_t err;		/* errno of the transport, 0 on success */
+} __attribute__((packed));
+
+atomic_bool apml_tracing;
+static FILE *trace_file;
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void apml_trace_record(uint8_t soc_num, int intf, struct apml_message *msg,
+		       uint64_t start_ns, uint64_t dur_ns, int err)
+{
+	struct trace_entry e = {
+		.ts_ns = start_ns,
+		.dur_ns = dur_ns > UINT32_MAX ? UINT32_MAX : dur_ns,
+		.cmd = msg->cmd,
+		.data_in = msg->data_in.cpu_msr_in,
+		.data_out = msg->data_out.cpu_msr_out,
+		.soc_num = soc_num,
+		.intf = intf < 0 ? 0xff : intf,
+		.fw_ret_code = msg->fw_ret_code,
+		.err = err,
+	};
+
+	pthread_mutex_lock(&trace_lock);
+	if (trace_file)
+		fwrite(&e, sizeof(e), 1, trace_file);
+	pthread_mutex_unlock(&trace_lock);
+}
+
+oob_status_t apml_trace_start(const char *path)
+{
+	struct trace_header hdr = {
+		.magic = TRACE_MAGIC,
+		.version = TRACE_VERSION,
+		.entry_size = sizeof(struct trace_entry),
+	};
+	oob_status_t ret = OOB_SUCCESS;
+	FILE *fp;
+
+	if (!path)
+		return OOB_ARG_PTR_NULL;
+
+	fp = fopen(path, "we");
+	if (!fp)
+		return errno_to_oob_status(errno);
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1) {
+		fclose(fp);
+		return OOB_FILE_ERROR;
+	}
+
+	pthread_mutex_lock(&trace_lock);
+	if (trace_file) {
+		ret = OOB_TRY_AGAIN;
+		fclose(fp);
+	} else {
+		trace_file = fp;
+		atomic_store(&apml_tracing, true);
+	}
+	pthread_mutex_unlock(&trace_lock);
+
+	return ret;
+}
+
+oob_status_t apml_trace_stop(void)
+{
+	oob_status_t ret = OOB_SUCCESS;
+
+	atomic_store(&apml_tracing, false);
+
+	pthread_mutex_lock(&trace_lock);
+	if (!trace_file)
+		ret = OOB_NOT_INITIALIZED;
+	else if (fclose(trace_file))
+		ret = OOB_FILE_ERROR;
+	trace_file = NULL;
+	pthread_mutex_unlock(&trace_lock);
+
+	return ret;
+}
+
+static int trace_key(uint32_t cmd)
+{
+	switch (cmd) {
+	case APML_CPUID:
+		return TRACE_MB_CMDS;
+	case APML_MCA_MSR:
+		return TRACE_MB_CMDS + 1;
+	case APML_REG:
+		return TRACE_MB_CMDS + 2;
+	default:
+		return cmd < TRACE_MB_CMDS ? (int)cmd : -1;
+	}
+}
+
+static uint32_t trace_key_cmd(int key)
+{
+	static const uint32_t proto[] = { APML_CPUID, APML_MCA_MSR, APML_REG };
+
+	return key < TRACE_MB_CMDS ? (uint32_t)key : proto[key - TRACE_MB_CMDS];
+}
+
+static oob_status_t trace_open(const char *path, FILE **fp)
+{
+	struct trace_header hdr;
+
+	*fp = fopen(path, "re");
+	if (!*fp)
+		return errno_to_oob_status(errno);
+
+	if (fread(&hdr, sizeof(hdr), 1, *fp) != 1 ||
+	    memcmp(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic)) ||
+	    hdr.version != TRACE_VERSION ||
+	    hdr.entry_size != sizeof(struct trace_entry)) {
+		fclose(*fp);
+		return OOB_INVALID_INPUT;
+	}
+
+	return OOB_SUCCESS;
+}
+
+/*
+ * Get the time span of the requests replayed, from the earliest start to
+ * the latest end. With emul_timing, also give every emulated command the
+ * latency range seen in the trace.
+ */
+static oob_status_t trace_scan(const char *path, bool emul_timing,
+			       uint64_t *first_ns, uint64_t *end_ns)
+{
+	uint32_t min_ns[TRACE_KEYS], max_ns[TRACE_KEYS];
+	struct trace_entry e;
+	oob_status_t ret;
+	FILE *fp;
+	int key;
+
+	ret = trace_open(path, &fp);
+	if (ret)
+		return ret;
+
+	*first_ns = UINT64_MAX;
+	*end_ns = 0;
+	memset(min_ns, 0xff, sizeof(min_ns));
+	memset(max_ns, 0, sizeof(max_ns));
+	while (fread(&e, sizeof(e), 1, fp) == 1) {
+		if (e.intf < APML_INTF_MAX) {
+			if (e.ts_ns < *first_ns)
+				*first_ns = e.ts_ns;
+			if (e.ts_ns + e.dur_ns > *end_ns)
+				*end_ns = e.ts_ns + e.dur_ns;
+		}
+		key = trace_key(e.cmd);
+		if (key < 0)
+			continue;
+		if (e.dur_ns < min_ns[key])
+			min_ns[key] = e.dur_ns;
+		if (e.dur_ns > max_ns[key])
+			max_ns[key] = e.dur_ns;
+	}
+	fclose(fp);
+
+	if (*first_ns > *end_ns)
+		*first_ns = *end_ns;
+	if (!emul_timing)
+		return OOB_SUCCESS;
+
+	for (key = 0; key < TRACE_KEYS; key++)
+		if (max_ns[key])
+			apml_emul_set_latency(trace_key_cmd(key), min_ns[key],
+					      max_ns[key]);
+
+	return OOB_SUCCESS;
+}
+
+/*
+ * Replay handle of a socket, opened on first use. The replay does not go
+ * through the default handles, whose read cache age, retry policy and
+ * priority the caller may have set: each request is issued once, alone.
+ */
+static struct apml_handle *replay_handle(struct apml_handle **handles,
+					 uint8_t soc_num)
+{
+	if (soc_num >= APML_MAX_SOCKETS)
+		return NULL;
+	if (!handles[soc_num] && !apml_open(soc_num, 0, &handles[soc_num]))
+		handles[soc_num]->no_coalesce = true;
+
+	return handles[soc_num];
+}
+
+oob_status_t apml_trace_replay(const char *path, double speed,
+			       uint32_t flags,
+			       struct apml_replay_stats *stats)
+{
+	struct apml_handle *handles[APML_MAX_SOCKETS] = {0}, *handle;
+	struct apml_replay_stats st = {0};
+	struct apml_message msg;
+	struct trace_entry e;
+	struct timespec ts;
+	uint64_t first_ns, end_ns, start_ns, due_ns;
+	oob_status_t ret, status;
+	FILE *fp;
+	int i;
+
+	if (!path)
+		return OOB_ARG_PTR_NULL;
+	if (speed < 0 || flags & ~APML_REPLAY_FLAGS)
+		return OOB_INVALID_INPUT;
+
+	ret = trace_scan(path, flags & APML_REPLAY_EMUL_TIMING, &first_ns,
+			 &end_ns);
+	if (ret)
+		return ret;
+	st.recorded_ns = end_ns - first_ns;
+
+	ret = trace_open(path, &fp);
+	if (ret)
+		return ret;
+
+	start_ns = apml_monotonic_ns();
+	while (fread(&e, sizeof(e), 1, fp) == 1) {
+		if (e.intf >= APML_INTF_MAX)
+			continue;
+		/*
+		 * Keep the original spacing, scaled by speed. The entries are
+		 * in completion order: one started before the request replayed
+		 * last is due at once.
+		 */
+		if (speed > 0) {
+			due_ns = start_ns;
+			if (e.ts_ns > first_ns)
+				due_ns += (e.ts_ns - first_ns) / speed;
+			ts.tv_sec = due_ns / 1000000000ULL;
+			ts.tv_nsec = due_ns % 1000000000ULL;
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+					       &ts, NULL) == EINTR)
+				;
+		}
+
+		memset(&msg, 0, sizeof(msg));
+		msg.cmd = e.cmd;
+		msg.data_in.cpu_msr_in = e.data_in;
+
+		/* Never change the settings of real hardware unasked */
+		if (!apml_msg_is_read(&msg) && !(flags & APML_REPLAY_WRITES) &&
+		    apml_transport_get(e.intf) != &apml_emul_transport) {
+			st.skipped++;
+			continue;
+		}
+		handle = replay_handle(handles, e.soc_num);
+		if (!handle) {
+			st.skipped++;
+			continue;
+		}
+		apml_xfer_batch(handle,
+				e.intf == APML_INTF_SBTSI ? SBTSI : SBRMI,
+				&msg, 1, &status);
+
+		st.transactions++;
+		if (!!status != !!e.err ||
+		    (!status && msg.data_out.cpu_msr_out != e.data_out))
+			st.mismatches++;
+	}
+	st.elapsed_ns = apml_monotonic_ns() - start_ns;
+	fclose(fp);
+	for (i = 0; i < APML_MAX_SOCKETS; i++)
+		if (handles[i])
+			apml_close(handles[i]);
+
+	if (stats)
+		*stats = st;
+
+	return OOB_SUCCESS;
+}
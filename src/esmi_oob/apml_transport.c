@@ -0,0 +1,284 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *		AMD Research and AMD Software Development
+ *
+ *		Advanced Micro Devices, Inc.
+ *
+ *		www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <esmi_oob/apml.h>
+
+#include "common.h"
+
+/* Max length of "/dev/<sbrmi|sbtsi><socket>" and "/dev/i2c-<bus>" */
+#define DEV_FILE_LEN		16
+
+/* Register access message layout, see esmi_oob_read_byte() */
+#define REG_OFFSET		0
+#define REG_VALUE		4
+#define REG_READ		7
+
+/*
+ * apml_modules character device, /dev/sbrmiN and /dev/sbtsiN
+ */
+static int module_open(uint8_t soc_num, int intf __maybe_unused,
+		       char *file_name)
+{
+	char dev_file[DEV_FILE_LEN];
+
+	snprintf(dev_file, sizeof(dev_file), "/dev/%s%d",
+		 file_name, soc_num);
+
+	return open(dev_file, O_RDWR | O_CLOEXEC);
+}
+
+static int module_xfer(int fd, uint8_t soc_num __maybe_unused,
+		       int intf __maybe_unused, struct apml_message *msg)
+{
+	if (ioctl(fd, SBRMI_IOCTL_CMD, msg) < 0)
+		return errno;
+
+	return 0;
+}
+
+static void module_close(int fd)
+{
+	close(fd);
+}
+
+/*
+ * Raw i2c-dev adapter, register access only. The mailbox, CPUID and MCA
+ * MSR protocols are sequenced by the apml module and are not available.
+ *
+ * The adapter and target address of an interface are packed in one word,
+ * read on every transfer without a lock: bits 7:0 hold the address, the
+ * bits above the adapter number plus one, 0 while the adapter is not set.
+ */
+#define I2C_ADDR_MASK		0xff
+#define I2C_BUS_SHIFT		8
+
+/* Default SB-RMI and SB-TSI target addresses of sockets 0 and 1 */
+static atomic_uint_least64_t i2c_devs[APML_MAX_SOCKETS][APML_INTF_MAX] = {
+	[0] = {
+		[APML_INTF_SBRMI] = 0x3c,
+		[APML_INTF_SBTSI] = 0x4c,
+	},
+	[1] = {
+		[APML_INTF_SBRMI] = 0x38,
+		[APML_INTF_SBTSI] = 0x48,
+	},
+};
+
+static int i2c_lookup(uint8_t soc_num, int intf, int *bus, uint16_t *addr)
+{
+	uint64_t dev;
+
+	if (soc_num >= APML_MAX_SOCKETS || intf < 0)
+		return ENODEV;
+
+	dev = atomic_load_explicit(&i2c_devs[soc_num][intf],
+				   memory_order_relaxed);
+	if (!(dev >> I2C_BUS_SHIFT) || !(dev & I2C_ADDR_MASK))
+		return ENODEV;
+	*bus = (dev >> I2C_BUS_SHIFT) - 1;
+	*addr = dev & I2C_ADDR_MASK;
+
+	return 0;
+}
+
+static int i2c_open(uint8_t soc_num, int intf,
+		    char *file_name __maybe_unused)
+{
+	char dev_file[DEV_FILE_LEN];
+	uint16_t addr;
+	int bus, ret;
+
+	ret = i2c_lookup(soc_num, intf, &bus, &addr);
+	if (ret) {
+		errno = ret;
+		return -1;
+	}
+	snprintf(dev_file, sizeof(dev_file), "/dev/i2c-%d", bus);
+
+	return open(dev_file, O_RDWR | O_CLOEXEC);
+}
+
+static int i2c_xfer(int fd, uint8_t soc_num, int intf,
+		    struct apml_message *msg)
+{
+	struct i2c_rdwr_ioctl_data data;
+	struct i2c_msg xfer[2];
+	uint8_t buf[2];
+	uint16_t addr;
+	int bus, ret;
+
+	ret = i2c_lookup(soc_num, intf, &bus, &addr);
+	if (ret)
+		return ret;
+
+	buf[0] = msg->data_in.reg_in[REG_OFFSET];
+	buf[1] = msg->data_in.reg_in[REG_VALUE];
+	xfer[0].addr = addr;
+	xfer[0].flags = 0;
+	xfer[0].buf = buf;
+	data.msgs = xfer;
+
+	if (msg->data_in.reg_in[REG_READ]) {
+		/* Write the offset, repeated start, read one byte */
+		xfer[0].len = 1;
+		xfer[1].addr = addr;
+		xfer[1].flags = I2C_M_RD;
+		xfer[1].len = 1;
+		xfer[1].buf = &msg->data_out.reg_out[0];
+		data.nmsgs = 2;
+	} else {
+		xfer[0].len = 2;
+		data.nmsgs = 1;
+	}
+
+	if (ioctl(fd, I2C_RDWR, &data) < 0)
+		return errno;
+
+	return 0;
+}
+
+static const struct apml_transport_ops module_ops = {
+	.caps = APML_CAP_REG | APML_CAP_MAILBOX | APML_CAP_CPUID |
+		APML_CAP_MCA_MSR,
+	.open = module_open,
+	.xfer = module_xfer,
+	.close = module_close,
+};
+
+static const struct apml_transport_ops i2c_ops = {
+	.caps = APML_CAP_REG,
+	.open = i2c_open,
+	.xfer = i2c_xfer,
+	.close = module_close,
+};
+
+static const struct apml_transport_ops *const transports[APML_TRANSPORT_MAX] = {
+	[APML_TRANSPORT_MODULE] = &module_ops,
+	[APML_TRANSPORT_I2C_DEV] = &i2c_ops,
+	[APML_TRANSPORT_EMUL] = &apml_emul_transport,
+};
+
+/* Transport selected per interface, the apml module by default */
+static _Atomic(const struct apml_transport_ops *)
+intf_transport[APML_INTF_MAX] = {
+	[0 ... APML_INTF_MAX - 1] = &module_ops
+};
+
+const struct apml_transport_ops *apml_transport_get(int intf)
+{
+	if (intf < 0)
+		return &module_ops;
+
+	return atomic_load(&intf_transport[intf]);
+}
+
+oob_status_t apml_set_transport(char *file_name, apml_transport_t transport)
+{
+	int intf, i;
+
+	if (!file_name)
+		return OOB_ARG_PTR_NULL;
+
+	intf = apml_intf_index(file_name);
+	if (intf < 0 || transport >= APML_TRANSPORT_MAX)
+		return OOB_INVALID_INPUT;
+
+	/*
+	 * Cached fds of the previous transport are closed on next use, the
+	 * values read from the previous devices are dropped now
+	 */
+	atomic_store(&intf_transport[intf], transports[transport]);
+	for (i = 0; i < APML_MAX_SOCKETS; i++)
+		apml_socket_invalidate(i, false);
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_get_transport_caps(apml_transport_t transport,
+				     uint32_t *caps)
+{
+	if (!caps)
+		return OOB_ARG_PTR_NULL;
+	if (transport >= APML_TRANSPORT_MAX)
+		return OOB_INVALID_INPUT;
+
+	*caps = transports[transport]->caps;
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t apml_set_i2c_device(uint8_t soc_num, char *file_name,
+				 uint32_t bus, uint8_t addr)
+{
+	uint64_t dev;
+	int intf;
+
+	if (!file_name)
+		return OOB_ARG_PTR_NULL;
+
+	intf = apml_intf_index(file_name);
+	if (soc_num >= APML_MAX_SOCKETS || intf < 0 || bus > INT32_MAX ||
+	    !addr || addr > 0x7f)
+		return OOB_INVALID_INPUT;
+
+	/*
+	 * The fd of the previous adapter is closed on next use, the values
+	 * read from the previous device are dropped now
+	 */
+	dev = ((uint64_t)bus + 1) << I2C_BUS_SHIFT | addr;
+	if (atomic_exchange_explicit(&i2c_devs[soc_num][intf], dev,
+				     memory_order_relaxed) != dev) {
+		apml_dev_reopen(soc_num, intf);
+		apml_socket_invalidate(soc_num, false);
+	}
+
+	return OOB_SUCCESS;
+}
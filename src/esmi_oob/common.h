@@ -42,24 +42,617 @@
 #ifndef INCLUDE_COMMON_H_
 #define INCLUDE_COMMON_H_
 
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include <esmi_oob/apml.h>
+
+/* Parameter required by a callback signature but not used */
+#define __maybe_unused	__attribute__((unused))
+
+struct apml_cpuid_slot;
+struct apml_read_slot;
+
+/* Character device interfaces exposed per socket */
+enum apml_intf {
+	APML_INTF_SBRMI = 0,
+	APML_INTF_SBTSI,
+	APML_INTF_MAX
+};
+
+/* Transport backend issuing the messages of an interface */
+struct apml_transport_ops {
+	uint32_t caps;		/* APML_CAP_* */
+	/* Return a descriptor for the interface, -1 with errno on failure */
+	int (*open)(uint8_t soc_num, int intf, char *file_name);
+	/* Issue one message, return 0 or an errno value */
+	int (*xfer)(int fd, uint8_t soc_num, int intf,
+		    struct apml_message *msg);
+	void (*close)(int fd);
+};
+
+/* In-process device emulator, apml_emul.c */
+extern const struct apml_transport_ops apml_emul_transport;
+
+/* Scheduling of a vector of messages */
+struct apml_sched {
+	uint64_t deadline_ns;		/* CLOCK_MONOTONIC, 0 for none */
+	int prio;			/* apml_prio_t */
+	uint64_t max_age_ns;		/* of cached reads served, 0 for none */
+};
+
+/* Read issued by one thread on behalf of all the identical ones */
+struct apml_flight {
+	struct apml_flight *next;
+	struct apml_message *msg;	/* of the leader, valid until done */
+	struct apml_sched sched;	/* of the leader */
+	bool started;			/* reached the bus, no more joins */
+	bool done;
+	oob_status_t status;
+	unsigned int waiters;		/* followers not yet served */
+};
+
+/*
+ * Bus of one interface and its cached device node. The bus is owned by
+ * one vector of messages at a time and handed over in priority order;
+ * lock only protects the scheduling state.
+ */
+struct apml_dev {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;		/* signalled when the bus is released */
+	bool busy;
+	unsigned int waiting[APML_PRIO_MAX];	/* waiters per class */
+	unsigned int passed[APML_PRIO_MAX];	/* grants while waiting */
+	struct apml_flight *flights;		/* reads not done yet */
+	/* Owned by the holder of the bus */
+	int fd;
+	const struct apml_transport_ops *ops;	/* transport fd belongs to */
+	unsigned int fd_gen;			/* reopen_gen fd was opened at */
+	atomic_uint reopen_gen;		/* bumped to reopen the device node */
+
+	/* Read cache, see apml_read_cache_get() */
+	_Atomic(struct apml_read_slot *) reads;
+	atomic_uint read_gen;		/* bumped to drop all the reads */
+};
+
+/* Request queued by apml_submit() */
+struct apml_req {
+	struct apml_req *next;
+	struct apml_handle *handle;
+	char *file_name;
+	struct apml_message *msg;
+	apml_callback_t callback;
+	void *ctx;
+	struct apml_sched sched;	/* of the handle when submitted */
+	unsigned int cancel_gen;	/* of the handle when submitted */
+	oob_status_t status;
+};
+
+/* SB-TSI registers shadowed per socket, see esmi_tsi.c */
+#define APML_TSI_SHADOW_REGS	8
+
+/* Words of a bitmap of the mailbox command ids */
+#define APML_MB_CAP_WORDS	(APML_MB_MAX_CMD / 32)
+
+/* Values fixed until the host resets, cached per socket */
+enum apml_cache_id {
+	APML_CACHE_CPU_SIG = 0,		/* family << 16 | model << 8 | step */
+	APML_CACHE_THREADS_PER_SOCKET,
+	APML_CACHE_THREADS_PER_CORE,
+	APML_CACHE_LOGICAL_CORES,
+	APML_CACHE_VENDOR_EBX,		/* CPUID_Fn00000000 */
+	APML_CACHE_VENDOR_EDX,
+	APML_CACHE_VENDOR_ECX,
+	APML_CACHE_RAPL_UNITS,		/* tu << 8 | esu */
+	APML_CACHE_RMI_REV,		/* SBRMI_REVISION */
+	APML_CACHE_MAX_POWER_LIMIT,
+	APML_CACHE_MAX_TDP,
+	APML_CACHE_MIN_TDP,
+	APML_CACHE_FREQ_RANGE,		/* fmax << 16 | fmin */
+	APML_CACHE_BASE_FREQ,
+	/* Bitmaps of the mailbox commands, 32 commands per word */
+	APML_CACHE_MB_UNKNOWN,		/* reported unknown by the firmware */
+	APML_CACHE_MB_KNOWN = APML_CACHE_MB_UNKNOWN + APML_MB_CAP_WORDS,
+	APML_CACHE_MAX = APML_CACHE_MB_KNOWN + APML_MB_CAP_WORDS
+};
+
+/* Library state of one socket, shared by all handles of the socket */
+struct apml_socket {
+	struct apml_dev dev[APML_INTF_MAX];
+	atomic_int persistent_refs;	/* open APML_OPEN_PERSISTENT handles */
+
+	/* Submission queue drained by the worker of the socket */
+	_Atomic(struct apml_req *) sq;	/* lock-free stack, newest first */
+	sem_t sq_sem;			/* posted once per submission */
+	pthread_mutex_t worker_lock;	/* protects the fields below */
+	int worker_refs;		/* open APML_OPEN_ASYNC handles */
+	atomic_bool worker_stop;
+	pthread_t worker;
+
+	/*
+	 * Values read once from the processor, see apml_cache_get(), and
+	 * cleared by apml_socket_invalidate()
+	 */
+	atomic_uint_least64_t cache[APML_CACHE_MAX];
+	atomic_int disk_state;		/* APML_DISK_*, see apml_cache.c */
+	/* SB-TSI configuration registers, see apml_set_tsi_shadow() */
+	atomic_uint tsi_shadow[APML_TSI_SHADOW_REGS];
+	atomic_uint tsi_read_order;	/* SB-TSI Config[ReadOrder], see esmi_tsi.c */
+
+	/* CPUID leaf cache, see apml_set_cpuid_cache() */
+	_Atomic(struct apml_cpuid_slot *) cpuid_cache;
+	atomic_uint cpuid_gen;		/* bumped to drop all the entries */
+};
+
+/* Handle returned by apml_open() */
+struct apml_handle {
+	uint8_t soc_num;
+	struct apml_socket *sock;	/* NULL beyond APML_MAX_SOCKETS */
+	uint32_t flags;			/* APML_OPEN_* */
+	bool is_default;		/* of apml_socket_handle() */
+
+	/* APML_OPEN_ASYNC state */
+	int event_fd;
+	_Atomic(struct apml_req *) cq;	/* completed, newest first */
+	atomic_uint inflight;		/* submitted, not yet dispatched */
+
+	struct apml_call_opts opts;	/* see apml_set_call_opts() */
+	apml_prio_t prio;		/* see apml_set_priority() */
+	bool prio_set;			/* prio chosen by the caller */
+	bool no_coalesce;		/* reads never joined, for replay */
+	atomic_uint cancel_gen;		/* bumped by apml_cancel() */
+
+	/* Retry policies, see apml_set_retry_policy() */
+	struct apml_retry_policy retry;
+	struct apml_retry_policy *cmd_retry;	/* APML_STATS_MAX_CMD entries */
+};
+
+/**
+ *  @brief Get the interface of a device file name
+ *
+ *  @param[in] file_name Character device file name for RMI/TSI I/F
+ *
+ *  @retval ::APML_INTF_SBRMI or ::APML_INTF_SBTSI, -1 for any other name.
+ */
+int apml_intf_index(char *file_name);
+
 /**
- *  @brief Writes data to device file
+ *  @brief Get the transport selected for an interface
  *
- *  @details This function will write data to character device file,
- *  through ioctl.
+ *  @param[in] intf Interface index, -1 for device files other than the
+ *  SB-RMI and SB-TSI ones, which always use the apml module.
  *
- *  @param[in] soc_num  Socket index.
+ *  @retval Transport operations to issue the messages with.
+ */
+const struct apml_transport_ops *apml_transport_get(int intf);
+
+/**
+ *  @brief Get the CLOCK_MONOTONIC time in nanoseconds
+ */
+uint64_t apml_monotonic_ns(void);
+
+/* Set while apml_trace_start() is recording, see apml_trace.c */
+extern atomic_bool apml_tracing;
+
+/**
+ *  @brief Append a transaction to the trace being recorded
  *
- *  @param[in] file_name Character device file name for RMI/TSI I/F
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[in] intf Interface index, -1 for other device files.
+ *
+ *  @param[in] msg message holding the request and the response.
+ *
+ *  @param[in] start_ns apml_monotonic_ns() when the transaction started.
+ *
+ *  @param[in] dur_ns duration of the transaction.
+ *
+ *  @param[in] err errno value the transport returned, 0 on success.
+ */
+void apml_trace_record(uint8_t soc_num, int intf, struct apml_message *msg,
+		       uint64_t start_ns, uint64_t dur_ns, int err);
+
+/**
+ *  @brief Account a transaction in the per-command statistics
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[in] intf Interface index, -1 for other device files.
+ *
+ *  @param[in] msg message issued.
+ *
+ *  @param[in] status outcome of the transaction.
+ *
+ *  @param[in] dur_ns time spent in the transport.
+ */
+void apml_stats_record(uint8_t soc_num, int intf, struct apml_message *msg,
+		       oob_status_t status, uint64_t dur_ns);
+
+/**
+ *  @brief Count a re-issued transaction in the per-command statistics
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[in] intf Interface index, -1 for other device files.
+ *
+ *  @param[in] msg message re-issued.
+ */
+void apml_stats_retry(uint8_t soc_num, int intf, struct apml_message *msg);
+
+/**
+ *  @brief Count a read served by an identical read of another thread
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[in] intf Interface index.
+ *
+ *  @param[in] msg message served.
+ */
+void apml_stats_coalesced(uint8_t soc_num, int intf,
+			  struct apml_message *msg);
+
+/**
+ *  @brief Count a read served by the read cache
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[in] intf Interface index.
+ *
+ *  @param[in] msg message served.
+ */
+void apml_stats_cached(uint8_t soc_num, int intf, struct apml_message *msg);
+
+/**
+ *  @brief Get the command slot of a message
+ *
+ *  @param[in] intf Interface index, -1 for other device files.
+ *
+ *  @param[in] msg message.
+ *
+ *  @retval Mailbox command id or APML_STATS_CMD_* value, -1 for messages
+ *  not accounted per command.
+ */
+int apml_cmd_slot(int intf, struct apml_message *msg);
+
+/**
+ *  @brief Issue a vector of messages on the device of a handle
+ *
+ *  @details apml_xfer_batch() without argument checks and retries.
+ *
+ *  @param[in] handle Handle to issue the messages on.
+ *
+ *  @param[in] intf Interface index of @p file_name.
+ *
+ *  @param[in] file_name Character device file name.
+ *
+ *  @param[inout] msgs messages to issue.
+ *
+ *  @param[in] n number of messages.
+ *
+ *  @param[out] status array of @p n statuses.
+ *
+ *  @param[in] sched deadline and priority class of the messages.
+ */
+void apml_issue_batch(struct apml_handle *handle, int intf, char *file_name,
+		      struct apml_message *msgs, size_t n,
+		      oob_status_t *status, const struct apml_sched *sched);
+
+/**
+ *  @brief Re-issue a batch with a failed message per the retry policy
+ *
+ *  @details The whole batch is re-issued in order, so that related
+ *  members (e.g. torn read detection) stay consistent.
+ *
+ *  @param[in] handle Handle the messages were issued on.
+ *
+ *  @param[in] intf Interface index of @p file_name.
+ *
+ *  @param[in] file_name Character device file name.
+ *
+ *  @param[inout] msgs messages issued.
+ *
+ *  @param[in] n number of messages.
+ *
+ *  @param[inout] status array of @p n statuses, updated by the retries.
+ *
+ *  @param[in] start_ns apml_monotonic_ns() when the batch started.
+ *
+ *  @param[in] sched deadline and priority class of the batch.
+ */
+void apml_retry_batch(struct apml_handle *handle, int intf, char *file_name,
+		      struct apml_message *msgs, size_t n,
+		      oob_status_t *status, uint64_t start_ns,
+		      const struct apml_sched *sched);
+
+/**
+ *  @brief apml_xfer_batch() with explicit scheduling
+ *
+ *  @details Used by the worker for requests keeping the deadline and the
+ *  priority class they were submitted with.
+ *
+ *  @param[in] handle Handle to issue the messages on.
+ *
+ *  @param[in] file_name Character device file name.
+ *
+ *  @param[inout] msgs messages to issue.
+ *
+ *  @param[in] n number of messages.
+ *
+ *  @param[out] status array of @p n statuses, may be NULL when @p n is 1.
+ *
+ *  @param[in] sched deadline and priority class of the messages.
+ *
+ *  @retval ::OOB_SUCCESS is returned when all the messages succeeded.
+ *  @retval Non-zero status of the first failing message otherwise.
+ */
+oob_status_t apml_xfer_until(struct apml_handle *handle, char *file_name,
+			     struct apml_message *msgs, size_t n,
+			     oob_status_t *status,
+			     const struct apml_sched *sched);
+
+/**
+ *  @brief Priority class of messages issued on a handle
+ *
+ *  @details Mailbox writes are actuation: they are issued in
+ *  ::APML_PRIO_CONTROL unless the caller set the priority of the handle
+ *  with apml_set_priority().
+ *
+ *  @param[in] handle Handle the messages are issued on.
  *
- *  @param[in] msg struct apml_message which contains information about the protocol,
- *  input/output data etc.
+ *  @param[in] msgs messages to issue.
+ *
+ *  @param[in] n number of messages.
+ *
+ *  @retval priority class to schedule @p msgs with.
+ */
+apml_prio_t apml_msgs_prio(const struct apml_handle *handle,
+			   const struct apml_message *msgs, size_t n);
+
+/**
+ *  @brief Whether a message only reads state
+ *
+ *  @details Such messages can be shared by their callers, served from the
+ *  read cache or replayed without changing the processor settings.
+ *
+ *  @param[in] msg message to classify.
+ *
+ *  @retval true for the register reads, CPUID and MCA MSR reads and the
+ *  mailbox read commands.
+ */
+bool apml_msg_is_read(const struct apml_message *msg);
+
+/**
+ *  @brief Build a mailbox read message, as esmi_oob_read_mailbox_h() does
+ *
+ *  @details For the callers issuing several mailbox reads in one
+ *  apml_xfer_batch().
+ *
+ *  @param[out] msg message to initialise.
+ *
+ *  @param[in] cmd mailbox command.
+ *
+ *  @param[in] input input argument of the command.
+ */
+void apml_mailbox_read_msg(struct apml_message *msg, uint32_t cmd,
+			   uint32_t input);
+
+/**
+ *  @brief Sleep between the steps of a multi-step operation
+ *
+ *  @param[in] handle Handle the operation runs on, may be NULL.
+ *
+ *  @param[in] usec time to sleep in microseconds.
+ *
+ *  @retval ::OOB_SUCCESS is returned after sleeping.
+ *  @retval ::OOB_CMD_TIMEOUT the deadline of @p handle would pass first.
+ */
+oob_status_t apml_handle_usleep(struct apml_handle *handle,
+				unsigned int usec);
+
+/*
+ * A per-socket cached word is 0 until the value has been read, then holds
+ * the value with APML_CACHED set. The value is self-contained in the word,
+ * so readers need neither a lock nor ordering with other memory.
+ */
+#define APML_CACHED		(1ULL << 32)
+
+/**
+ *  @brief Look a cached value up in the on-disk cache
+ *
+ *  @details Slow path of apml_cache_get(), merges the record of the socket
+ *  from the file set by apml_set_disk_cache() on the first miss, and
+ *  checks its fingerprint on the first value missing from the record.
+ *
+ *  @param[in] handle Handle of the socket.
+ *
+ *  @param[in] id ::apml_cache_id of the value.
+ *
+ *  @param[out] val cached value.
+ *
+ *  @retval true @p val was found.
+ */
+bool apml_cache_miss(struct apml_handle *handle, int id, uint32_t *val);
+
+/* Get a value cached for the socket of handle, false if it must be read */
+static inline bool apml_cache_get(struct apml_handle *handle, int id,
+				  uint32_t *val)
+{
+	uint64_t v;
+
+	if (!handle || !handle->sock)
+		return false;
+	v = atomic_load_explicit(&handle->sock->cache[id],
+				 memory_order_relaxed);
+	if (!(v & APML_CACHED))
+		return apml_cache_miss(handle, id, val);
+	*val = (uint32_t)v;
+	return true;
+}
+
+/**
+ *  @brief Cache a value read from the socket of a handle
+ *
+ *  @details Racing readers store the same value. The value is also written
+ *  to the on-disk cache once the record of the socket has been validated.
+ *
+ *  @param[in] handle Handle of the socket, may be NULL.
+ *
+ *  @param[in] id ::apml_cache_id of the value.
+ *
+ *  @param[in] val value read.
+ */
+void apml_cache_set(struct apml_handle *handle, int id, uint32_t val);
+
+/**
+ *  @brief Set a bit of a cached bitmap word
+ *
+ *  @details apml_cache_set() for bitmaps learnt one bit at a time by
+ *  concurrent callers.
+ *
+ *  @param[in] handle Handle of the socket, may be NULL.
+ *
+ *  @param[in] id ::apml_cache_id of the word.
+ *
+ *  @param[in] bit bit to set, less than 32.
+ */
+void apml_cache_set_bit(struct apml_handle *handle, int id, unsigned int bit);
+
+/**
+ *  @brief Learn the support of a mailbox command from its outcome
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @param[in] intf Interface index, -1 for other device files.
+ *
+ *  @param[in] msg message issued.
+ *
+ *  @param[in] status outcome of the transaction.
+ */
+void apml_mailbox_learn(uint8_t soc_num, int intf, struct apml_message *msg,
+			oob_status_t status);
+
+/**
+ *  @brief Whether the firmware of a socket reported a mailbox command unknown
+ *
+ *  @param[in] handle Handle of the socket.
+ *
+ *  @param[in] intf Interface index, -1 for other device files.
+ *
+ *  @param[in] msg message to issue.
+ *
+ *  @retval true @p msg would fail with ::OOB_MAILBOX_CMD_UNKNOWN.
+ */
+bool apml_mailbox_unknown(struct apml_handle *handle, int intf,
+			  struct apml_message *msg);
+
+/**
+ *  @brief Drop the values cached for a socket
+ *
+ *  @details Called when the device of the socket may have changed: a
+ *  transaction reported a warm reset, the device node had to be reopened or
+ *  the transport was switched. The on-disk record of the socket is
+ *  validated again before its next use.
+ *
+ *  @param[in] soc_num Socket index, ignored beyond APML_MAX_SOCKETS.
+ *
+ *  @param[in] reset the host was reset, also drop the on-disk record.
+ */
+void apml_socket_invalidate(uint8_t soc_num, bool reset);
+
+/**
+ *  @brief Close the cached device node of an interface on its next use
+ *
+ *  @details For a change of the device the transport opens, e.g. of the
+ *  I2C adapter of the socket. The holder of the bus reopens it.
+ *
+ *  @param[in] soc_num Socket index, ignored beyond APML_MAX_SOCKETS.
+ *
+ *  @param[in] intf Interface index.
+ */
+void apml_dev_reopen(uint8_t soc_num, int intf);
+
+/**
+ *  @brief Serve a read from the read cache of a device
+ *
+ *  @param[in] dev device the read would be issued on.
+ *
+ *  @param[inout] msg read, data_out and fw_ret_code are filled on a hit.
+ *
+ *  @param[in] max_age_ns oldest result accepted.
+ *
+ *  @param[in] now_ns apml_monotonic_ns() of the call.
+ *
+ *  @retval true @p msg was served.
+ */
+bool apml_read_cache_get(struct apml_dev *dev, struct apml_message *msg,
+			 uint64_t max_age_ns, uint64_t now_ns);
+
+/**
+ *  @brief Keep the result of a read in the read cache of a device
+ *
+ *  @details Only kept once a caller has asked for cached reads on @p dev.
+ *
+ *  @param[in] dev device the read was issued on.
+ *
+ *  @param[in] msg read issued successfully.
+ *
+ *  @param[in] gen read_gen of @p dev before the read was issued.
+ *
+ *  @param[in] start_ns apml_monotonic_ns() before the read was issued.
+ */
+void apml_read_cache_put(struct apml_dev *dev, struct apml_message *msg,
+			 unsigned int gen, uint64_t start_ns);
+
+/**
+ *  @brief Get the SB-RMI revision of the socket of a handle
+ *
+ *  @details Read once per socket and served from the socket afterwards.
+ *
+ *  @param[in] handle Handle of the socket.
+ *
+ *  @param[out] rev SBRMI_REVISION register value.
+ *
+ *  @retval ::OOB_SUCCESS is returned upon successful call.
+ *  @retval Non-zero is returned upon failure.
+ */
+oob_status_t apml_rmi_revision(struct apml_handle *handle, uint8_t *rev);
+
+/**
+ *  @brief Get the default handle of a socket
+ *
+ *  @details The socket index based API operates on these handles. They
+ *  are never freed; sockets beyond APML_MAX_SOCKETS get a handle without
+ *  per-socket state.
+ *
+ *  @param[in] soc_num Socket index.
+ *
+ *  @retval Pointer to the default handle of @p soc_num.
+ */
+struct apml_handle *apml_socket_handle(uint8_t soc_num);
+
+/**
+ *  @brief Set up asynchronous submission on a newly opened handle
+ *
+ *  @details Creates the completion eventfd of the handle and starts the
+ *  worker of its socket if this is the first APML_OPEN_ASYNC handle.
+ *
+ *  @param[in] handle Handle being opened.
  *
  *  @retval ::OOB_SUCCESS is returned upon successful call.
  *  @retval Non-zero is returned upon failure.
+ */
+oob_status_t apml_async_attach(struct apml_handle *handle);
+
+/**
+ *  @brief Tear down asynchronous submission of a handle being closed
+ *
+ *  @details Waits for and dispatches the outstanding requests of the
+ *  handle, then stops the worker of the socket with its last user.
  *
+ *  @param[in] handle Handle being closed.
  */
-oob_status_t sbrmi_xfer_msg(uint8_t soc_num, char *file_name,
-			    struct apml_message *msg);
+void apml_async_detach(struct apml_handle *handle);
 
 #endif  // INCLUDE_COMMON_H_
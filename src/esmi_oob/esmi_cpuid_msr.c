@@ -40,14 +40,19 @@
  */
 #include <errno.h>
 #include <inttypes.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 #include <esmi_oob/esmi_cpuid_msr.h>
 #include <esmi_oob/apml.h>
 #include <esmi_oob/esmi_rmi.h>
 
+#include "common.h"
+
 /* Default message lengths as per APML command protocol */
 #define MSR_RD_LEN	0xa
 #define MSR_WR_LEN	0x9
@@ -63,6 +68,32 @@
 #define HW_ALERT_MASK	0x80
 /* Thread Mask */
 #define THREAD_MASK	0xFFFF
+/* CPUID register pair returned by one transaction */
+#define CPUID_EAX_EBX	0
+#define CPUID_ECX_EDX	1
+/* Entries of the CPUID leaf cache of a socket, a power of 2 */
+#define CPUID_CACHE_SLOTS	256
+/* Bits of the generation in a CPUID leaf cache key */
+#define CPUID_GEN_BITS	11
+
+/*
+ * Slot of the CPUID leaf cache, a seqlock: seq is odd while the slot is
+ * written and bumped again once key and val are consistent.
+ */
+struct apml_cpuid_slot {
+	atomic_uint seq;
+	atomic_uint_least64_t key;	/* see cpuid_cache_key() */
+	atomic_uint_least64_t val;	/* high register << 32 | low register */
+};
+
+/* See apml_set_cpuid_cache() */
+static atomic_bool cpuid_cache_enabled;
+
+static oob_status_t esmi_oob_cpuid_pair(struct apml_handle *handle,
+					uint32_t thread,
+					uint32_t fn_eax, uint32_t fn_ecx,
+					uint8_t read_reg,
+					uint32_t *lo, uint32_t *hi);
 
 static oob_status_t esmi_convert_reg_val(uint32_t reg, char *id)
 {
@@ -85,19 +116,46 @@ static oob_status_t esmi_convert_reg_val(uint32_t reg, char *id)
 
 }
 
-oob_status_t esmi_get_vendor_id(uint8_t soc_num,
-				char *vendor_id)
+/* CPUID_Fn00000000 EBX, EDX and ECX of the socket, read once */
+static oob_status_t esmi_vendor_regs(struct apml_handle *handle,
+				     uint32_t *ebx, uint32_t *edx,
+				     uint32_t *ecx)
 {
-	uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
 	uint32_t core_id = 0;
+	uint32_t eax;
+	oob_status_t ret;
+
+	if (apml_cache_get(handle, APML_CACHE_VENDOR_EBX, ebx) &&
+	    apml_cache_get(handle, APML_CACHE_VENDOR_EDX, edx) &&
+	    apml_cache_get(handle, APML_CACHE_VENDOR_ECX, ecx))
+		return OOB_SUCCESS;
+
+	ret = esmi_oob_cpuid_pair(handle, core_id, 0, 0, CPUID_EAX_EBX,
+				  &eax, ebx);
+	if (ret)
+		return ret;
+	ret = esmi_oob_cpuid_pair(handle, core_id, 0, 0, CPUID_ECX_EDX,
+				  ecx, edx);
+	if (ret)
+		return ret;
+
+	apml_cache_set(handle, APML_CACHE_VENDOR_EBX, *ebx);
+	apml_cache_set(handle, APML_CACHE_VENDOR_EDX, *edx);
+	apml_cache_set(handle, APML_CACHE_VENDOR_ECX, *ecx);
+	return ret;
+}
+
+oob_status_t esmi_get_vendor_id_h(struct apml_handle *handle,
+				  char *vendor_id)
+{
+	uint32_t ebx, ecx, edx;
 	char ebx_id[REG_SIZE + 1], ecx_id[REG_SIZE + 1], edx_id[REG_SIZE + 1];
 	oob_status_t ret;
 
 	if (!vendor_id)
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_cpuid(soc_num, core_id,
-			     &eax, &ebx, &ecx, &edx);
+	ret = esmi_vendor_regs(handle, &ebx, &edx, &ecx);
 	if (ret)
 		return ret;
 	/*
@@ -129,19 +187,27 @@ static oob_status_t esmi_reg_offset_conv(uint32_t reg, uint32_t offset,
 	return (reg >> offset) & flag;
 }
 
-oob_status_t esmi_get_processor_info(uint8_t soc_num,
-				     struct processor_info *proc_info)
+oob_status_t esmi_get_processor_info_h(struct apml_handle *handle,
+				       struct processor_info *proc_info)
 {
 
 	oob_status_t ret;
-	uint32_t eax = 1, ebx, ecx = 0, edx;
+	uint32_t eax, ebx, sig;
 	uint32_t core_id = 0;
 
 	if (!proc_info)
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_cpuid(soc_num, core_id,
-			     &eax, &ebx, &ecx, &edx);
+	if (apml_cache_get(handle, APML_CACHE_CPU_SIG, &sig)) {
+		proc_info->family = sig >> 16;
+		proc_info->model = (sig >> 8) & 0xff;
+		proc_info->step_id = sig & 0xf;
+		return OOB_SUCCESS;
+	}
+
+	/* EAX of CPUID_Fn00000001 holds the signature */
+	ret = esmi_oob_cpuid_pair(handle, core_id, 1, 0, CPUID_EAX_EBX,
+				  &eax, &ebx);
 	if (ret != 0)
 		return ret;
 	/*
@@ -158,11 +224,18 @@ oob_status_t esmi_get_processor_info(uint8_t soc_num,
 	 * Stepping = Processor stepping (revision) for a specific model
 	 */
 	proc_info->step_id = esmi_reg_offset_conv(eax, 0, 0xf);
+
+	apml_cache_set(handle, APML_CACHE_CPU_SIG,
+		       proc_info->family << 16 | proc_info->model << 8 |
+		       proc_info->step_id);
+	/* Came with the same transaction, see below */
+	apml_cache_set(handle, APML_CACHE_THREADS_PER_SOCKET,
+		       (ebx >> 16) & 0xFF);
 	return ret;
 }
 
-oob_status_t esmi_get_threads_per_socket(uint8_t soc_num,
-					 uint32_t *threads_per_socket)
+oob_status_t esmi_get_threads_per_socket_h(struct apml_handle *handle,
+					   uint32_t *threads_per_socket)
 {
 	uint32_t value;
 	uint32_t thread_ind = 0;
@@ -173,8 +246,12 @@ oob_status_t esmi_get_threads_per_socket(uint8_t soc_num,
 	if (!threads_per_socket)
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_cpuid_ebx(soc_num, thread_ind, cpuid_fn,
-				 cpuid_extd_fn, &value);
+	if (apml_cache_get(handle, APML_CACHE_THREADS_PER_SOCKET,
+			   threads_per_socket))
+		return OOB_SUCCESS;
+
+	ret = esmi_oob_cpuid_ebx_h(handle, thread_ind, cpuid_fn,
+				   cpuid_extd_fn, &value);
 
 	if (ret != OOB_SUCCESS)
 		return ret;
@@ -183,11 +260,13 @@ oob_status_t esmi_get_threads_per_socket(uint8_t soc_num,
 	 * Specifies the number of threads in the processor
 	 */
 	*threads_per_socket = (value >> 16) & 0xFF;
+	apml_cache_set(handle, APML_CACHE_THREADS_PER_SOCKET,
+		       *threads_per_socket);
 	return ret;
 }
 
-oob_status_t esmi_get_threads_per_core(uint8_t soc_num,
-				       uint32_t *threads_per_core)
+oob_status_t esmi_get_threads_per_core_h(struct apml_handle *handle,
+					 uint32_t *threads_per_core)
 {
 	oob_status_t ret;
 	uint32_t value;
@@ -198,9 +277,13 @@ oob_status_t esmi_get_threads_per_core(uint8_t soc_num,
 	if (!threads_per_core)
 		return OOB_ARG_PTR_NULL;
 
+	if (apml_cache_get(handle, APML_CACHE_THREADS_PER_CORE,
+			   threads_per_core))
+		return OOB_SUCCESS;
+
 	cpuid_fn = 0x8000001e; // CPUID_Fn8000001E_EBX [Core Identifiers]
-	ret = esmi_oob_cpuid_ebx(soc_num, thread_ind, cpuid_fn,
-				 cpuid_extd_fn, &value);
+	ret = esmi_oob_cpuid_ebx_h(handle, thread_ind, cpuid_fn,
+				   cpuid_extd_fn, &value);
 	if (ret != OOB_SUCCESS)
 		return ret;
 	/*
@@ -208,13 +291,15 @@ oob_status_t esmi_get_threads_per_core(uint8_t soc_num,
 	 * Reset: XXh. The number of threads per core is ThreadsPerCore+1.
 	 */
 	*threads_per_core = ((value >> 8) & 0xFF) + 1;
+	apml_cache_set(handle, APML_CACHE_THREADS_PER_CORE,
+		       *threads_per_core);
 
 	return ret;
 }
 
 oob_status_t
-esmi_get_logical_cores_per_socket(uint8_t soc_num,
-				  uint32_t *logical_cores_per_socket)
+esmi_get_logical_cores_per_socket_h(struct apml_handle *handle,
+				    uint32_t *logical_cores_per_socket)
 {
 	oob_status_t ret;
 	uint32_t value;
@@ -225,22 +310,55 @@ esmi_get_logical_cores_per_socket(uint8_t soc_num,
 	if (!logical_cores_per_socket)
 		return OOB_ARG_PTR_NULL;
 
+	if (apml_cache_get(handle, APML_CACHE_LOGICAL_CORES,
+			   logical_cores_per_socket))
+		return OOB_SUCCESS;
+
 	/*
 	 * CPUID_Fn0000000B_EBX_x01 [Extended Topology Enumeration]
 	 */
 	cpuid_fn = 0xB;
 	cpuid_extd_fn = 1;
-	ret = esmi_oob_cpuid_ebx(soc_num, thread_ind, cpuid_fn,
-				 cpuid_extd_fn, &value);
+	ret = esmi_oob_cpuid_ebx_h(handle, thread_ind, cpuid_fn,
+				   cpuid_extd_fn, &value);
 	if (ret != OOB_SUCCESS)
 		return ret;
 	*logical_cores_per_socket = value & 0xFFFF;
+	apml_cache_set(handle, APML_CACHE_LOGICAL_CORES,
+		       *logical_cores_per_socket);
 
 	return ret;
 }
 
+oob_status_t
+esmi_get_processor_static_info_h(struct apml_handle *handle,
+				 struct processor_static_info *info)
+{
+	oob_status_t ret;
+
+	if (!info)
+		return OOB_ARG_PTR_NULL;
+
+	ret = esmi_get_processor_info_h(handle, &info->info);
+	if (ret)
+		return ret;
+	ret = esmi_get_threads_per_socket_h(handle, &info->threads_per_socket);
+	if (ret)
+		return ret;
+	ret = esmi_get_threads_per_core_h(handle, &info->threads_per_core);
+	if (ret)
+		return ret;
+	ret = esmi_get_logical_cores_per_socket_h(handle,
+						  &info->logical_cores_per_socket);
+	if (ret)
+		return ret;
+
+	return esmi_get_vendor_id_h(handle, info->vendor_id);
+}
+
 /* Thread > 127, Thread128 CS register, 1'b1 needs to be set to 1 */
-static oob_status_t esmi_oob_extend_thread(uint8_t soc_num, uint32_t *thread)
+static oob_status_t esmi_oob_extend_thread(struct apml_handle *handle,
+					   uint32_t *thread)
 {
 	uint8_t val = 0;
 
@@ -248,12 +366,12 @@ static oob_status_t esmi_oob_extend_thread(uint8_t soc_num, uint32_t *thread)
 		*thread -= 128;
 		val = 1;
 	}
-	return esmi_oob_write_byte(soc_num, SBRMI_THREAD128CS, SBRMI, val);
+	return esmi_oob_write_byte_h(handle, SBRMI_THREAD128CS, SBRMI, val);
 }
 
-oob_status_t esmi_oob_read_msr(uint8_t soc_num,
-			       uint32_t thread, uint32_t msraddr,
-			       uint64_t *buffer)
+oob_status_t esmi_oob_read_msr_h(struct apml_handle *handle,
+				 uint32_t thread, uint32_t msraddr,
+				 uint64_t *buffer)
 {
 	struct apml_message msg = {0};
 	uint8_t index = 0;
@@ -273,7 +391,7 @@ oob_status_t esmi_oob_read_msr(uint8_t soc_num,
 
 	/* Assign 7 byte to READ Mode */
 	msg.data_in.reg_in[7] = 1;
-	ret = sbrmi_xfer_msg(soc_num, SBRMI, &msg);
+	ret = sbrmi_xfer_msg_h(handle, SBRMI, &msg);
 	if (ret)
 		return ret;
 
@@ -282,41 +400,136 @@ oob_status_t esmi_oob_read_msr(uint8_t soc_num,
 	return OOB_SUCCESS;
 }
 
-oob_status_t esmi_oob_cpuid(uint8_t soc_num, uint32_t thread,
-			    uint32_t *eax, uint32_t *ebx,
-			    uint32_t *ecx, uint32_t *edx)
+static uint64_t cpuid_cache_key(struct apml_socket *sock, uint32_t thread,
+				uint32_t fn_eax, uint32_t fn_ecx,
+				uint8_t read_reg)
 {
-	uint32_t fn_eax, fn_ecx;
-	oob_status_t ret;
+	uint64_t gen;
 
-	fn_eax = *eax;
-	fn_ecx = *ecx;
+	/* Never 0, so that zeroed slots do not match */
+	gen = atomic_load_explicit(&sock->cpuid_gen, memory_order_relaxed) %
+	      ((1 << CPUID_GEN_BITS) - 1) + 1;
 
-	ret = esmi_oob_cpuid_eax(soc_num, thread, fn_eax, fn_ecx, eax);
-	if (ret)
-		return ret;
+	return (uint64_t)fn_eax | (uint64_t)(thread & THREAD_MASK) << 32 |
+	       (uint64_t)(fn_ecx & 0xf) << 48 | (uint64_t)read_reg << 52 |
+	       gen << (64 - CPUID_GEN_BITS);
+}
 
-	ret = esmi_oob_cpuid_ebx(soc_num, thread, fn_eax, fn_ecx, ebx);
-	if (ret)
-		return ret;
+static struct apml_cpuid_slot *cpuid_cache_slot(struct apml_cpuid_slot *tab,
+						uint64_t key)
+{
+	/* Fibonacci hashing of the whole key */
+	return &tab[(key * 0x9E3779B97F4A7C15ULL) >> 56 &
+		    (CPUID_CACHE_SLOTS - 1)];
+}
 
-	ret = esmi_oob_cpuid_ecx(soc_num, thread, fn_eax, fn_ecx, ecx);
-	if (ret)
-		return ret;
+/* Table of the socket, allocated on first use */
+static struct apml_cpuid_slot *cpuid_cache_table(struct apml_socket *sock)
+{
+	struct apml_cpuid_slot *tab, *cur = NULL;
+
+	tab = atomic_load_explicit(&sock->cpuid_cache, memory_order_acquire);
+	if (tab)
+		return tab;
+
+	tab = calloc(CPUID_CACHE_SLOTS, sizeof(*tab));
+	if (!tab)
+		return NULL;
+	if (!atomic_compare_exchange_strong_explicit(&sock->cpuid_cache,
+						     &cur, tab,
+						     memory_order_acq_rel,
+						     memory_order_acquire)) {
+		free(tab);
+		tab = cur;
+	}
+	return tab;
+}
 
-	return esmi_oob_cpuid_edx(soc_num, thread, fn_eax, fn_ecx, edx);
+static bool cpuid_cache_get(struct apml_cpuid_slot *tab, uint64_t key,
+			    uint64_t *val)
+{
+	struct apml_cpuid_slot *slot = cpuid_cache_slot(tab, key);
+	unsigned int seq;
+	uint64_t k;
+
+	seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+	if (seq & 1)
+		return false;
+	k = atomic_load_explicit(&slot->key, memory_order_relaxed);
+	*val = atomic_load_explicit(&slot->val, memory_order_relaxed);
+	atomic_thread_fence(memory_order_acquire);
+
+	return k == key &&
+	       atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq;
 }
 
-static oob_status_t esmi_oob_cpuid_fn(uint8_t soc_num, uint32_t thread,
-				      uint32_t fn_eax, uint32_t fn_ecx,
-				      uint8_t mode, uint32_t *value)
+static void cpuid_cache_put(struct apml_cpuid_slot *tab, uint64_t key,
+			    uint64_t val)
+{
+	struct apml_cpuid_slot *slot = cpuid_cache_slot(tab, key);
+	unsigned int seq;
+
+	/* Skip the slot while another thread writes it */
+	seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+	if (seq & 1 ||
+	    !atomic_compare_exchange_strong_explicit(&slot->seq, &seq,
+						     seq + 1,
+						     memory_order_relaxed,
+						     memory_order_relaxed))
+		return;
+	atomic_thread_fence(memory_order_release);
+
+	atomic_store_explicit(&slot->key, key, memory_order_relaxed);
+	atomic_store_explicit(&slot->val, val, memory_order_relaxed);
+	atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+}
+
+oob_status_t apml_set_cpuid_cache(bool enable)
 {
+	struct apml_socket *sock;
+	int i;
+
+	atomic_store(&cpuid_cache_enabled, enable);
+	if (enable)
+		return OOB_SUCCESS;
+
+	/* Results cached so far may be stale when enabled again */
+	for (i = 0; i < APML_MAX_SOCKETS; i++) {
+		sock = apml_socket_handle(i)->sock;
+		atomic_fetch_add_explicit(&sock->cpuid_gen, 1,
+					  memory_order_relaxed);
+	}
+
+	return OOB_SUCCESS;
+}
+
+/*
+ * One CPUID transaction returns two registers: EAX in @lo and EBX in @hi
+ * for CPUID_EAX_EBX, ECX and EDX for CPUID_ECX_EDX.
+ */
+static oob_status_t esmi_oob_cpuid_pair(struct apml_handle *handle,
+					uint32_t thread,
+					uint32_t fn_eax, uint32_t fn_ecx,
+					uint8_t read_reg,
+					uint32_t *lo, uint32_t *hi)
+{
+	struct apml_socket *sock = handle ? handle->sock : NULL;
+	struct apml_cpuid_slot *tab = NULL;
 	struct apml_message msg = {0};
-	uint8_t ext = 0, read_reg = 0;
+	uint64_t key = 0, val;
+	uint8_t ext = 0;
 	oob_status_t ret;
 
-	if (!value)
-		return OOB_ARG_PTR_NULL;
+	if (sock && atomic_load_explicit(&cpuid_cache_enabled,
+					 memory_order_relaxed)) {
+		key = cpuid_cache_key(sock, thread, fn_eax, fn_ecx, read_reg);
+		tab = cpuid_cache_table(sock);
+		if (tab && cpuid_cache_get(tab, key, &val)) {
+			*lo = val;
+			*hi = val >> 32;
+			return OOB_SUCCESS;
+		}
+	}
 
 	/* cmd for CPUID is 0x1000 */
 	msg.cmd = 0x1000;
@@ -327,28 +540,67 @@ static oob_status_t esmi_oob_cpuid_fn(uint8_t soc_num, uint32_t thread,
 				 | ((uint64_t)thread << 32);
 
 	/* Assign extended function to data_in[6][4:7] */
-	if (mode == EAX || mode == EBX)
-		/* read eax/ebx */
-		read_reg = 0;
-	else
-		/* read ecx/edx */
-		read_reg = 1;
-
 	ext = (uint8_t)fn_ecx;
-        ext = ext << 4 | read_reg;
-        msg.data_in.cpu_msr_in = msg.data_in.cpu_msr_in | ((uint64_t) ext << 48);
+	ext = ext << 4 | read_reg;
+	msg.data_in.cpu_msr_in = msg.data_in.cpu_msr_in | ((uint64_t) ext << 48);
 	/* Assign 7 byte to READ Mode */
 	msg.data_in.reg_in[7] = 1;
-        ret = sbrmi_xfer_msg(soc_num, SBRMI, &msg);
-        if (ret)
-                return ret;
+	ret = sbrmi_xfer_msg_h(handle, SBRMI, &msg);
+	if (ret)
+		return ret;
+
+	/* Low word/mbout[0] and high word/mbout[1] */
+	*lo = msg.data_out.mb_out[0];
+	*hi = msg.data_out.mb_out[1];
 
-	if (mode == EAX || mode == ECX)
-		/* Read low word/mbout[0] */
-		*value = msg.data_out.mb_out[0];
-	else
-		/* Read high word/mbout[1] */
-		*value = msg.data_out.mb_out[1];
+	/* A result of a previous generation is never looked up again */
+	if (tab)
+		cpuid_cache_put(tab, key, (uint64_t)*hi << 32 | *lo);
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t esmi_oob_cpuid_h(struct apml_handle *handle, uint32_t thread,
+			      uint32_t *eax, uint32_t *ebx,
+			      uint32_t *ecx, uint32_t *edx)
+{
+	uint32_t fn_eax, fn_ecx;
+	oob_status_t ret;
+
+	if (!eax || !ebx || !ecx || !edx)
+		return OOB_ARG_PTR_NULL;
+
+	fn_eax = *eax;
+	fn_ecx = *ecx;
+
+	ret = esmi_oob_cpuid_pair(handle, thread, fn_eax, fn_ecx,
+				  CPUID_EAX_EBX, eax, ebx);
+	if (ret)
+		return ret;
+
+	return esmi_oob_cpuid_pair(handle, thread, fn_eax, fn_ecx,
+				   CPUID_ECX_EDX, ecx, edx);
+}
+
+static oob_status_t esmi_oob_cpuid_fn(struct apml_handle *handle,
+				      uint32_t thread,
+				      uint32_t fn_eax, uint32_t fn_ecx,
+				      uint8_t mode, uint32_t *value)
+{
+	uint32_t lo, hi;
+	oob_status_t ret;
+
+	if (!value)
+		return OOB_ARG_PTR_NULL;
+
+	/* read eax/ebx or ecx/edx */
+	ret = esmi_oob_cpuid_pair(handle, thread, fn_eax, fn_ecx,
+				  mode == EAX || mode == EBX ?
+				  CPUID_EAX_EBX : CPUID_ECX_EDX, &lo, &hi);
+	if (ret)
+		return ret;
+
+	*value = mode == EAX || mode == ECX ? lo : hi;
 
 	return OOB_SUCCESS;
 }
@@ -357,34 +609,127 @@ static oob_status_t esmi_oob_cpuid_fn(uint8_t soc_num, uint32_t thread,
 /*
  * CPUID functions returning a single datum
  */
+oob_status_t esmi_oob_cpuid_eax_h(struct apml_handle *handle,
+				  uint32_t thread, uint32_t fn_eax,
+				  uint32_t fn_ecx, uint32_t *eax)
+{
+	return esmi_oob_cpuid_fn(handle, thread, fn_eax, fn_ecx,
+				 EAX, eax);
+}
+
+oob_status_t esmi_oob_cpuid_ebx_h(struct apml_handle *handle,
+				  uint32_t thread, uint32_t fn_eax,
+				  uint32_t fn_ecx, uint32_t *ebx)
+{
+	return esmi_oob_cpuid_fn(handle, thread, fn_eax, fn_ecx,
+				 EBX, ebx);
+}
+
+oob_status_t esmi_oob_cpuid_ecx_h(struct apml_handle *handle,
+				  uint32_t thread, uint32_t fn_eax,
+				  uint32_t fn_ecx, uint32_t *ecx)
+{
+        return esmi_oob_cpuid_fn(handle, thread, fn_eax, fn_ecx,
+				 ECX, ecx);
+}
+
+oob_status_t esmi_oob_cpuid_edx_h(struct apml_handle *handle,
+				  uint32_t thread, uint32_t fn_eax,
+				  uint32_t fn_ecx, uint32_t *edx)
+{
+        return esmi_oob_cpuid_fn(handle, thread, fn_eax, fn_ecx,
+				 EDX, edx);
+}
+
+/*
+ * Socket index based API, operating on the default handle of the socket
+ */
+oob_status_t esmi_get_vendor_id(uint8_t soc_num,
+				char *vendor_id)
+{
+	return esmi_get_vendor_id_h(apml_socket_handle(soc_num), vendor_id);
+}
+
+oob_status_t esmi_get_processor_info(uint8_t soc_num,
+				     struct processor_info *proc_info)
+{
+	return esmi_get_processor_info_h(apml_socket_handle(soc_num),
+					 proc_info);
+}
+
+oob_status_t esmi_get_processor_static_info(uint8_t soc_num,
+					    struct processor_static_info *info)
+{
+	return esmi_get_processor_static_info_h(apml_socket_handle(soc_num),
+						info);
+}
+
+oob_status_t esmi_get_threads_per_socket(uint8_t soc_num,
+					 uint32_t *threads_per_socket)
+{
+	return esmi_get_threads_per_socket_h(apml_socket_handle(soc_num),
+					     threads_per_socket);
+}
+
+oob_status_t esmi_get_threads_per_core(uint8_t soc_num,
+				       uint32_t *threads_per_core)
+{
+	return esmi_get_threads_per_core_h(apml_socket_handle(soc_num),
+					   threads_per_core);
+}
+
+oob_status_t
+esmi_get_logical_cores_per_socket(uint8_t soc_num,
+				  uint32_t *logical_cores_per_socket)
+{
+	return esmi_get_logical_cores_per_socket_h(apml_socket_handle(soc_num),
+						   logical_cores_per_socket);
+}
+
+oob_status_t esmi_oob_read_msr(uint8_t soc_num,
+			       uint32_t thread, uint32_t msraddr,
+			       uint64_t *buffer)
+{
+	return esmi_oob_read_msr_h(apml_socket_handle(soc_num), thread, msraddr,
+				   buffer);
+}
+
+oob_status_t esmi_oob_cpuid(uint8_t soc_num, uint32_t thread,
+			    uint32_t *eax, uint32_t *ebx,
+			    uint32_t *ecx, uint32_t *edx)
+{
+	return esmi_oob_cpuid_h(apml_socket_handle(soc_num), thread, eax, ebx,
+				ecx, edx);
+}
+
 oob_status_t esmi_oob_cpuid_eax(uint8_t soc_num,
 				uint32_t thread, uint32_t fn_eax,
 				uint32_t fn_ecx, uint32_t *eax)
 {
-	return esmi_oob_cpuid_fn(soc_num, thread, fn_eax, fn_ecx,
-				 EAX, eax);
+	return esmi_oob_cpuid_eax_h(apml_socket_handle(soc_num), thread, fn_eax,
+				    fn_ecx, eax);
 }
 
 oob_status_t esmi_oob_cpuid_ebx(uint8_t soc_num,
 				uint32_t thread, uint32_t fn_eax,
 				uint32_t fn_ecx, uint32_t *ebx)
 {
-	return esmi_oob_cpuid_fn(soc_num, thread, fn_eax, fn_ecx,
-				 EBX, ebx);
+	return esmi_oob_cpuid_ebx_h(apml_socket_handle(soc_num), thread, fn_eax,
+				    fn_ecx, ebx);
 }
 
 oob_status_t esmi_oob_cpuid_ecx(uint8_t soc_num,
 				uint32_t thread, uint32_t fn_eax,
 				uint32_t fn_ecx, uint32_t *ecx)
 {
-        return esmi_oob_cpuid_fn(soc_num, thread, fn_eax, fn_ecx,
-				 ECX, ecx);
+	return esmi_oob_cpuid_ecx_h(apml_socket_handle(soc_num), thread, fn_eax,
+				    fn_ecx, ecx);
 }
 
 oob_status_t esmi_oob_cpuid_edx(uint8_t soc_num,
 				uint32_t thread, uint32_t fn_eax,
 				uint32_t fn_ecx, uint32_t *edx)
 {
-        return esmi_oob_cpuid_fn(soc_num, thread, fn_eax, fn_ecx,
-				 EDX, edx);
+	return esmi_oob_cpuid_edx_h(apml_socket_handle(soc_num), thread, fn_eax,
+				    fn_ecx, edx);
 }
@@ -41,7 +41,6 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <math.h>
 #include <unistd.h>
 
 #include <esmi_oob/esmi_mailbox.h>
@@ -49,6 +48,8 @@
 #include <esmi_oob/esmi_cpuid_msr.h>
 #include <esmi_oob/esmi_rmi.h>
 
+#include "common.h"
+
 /* MASKS */
 
 /* Mask for bmc control pcie rate */
@@ -65,6 +66,10 @@
 #define TU_MASK			0xF
 /* ESU Mask in read bmc rapl units */
 #define ESU_MASK		0x1F
+/* Microjoules per Joule, RAPL energy in uJ */
+#define UJ_PER_J		1000000ULL
+/* Reads of a core energy counter until its high half stays put */
+#define RAPL_TORN_RETRIES	3
 /* FCLK Mask used in read current df-pstate frequency */
 #define FCLK_MASK		0xFFF
 /* Bandwidth Mask used in reading ddr bandwidth */
@@ -89,9 +94,6 @@
 /* Maximum value for df p-state limit */
 #define MAX_DF_PSTATE_LIMIT	2
 
-float esu_multiplier;
-struct processor_info plat_info[1];
-
 /*
  * Validates max and min values.Max values should always be greater
  * than or equal to the min value.
@@ -118,65 +120,87 @@ static oob_status_t validate_pwr_efficiency_mode(uint8_t value)
 	}
 }
 
-oob_status_t read_socket_power(uint8_t soc_num, uint32_t *buffer)
+/* Mailbox read of a value fixed until the host resets, cached per socket */
+static oob_status_t read_static_mailbox(struct apml_handle *handle, int id,
+					esb_mailbox_commmands cmd,
+					uint32_t *buffer)
 {
-	return esmi_oob_read_mailbox(soc_num, READ_PACKAGE_POWER_CONSUMPTION,
-				     0, buffer);
+	oob_status_t ret;
+
+	if (!buffer)
+		return OOB_ARG_PTR_NULL;
+
+	if (apml_cache_get(handle, id, buffer))
+		return OOB_SUCCESS;
+
+	ret = esmi_oob_read_mailbox_h(handle, cmd, 0, buffer);
+	if (!ret)
+		apml_cache_set(handle, id, *buffer);
+	return ret;
 }
 
-oob_status_t read_socket_power_limit(uint8_t soc_num, uint32_t *buffer)
+oob_status_t read_socket_power_h(struct apml_handle *handle, uint32_t *buffer)
 {
-	return esmi_oob_read_mailbox(soc_num, READ_PACKAGE_POWER_LIMIT,
-				     0, buffer);
+	return esmi_oob_read_mailbox_h(handle, READ_PACKAGE_POWER_CONSUMPTION,
+				       0, buffer);
 }
 
-oob_status_t read_max_socket_power_limit(uint8_t soc_num, uint32_t *buffer)
+oob_status_t read_socket_power_limit_h(struct apml_handle *handle,
+				       uint32_t *buffer)
 {
-	return esmi_oob_read_mailbox(soc_num, READ_MAX_PACKAGE_POWER_LIMIT,
-				     0, buffer);
+	return esmi_oob_read_mailbox_h(handle, READ_PACKAGE_POWER_LIMIT,
+				       0, buffer);
 }
 
-oob_status_t read_tdp(uint8_t soc_num, uint32_t *buffer)
+oob_status_t read_max_socket_power_limit_h(struct apml_handle *handle,
+					   uint32_t *buffer)
 {
-	return esmi_oob_read_mailbox(soc_num,
-				     READ_TDP, 0, buffer);
+	return read_static_mailbox(handle, APML_CACHE_MAX_POWER_LIMIT,
+				   READ_MAX_PACKAGE_POWER_LIMIT, buffer);
 }
 
-oob_status_t read_max_tdp(uint8_t soc_num, uint32_t *buffer)
+oob_status_t read_tdp_h(struct apml_handle *handle, uint32_t *buffer)
 {
-	return esmi_oob_read_mailbox(soc_num, READ_MAX_cTDP,
-				     0, buffer);
+	return esmi_oob_read_mailbox_h(handle,
+				       READ_TDP, 0, buffer);
 }
 
-oob_status_t read_min_tdp(uint8_t soc_num, uint32_t *buffer)
+oob_status_t read_max_tdp_h(struct apml_handle *handle, uint32_t *buffer)
 {
-	return esmi_oob_read_mailbox(soc_num, READ_MIN_cTDP,
-				     0, buffer);
+	return read_static_mailbox(handle, APML_CACHE_MAX_TDP,
+				   READ_MAX_cTDP, buffer);
 }
 
-oob_status_t write_socket_power_limit(uint8_t soc_num, uint32_t limit)
+oob_status_t read_min_tdp_h(struct apml_handle *handle, uint32_t *buffer)
 {
-	return esmi_oob_write_mailbox(soc_num,
-				      WRITE_PACKAGE_POWER_LIMIT, limit);
+	return read_static_mailbox(handle, APML_CACHE_MIN_TDP,
+				   READ_MIN_cTDP, buffer);
 }
 
-oob_status_t read_bios_boost_fmax(uint8_t soc_num,
-				  uint32_t value, uint32_t *buffer)
+oob_status_t write_socket_power_limit_h(struct apml_handle *handle,
+					uint32_t limit)
+{
+	return esmi_oob_write_mailbox_h(handle,
+					WRITE_PACKAGE_POWER_LIMIT, limit);
+}
+
+oob_status_t read_bios_boost_fmax_h(struct apml_handle *handle,
+				    uint32_t value, uint32_t *buffer)
 {
+	struct processor_info proc_info;
 	uint8_t rev;
 	oob_status_t ret;
 
-	ret = read_sbrmi_revision(soc_num, &rev);
+	ret = apml_rmi_revision(handle, &rev);
 	if (ret)
 		return ret;
 	if (rev == 0x20) {
-		if (!plat_info->family) {
-			ret = esmi_get_processor_info(soc_num, plat_info);
-			if (ret)
-				return ret;
-			}
-		if (plat_info->family == 0x19) {
-			switch (plat_info->model) {
+		ret = esmi_get_processor_info_h(handle, &proc_info);
+		if (ret)
+			return ret;
+
+		if (proc_info.family == 0x19) {
+			switch (proc_info.model) {
 			case 0x30 ... 0x3F:
 				break;
 			default:
@@ -185,29 +209,28 @@ oob_status_t read_bios_boost_fmax(uint8_t soc_num,
 			}
 		}
 	}
-	return esmi_oob_read_mailbox(soc_num,
-				     READ_BIOS_BOOST_Fmax,
-				     value, buffer);
+	return esmi_oob_read_mailbox_h(handle,
+				       READ_BIOS_BOOST_Fmax,
+				       value, buffer);
 }
 
-oob_status_t read_esb_boost_limit(uint8_t soc_num,
-				  uint32_t value, uint32_t *buffer)
+oob_status_t read_esb_boost_limit_h(struct apml_handle *handle,
+				    uint32_t value, uint32_t *buffer)
 {
+	struct processor_info proc_info;
 	uint8_t rev;
 	oob_status_t ret;
 
-	ret = read_sbrmi_revision(soc_num, &rev);
+	ret = apml_rmi_revision(handle, &rev);
 	if (ret)
 		return ret;
 	if (rev == 0x20) {
-		if (!plat_info->family) {
-			ret = esmi_get_processor_info(soc_num, plat_info);
-			if (ret)
-				return ret;
-		}
+		ret = esmi_get_processor_info_h(handle, &proc_info);
+		if (ret)
+			return ret;
 
-		if (plat_info->family == 0x19) {
-			switch (plat_info->model) {
+		if (proc_info.family == 0x19) {
+			switch (proc_info.model) {
 			case 0x30 ... 0x3F:
 				break;
 			default:
@@ -216,47 +239,47 @@ oob_status_t read_esb_boost_limit(uint8_t soc_num,
 			}
 		}
 	}
-	return esmi_oob_read_mailbox(soc_num,
-				     READ_APML_BOOST_LIMIT,
-				     value, buffer);
+	return esmi_oob_read_mailbox_h(handle,
+				       READ_APML_BOOST_LIMIT,
+				       value, buffer);
 }
 
-oob_status_t write_esb_boost_limit(uint8_t soc_num,
-				   uint32_t cpu_ind, uint32_t limit)
+oob_status_t write_esb_boost_limit_h(struct apml_handle *handle,
+				     uint32_t cpu_ind, uint32_t limit)
 {
 	limit = (limit & TWO_BYTE_MASK) | ((cpu_ind << 16) & CPU_INDEX_MASK);
 
-	return esmi_oob_write_mailbox(soc_num,
-				      WRITE_APML_BOOST_LIMIT, limit);
+	return esmi_oob_write_mailbox_h(handle,
+					WRITE_APML_BOOST_LIMIT, limit);
 }
 
-oob_status_t write_esb_boost_limit_allcores(uint8_t soc_num,
-					    uint32_t limit)
+oob_status_t write_esb_boost_limit_allcores_h(struct apml_handle *handle,
+					      uint32_t limit)
 {
 	limit &= TWO_BYTE_MASK;
-	return esmi_oob_write_mailbox(soc_num,
-				      WRITE_APML_BOOST_LIMIT_ALLCORES, limit);
+	return esmi_oob_write_mailbox_h(handle,
+					WRITE_APML_BOOST_LIMIT_ALLCORES, limit);
 }
 
-oob_status_t read_dram_throttle(uint8_t soc_num, uint32_t *buffer)
+oob_status_t read_dram_throttle_h(struct apml_handle *handle, uint32_t *buffer)
 {
-	return esmi_oob_read_mailbox(soc_num,
-				     READ_DRAM_THROTTLE, 0, buffer);
+	return esmi_oob_read_mailbox_h(handle,
+				       READ_DRAM_THROTTLE, 0, buffer);
 }
 
-oob_status_t write_dram_throttle(uint8_t soc_num, uint32_t limit)
+oob_status_t write_dram_throttle_h(struct apml_handle *handle, uint32_t limit)
 {
 	/* As per SSP PPR, Write can be 0 to 80%, But read is 0 to 100% */
-	return esmi_oob_write_mailbox(soc_num,
-				      WRITE_DRAM_THROTTLE, limit);
+	return esmi_oob_write_mailbox_h(handle,
+					WRITE_DRAM_THROTTLE, limit);
 }
 
-oob_status_t read_prochot_status(uint8_t soc_num, uint32_t *buffer)
+oob_status_t read_prochot_status_h(struct apml_handle *handle, uint32_t *buffer)
 {
-	return esmi_oob_read_mailbox(soc_num, READ_PROCHOT_STATUS, 0, buffer);
+	return esmi_oob_read_mailbox_h(handle, READ_PROCHOT_STATUS, 0, buffer);
 }
 
-oob_status_t read_prochot_residency(uint8_t soc_num, float *buffer)
+oob_status_t read_prochot_residency_h(struct apml_handle *handle, float *buffer)
 {
 	uint32_t residency;
 	oob_status_t ret;
@@ -264,8 +287,8 @@ oob_status_t read_prochot_residency(uint8_t soc_num, float *buffer)
 	if (!buffer)
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_read_mailbox(soc_num,
-				    READ_PROCHOT_RESIDENCY, 0, &residency);
+	ret = esmi_oob_read_mailbox_h(handle,
+				      READ_PROCHOT_RESIDENCY, 0, &residency);
 	if (ret)
 		return ret;
 	*buffer = ((float)(residency & TWO_BYTE_MASK) / TWO_BYTE_MASK) * 100;
@@ -274,43 +297,43 @@ oob_status_t read_prochot_residency(uint8_t soc_num, float *buffer)
 }
 
 oob_status_t
-read_nbio_error_logging_register(uint8_t soc_num,
-				 struct nbio_err_log nbio,
-				 uint32_t *buffer)
+read_nbio_error_logging_register_h(struct apml_handle *handle,
+				   struct nbio_err_log nbio,
+				   uint32_t *buffer)
 {
 	uint32_t input;
 
 	input = nbio.quadrant << 24 | nbio.offset;
-	return esmi_oob_read_mailbox(soc_num,
-				     READ_NBIO_ERROR_LOGGING_REGISTER,
-				     input, buffer);
+	return esmi_oob_read_mailbox_h(handle,
+				       READ_NBIO_ERROR_LOGGING_REGISTER,
+				       input, buffer);
 }
 
-oob_status_t read_iod_bist(uint8_t soc_num, uint32_t *buffer)
+oob_status_t read_iod_bist_h(struct apml_handle *handle, uint32_t *buffer)
 {
 	if (!buffer)
 		return OOB_ARG_PTR_NULL;
 
-	return esmi_oob_read_mailbox(soc_num, READ_IOD_BIST,
-				     0, buffer);
+	return esmi_oob_read_mailbox_h(handle, READ_IOD_BIST,
+				       0, buffer);
 }
 
-oob_status_t read_ccd_bist_result(uint8_t soc_num,
-				  uint32_t input, uint32_t *buffer)
+oob_status_t read_ccd_bist_result_h(struct apml_handle *handle,
+				    uint32_t input, uint32_t *buffer)
 {
-	return esmi_oob_read_mailbox(soc_num,
-				     READ_CCD_BIST_RESULT, input, buffer);
+	return esmi_oob_read_mailbox_h(handle,
+				       READ_CCD_BIST_RESULT, input, buffer);
 }
 
-oob_status_t read_ccx_bist_result(uint8_t soc_num,
-				  uint32_t value, uint32_t *ccx_bist)
+oob_status_t read_ccx_bist_result_h(struct apml_handle *handle,
+				    uint32_t value, uint32_t *ccx_bist)
 {
-	return esmi_oob_read_mailbox(soc_num, READ_CCX_BIST_RESULT,
-				     value, ccx_bist);
+	return esmi_oob_read_mailbox_h(handle, READ_CCX_BIST_RESULT,
+				       value, ccx_bist);
 }
 
-oob_status_t read_ddr_bandwidth(uint8_t soc_num,
-				struct max_ddr_bw *max_ddr)
+oob_status_t read_ddr_bandwidth_h(struct apml_handle *handle,
+				  struct max_ddr_bw *max_ddr)
 {
 	uint32_t result;
 	oob_status_t ret;
@@ -318,8 +341,8 @@ oob_status_t read_ddr_bandwidth(uint8_t soc_num,
 	if (!max_ddr)
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_read_mailbox(soc_num,
-				    READ_DDR_BANDWIDTH, 0, &result);
+	ret = esmi_oob_read_mailbox_h(handle,
+				      READ_DDR_BANDWIDTH, 0, &result);
 	if (ret == OOB_SUCCESS) {
 		max_ddr->max_bw = result >> 20;
 		max_ddr->utilized_bw = (result >> 8) & BW_MASK;
@@ -328,34 +351,34 @@ oob_status_t read_ddr_bandwidth(uint8_t soc_num,
 	return ret;
 }
 
-oob_status_t write_bmc_report_dimm_power(uint8_t soc_num,
-					 struct dimm_power dp_info)
+oob_status_t write_bmc_report_dimm_power_h(struct apml_handle *handle,
+					   struct dimm_power dp_info)
 {
 	uint32_t input = 0;
 
 	input = dp_info.dimm_addr | dp_info.update_rate << 8
 		| dp_info.power << 17;
 
-	return esmi_oob_write_mailbox(soc_num,
-				      WRITE_BMC_REPORT_DIMM_POWER, input);
+	return esmi_oob_write_mailbox_h(handle,
+					WRITE_BMC_REPORT_DIMM_POWER, input);
 }
 
-oob_status_t write_bmc_report_dimm_thermal_sensor(uint8_t soc_num,
-						  struct dimm_thermal dt_info)
+oob_status_t write_bmc_report_dimm_thermal_sensor_h(struct apml_handle *handle,
+						    struct dimm_thermal dt_info)
 {
 	uint32_t input = 0;
 
 	input = dt_info.dimm_addr | dt_info.update_rate << 8
 		| dt_info.sensor << 21;
 
-	return esmi_oob_write_mailbox(soc_num,
-				      WRITE_BMC_REPORT_DIMM_THERMAL_SENSOR,
-				      input);
+	return esmi_oob_write_mailbox_h(handle,
+					WRITE_BMC_REPORT_DIMM_THERMAL_SENSOR,
+					input);
 }
 
-oob_status_t read_bmc_ras_pcie_config_access(uint8_t soc_num,
-					     struct pci_address pci_addr,
-					     uint32_t *buffer)
+oob_status_t read_bmc_ras_pcie_config_access_h(struct apml_handle *handle,
+					       struct pci_address pci_addr,
+					       uint32_t *buffer)
 {
 	uint32_t input;
 
@@ -369,14 +392,14 @@ oob_status_t read_bmc_ras_pcie_config_access(uint8_t soc_num,
 	input = pci_addr.func | pci_addr.device << 3 | pci_addr.bus << 8\
 		| pci_addr.offset << 16 | pci_addr.segment << 28;
 
-	return esmi_oob_read_mailbox(soc_num,
-				     READ_BMC_RAS_PCIE_CONFIG_ACCESS,
-				     input, buffer);
+	return esmi_oob_read_mailbox_h(handle,
+				       READ_BMC_RAS_PCIE_CONFIG_ACCESS,
+				       input, buffer);
 }
 
-oob_status_t read_bmc_ras_mca_validity_check(uint8_t soc_num,
-					     uint16_t *bytes_per_mca,
-					     uint16_t *mca_banks)
+oob_status_t read_bmc_ras_mca_validity_check_h(struct apml_handle *handle,
+					       uint16_t *bytes_per_mca,
+					       uint16_t *mca_banks)
 {
 	uint32_t output;
 	oob_status_t ret;
@@ -384,9 +407,9 @@ oob_status_t read_bmc_ras_mca_validity_check(uint8_t soc_num,
 	if ((!mca_banks) || (!bytes_per_mca))
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_read_mailbox(soc_num,
-				    READ_BMC_RAS_MCA_VALIDITY_CHECK,
-				    0, &output);
+	ret = esmi_oob_read_mailbox_h(handle,
+				      READ_BMC_RAS_MCA_VALIDITY_CHECK,
+				      0, &output);
 	if (ret)
 		return ret;
 
@@ -396,34 +419,35 @@ oob_status_t read_bmc_ras_mca_validity_check(uint8_t soc_num,
 	return ret;
 }
 
-oob_status_t read_bmc_ras_mca_msr_dump(uint8_t soc_num,
-				       struct mca_bank mca_dump,
-				       uint32_t *buffer)
+oob_status_t read_bmc_ras_mca_msr_dump_h(struct apml_handle *handle,
+					 struct mca_bank mca_dump,
+					 uint32_t *buffer)
 {
 	uint32_t input;
 
 	input = mca_dump.index << 16 | mca_dump.offset;
 
-	return esmi_oob_read_mailbox(soc_num,
-				     READ_BMC_RAS_MCA_MSR_DUMP,
-				     input, buffer);
+	return esmi_oob_read_mailbox_h(handle,
+				       READ_BMC_RAS_MCA_MSR_DUMP,
+				       input, buffer);
 }
 
-oob_status_t read_bmc_ras_fch_reset_reason(uint8_t soc_num,
-					   uint32_t input,
-					   uint32_t *buffer)
+oob_status_t read_bmc_ras_fch_reset_reason_h(struct apml_handle *handle,
+					     uint32_t input,
+					     uint32_t *buffer)
 {
 	if (input > 1)
 		return OOB_INVALID_INPUT;
 
-	return esmi_oob_read_mailbox(soc_num,
-				     READ_BMC_RAS_FCH_RESET_REASON,
-				     input, buffer);
+	return esmi_oob_read_mailbox_h(handle,
+				       READ_BMC_RAS_FCH_RESET_REASON,
+				       input, buffer);
 }
 
-oob_status_t read_dimm_temp_range_and_refresh_rate(uint8_t soc_num,
-						   uint32_t dimm_addr,
-						   struct temp_refresh_rate *rate)
+oob_status_t
+read_dimm_temp_range_and_refresh_rate_h(struct apml_handle *handle,
+					uint32_t dimm_addr,
+					struct temp_refresh_rate *rate)
 {
 	uint32_t input, output;
 	oob_status_t ret;
@@ -433,9 +457,9 @@ oob_status_t read_dimm_temp_range_and_refresh_rate(uint8_t soc_num,
 
 	input = dimm_addr & 0xFF;
 
-	ret = esmi_oob_read_mailbox(soc_num,
-				    READ_DIMM_TEMP_RANGE_AND_REFRESH_RATE,
-				    input, &output);
+	ret = esmi_oob_read_mailbox_h(handle,
+				      READ_DIMM_TEMP_RANGE_AND_REFRESH_RATE,
+				      input, &output);
 	if (ret)
 		return ret;
 
@@ -445,10 +469,9 @@ oob_status_t read_dimm_temp_range_and_refresh_rate(uint8_t soc_num,
 	return ret;
 }
 
-oob_status_t read_dimm_power_consumption(uint8_t soc_num,
-					 uint32_t dimm_addr,
-					 struct dimm_power *dimm_pow)
-
+oob_status_t read_dimm_power_consumption_h(struct apml_handle *handle,
+					   uint32_t dimm_addr,
+					   struct dimm_power *dimm_pow)
 {
 	uint32_t input, output;
 	oob_status_t ret;
@@ -457,9 +480,9 @@ oob_status_t read_dimm_power_consumption(uint8_t soc_num,
 		return OOB_ARG_PTR_NULL;
 
 	input = dimm_addr & 0xFF;
-	ret = esmi_oob_read_mailbox(soc_num,
-				    READ_DIMM_POWER_CONSUMPTION,
-				    input, &output);
+	ret = esmi_oob_read_mailbox_h(handle,
+				      READ_DIMM_POWER_CONSUMPTION,
+				      input, &output);
 	if (ret)
 		return ret;
 
@@ -470,9 +493,9 @@ oob_status_t read_dimm_power_consumption(uint8_t soc_num,
 	return ret;
 }
 
-oob_status_t read_dimm_thermal_sensor(uint8_t soc_num,
-				      uint32_t dimm_addr,
-				      struct dimm_thermal *dimm_temp)
+oob_status_t read_dimm_thermal_sensor_h(struct apml_handle *handle,
+					uint32_t dimm_addr,
+					struct dimm_thermal *dimm_temp)
 {
 	uint32_t input, output;
 	oob_status_t ret;
@@ -481,9 +504,9 @@ oob_status_t read_dimm_thermal_sensor(uint8_t soc_num,
 		return OOB_ARG_PTR_NULL;
 
 	input = dimm_addr & 0xFF;
-	ret = esmi_oob_read_mailbox(soc_num,
-				    READ_DIMM_THERMAL_SENSOR,
-				    input, &output);
+	ret = esmi_oob_read_mailbox_h(handle,
+				      READ_DIMM_THERMAL_SENSOR,
+				      input, &output);
 	if (ret)
 		return ret;
 
@@ -494,9 +517,9 @@ oob_status_t read_dimm_thermal_sensor(uint8_t soc_num,
 	return ret;
 }
 
-oob_status_t read_pwr_current_active_freq_limit_socket(uint8_t soc_num,
-						       uint16_t *freq,
-						       char **source_type)
+oob_status_t
+read_pwr_current_active_freq_limit_socket_h(struct apml_handle *handle,
+					    uint16_t *freq, char **source_type)
 {
 	uint32_t output;
 	uint16_t limit;
@@ -510,9 +533,9 @@ oob_status_t read_pwr_current_active_freq_limit_socket(uint8_t soc_num,
 
 	// frequency limit source names array length
 	src_length = ARRAY_SIZE(freqlimitsrcnames);
-	ret = esmi_oob_read_mailbox(soc_num,
-				    READ_PWR_CURRENT_ACTIVE_FREQ_LIMIT_SOCKET,
-				    0, &output);
+	ret = esmi_oob_read_mailbox_h(handle,
+				      READ_PWR_CURRENT_ACTIVE_FREQ_LIMIT_SOCKET,
+				      0, &output);
 	if (ret)
 		return ret;
 
@@ -531,28 +554,28 @@ oob_status_t read_pwr_current_active_freq_limit_socket(uint8_t soc_num,
 	return ret;
 }
 
-oob_status_t read_pwr_current_active_freq_limit_core(uint8_t soc_num,
-						     uint32_t core_id,
-						     uint16_t *base_freq)
+oob_status_t
+read_pwr_current_active_freq_limit_core_h(struct apml_handle *handle,
+					  uint32_t core_id, uint16_t *base_freq)
 {
-	return esmi_oob_read_mailbox(soc_num,
-				     READ_PWR_CURRENT_ACTIVE_FREQ_LIMIT_CORE,
-				     core_id, (uint32_t *)base_freq);
+	return esmi_oob_read_mailbox_h(handle,
+				       READ_PWR_CURRENT_ACTIVE_FREQ_LIMIT_CORE,
+				       core_id, (uint32_t *)base_freq);
 }
 
-oob_status_t read_pwr_svi_telemetry_all_rails(uint8_t soc_num,
-					      uint32_t *power)
+oob_status_t read_pwr_svi_telemetry_all_rails_h(struct apml_handle *handle,
+						uint32_t *power)
 {
 	if (!power)
 		return OOB_ARG_PTR_NULL;
 
-	return esmi_oob_read_mailbox(soc_num, READ_PWR_SVI_TELEMETRY_ALL_RAILS,
-				     0, power);
+	return esmi_oob_read_mailbox_h(handle, READ_PWR_SVI_TELEMETRY_ALL_RAILS,
+				       0, power);
 }
 
-oob_status_t read_socket_freq_range(uint8_t soc_num,
-				    uint16_t *fmax,
-				    uint16_t *fmin)
+oob_status_t read_socket_freq_range_h(struct apml_handle *handle,
+				      uint16_t *fmax,
+				      uint16_t *fmin)
 {
 	uint32_t output;
 	oob_status_t ret;
@@ -560,9 +583,8 @@ oob_status_t read_socket_freq_range(uint8_t soc_num,
 	if ((!fmax) || (!fmin))
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_read_mailbox(soc_num,
-				    READ_SOCKET_FREQ_RANGE,
-				    0, &output);
+	ret = read_static_mailbox(handle, APML_CACHE_FREQ_RANGE,
+				  READ_SOCKET_FREQ_RANGE, &output);
 	if (ret)
 		return ret;
 
@@ -611,9 +633,9 @@ static oob_status_t validate_link_id_encoding(uint8_t link_id)
 	return ret;
 }
 
-oob_status_t read_current_io_bandwidth(uint8_t soc_num,
-				       struct link_id_bw_type link,
-				       uint32_t *io_bw)
+oob_status_t read_current_io_bandwidth_h(struct apml_handle *handle,
+					 struct link_id_bw_type link,
+					 uint32_t *io_bw)
 {
 	uint32_t input;
 
@@ -626,14 +648,14 @@ oob_status_t read_current_io_bandwidth(uint8_t soc_num,
 
 	input = link.bw_type | link.link_id << 8;
 
-	return esmi_oob_read_mailbox(soc_num,
-				     READ_CURRENT_IO_BANDWIDTH,
-				     input, io_bw);
+	return esmi_oob_read_mailbox_h(handle,
+				       READ_CURRENT_IO_BANDWIDTH,
+				       input, io_bw);
 }
 
-oob_status_t read_current_xgmi_bandwidth(uint8_t soc_num,
-					 struct link_id_bw_type link,
-					 uint32_t *xgmi_bw)
+oob_status_t read_current_xgmi_bandwidth_h(struct apml_handle *handle,
+					   struct link_id_bw_type link,
+					   uint32_t *xgmi_bw)
 {
 	uint32_t input;
 
@@ -645,14 +667,14 @@ oob_status_t read_current_xgmi_bandwidth(uint8_t soc_num,
 
 	input = link.bw_type | link.link_id << 8;
 
-	return esmi_oob_read_mailbox(soc_num,
-				     READ_CURRENT_XGMI_BANDWIDTH,
-				     input, xgmi_bw);
+	return esmi_oob_read_mailbox_h(handle,
+				       READ_CURRENT_XGMI_BANDWIDTH,
+				       input, xgmi_bw);
 }
 
-oob_status_t write_gmi3_link_width_range(uint8_t soc_num,
-					 uint8_t min_link_width,
-					 uint8_t max_link_width)
+oob_status_t write_gmi3_link_width_range_h(struct apml_handle *handle,
+					   uint8_t min_link_width,
+					   uint8_t max_link_width)
 {
 	uint32_t input;
 	oob_status_t ret;
@@ -664,13 +686,13 @@ oob_status_t write_gmi3_link_width_range(uint8_t soc_num,
 
 	input = max_link_width | min_link_width << 8;
 
-	return esmi_oob_write_mailbox(soc_num,
-				      WRITE_GMI3_LINK_WIDTH_RANGE, input);
+	return esmi_oob_write_mailbox_h(handle,
+					WRITE_GMI3_LINK_WIDTH_RANGE, input);
 }
 
-oob_status_t write_xgmi_link_width_range(uint8_t soc_num,
-					 uint8_t min_link_width,
-					 uint8_t max_link_width)
+oob_status_t write_xgmi_link_width_range_h(struct apml_handle *handle,
+					   uint8_t min_link_width,
+					   uint8_t max_link_width)
 {
 	uint32_t input;
 	oob_status_t ret;
@@ -682,12 +704,12 @@ oob_status_t write_xgmi_link_width_range(uint8_t soc_num,
 
 	input = max_link_width | min_link_width << 8;
 
-	return esmi_oob_write_mailbox(soc_num,
-				      WRITE_XGMI_LINK_WIDTH_RANGE, input);
+	return esmi_oob_write_mailbox_h(handle,
+					WRITE_XGMI_LINK_WIDTH_RANGE, input);
 }
 
-oob_status_t write_apb_disable(uint8_t soc_num, uint8_t df_pstate,
-			       bool *prochot_asserted)
+oob_status_t write_apb_disable_h(struct apml_handle *handle, uint8_t df_pstate,
+				 bool *prochot_asserted)
 {
 	uint32_t prochat_status;
 	oob_status_t ret;
@@ -698,7 +720,7 @@ oob_status_t write_apb_disable(uint8_t soc_num, uint8_t df_pstate,
 	if (df_pstate > MAX_DF_PSTATE_LIMIT)
 		return OOB_INVALID_INPUT;
 
-	ret = read_prochot_status(soc_num, &prochat_status);
+	ret = read_prochot_status_h(handle, &prochat_status);
 	if (ret)
 		return ret;
 
@@ -707,11 +729,12 @@ oob_status_t write_apb_disable(uint8_t soc_num, uint8_t df_pstate,
 		return OOB_SUCCESS;
 	}
 
-	return esmi_oob_write_mailbox(soc_num,
-				      WRITE_APB_DISABLE, (uint32_t)df_pstate);
+	return esmi_oob_write_mailbox_h(handle,
+					WRITE_APB_DISABLE, (uint32_t)df_pstate);
 }
 
-oob_status_t write_apb_enable(uint8_t soc_num, bool *prochot_asserted)
+oob_status_t write_apb_enable_h(struct apml_handle *handle,
+				bool *prochot_asserted)
 {
 	uint32_t prochat_status;
 	oob_status_t ret;
@@ -719,7 +742,7 @@ oob_status_t write_apb_enable(uint8_t soc_num, bool *prochot_asserted)
 	if (!prochot_asserted)
 		return OOB_ARG_PTR_NULL;
 
-	ret = read_prochot_status(soc_num, &prochat_status);
+	ret = read_prochot_status_h(handle, &prochat_status);
 	if (ret)
 		return ret;
 
@@ -728,11 +751,11 @@ oob_status_t write_apb_enable(uint8_t soc_num, bool *prochot_asserted)
 		return OOB_SUCCESS;
 	}
 
-	return esmi_oob_write_mailbox(soc_num, WRITE_APB_ENABLE, 0);
+	return esmi_oob_write_mailbox_h(handle, WRITE_APB_ENABLE, 0);
 }
 
-oob_status_t read_current_dfpstate_frequency(uint8_t soc_num,
-					     struct pstate_freq *df_pstate)
+oob_status_t read_current_dfpstate_frequency_h(struct apml_handle *handle,
+					       struct pstate_freq *df_pstate)
 {
 	uint32_t output;
 	oob_status_t ret;
@@ -740,9 +763,9 @@ oob_status_t read_current_dfpstate_frequency(uint8_t soc_num,
 	if (!df_pstate)
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_read_mailbox(soc_num,
-				    READ_CURRENT_DFPSTATE_FREQUENCY,
-				    0, &output);
+	ret = esmi_oob_read_mailbox_h(handle,
+				      READ_CURRENT_DFPSTATE_FREQUENCY,
+				      0, &output);
 	if (ret)
 		return ret;
 
@@ -753,8 +776,8 @@ oob_status_t read_current_dfpstate_frequency(uint8_t soc_num,
 	return ret;
 }
 
-oob_status_t write_lclk_dpm_level_range(uint8_t soc_num,
-					struct lclk_dpm_level_range lclk)
+oob_status_t write_lclk_dpm_level_range_h(struct apml_handle *handle,
+					  struct lclk_dpm_level_range lclk)
 {
 	uint32_t input;
 	oob_status_t ret;
@@ -768,13 +791,13 @@ oob_status_t write_lclk_dpm_level_range(uint8_t soc_num,
 	input = lclk.dpm.min_dpm_level | lclk.dpm.max_dpm_level << 8
 		| lclk.nbio_id << 16;
 
-	return esmi_oob_write_mailbox(soc_num,
-				      WRITE_LCLK_DPM_LEVEL_RANGE, input);
+	return esmi_oob_write_mailbox_h(handle,
+					WRITE_LCLK_DPM_LEVEL_RANGE, input);
 }
 
-oob_status_t read_bmc_rapl_units(uint8_t soc_num,
-				 uint8_t *tu_value,
-				 uint8_t *esu_value)
+oob_status_t read_bmc_rapl_units_h(struct apml_handle *handle,
+				   uint8_t *tu_value,
+				   uint8_t *esu_value)
 {
 	uint32_t output;
 	oob_status_t ret;
@@ -782,64 +805,81 @@ oob_status_t read_bmc_rapl_units(uint8_t soc_num,
 	if ((!tu_value) || (!esu_value))
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_read_mailbox(soc_num,
-				    READ_BMC_RAPL_UNITS,
-				    0, &output);
+	/* The units only change with the part, they are read once */
+	if (apml_cache_get(handle, APML_CACHE_RAPL_UNITS, &output)) {
+		*tu_value = output >> 8;
+		*esu_value = output & 0xff;
+		return OOB_SUCCESS;
+	}
+
+	ret = esmi_oob_read_mailbox_h(handle,
+				      READ_BMC_RAPL_UNITS,
+				      0, &output);
 	if (ret)
 		return ret;
 
 	*tu_value  = (output >> 16) & TU_MASK;
 	*esu_value = (output >> 8) & ESU_MASK;
+	apml_cache_set(handle, APML_CACHE_RAPL_UNITS,
+		       (uint32_t)*tu_value << 8 | *esu_value);
 
 	return ret;
 }
 
-static oob_status_t read_bmc_rapl_core_lo_counter(uint8_t soc_num,
+static oob_status_t read_bmc_rapl_core_lo_counter(struct apml_handle *handle,
 						  uint32_t core_id,
 						  uint32_t *value)
 {
-	return esmi_oob_read_mailbox(soc_num,
-				     READ_BMC_RAPL_CORE_LO_COUNTER,
-				     core_id, value);
+	return esmi_oob_read_mailbox_h(handle,
+				       READ_BMC_RAPL_CORE_LO_COUNTER,
+				       core_id, value);
 }
 
-static oob_status_t read_bmc_rapl_core_hi_counter(uint8_t soc_num,
+static oob_status_t read_bmc_rapl_core_hi_counter(struct apml_handle *handle,
 						  uint32_t core_id,
 						  uint32_t *value)
 {
-	return esmi_oob_read_mailbox(soc_num, READ_BMC_RAPL_CORE_HI_COUNTER,
-				     core_id, value);
+	return esmi_oob_read_mailbox_h(handle, READ_BMC_RAPL_CORE_HI_COUNTER,
+				       core_id, value);
 }
 
-static oob_status_t read_bmc_rapl_pkg_counter(uint8_t soc_num,
+static oob_status_t read_bmc_rapl_pkg_counter(struct apml_handle *handle,
 					      uint8_t counter,
 					      uint32_t *counter_value)
 {
-	return esmi_oob_read_mailbox(soc_num,
-				     READ_BMC_RAPL_PKG_COUNTER,
-				     counter, counter_value);
+	return esmi_oob_read_mailbox_h(handle,
+				       READ_BMC_RAPL_PKG_COUNTER,
+				       counter, counter_value);
 }
 
-oob_status_t read_bmc_cpu_base_frequency(uint8_t soc_num,
-					 uint16_t *base_freq)
+oob_status_t read_bmc_cpu_base_frequency_h(struct apml_handle *handle,
+					   uint16_t *base_freq)
 {
-	return esmi_oob_read_mailbox(soc_num,
-				     READ_BMC_CPU_BASE_FREQUENCY,
-				     0, (uint32_t *)base_freq);
+	uint32_t output;
+	oob_status_t ret;
+
+	if (!base_freq)
+		return OOB_ARG_PTR_NULL;
+
+	ret = read_static_mailbox(handle, APML_CACHE_BASE_FREQ,
+				  READ_BMC_CPU_BASE_FREQUENCY, &output);
+	if (!ret)
+		*base_freq = output;
+	return ret;
 }
 
-oob_status_t read_bmc_control_pcie_gen5_rate(uint8_t soc_num,
-					     uint8_t rate,
-					     uint8_t *mode)
+oob_status_t read_bmc_control_pcie_gen5_rate_h(struct apml_handle *handle,
+					       uint8_t rate,
+					       uint8_t *mode)
 {
 	oob_status_t ret;
 
 	if (rate > GEN5_RATE)
 		return OOB_INVALID_INPUT;
 
-	ret = esmi_oob_read_mailbox(soc_num,
-				    READ_BMC_CONTROL_PCIE_GEN5_RATE,
-				    rate, (uint32_t *)mode);
+	ret = esmi_oob_read_mailbox_h(handle,
+				      READ_BMC_CONTROL_PCIE_GEN5_RATE,
+				      rate, (uint32_t *)mode);
 	if (ret)
 		return ret;
 
@@ -847,20 +887,20 @@ oob_status_t read_bmc_control_pcie_gen5_rate(uint8_t soc_num,
 	return ret;
 }
 
-oob_status_t write_pwr_efficiency_mode(uint8_t soc_num,
-				       uint8_t mode)
+oob_status_t write_pwr_efficiency_mode_h(struct apml_handle *handle,
+					 uint8_t mode)
 {
 	if (validate_pwr_efficiency_mode(mode))
 		return OOB_INVALID_INPUT;
 
-	return esmi_oob_write_mailbox(soc_num,
-				      WRITE_PWR_EFFICIENCY_MODE,
-				      (uint32_t)mode);
+	return esmi_oob_write_mailbox_h(handle,
+					WRITE_PWR_EFFICIENCY_MODE,
+					(uint32_t)mode);
 }
 
-oob_status_t write_df_pstate_range(uint8_t soc_num,
-				   uint8_t max_pstate,
-				   uint8_t min_pstate)
+oob_status_t write_df_pstate_range_h(struct apml_handle *handle,
+				     uint8_t max_pstate,
+				     uint8_t min_pstate)
 {
 	uint32_t input;
 
@@ -869,13 +909,14 @@ oob_status_t write_df_pstate_range(uint8_t soc_num,
 
 	input = ((uint16_t)min_pstate << 8 | max_pstate) & TWO_BYTE_MASK;
 
-	return esmi_oob_write_mailbox(soc_num,
-				      WRITE_DF_PSTATE_RANGE,
-				      input);
+	return esmi_oob_write_mailbox_h(handle,
+					WRITE_DF_PSTATE_RANGE,
+					input);
 }
 
-oob_status_t read_lclk_dpm_level_range(uint8_t soc_num, uint8_t nbio_id,
-				       struct dpm_level *dpm)
+oob_status_t read_lclk_dpm_level_range_h(struct apml_handle *handle,
+					 uint8_t nbio_id,
+					 struct dpm_level *dpm)
 {
 	uint32_t input, output;
 	oob_status_t ret;
@@ -887,8 +928,8 @@ oob_status_t read_lclk_dpm_level_range(uint8_t soc_num, uint8_t nbio_id,
 		return OOB_INVALID_INPUT;
 
 	input = (uint32_t)nbio_id << 16;
-	ret = esmi_oob_read_mailbox(soc_num, READ_LCLK_DPM_LEVEL_RANGE,
-				    input, &output);
+	ret = esmi_oob_read_mailbox_h(handle, READ_LCLK_DPM_LEVEL_RANGE,
+				      input, &output);
 	if (ret)
 		return ret;
 	dpm->min_dpm_level = output;
@@ -897,145 +938,721 @@ oob_status_t read_lclk_dpm_level_range(uint8_t soc_num, uint8_t nbio_id,
 	return OOB_SUCCESS;
 }
 
-static oob_status_t read_bmc_esu_multiplier(uint8_t soc_num)
-{
-	uint8_t tu_value, esu_value;
-	oob_status_t ret;
-
-	ret = read_bmc_rapl_units(soc_num, &tu_value, &esu_value);
-	if (ret)
-		return ret;
-
-	esu_multiplier = pow(2, -1 * (esu_value));
-	return ret;
-}
-
-oob_status_t read_rapl_core_energy_counters(uint8_t soc_num,
-					    uint32_t core_id,
-					    double *energy_counters)
+/*
+ * The 64-bit RAPL energy counters are read as two 32-bit halves. The low
+ * half is read again when the high half changed in between, i.e. the low
+ * half wrapped.
+ */
+static oob_status_t read_rapl_core_counter(struct apml_handle *handle,
+					   uint32_t core_id,
+					   uint64_t *counter)
 {
-	uint64_t counter;
 	uint32_t hi_counter, new_hi_counter, lo_counter;
 	oob_status_t ret;
 
-	if (!energy_counters)
-		return OOB_ARG_PTR_NULL;
-
 	/* Read Package High count Register Value */
-	ret = read_bmc_rapl_core_hi_counter(soc_num, core_id, &hi_counter);
+	ret = read_bmc_rapl_core_hi_counter(handle, core_id, &hi_counter);
 
 	if (ret)
 		return ret;
 
 	/* Read Package Low count Register Value */
-	ret = read_bmc_rapl_core_lo_counter(soc_num, core_id, &lo_counter);
+	ret = read_bmc_rapl_core_lo_counter(handle, core_id, &lo_counter);
 	if (ret)
 		return ret;
 
 	/* Read Package High count Register Value */
-	ret = read_bmc_rapl_core_hi_counter(soc_num, core_id, &new_hi_counter);
+	ret = read_bmc_rapl_core_hi_counter(handle, core_id, &new_hi_counter);
 	if (ret)
 		return ret;
 
 	if (hi_counter != new_hi_counter) {
 		/* Read Package low count Register Value */
-		ret = read_bmc_rapl_core_lo_counter(soc_num, core_id, &lo_counter);
+		ret = read_bmc_rapl_core_lo_counter(handle, core_id, &lo_counter);
 		if (ret)
 			return ret;
 	}
 
 	/* Get the 64-bit counter from high and low word counters */
-	counter = (uint64_t)new_hi_counter << 32\
-		  | (uint64_t)lo_counter & FOUR_BYTE_MASK;
-
-	/* Get the esu multiplier */
-	if (!esu_multiplier) {
-		ret = read_bmc_esu_multiplier(soc_num);
-		if (ret)
-			return ret;
-	}
-
-	/* Calculate the energy counters(64bit counter * esu_multiplier) */
-	/* Convert the energy counters to Kilo Joules by dividing it by 1000 */
-	*energy_counters = (counter * esu_multiplier) / 1000;
+	*counter = (uint64_t)new_hi_counter << 32\
+		   | (uint64_t)lo_counter & FOUR_BYTE_MASK;
 
 	return ret;
 }
 
-oob_status_t read_rapl_pckg_energy_counters(uint8_t soc_num,
-					    double *energy_counters)
+static oob_status_t read_rapl_pkg_counter(struct apml_handle *handle,
+					  uint64_t *counter)
 {
-	uint64_t counter;
 	uint32_t hi_counter, new_hi_counter, lo_counter;
 	oob_status_t ret;
 
-	if (!energy_counters)
-		return OOB_ARG_PTR_NULL;
-
 	/* Read Package High count Register Value */
-	ret = read_bmc_rapl_pkg_counter(soc_num, HI_WORD_REG,
+	ret = read_bmc_rapl_pkg_counter(handle, HI_WORD_REG,
 					&hi_counter);
 	if (ret)
 		return ret;
 
 	/* Read Package low count Register Value */
-	ret = read_bmc_rapl_pkg_counter(soc_num, LO_WORD_REG,
+	ret = read_bmc_rapl_pkg_counter(handle, LO_WORD_REG,
 					&lo_counter);
 	if (ret)
 		return ret;
 
 	/* Read Package High count Register value */
-	ret = read_bmc_rapl_pkg_counter(soc_num, HI_WORD_REG,
+	ret = read_bmc_rapl_pkg_counter(handle, HI_WORD_REG,
 					&new_hi_counter);
 	if (ret)
 		return ret;
 
 	if (hi_counter != new_hi_counter) {
 		/* Read Package low count Register value */
-		ret = read_bmc_rapl_pkg_counter(soc_num,
+		ret = read_bmc_rapl_pkg_counter(handle,
 						LO_WORD_REG,
 						&lo_counter);
 		if (ret)
 			return ret;
 	}
-	counter = (uint64_t)new_hi_counter << 32 |\
-		  (uint64_t)lo_counter & FOUR_BYTE_MASK;
+	*counter = (uint64_t)new_hi_counter << 32 |\
+		   (uint64_t)lo_counter & FOUR_BYTE_MASK;
+
+	return ret;
+}
+
+oob_status_t read_rapl_core_energy_raw_h(struct apml_handle *handle,
+					 uint32_t core_id,
+					 struct rapl_energy *energy)
+{
+	uint8_t tu_value;
+	oob_status_t ret;
+
+	if (!energy)
+		return OOB_ARG_PTR_NULL;
+
+	ret = read_rapl_core_counter(handle, core_id, &energy->counter);
+	if (ret)
+		return ret;
+
+	return read_bmc_rapl_units_h(handle, &tu_value, &energy->esu);
+}
+
+oob_status_t read_rapl_pckg_energy_raw_h(struct apml_handle *handle,
+					 struct rapl_energy *energy)
+{
+	uint8_t tu_value;
+	oob_status_t ret;
+
+	if (!energy)
+		return OOB_ARG_PTR_NULL;
+
+	ret = read_rapl_pkg_counter(handle, &energy->counter);
+	if (ret)
+		return ret;
+
+	return read_bmc_rapl_units_h(handle, &tu_value, &energy->esu);
+}
 
-	/* Get the esu multiplier */
-	if (!esu_multiplier) {
-		ret = read_bmc_esu_multiplier(soc_num);
+/*
+ * Sample one core counter for read_rapl_core_energy_all_h(): hi, lo, hi in
+ * one batch, then lo, hi again while the high half keeps moving. The
+ * sample is timed at the middle of the batch that read the low half.
+ */
+static oob_status_t read_rapl_core_sample(struct apml_handle *handle,
+					  uint32_t core_id,
+					  struct rapl_core_energy *sample)
+{
+	struct apml_message msgs[3];
+	oob_status_t status[3];
+	uint32_t hi_counter;
+	uint64_t start;
+	oob_status_t ret;
+	int i, first;
+
+	apml_mailbox_read_msg(&msgs[0], READ_BMC_RAPL_CORE_HI_COUNTER,
+			      core_id);
+	apml_mailbox_read_msg(&msgs[1], READ_BMC_RAPL_CORE_LO_COUNTER,
+			      core_id);
+	apml_mailbox_read_msg(&msgs[2], READ_BMC_RAPL_CORE_HI_COUNTER,
+			      core_id);
+
+	for (i = 0; i < RAPL_TORN_RETRIES; i++) {
+		first = i ? 1 : 0;
+		start = apml_monotonic_ns();
+		ret = apml_xfer_batch(handle, SBRMI, &msgs[first], 3 - first,
+				      status);
 		if (ret)
 			return ret;
+		sample->timestamp_ns = start + (apml_monotonic_ns() - start) / 2;
+
+		hi_counter = msgs[2].data_out.mb_out[0];
+		if (msgs[0].data_out.mb_out[0] == hi_counter) {
+			sample->counter = (uint64_t)hi_counter << 32 |
+					  msgs[1].data_out.mb_out[0];
+			return OOB_SUCCESS;
+		}
+		/* The low half wrapped, it must agree with the new high half */
+		msgs[0].data_out.mb_out[0] = hi_counter;
 	}
 
-	/* Calculate the energy counters(64bit counter * esu_multiplier) */
-	/* Convert the energy counters to Mega Joules by dividing it by 1000000 */
-	*energy_counters = (counter * esu_multiplier) / 1000000;
-	return ret;
+	return OOB_TRY_AGAIN;
 }
 
-oob_status_t read_ras_last_transaction_address(uint8_t soc_num,
-					       uint64_t *transaction_addr)
+oob_status_t read_rapl_core_energy_all_h(struct apml_handle *handle,
+					 struct rapl_core_energy *energy,
+					 uint32_t max_cores,
+					 uint32_t *num_cores, uint8_t *esu)
 {
-	uint32_t lo_addr, high_addr;
+	uint8_t thread_en[MAX_THREAD_REG_V20] = {0};
+	uint32_t threads, threads_per_core, cores, core, n;
+	oob_status_t ret, first_err = OOB_SUCCESS;
+	uint8_t tu_value;
+
+	if (!energy || !num_cores || !esu)
+		return OOB_ARG_PTR_NULL;
+
+	/* Cached per socket, only the thread enable status is read */
+	ret = read_bmc_rapl_units_h(handle, &tu_value, esu);
+	if (ret)
+		return ret;
+	/* CPUID Fn0B, the 8-bit count of Fn01 overflows on 256 threads */
+	ret = esmi_get_logical_cores_per_socket_h(handle, &threads);
+	if (ret)
+		return ret;
+	ret = esmi_get_threads_per_core_h(handle, &threads_per_core);
+	if (ret)
+		return ret;
+	ret = read_sbrmi_multithreadenablestatus_h(handle, thread_en);
+	if (ret)
+		return ret;
+
+	/* Threads 0 to cores - 1 are the first threads of the cores */
+	cores = threads / threads_per_core;
+	if (!cores)
+		return OOB_UNEXPECTED_SIZE;
+	if (cores > sizeof(thread_en) * 8)
+		cores = sizeof(thread_en) * 8;
+
+	n = 0;
+	for (core = 0; core < cores; core++)
+		if (thread_en[core / 8] & 1 << core % 8)
+			n++;
+	*num_cores = n;
+	if (n > max_cores)
+		return OOB_INVALID_INPUT;
+
+	n = 0;
+	for (core = 0; core < cores; core++) {
+		if (!(thread_en[core / 8] & 1 << core % 8))
+			continue;
+		energy[n].core_id = core;
+		energy[n].status = read_rapl_core_sample(handle, core,
+							 &energy[n]);
+		if (!first_err)
+			first_err = energy[n].status;
+		n++;
+	}
+
+	return first_err;
+}
+
+oob_status_t rapl_energy_to_uj(const struct rapl_energy *energy,
+			       uint64_t *energy_uj)
+{
+	uint64_t frac;
+
+	if (!energy || !energy_uj)
+		return OOB_ARG_PTR_NULL;
+	if (energy->esu > ESU_MASK)
+		return OOB_INVALID_INPUT;
+
+	/*
+	 * counter / 2^esu J, split into whole and fractional Joules so that
+	 * the scaling to uJ cannot overflow: the fraction is below 2^31.
+	 */
+	frac = energy->counter & ((1ULL << energy->esu) - 1);
+	*energy_uj = (energy->counter >> energy->esu) * UJ_PER_J +
+		     ((frac * UJ_PER_J) >> energy->esu);
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t read_rapl_core_energy_uj_h(struct apml_handle *handle,
+					uint32_t core_id,
+					uint64_t *energy_uj)
+{
+	struct rapl_energy energy;
 	oob_status_t ret;
 
-	if (!transaction_addr)
+	if (!energy_uj)
 		return OOB_ARG_PTR_NULL;
 
-	/* Read high word register for RAS last transaction address */
-	ret = esmi_oob_read_mailbox(soc_num, READ_RAS_LAST_TRANSACTION_ADDRESS,
-				    HI_WORD_REG, &high_addr);
+	ret = read_rapl_core_energy_raw_h(handle, core_id, &energy);
 	if (ret)
 		return ret;
 
-	/* Read low word register for RAS last transaction address */
-	ret = esmi_oob_read_mailbox(soc_num, READ_RAS_LAST_TRANSACTION_ADDRESS,
-				    LO_WORD_REG, &lo_addr);
+	return rapl_energy_to_uj(&energy, energy_uj);
+}
+
+oob_status_t read_rapl_pckg_energy_uj_h(struct apml_handle *handle,
+					uint64_t *energy_uj)
+{
+	struct rapl_energy energy;
+	oob_status_t ret;
+
+	if (!energy_uj)
+		return OOB_ARG_PTR_NULL;
+
+	ret = read_rapl_pckg_energy_raw_h(handle, &energy);
 	if (ret)
 		return ret;
-	*transaction_addr = ((uint64_t)high_addr) << 32
-			      | (uint64_t)lo_addr & FOUR_BYTE_MASK;
+
+	return rapl_energy_to_uj(&energy, energy_uj);
+}
+
+oob_status_t read_rapl_core_energy_counters_h(struct apml_handle *handle,
+					      uint32_t core_id,
+					      double *energy_counters)
+{
+	struct rapl_energy energy;
+	oob_status_t ret;
+
+	if (!energy_counters)
+		return OOB_ARG_PTR_NULL;
+
+	ret = read_rapl_core_energy_raw_h(handle, core_id, &energy);
+	if (ret)
+		return ret;
+
+	/* Calculate the energy counters(64bit counter / 2^esu) */
+	/* Convert the energy counters to Kilo Joules by dividing it by 1000 */
+	*energy_counters = (double)energy.counter / (1ULL << energy.esu) / 1000;
 
 	return ret;
 }
+
+oob_status_t read_rapl_pckg_energy_counters_h(struct apml_handle *handle,
+					      double *energy_counters)
+{
+	struct rapl_energy energy;
+	oob_status_t ret;
+
+	if (!energy_counters)
+		return OOB_ARG_PTR_NULL;
+
+	ret = read_rapl_pckg_energy_raw_h(handle, &energy);
+	if (ret)
+		return ret;
+
+	/* Calculate the energy counters(64bit counter / 2^esu) */
+	/* Convert the energy counters to Mega Joules by dividing it by 1000000 */
+	*energy_counters = (double)energy.counter / (1ULL << energy.esu) /
+			   1000000;
+	return ret;
+}
+
+oob_status_t read_ras_last_transaction_address_h(struct apml_handle *handle,
+						 uint64_t *transaction_addr)
+{
+	uint32_t lo_addr, high_addr;
+	oob_status_t ret;
+
+	if (!transaction_addr)
+		return OOB_ARG_PTR_NULL;
+
+	/* Read high word register for RAS last transaction address */
+	ret = esmi_oob_read_mailbox_h(handle, READ_RAS_LAST_TRANSACTION_ADDRESS,
+				      HI_WORD_REG, &high_addr);
+	if (ret)
+		return ret;
+
+	/* Read low word register for RAS last transaction address */
+	ret = esmi_oob_read_mailbox_h(handle, READ_RAS_LAST_TRANSACTION_ADDRESS,
+				      LO_WORD_REG, &lo_addr);
+	if (ret)
+		return ret;
+	*transaction_addr = ((uint64_t)high_addr) << 32
+			      | (uint64_t)lo_addr & FOUR_BYTE_MASK;
+
+	return ret;
+}
+
+/*
+ * Socket index based API, operating on the default handle of the socket
+ */
+oob_status_t read_socket_power(uint8_t soc_num, uint32_t *buffer)
+{
+	return read_socket_power_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_socket_power_limit(uint8_t soc_num, uint32_t *buffer)
+{
+	return read_socket_power_limit_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_max_socket_power_limit(uint8_t soc_num, uint32_t *buffer)
+{
+	return read_max_socket_power_limit_h(apml_socket_handle(soc_num),
+					     buffer);
+}
+
+oob_status_t read_tdp(uint8_t soc_num, uint32_t *buffer)
+{
+	return read_tdp_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_max_tdp(uint8_t soc_num, uint32_t *buffer)
+{
+	return read_max_tdp_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_min_tdp(uint8_t soc_num, uint32_t *buffer)
+{
+	return read_min_tdp_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t write_socket_power_limit(uint8_t soc_num, uint32_t limit)
+{
+	return write_socket_power_limit_h(apml_socket_handle(soc_num), limit);
+}
+
+oob_status_t read_bios_boost_fmax(uint8_t soc_num,
+				  uint32_t value, uint32_t *buffer)
+{
+	return read_bios_boost_fmax_h(apml_socket_handle(soc_num), value,
+				      buffer);
+}
+
+oob_status_t read_esb_boost_limit(uint8_t soc_num,
+				  uint32_t value, uint32_t *buffer)
+{
+	return read_esb_boost_limit_h(apml_socket_handle(soc_num), value,
+				      buffer);
+}
+
+oob_status_t write_esb_boost_limit(uint8_t soc_num,
+				   uint32_t cpu_ind, uint32_t limit)
+{
+	return write_esb_boost_limit_h(apml_socket_handle(soc_num), cpu_ind,
+				       limit);
+}
+
+oob_status_t write_esb_boost_limit_allcores(uint8_t soc_num,
+					    uint32_t limit)
+{
+	return write_esb_boost_limit_allcores_h(apml_socket_handle(soc_num),
+						limit);
+}
+
+oob_status_t read_dram_throttle(uint8_t soc_num, uint32_t *buffer)
+{
+	return read_dram_throttle_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t write_dram_throttle(uint8_t soc_num, uint32_t limit)
+{
+	return write_dram_throttle_h(apml_socket_handle(soc_num), limit);
+}
+
+oob_status_t read_prochot_status(uint8_t soc_num, uint32_t *buffer)
+{
+	return read_prochot_status_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_prochot_residency(uint8_t soc_num, float *buffer)
+{
+	return read_prochot_residency_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t
+read_nbio_error_logging_register(uint8_t soc_num,
+				 struct nbio_err_log nbio,
+				 uint32_t *buffer)
+{
+	return read_nbio_error_logging_register_h(apml_socket_handle(soc_num),
+						  nbio, buffer);
+}
+
+oob_status_t read_iod_bist(uint8_t soc_num, uint32_t *buffer)
+{
+	return read_iod_bist_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_ccd_bist_result(uint8_t soc_num,
+				  uint32_t input, uint32_t *buffer)
+{
+	return read_ccd_bist_result_h(apml_socket_handle(soc_num), input,
+				      buffer);
+}
+
+oob_status_t read_ccx_bist_result(uint8_t soc_num,
+				  uint32_t value, uint32_t *ccx_bist)
+{
+	return read_ccx_bist_result_h(apml_socket_handle(soc_num), value,
+				      ccx_bist);
+}
+
+oob_status_t read_ddr_bandwidth(uint8_t soc_num,
+				struct max_ddr_bw *max_ddr)
+{
+	return read_ddr_bandwidth_h(apml_socket_handle(soc_num), max_ddr);
+}
+
+oob_status_t write_bmc_report_dimm_power(uint8_t soc_num,
+					 struct dimm_power dp_info)
+{
+	return write_bmc_report_dimm_power_h(apml_socket_handle(soc_num),
+					     dp_info);
+}
+
+oob_status_t write_bmc_report_dimm_thermal_sensor(uint8_t soc_num,
+						  struct dimm_thermal dt_info)
+{
+	return write_bmc_report_dimm_thermal_sensor_h(
+			apml_socket_handle(soc_num), dt_info);
+}
+
+oob_status_t read_bmc_ras_pcie_config_access(uint8_t soc_num,
+					     struct pci_address pci_addr,
+					     uint32_t *buffer)
+{
+	return read_bmc_ras_pcie_config_access_h(apml_socket_handle(soc_num),
+						 pci_addr, buffer);
+}
+
+oob_status_t read_bmc_ras_mca_validity_check(uint8_t soc_num,
+					     uint16_t *bytes_per_mca,
+					     uint16_t *mca_banks)
+{
+	return read_bmc_ras_mca_validity_check_h(apml_socket_handle(soc_num),
+						 bytes_per_mca, mca_banks);
+}
+
+oob_status_t read_bmc_ras_mca_msr_dump(uint8_t soc_num,
+				       struct mca_bank mca_dump,
+				       uint32_t *buffer)
+{
+	return read_bmc_ras_mca_msr_dump_h(apml_socket_handle(soc_num),
+					   mca_dump, buffer);
+}
+
+oob_status_t read_bmc_ras_fch_reset_reason(uint8_t soc_num,
+					   uint32_t input,
+					   uint32_t *buffer)
+{
+	return read_bmc_ras_fch_reset_reason_h(apml_socket_handle(soc_num),
+					       input, buffer);
+}
+
+oob_status_t read_dimm_temp_range_and_refresh_rate(uint8_t soc_num,
+						   uint32_t dimm_addr,
+						   struct temp_refresh_rate *rate)
+{
+	return read_dimm_temp_range_and_refresh_rate_h(
+			apml_socket_handle(soc_num), dimm_addr, rate);
+}
+
+oob_status_t read_dimm_power_consumption(uint8_t soc_num,
+					 uint32_t dimm_addr,
+					 struct dimm_power *dimm_pow)
+{
+	return read_dimm_power_consumption_h(apml_socket_handle(soc_num),
+					     dimm_addr, dimm_pow);
+}
+
+oob_status_t read_dimm_thermal_sensor(uint8_t soc_num,
+				      uint32_t dimm_addr,
+				      struct dimm_thermal *dimm_temp)
+{
+	return read_dimm_thermal_sensor_h(apml_socket_handle(soc_num),
+					  dimm_addr, dimm_temp);
+}
+
+oob_status_t read_pwr_current_active_freq_limit_socket(uint8_t soc_num,
+						       uint16_t *freq,
+						       char **source_type)
+{
+	return read_pwr_current_active_freq_limit_socket_h(
+			apml_socket_handle(soc_num), freq, source_type);
+}
+
+oob_status_t read_pwr_current_active_freq_limit_core(uint8_t soc_num,
+						     uint32_t core_id,
+						     uint16_t *base_freq)
+{
+	return read_pwr_current_active_freq_limit_core_h(
+			apml_socket_handle(soc_num), core_id, base_freq);
+}
+
+oob_status_t read_pwr_svi_telemetry_all_rails(uint8_t soc_num,
+					      uint32_t *power)
+{
+	return read_pwr_svi_telemetry_all_rails_h(apml_socket_handle(soc_num),
+						  power);
+}
+
+oob_status_t read_socket_freq_range(uint8_t soc_num,
+				    uint16_t *fmax,
+				    uint16_t *fmin)
+{
+	return read_socket_freq_range_h(apml_socket_handle(soc_num), fmax,
+					fmin);
+}
+
+oob_status_t read_current_io_bandwidth(uint8_t soc_num,
+				       struct link_id_bw_type link,
+				       uint32_t *io_bw)
+{
+	return read_current_io_bandwidth_h(apml_socket_handle(soc_num), link,
+					   io_bw);
+}
+
+oob_status_t read_current_xgmi_bandwidth(uint8_t soc_num,
+					 struct link_id_bw_type link,
+					 uint32_t *xgmi_bw)
+{
+	return read_current_xgmi_bandwidth_h(apml_socket_handle(soc_num), link,
+					     xgmi_bw);
+}
+
+oob_status_t write_gmi3_link_width_range(uint8_t soc_num,
+					 uint8_t min_link_width,
+					 uint8_t max_link_width)
+{
+	return write_gmi3_link_width_range_h(apml_socket_handle(soc_num),
+					     min_link_width, max_link_width);
+}
+
+oob_status_t write_xgmi_link_width_range(uint8_t soc_num,
+					 uint8_t min_link_width,
+					 uint8_t max_link_width)
+{
+	return write_xgmi_link_width_range_h(apml_socket_handle(soc_num),
+					     min_link_width, max_link_width);
+}
+
+oob_status_t write_apb_disable(uint8_t soc_num, uint8_t df_pstate,
+			       bool *prochot_asserted)
+{
+	return write_apb_disable_h(apml_socket_handle(soc_num), df_pstate,
+				   prochot_asserted);
+}
+
+oob_status_t write_apb_enable(uint8_t soc_num, bool *prochot_asserted)
+{
+	return write_apb_enable_h(apml_socket_handle(soc_num),
+				  prochot_asserted);
+}
+
+oob_status_t read_current_dfpstate_frequency(uint8_t soc_num,
+					     struct pstate_freq *df_pstate)
+{
+	return read_current_dfpstate_frequency_h(apml_socket_handle(soc_num),
+						 df_pstate);
+}
+
+oob_status_t write_lclk_dpm_level_range(uint8_t soc_num,
+					struct lclk_dpm_level_range lclk)
+{
+	return write_lclk_dpm_level_range_h(apml_socket_handle(soc_num), lclk);
+}
+
+oob_status_t read_bmc_rapl_units(uint8_t soc_num,
+				 uint8_t *tu_value,
+				 uint8_t *esu_value)
+{
+	return read_bmc_rapl_units_h(apml_socket_handle(soc_num), tu_value,
+				     esu_value);
+}
+
+oob_status_t read_bmc_cpu_base_frequency(uint8_t soc_num,
+					 uint16_t *base_freq)
+{
+	return read_bmc_cpu_base_frequency_h(apml_socket_handle(soc_num),
+					     base_freq);
+}
+
+oob_status_t read_bmc_control_pcie_gen5_rate(uint8_t soc_num,
+					     uint8_t rate,
+					     uint8_t *mode)
+{
+	return read_bmc_control_pcie_gen5_rate_h(apml_socket_handle(soc_num),
+						 rate, mode);
+}
+
+oob_status_t write_pwr_efficiency_mode(uint8_t soc_num,
+				       uint8_t mode)
+{
+	return write_pwr_efficiency_mode_h(apml_socket_handle(soc_num), mode);
+}
+
+oob_status_t write_df_pstate_range(uint8_t soc_num,
+				   uint8_t max_pstate,
+				   uint8_t min_pstate)
+{
+	return write_df_pstate_range_h(apml_socket_handle(soc_num), max_pstate,
+				       min_pstate);
+}
+
+oob_status_t read_lclk_dpm_level_range(uint8_t soc_num, uint8_t nbio_id,
+				       struct dpm_level *dpm)
+{
+	return read_lclk_dpm_level_range_h(apml_socket_handle(soc_num), nbio_id,
+					   dpm);
+}
+
+oob_status_t read_rapl_core_energy_counters(uint8_t soc_num,
+					    uint32_t core_id,
+					    double *energy_counters)
+{
+	return read_rapl_core_energy_counters_h(apml_socket_handle(soc_num),
+						core_id, energy_counters);
+}
+
+oob_status_t read_rapl_pckg_energy_counters(uint8_t soc_num,
+					    double *energy_counters)
+{
+	return read_rapl_pckg_energy_counters_h(apml_socket_handle(soc_num),
+						energy_counters);
+}
+
+oob_status_t read_rapl_core_energy_raw(uint8_t soc_num, uint32_t core_id,
+				       struct rapl_energy *energy)
+{
+	return read_rapl_core_energy_raw_h(apml_socket_handle(soc_num),
+					   core_id, energy);
+}
+
+oob_status_t read_rapl_pckg_energy_raw(uint8_t soc_num,
+				       struct rapl_energy *energy)
+{
+	return read_rapl_pckg_energy_raw_h(apml_socket_handle(soc_num),
+					   energy);
+}
+
+oob_status_t read_rapl_core_energy_all(uint8_t soc_num,
+				       struct rapl_core_energy *energy,
+				       uint32_t max_cores, uint32_t *num_cores,
+				       uint8_t *esu)
+{
+	return read_rapl_core_energy_all_h(apml_socket_handle(soc_num), energy,
+					   max_cores, num_cores, esu);
+}
+
+oob_status_t read_rapl_core_energy_uj(uint8_t soc_num, uint32_t core_id,
+				      uint64_t *energy_uj)
+{
+	return read_rapl_core_energy_uj_h(apml_socket_handle(soc_num),
+					  core_id, energy_uj);
+}
+
+oob_status_t read_rapl_pckg_energy_uj(uint8_t soc_num, uint64_t *energy_uj)
+{
+	return read_rapl_pckg_energy_uj_h(apml_socket_handle(soc_num),
+					  energy_uj);
+}
+
+oob_status_t read_ras_last_transaction_address(uint8_t soc_num,
+					       uint64_t *transaction_addr)
+{
+	return read_ras_last_transaction_address_h(apml_socket_handle(soc_num),
+						   transaction_addr);
+}
@@ -44,6 +44,8 @@
 #include <esmi_oob/esmi_rmi.h>
 #include <esmi_oob/apml.h>
 
+#include "common.h"
+
 /* REVISION 0x10 */
 /* Thread enable status registers */
 const uint8_t thread_en_reg_v10[] = {0x4, 0x5, 0x8, 0x9,
@@ -92,240 +94,346 @@ const uint8_t alert_mask_v20[] = {0x20, 0x21, 0x22, 0x23,
 				  0xC8, 0xC9, 0xCA, 0xCB,
 				  0xCC, 0xCD, 0xCE, 0xCF};
 
+/*
+ * Read a vector of SB-RMI registers in one batch. All the registers are
+ * read even if some of them fail, the first failure is returned.
+ */
+static oob_status_t read_sbrmi_regs(struct apml_handle *handle,
+				    const uint8_t *regs, size_t n,
+				    uint8_t *buffer)
+{
+	struct apml_message msgs[MAX_ALERT_REG_V20] = {0};
+	oob_status_t status[MAX_ALERT_REG_V20];
+	oob_status_t ret;
+	size_t i;
+
+	if (!handle || !buffer)
+		return OOB_ARG_PTR_NULL;
+
+	for (i = 0; i < n; i++) {
+		msgs[i].cmd = APML_REG;
+		msgs[i].data_in.reg_in[0] = regs[i];
+		/* Read operation */
+		msgs[i].data_in.reg_in[7] = 1;
+	}
+
+	ret = apml_xfer_batch(handle, SBRMI, msgs, n, status);
+	for (i = 0; i < n; i++)
+		if (!status[i])
+			buffer[i] = msgs[i].data_out.reg_out[0];
+
+	return ret;
+}
+
+/* Read the contiguous SB-RMI registers [first, last] in one batch */
+static oob_status_t read_sbrmi_reg_range(struct apml_handle *handle,
+					 uint8_t first, uint8_t last,
+					 uint8_t *buffer)
+{
+	uint8_t regs[MAX_ALERT_REG_V20];
+	int i;
+
+	for (i = 0; i <= last - first; i++)
+		regs[i] = first + i;
+
+	return read_sbrmi_regs(handle, regs, last - first + 1, buffer);
+}
+
 /* sb-rmi register access */
-oob_status_t read_sbrmi_revision(uint8_t soc_num,
-				 uint8_t *buffer)
+oob_status_t read_sbrmi_revision_h(struct apml_handle *handle,
+				   uint8_t *buffer)
 {
-	return esmi_oob_read_byte(soc_num,
-				  SBRMI_REVISION, SBRMI, buffer);
+	oob_status_t ret;
+
+	ret = esmi_oob_read_byte_h(handle,
+				   SBRMI_REVISION, SBRMI, buffer);
+	if (!ret)
+		apml_cache_set(handle, APML_CACHE_RMI_REV, *buffer);
+	return ret;
 }
 
-oob_status_t read_sbrmi_control(uint8_t soc_num,
-				uint8_t *buffer)
+oob_status_t apml_rmi_revision(struct apml_handle *handle, uint8_t *rev)
 {
-	return esmi_oob_read_byte(soc_num,
-				  SBRMI_CONTROL, SBRMI, buffer);
+	uint32_t val;
+
+	if (apml_cache_get(handle, APML_CACHE_RMI_REV, &val)) {
+		*rev = val;
+		return OOB_SUCCESS;
+	}
+
+	return read_sbrmi_revision_h(handle, rev);
 }
 
-oob_status_t read_sbrmi_status(uint8_t soc_num,
-			       uint8_t *buffer)
+oob_status_t read_sbrmi_control_h(struct apml_handle *handle,
+				  uint8_t *buffer)
 {
-	return esmi_oob_read_byte(soc_num,
-				  SBRMI_STATUS, SBRMI, buffer);
+	return esmi_oob_read_byte_h(handle,
+				    SBRMI_CONTROL, SBRMI, buffer);
 }
 
-oob_status_t read_sbrmi_readsize(uint8_t soc_num,
+oob_status_t read_sbrmi_status_h(struct apml_handle *handle,
 				 uint8_t *buffer)
 {
-	return esmi_oob_read_byte(soc_num,
-				  SBRMI_READSIZE, SBRMI, buffer);
+	return esmi_oob_read_byte_h(handle,
+				    SBRMI_STATUS, SBRMI, buffer);
 }
 
-oob_status_t read_sbrmi_threadenablestatus(uint8_t soc_num,
-					   uint8_t *buffer)
+oob_status_t read_sbrmi_readsize_h(struct apml_handle *handle,
+				   uint8_t *buffer)
 {
-	return esmi_oob_read_byte(soc_num,
-				  SBRMI_THREADENABLESTATUS0,
-				  SBRMI,
-				  buffer);
+	return esmi_oob_read_byte_h(handle,
+				    SBRMI_READSIZE, SBRMI, buffer);
 }
 
-oob_status_t read_sbrmi_multithreadenablestatus(uint8_t soc_num,
-						uint8_t *buffer)
+oob_status_t read_sbrmi_threadenablestatus_h(struct apml_handle *handle,
+					     uint8_t *buffer)
+{
+	return esmi_oob_read_byte_h(handle,
+				    SBRMI_THREADENABLESTATUS0,
+				    SBRMI,
+				    buffer);
+}
+
+oob_status_t read_sbrmi_multithreadenablestatus_h(struct apml_handle *handle,
+						  uint8_t *buffer)
 {
 	oob_status_t ret;
-	int i;
 	uint8_t rev;
 
 	if (!buffer)
 		return OOB_ARG_PTR_NULL;
 
-	ret = read_sbrmi_revision(soc_num, &rev);
+	ret = apml_rmi_revision(handle, &rev);
 	if (ret)
 		return ret;
-	if (rev == 0x10) {
-		for (i = 0; i < sizeof(thread_en_reg_v10); i++) {
-			ret = esmi_oob_read_byte(soc_num, thread_en_reg_v10[i],
-						 SBRMI, &buffer[i]);
-			if (ret)
-				return ret;
-		}
-	} else {
-		for (i = 0; i < sizeof(thread_en_reg_v20); i++) {
-			ret = esmi_oob_read_byte(soc_num, thread_en_reg_v20[i],
-						 SBRMI, &buffer[i]);
-			if (ret)
-				return ret;
-		}
-	}
+	if (rev == 0x10)
+		return read_sbrmi_regs(handle, thread_en_reg_v10,
+				       sizeof(thread_en_reg_v10), buffer);
 
-	return OOB_SUCCESS;
+	return read_sbrmi_regs(handle, thread_en_reg_v20,
+			       sizeof(thread_en_reg_v20), buffer);
 }
 
-oob_status_t read_sbrmi_swinterrupt(uint8_t soc_num,
-				    uint8_t *buffer)
+oob_status_t read_sbrmi_swinterrupt_h(struct apml_handle *handle,
+				      uint8_t *buffer)
 {
-	return esmi_oob_read_byte(soc_num,
-				  SBRMI_SOFTWAREINTERRUPT, SBRMI, buffer);
+	return esmi_oob_read_byte_h(handle,
+				    SBRMI_SOFTWAREINTERRUPT, SBRMI, buffer);
 }
 
-oob_status_t read_sbrmi_threadnumber(uint8_t soc_num,
-				     uint8_t *buffer)
+oob_status_t read_sbrmi_threadnumber_h(struct apml_handle *handle,
+				       uint8_t *buffer)
 {
-	return esmi_oob_read_byte(soc_num,
-				  SBRMI_THREADNUMBER, SBRMI, buffer);
+	return esmi_oob_read_byte_h(handle,
+				    SBRMI_THREADNUMBER, SBRMI, buffer);
 }
 
-oob_status_t read_sbrmi_threadnumberlow(uint8_t soc_num,
-					uint8_t *buffer)
+oob_status_t read_sbrmi_threadnumberlow_h(struct apml_handle *handle,
+					  uint8_t *buffer)
 {
-	return esmi_oob_read_byte(soc_num,
-				  SBRMI_THREADNUMBERLOW, SBRMI, buffer);
+	return esmi_oob_read_byte_h(handle,
+				    SBRMI_THREADNUMBERLOW, SBRMI, buffer);
 }
 
-oob_status_t read_sbrmi_threadnumberhi(uint8_t soc_num,
-				       uint8_t *buffer)
+oob_status_t read_sbrmi_threadnumberhi_h(struct apml_handle *handle,
+					 uint8_t *buffer)
 {
-	return esmi_oob_read_byte(soc_num,
-				  SBRMI_THREADNUMBERHIGH, SBRMI, buffer);
+	return esmi_oob_read_byte_h(handle,
+				    SBRMI_THREADNUMBERHIGH, SBRMI, buffer);
 }
 
-oob_status_t read_sbrmi_mp0_msg(uint8_t soc_num,
-				uint8_t *buffer)
+oob_status_t read_sbrmi_mp0_msg_h(struct apml_handle *handle,
+				  uint8_t *buffer)
 {
-	int i, range;
-	oob_status_t ret;
-
-	range = SBRMI_MP0OUTBNDMSG7 - SBRMI_MP0OUTBNDMSG0 + 1;
-	for (i = 0; i < range; i++) {
-		ret = esmi_oob_read_byte(soc_num, SBRMI_MP0OUTBNDMSG0 + i,
-					 SBRMI, &buffer[i]);
-		if (ret)
-			return ret;
-	}
-
-	return OOB_SUCCESS;
+	return read_sbrmi_reg_range(handle, SBRMI_MP0OUTBNDMSG0,
+				    SBRMI_MP0OUTBNDMSG7, buffer);
 }
 
-oob_status_t read_sbrmi_alert_status(uint8_t soc_num,
-				     uint8_t *buffer)
+oob_status_t read_sbrmi_alert_status_h(struct apml_handle *handle,
+				       uint8_t *buffer)
 {
 	oob_status_t ret;
-	int i;
 	uint8_t rev;
 
 	if (!buffer)
 		return OOB_ARG_PTR_NULL;
 
-	ret = read_sbrmi_revision(soc_num, &rev);
+	ret = apml_rmi_revision(handle, &rev);
 	if (ret)
 		return ret;
-	if (rev == 0x10) {
-		for (i = 0; i < sizeof(alert_status_v10); i++) {
-			ret = esmi_oob_read_byte(soc_num, alert_status_v10[i],
-						 SBRMI, &buffer[i]);
-			if (ret)
-				return ret;
-		}
-	} else {
-		for (i = 0; i < sizeof(alert_status_v20); i++) {
-			ret = esmi_oob_read_byte(soc_num, alert_status_v20[i],
-						 SBRMI, &buffer[i]);
-			if (ret)
-				return ret;
-		}
-	}
-	return OOB_SUCCESS;
+	if (rev == 0x10)
+		return read_sbrmi_regs(handle, alert_status_v10,
+				       sizeof(alert_status_v10), buffer);
+
+	return read_sbrmi_regs(handle, alert_status_v20,
+			       sizeof(alert_status_v20), buffer);
 }
 
-oob_status_t read_sbrmi_alert_mask(uint8_t soc_num,
-				   uint8_t *buffer)
+oob_status_t read_sbrmi_alert_mask_h(struct apml_handle *handle,
+				     uint8_t *buffer)
 {
 	oob_status_t ret;
-	int i;
 	uint8_t rev;
 
 	if (!buffer)
 		return OOB_ARG_PTR_NULL;
 
-	ret = read_sbrmi_revision(soc_num, &rev);
+	ret = apml_rmi_revision(handle, &rev);
 	if (ret)
 		return ret;
-	if (rev == 0x10) {
-		for (i = 0; i < sizeof(alert_mask_v10); i++) {
-			ret = esmi_oob_read_byte(soc_num, alert_mask_v10[i],
-						 SBRMI, &buffer[i]);
-			if (ret)
-				return ret;
-		}
-	} else {
-		for (i = 0; i < sizeof(alert_mask_v20); i++) {
-			ret = esmi_oob_read_byte(soc_num, alert_mask_v20[i],
-						 SBRMI, &buffer[i]);
-			if (ret)
-				return ret;
-		}
-	}
-	return OOB_SUCCESS;
+	if (rev == 0x10)
+		return read_sbrmi_regs(handle, alert_mask_v10,
+				       sizeof(alert_mask_v10), buffer);
+
+	return read_sbrmi_regs(handle, alert_mask_v20,
+			       sizeof(alert_mask_v20), buffer);
 }
 
-oob_status_t read_sbrmi_inbound_msg(uint8_t soc_num,
+oob_status_t read_sbrmi_inbound_msg_h(struct apml_handle *handle,
+				      uint8_t *buffer)
+{
+	return read_sbrmi_reg_range(handle, SBRMI_INBNDMSG0,
+				    SBRMI_INBNDMSG7, buffer);
+}
+
+oob_status_t read_sbrmi_outbound_msg_h(struct apml_handle *handle,
+				       uint8_t *buffer)
+{
+	return read_sbrmi_reg_range(handle, SBRMI_OUTBNDMSG0,
+				    SBRMI_OUTBNDMSG7, buffer);
+}
+
+oob_status_t read_sbrmi_thread_cs_h(struct apml_handle *handle,
 				    uint8_t *buffer)
 {
-	int i, range;
 	oob_status_t ret;
 
-	range = SBRMI_INBNDMSG7 - SBRMI_INBNDMSG0 + 1;
-	for (i = 0; i < range; i++) {
-		ret = esmi_oob_read_byte(soc_num, SBRMI_INBNDMSG0 + i,
-					 SBRMI, &buffer[i]);
-		if (ret)
-			return ret;
-	}
+	ret = esmi_oob_read_byte_h(handle,
+				   SBRMI_THREAD128CS, SBRMI, buffer);
+	*buffer &= 1;
 
 	return OOB_SUCCESS;
 }
 
-oob_status_t read_sbrmi_outbound_msg(uint8_t soc_num,
+oob_status_t read_sbrmi_ras_status_h(struct apml_handle *handle,
 				     uint8_t *buffer)
 {
-	int i, range;
 	oob_status_t ret;
 
-	range = SBRMI_OUTBNDMSG7 - SBRMI_OUTBNDMSG0 + 1;
-	for (i = 0; i < range; i++) {
-		ret = esmi_oob_read_byte(soc_num, SBRMI_OUTBNDMSG0 + i,
-					 SBRMI, &buffer[i]);
-		if (ret)
-			return ret;
-	}
+	ret = esmi_oob_read_byte_h(handle,
+				   SBRMI_RASSTATUS, SBRMI, buffer);
+	if (ret)
+		return ret;
 
-	return OOB_SUCCESS;
+	/* BMC should write 1 to clear them, make way for next update */
+	return esmi_oob_write_byte_h(handle,
+				     SBRMI_RASSTATUS, SBRMI, *buffer);
 }
 
-oob_status_t read_sbrmi_thread_cs(uint8_t soc_num,
-				  uint8_t *buffer)
+/*
+ * Socket index based API, operating on the default handle of the socket
+ */
+oob_status_t read_sbrmi_revision(uint8_t soc_num,
+				 uint8_t *buffer)
 {
-	oob_status_t ret;
+	return read_sbrmi_revision_h(apml_socket_handle(soc_num), buffer);
+}
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBRMI_THREAD128CS, SBRMI, buffer);
-	*buffer &= 1;
+oob_status_t read_sbrmi_control(uint8_t soc_num,
+				uint8_t *buffer)
+{
+	return read_sbrmi_control_h(apml_socket_handle(soc_num), buffer);
+}
 
-	return OOB_SUCCESS;
+oob_status_t read_sbrmi_status(uint8_t soc_num,
+			       uint8_t *buffer)
+{
+	return read_sbrmi_status_h(apml_socket_handle(soc_num), buffer);
 }
 
-oob_status_t read_sbrmi_ras_status(uint8_t soc_num,
+oob_status_t read_sbrmi_readsize(uint8_t soc_num,
+				 uint8_t *buffer)
+{
+	return read_sbrmi_readsize_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_sbrmi_threadenablestatus(uint8_t soc_num,
+					   uint8_t *buffer)
+{
+	return read_sbrmi_threadenablestatus_h(apml_socket_handle(soc_num),
+					       buffer);
+}
+
+oob_status_t read_sbrmi_multithreadenablestatus(uint8_t soc_num,
+						uint8_t *buffer)
+{
+	return read_sbrmi_multithreadenablestatus_h(apml_socket_handle(soc_num),
+						    buffer);
+}
+
+oob_status_t read_sbrmi_swinterrupt(uint8_t soc_num,
+				    uint8_t *buffer)
+{
+	return read_sbrmi_swinterrupt_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_sbrmi_threadnumber(uint8_t soc_num,
+				     uint8_t *buffer)
+{
+	return read_sbrmi_threadnumber_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_sbrmi_threadnumberlow(uint8_t soc_num,
+					uint8_t *buffer)
+{
+	return read_sbrmi_threadnumberlow_h(apml_socket_handle(soc_num),
+					    buffer);
+}
+
+oob_status_t read_sbrmi_threadnumberhi(uint8_t soc_num,
+				       uint8_t *buffer)
+{
+	return read_sbrmi_threadnumberhi_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_sbrmi_mp0_msg(uint8_t soc_num,
+				uint8_t *buffer)
+{
+	return read_sbrmi_mp0_msg_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_sbrmi_alert_status(uint8_t soc_num,
+				     uint8_t *buffer)
+{
+	return read_sbrmi_alert_status_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_sbrmi_alert_mask(uint8_t soc_num,
 				   uint8_t *buffer)
 {
-	oob_status_t ret;
+	return read_sbrmi_alert_mask_h(apml_socket_handle(soc_num), buffer);
+}
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBRMI_RASSTATUS, SBRMI, buffer);
-	if (ret)
-		return ret;
+oob_status_t read_sbrmi_inbound_msg(uint8_t soc_num,
+				    uint8_t *buffer)
+{
+	return read_sbrmi_inbound_msg_h(apml_socket_handle(soc_num), buffer);
+}
 
-	/* BMC should write 1 to clear them, make way for next update */
-	return esmi_oob_write_byte(soc_num,
-				   SBRMI_RASSTATUS, SBRMI, *buffer);
+oob_status_t read_sbrmi_outbound_msg(uint8_t soc_num,
+				     uint8_t *buffer)
+{
+	return read_sbrmi_outbound_msg_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_sbrmi_thread_cs(uint8_t soc_num,
+				  uint8_t *buffer)
+{
+	return read_sbrmi_thread_cs_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_sbrmi_ras_status(uint8_t soc_num,
+				   uint8_t *buffer)
+{
+	return read_sbrmi_ras_status_h(apml_socket_handle(soc_num), buffer);
 }
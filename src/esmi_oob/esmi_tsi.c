@@ -38,38 +38,50 @@
  * DEALINGS WITH THE SOFTWARE.
  *
  */
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <math.h>
 
 #include <esmi_oob/esmi_tsi.h>
 #include <esmi_oob/apml.h>
 
+#include "common.h"
+
 /* sb-tsi register access */
-oob_status_t read_sbtsi_cpuinttemp(uint8_t soc_num,
-				   uint8_t *buffer)
+oob_status_t read_sbtsi_cpuinttemp_h(struct apml_handle *handle,
+				     uint8_t *buffer)
 {
-	return esmi_oob_read_byte(soc_num, SBTSI_CPUTEMPINT,
-				  SBTSI, buffer);
+	return esmi_oob_read_byte_h(handle, SBTSI_CPUTEMPINT,
+				    SBTSI, buffer);
 }
 
-oob_status_t read_sbtsi_status(uint8_t soc_num,
-			       uint8_t *buffer)
+oob_status_t read_sbtsi_status_h(struct apml_handle *handle,
+				 uint8_t *buffer)
 {
-	return esmi_oob_read_byte(soc_num,
-				  SBTSI_STATUS, SBTSI, buffer);
+	return esmi_oob_read_byte_h(handle,
+				    SBTSI_STATUS, SBTSI, buffer);
 }
 
-oob_status_t read_sbtsi_config(uint8_t soc_num,
-			       uint8_t *buffer)
+static void tsi_read_order_seen(struct apml_handle *handle, uint8_t config,
+				oob_status_t ret);
+
+oob_status_t read_sbtsi_config_h(struct apml_handle *handle,
+				 uint8_t *buffer)
 {
-	return esmi_oob_read_byte(soc_num,
-				  SBTSI_CONFIGURATION, SBTSI, buffer);
+	oob_status_t ret;
+
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_CONFIGURATION, SBTSI, buffer);
+	if (buffer)
+		tsi_read_order_seen(handle, *buffer, ret);
+	return ret;
 }
 
-oob_status_t read_sbtsi_updaterate(uint8_t soc_num,
-				   float *buffer)
+oob_status_t read_sbtsi_updaterate_h(struct apml_handle *handle,
+				     float *buffer)
 {
 	/* as per the ssp document valid rates from 0 - 10 are as below */
 	float valid_rate[] = {0.0625, 0.125, 0.25, 0.5, 1, 2, 4, 8, 16, 32, 64};
@@ -80,8 +92,8 @@ oob_status_t read_sbtsi_updaterate(uint8_t soc_num,
 	if (!buffer)
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_UPDATERATE, SBTSI, &rdbyte);
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_UPDATERATE, SBTSI, &rdbyte);
 	if (ret != OOB_SUCCESS)
 		return ret;
 	if (rdbyte >= items)
@@ -91,8 +103,8 @@ oob_status_t read_sbtsi_updaterate(uint8_t soc_num,
 	return OOB_SUCCESS;
 }
 
-oob_status_t write_sbtsi_updaterate(uint8_t soc_num,
-				    float uprate)
+oob_status_t write_sbtsi_updaterate_h(struct apml_handle *handle,
+				      float uprate)
 {
 	/* as per the ssp document valid rates from 0 - 10 are as below */
 	float valid_rate[] = {0.0625, 0.125, 0.25, 0.5, 1, 2, 4, 8, 16, 32, 64};
@@ -106,107 +118,246 @@ oob_status_t write_sbtsi_updaterate(uint8_t soc_num,
 	if (wrbyte >= items)
 		return OOB_INVALID_INPUT;
 
-	return esmi_oob_write_byte(soc_num, SBTSI_UPDATERATE, SBTSI, wrbyte);
+	return esmi_oob_write_byte_h(handle, SBTSI_UPDATERATE, SBTSI, wrbyte);
 }
 
-oob_status_t sbtsi_set_hitemp_threshold(uint8_t soc_num,
-					float hitemp_thr)
+/*
+ * Shadow of the SB-TSI configuration registers, see apml_set_tsi_shadow().
+ * A word is 0 until the register is known, then its value with
+ * TSI_SHADOW_VALID set. ConfigWr writes Config, both share one word.
+ */
+#define TSI_SHADOW_VALID	0x100
+
+static atomic_bool tsi_shadow_enabled;
+
+static atomic_uint *tsi_shadow_word(struct apml_handle *handle, uint8_t reg)
+{
+	int idx;
+
+	if (!handle || !handle->sock ||
+	    !atomic_load_explicit(&tsi_shadow_enabled, memory_order_relaxed))
+		return NULL;
+
+	switch (reg) {
+	case SBTSI_CONFIGURATION:
+	case SBTSI_CONFIGWR:
+		idx = 0;
+		break;
+	case SBTSI_HITEMPINT:
+		idx = 1;
+		break;
+	case SBTSI_LOTEMPINT:
+		idx = 2;
+		break;
+	case SBTSI_HITEMPDEC:
+		idx = 3;
+		break;
+	case SBTSI_LOTEMPDEC:
+		idx = 4;
+		break;
+	case SBTSI_TIMEOUTCONFIG:
+		idx = 5;
+		break;
+	case SBTSI_ALERTTHRESHOLD:
+		idx = 6;
+		break;
+	case SBTSI_ALERTCONFIG:
+		idx = 7;
+		break;
+	default:
+		return NULL;
+	}
+
+	return &handle->sock->tsi_shadow[idx];
+}
+
+oob_status_t apml_set_tsi_shadow(bool enable)
 {
+	struct apml_socket *sock;
+	int i, j;
+
+	atomic_store(&tsi_shadow_enabled, enable);
+	if (enable)
+		return OOB_SUCCESS;
+
+	/* Other agents may write the registers until enabled again */
+	for (i = 0; i < APML_MAX_SOCKETS; i++) {
+		sock = apml_socket_handle(i)->sock;
+		for (j = 0; j < APML_TSI_SHADOW_REGS; j++)
+			atomic_store_explicit(&sock->tsi_shadow[j], 0,
+					      memory_order_relaxed);
+	}
+
+	return OOB_SUCCESS;
+}
+
+/*
+ * Config[ReadOrder] of the socket, kept for sbtsi_get_cputemp_fixed_h().
+ * 0 until known, then the bit with TSI_SHADOW_VALID set. Tracked through
+ * every read and write of Config by the library, shadow enabled or not.
+ */
+static void tsi_read_order_seen(struct apml_handle *handle, uint8_t config,
+				oob_status_t ret)
+{
+	if (!handle || !handle->sock)
+		return;
+
+	atomic_store_explicit(&handle->sock->tsi_read_order,
+			      ret ? 0 : (config & READORDER_MASK) |
+			      TSI_SHADOW_VALID, memory_order_relaxed);
+}
+
+static oob_status_t tsi_read_order(struct apml_handle *handle,
+				   uint8_t *read_ord)
+{
+	unsigned int cur = 0;
 	oob_status_t ret;
-	uint8_t prev, current, byte_int, byte_dec;
-	float temp_dec;
+	uint8_t config = 0;
+
+	if (handle && handle->sock)
+		cur = atomic_load_explicit(&handle->sock->tsi_read_order,
+					   memory_order_relaxed);
+	if (cur & TSI_SHADOW_VALID) {
+		*read_ord = cur & READORDER_MASK;
+		return OOB_SUCCESS;
+	}
 
-	if (hitemp_thr < 0 || hitemp_thr >= 256)
-		return OOB_INVALID_INPUT;
+	ret = esmi_oob_read_byte_h(handle, SBTSI_CONFIGURATION, SBTSI,
+				   &config);
+	tsi_read_order_seen(handle, config, ret);
+	*read_ord = config & READORDER_MASK;
+	return ret;
+}
 
-	byte_int = hitemp_thr;
-	temp_dec = hitemp_thr - byte_int;
+/*
+ * New value of a register once the bits of mask are set to bits. The
+ * current value is needed unless the whole register is written; *skip is
+ * set when the register is known to hold the new value already.
+ */
+static oob_status_t tsi_reg_merge(struct apml_handle *handle, uint8_t reg,
+				  uint8_t mask, uint8_t bits,
+				  uint8_t *val, bool *skip)
+{
+	atomic_uint *word = tsi_shadow_word(handle, reg);
+	unsigned int cur = 0;
+	oob_status_t ret;
+	uint8_t prev;
 
-	ret = esmi_oob_write_byte(soc_num,
-				  SBTSI_HITEMPINT,
-				  SBTSI,
-				  byte_int);
-	if (ret != OOB_SUCCESS)
-		return ret;
+	if (word)
+		cur = atomic_load_explicit(word, memory_order_relaxed);
+	if (!(cur & TSI_SHADOW_VALID) && mask != 0xFF) {
+		ret = esmi_oob_read_byte_h(handle, reg, SBTSI, &prev);
+		if (ret != OOB_SUCCESS)
+			return ret;
+		cur = prev | TSI_SHADOW_VALID;
+		if (word)
+			atomic_store_explicit(word, cur, memory_order_relaxed);
+		if (reg == SBTSI_CONFIGURATION || reg == SBTSI_CONFIGWR)
+			tsi_read_order_seen(handle, prev, ret);
+	}
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_HITEMPDEC, SBTSI, &prev);
-	if (ret != OOB_SUCCESS)
+	*val = (cur & ~mask) | (bits & mask);
+	*skip = (cur & TSI_SHADOW_VALID) && (uint8_t)cur == *val;
+	return OOB_SUCCESS;
+}
+
+/* Record the outcome of a write of a shadowed register */
+static void tsi_reg_written(struct apml_handle *handle, uint8_t reg,
+			    uint8_t val, oob_status_t ret)
+{
+	atomic_uint *word = tsi_shadow_word(handle, reg);
+
+	/* A failed write may or may not have reached the register */
+	if (word)
+		atomic_store_explicit(word, ret ? 0 : val | TSI_SHADOW_VALID,
+				      memory_order_relaxed);
+	if (reg == SBTSI_CONFIGURATION || reg == SBTSI_CONFIGWR)
+		tsi_read_order_seen(handle, val, ret);
+}
+
+/* Set the bits of mask of a register to bits, skipping no-op writes */
+static oob_status_t tsi_reg_update(struct apml_handle *handle, uint8_t reg,
+				   uint8_t mask, uint8_t bits)
+{
+	oob_status_t ret;
+	uint8_t val;
+	bool skip;
+
+	ret = tsi_reg_merge(handle, reg, mask, bits, &val, &skip);
+	if (ret != OOB_SUCCESS || skip)
 		return ret;
 
-	/* get number of steps increment */
-	byte_dec = temp_dec / TEMP_INC;
+	ret = esmi_oob_write_byte_h(handle, reg, SBTSI, val);
+	tsi_reg_written(handle, reg, val, ret);
+	return ret;
+}
 
-	/* [7:5] HiTempDec and [4:0] Reserved */
-	current = ((byte_dec << 5) | (prev & 0x1F));
-	return esmi_oob_write_byte(soc_num, SBTSI_HITEMPDEC,
-				   SBTSI, current);
+static oob_status_t validate_temp_thr(float temp_thr)
+{
+	if (temp_thr < 0 || temp_thr >= 256)
+		return OOB_INVALID_INPUT;
+
+	return OOB_SUCCESS;
 }
 
-oob_status_t sbtsi_set_lotemp_threshold(uint8_t soc_num,
-					float lotemp_thr)
+/* [7:5] of HiTempDec and LoTempDec, [4:0] Reserved */
+static uint8_t temp_thr_dec(float temp_thr)
+{
+	uint8_t byte_int = temp_thr;
+
+	/* get number of steps increment */
+	return (uint8_t)((temp_thr - byte_int) / TEMP_INC) << 5;
+}
+
+oob_status_t sbtsi_set_hitemp_threshold_h(struct apml_handle *handle,
+					  float hitemp_thr)
 {
 	oob_status_t ret;
-	uint8_t prev, current, byte_int, byte_dec;
-	float temp_dec;
 
-	if (lotemp_thr < 0 || lotemp_thr >= 256)
+	if (validate_temp_thr(hitemp_thr))
 		return OOB_INVALID_INPUT;
 
-	byte_int = lotemp_thr;
-	temp_dec = lotemp_thr - byte_int;
-
-	ret = esmi_oob_write_byte(soc_num,
-				  SBTSI_LOTEMPINT,
-				  SBTSI, byte_int);
+	ret = tsi_reg_update(handle, SBTSI_HITEMPINT, 0xFF, hitemp_thr);
 	if (ret != OOB_SUCCESS)
 		return ret;
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_LOTEMPDEC, SBTSI, &prev);
+	return tsi_reg_update(handle, SBTSI_HITEMPDEC, 0xE0,
+			      temp_thr_dec(hitemp_thr));
+}
+
+oob_status_t sbtsi_set_lotemp_threshold_h(struct apml_handle *handle,
+					  float lotemp_thr)
+{
+	oob_status_t ret;
+
+	if (validate_temp_thr(lotemp_thr))
+		return OOB_INVALID_INPUT;
+
+	ret = tsi_reg_update(handle, SBTSI_LOTEMPINT, 0xFF, lotemp_thr);
 	if (ret != OOB_SUCCESS)
 		return ret;
 
-	/* get number of steps increment */
-	byte_dec = temp_dec / TEMP_INC;
-
-	/* [7:5] LoTempDec and [4:0] Reserved */
-	current = ((byte_dec << 5) | (prev & 0x1F));
-	return esmi_oob_write_byte(soc_num, SBTSI_LOTEMPDEC, SBTSI, current);
+	return tsi_reg_update(handle, SBTSI_LOTEMPDEC, 0xE0,
+			      temp_thr_dec(lotemp_thr));
 }
 
-oob_status_t sbtsi_set_timeout_config(uint8_t soc_num,
-				      uint8_t mode)
+oob_status_t sbtsi_set_timeout_config_h(struct apml_handle *handle,
+					uint8_t mode)
 {
-	oob_status_t ret;
-	uint8_t prev, new;
-
 	/* 1 : Enabled and 0 Disbaled */
 	if (mode != 1 && mode != 0)
 		return OOB_INVALID_INPUT;
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_TIMEOUTCONFIG, SBTSI, &prev);
-	if (ret != OOB_SUCCESS)
-		return ret;
 
 	/* [7] TimeoutEn and [6:0] Reserved */
-	new = ((mode << 7) | (prev & 0x7F));
-	return esmi_oob_write_byte(soc_num, SBTSI_TIMEOUTCONFIG, SBTSI, new);
+	return tsi_reg_update(handle, SBTSI_TIMEOUTCONFIG, 0x80, mode << 7);
 }
 
-oob_status_t sbtsi_set_alert_threshold(uint8_t soc_num,
-				       uint8_t samples)
+oob_status_t sbtsi_set_alert_threshold_h(struct apml_handle *handle,
+					 uint8_t samples)
 {
-	oob_status_t ret;
-	uint8_t prev, new;
-
 	/* Alert threshold valid range from 1 to 8 samples. */
 	if (samples < 1 || samples > 8)
 		return OOB_INVALID_INPUT;
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_ALERTTHRESHOLD, SBTSI, &prev);
-	if (ret != OOB_SUCCESS)
-		return ret;
 	/**
 	 * [7:3] reserved and [2:0] AlertThr value
 	 * ex value : samples
@@ -214,75 +365,161 @@ oob_status_t sbtsi_set_alert_threshold(uint8_t soc_num,
 	 * 6h-1h: (value + 1) sample
 	 * 7h: 8 samples
 	 */
-	new = (prev & 0xF8) | (samples - 1);
-	return esmi_oob_write_byte(soc_num, SBTSI_ALERTTHRESHOLD, SBTSI, new);
+	return tsi_reg_update(handle, SBTSI_ALERTTHRESHOLD, 0x07,
+			      samples - 1);
 }
 
-oob_status_t sbtsi_set_alert_config(uint8_t soc_num,
-				    uint8_t mode)
+oob_status_t sbtsi_set_alert_config_h(struct apml_handle *handle,
+				      uint8_t mode)
 {
-	oob_status_t ret;
-	uint8_t prev, new;
-
 	/* single bit validation */
 	if (mode != 1 && mode != 0)
 		return OOB_INVALID_INPUT;
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_ALERTCONFIG, SBTSI, &prev);
-	if (ret != OOB_SUCCESS)
-		return ret;
+
 	/* [7:1] reserved, [0] Alert Comparator mode enable */
-	new = (prev & 0xFE) | mode;
-	return esmi_oob_write_byte(soc_num, SBTSI_ALERTCONFIG, SBTSI, new);
+	return tsi_reg_update(handle, SBTSI_ALERTCONFIG, 0x01, mode);
 }
 
-oob_status_t sbtsi_set_configwr(uint8_t soc_num,
-				uint8_t mode, uint8_t config_mask)
+static oob_status_t validate_config_mask(uint8_t config_mask)
 {
-	oob_status_t ret;
-	uint8_t prev, new;
-
-	/* single bit validation */
-	if (mode != 1 && mode != 0)
-		return OOB_INVALID_INPUT;
 	if (config_mask != ALERTMASK_MASK &&
 	    config_mask != RUNSTOP_MASK &&
 	    config_mask != READORDER_MASK &&
 	    config_mask != ARA_MASK)
 		return OOB_INVALID_INPUT;
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_CONFIGWR, SBTSI, &prev);
-	if (ret != OOB_SUCCESS)
+	return OOB_SUCCESS;
+}
+
+oob_status_t sbtsi_set_configwr_h(struct apml_handle *handle,
+				  uint8_t mode, uint8_t config_mask)
+{
+	/* single bit validation */
+	if (mode != 1 && mode != 0)
+		return OOB_INVALID_INPUT;
+	if (validate_config_mask(config_mask))
+		return OOB_INVALID_INPUT;
+
+	return tsi_reg_update(handle, SBTSI_CONFIGWR, config_mask,
+			      mode ? config_mask : 0);
+}
+
+/* Register writes of a profile, in the order they are issued */
+#define TSI_PROFILE_WRITES	8
+
+struct tsi_profile_writes {
+	struct apml_message msgs[TSI_PROFILE_WRITES];
+	size_t n;
+};
+
+static oob_status_t tsi_profile_add(struct apml_handle *handle,
+				    struct tsi_profile_writes *w,
+				    uint8_t reg, uint8_t mask, uint8_t bits)
+{
+	struct apml_message *msg = &w->msgs[w->n];
+	oob_status_t ret;
+	uint8_t val;
+	bool skip;
+
+	ret = tsi_reg_merge(handle, reg, mask, bits, &val, &skip);
+	if (ret != OOB_SUCCESS || skip)
 		return ret;
 
-	new = mode ? prev | config_mask : prev & (~config_mask);
-	return esmi_oob_write_byte(soc_num, SBTSI_CONFIGWR, SBTSI, new);
+	/* Register write */
+	memset(msg, 0, sizeof(*msg));
+	msg->cmd = APML_REG;
+	msg->data_in.reg_in[0] = reg;
+	msg->data_in.reg_in[4] = val;
+	w->n++;
+	return OOB_SUCCESS;
 }
 
-oob_status_t read_sbtsi_hitempint(uint8_t soc_num,
-				  uint8_t *buffer)
+oob_status_t sbtsi_apply_profile_h(struct apml_handle *handle,
+				   const struct sbtsi_profile *profile)
 {
-	return esmi_oob_read_byte(soc_num,
-				  SBTSI_HITEMPINT, SBTSI, buffer);
+	oob_status_t status[TSI_PROFILE_WRITES];
+	struct tsi_profile_writes w;
+	uint32_t f;
+	oob_status_t ret = OOB_SUCCESS;
+	size_t i;
+
+	if (!profile)
+		return OOB_ARG_PTR_NULL;
+
+	f = profile->fields;
+	if ((f & SBTSI_PROFILE_HITEMP && validate_temp_thr(profile->hitemp_thr)) ||
+	    (f & SBTSI_PROFILE_LOTEMP && validate_temp_thr(profile->lotemp_thr)) ||
+	    (f & SBTSI_PROFILE_ALERT_THRESHOLD &&
+	     (profile->alert_samples < 1 || profile->alert_samples > 8)) ||
+	    (f & SBTSI_PROFILE_ALERT_CONFIG && profile->alert_comp > 1) ||
+	    (f & SBTSI_PROFILE_TIMEOUT && profile->timeout_en > 1) ||
+	    (f & SBTSI_PROFILE_CONFIG &&
+	     (!profile->config_mask || profile->config_mask &
+	      ~(ALERTMASK_MASK | RUNSTOP_MASK | READORDER_MASK | ARA_MASK))))
+		return OOB_INVALID_INPUT;
+
+	w.n = 0;
+	if (f & SBTSI_PROFILE_HITEMP) {
+		ret = tsi_profile_add(handle, &w, SBTSI_HITEMPINT, 0xFF,
+				      profile->hitemp_thr);
+		if (!ret)
+			ret = tsi_profile_add(handle, &w, SBTSI_HITEMPDEC, 0xE0,
+					      temp_thr_dec(profile->hitemp_thr));
+	}
+	if (!ret && f & SBTSI_PROFILE_LOTEMP) {
+		ret = tsi_profile_add(handle, &w, SBTSI_LOTEMPINT, 0xFF,
+				      profile->lotemp_thr);
+		if (!ret)
+			ret = tsi_profile_add(handle, &w, SBTSI_LOTEMPDEC, 0xE0,
+					      temp_thr_dec(profile->lotemp_thr));
+	}
+	if (!ret && f & SBTSI_PROFILE_ALERT_THRESHOLD)
+		ret = tsi_profile_add(handle, &w, SBTSI_ALERTTHRESHOLD, 0x07,
+				      profile->alert_samples - 1);
+	if (!ret && f & SBTSI_PROFILE_ALERT_CONFIG)
+		ret = tsi_profile_add(handle, &w, SBTSI_ALERTCONFIG, 0x01,
+				      profile->alert_comp);
+	if (!ret && f & SBTSI_PROFILE_TIMEOUT)
+		ret = tsi_profile_add(handle, &w, SBTSI_TIMEOUTCONFIG, 0x80,
+				      profile->timeout_en << 7);
+	if (!ret && f & SBTSI_PROFILE_CONFIG)
+		ret = tsi_profile_add(handle, &w, SBTSI_CONFIGWR,
+				      profile->config_mask,
+				      profile->config);
+	if (ret || !w.n)
+		return ret;
+
+	ret = apml_xfer_batch(handle, SBTSI, w.msgs, w.n, status);
+	for (i = 0; i < w.n; i++)
+		tsi_reg_written(handle, w.msgs[i].data_in.reg_in[0],
+				w.msgs[i].data_in.reg_in[4], status[i]);
+
+	return ret;
 }
 
-oob_status_t read_sbtsi_lotempint(uint8_t soc_num,
-				  uint8_t *buffer)
+oob_status_t read_sbtsi_hitempint_h(struct apml_handle *handle,
+				    uint8_t *buffer)
 {
-	return esmi_oob_read_byte(soc_num,
-				  SBTSI_LOTEMPINT, SBTSI, buffer);
+	return esmi_oob_read_byte_h(handle,
+				    SBTSI_HITEMPINT, SBTSI, buffer);
 }
 
-oob_status_t read_sbtsi_configwrite(uint8_t soc_num,
+oob_status_t read_sbtsi_lotempint_h(struct apml_handle *handle,
 				    uint8_t *buffer)
 {
-	return esmi_oob_read_byte(soc_num,
-				  SBTSI_CONFIGWR, SBTSI, buffer);
+	return esmi_oob_read_byte_h(handle,
+				    SBTSI_LOTEMPINT, SBTSI, buffer);
 }
 
-oob_status_t read_sbtsi_cputempdecimal(uint8_t soc_num,
-				       float *buffer)
+oob_status_t read_sbtsi_configwrite_h(struct apml_handle *handle,
+				      uint8_t *buffer)
+{
+	return esmi_oob_read_byte_h(handle,
+				    SBTSI_CONFIGWR, SBTSI, buffer);
+}
+
+oob_status_t read_sbtsi_cputempdecimal_h(struct apml_handle *handle,
+					 float *buffer)
 {
 	uint8_t rd_byte;
 	oob_status_t ret;
@@ -290,10 +527,10 @@ oob_status_t read_sbtsi_cputempdecimal(uint8_t soc_num,
 	if (!buffer)
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_CPUTEMPDEC,
-				 SBTSI,
-				 &rd_byte);
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_CPUTEMPDEC,
+				   SBTSI,
+				   &rd_byte);
 	if (ret)
 		return ret;
 	*buffer = ((rd_byte >> 5) * TEMP_INC);
@@ -301,17 +538,17 @@ oob_status_t read_sbtsi_cputempdecimal(uint8_t soc_num,
 	return OOB_SUCCESS;
 }
 
-oob_status_t read_sbtsi_cputempoffint(uint8_t soc_num,
-				      uint8_t *temp_int)
+oob_status_t read_sbtsi_cputempoffint_h(struct apml_handle *handle,
+					uint8_t *temp_int)
 {
-	return esmi_oob_read_byte(soc_num,
-				  SBTSI_CPUTEMPOFFINT,
-				  SBTSI,
-				  temp_int);
+	return esmi_oob_read_byte_h(handle,
+				    SBTSI_CPUTEMPOFFINT,
+				    SBTSI,
+				    temp_int);
 }
 
-oob_status_t read_sbtsi_cputempoffdec(uint8_t soc_num,
-				      float *temp_dec)
+oob_status_t read_sbtsi_cputempoffdec_h(struct apml_handle *handle,
+					float *temp_dec)
 {
 	uint8_t rd_byte;
 	oob_status_t ret;
@@ -319,10 +556,10 @@ oob_status_t read_sbtsi_cputempoffdec(uint8_t soc_num,
 	if (!temp_dec)
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_CPUTEMPOFFDEC,
-				 SBTSI,
-				 &rd_byte);
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_CPUTEMPOFFDEC,
+				   SBTSI,
+				   &rd_byte);
 	if (ret)
 		return ret;
 	*temp_dec = ((rd_byte >> 5) * TEMP_INC);
@@ -330,8 +567,8 @@ oob_status_t read_sbtsi_cputempoffdec(uint8_t soc_num,
 	return OOB_SUCCESS;
 }
 
-oob_status_t read_sbtsi_hitempdecimal(uint8_t soc_num,
-				      float *temp_dec)
+oob_status_t read_sbtsi_hitempdecimal_h(struct apml_handle *handle,
+					float *temp_dec)
 {
 	uint8_t rd_byte;
 	oob_status_t ret;
@@ -339,8 +576,8 @@ oob_status_t read_sbtsi_hitempdecimal(uint8_t soc_num,
 	if (!temp_dec)
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_HITEMPDEC, SBTSI, &rd_byte);
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_HITEMPDEC, SBTSI, &rd_byte);
 	if (ret)
 		return ret;
 	*temp_dec = ((rd_byte >> 5) * TEMP_INC);
@@ -348,8 +585,8 @@ oob_status_t read_sbtsi_hitempdecimal(uint8_t soc_num,
 	return OOB_SUCCESS;
 }
 
-oob_status_t read_sbtsi_lotempdecimal(uint8_t soc_num,
-				      float *temp_dec)
+oob_status_t read_sbtsi_lotempdecimal_h(struct apml_handle *handle,
+					float *temp_dec)
 {
 	uint8_t rd_byte;
 	oob_status_t ret;
@@ -357,8 +594,8 @@ oob_status_t read_sbtsi_lotempdecimal(uint8_t soc_num,
 	if (!temp_dec)
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_LOTEMPDEC, SBTSI, &rd_byte);
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_LOTEMPDEC, SBTSI, &rd_byte);
 	if (ret)
 		return ret;
 	*temp_dec = ((rd_byte >> 5) * TEMP_INC);
@@ -366,15 +603,15 @@ oob_status_t read_sbtsi_lotempdecimal(uint8_t soc_num,
 	return OOB_SUCCESS;
 }
 
-oob_status_t read_sbtsi_timeoutconfig(uint8_t soc_num,
-				      uint8_t *timeout)
+oob_status_t read_sbtsi_timeoutconfig_h(struct apml_handle *handle,
+					uint8_t *timeout)
 {
-	return esmi_oob_read_byte(soc_num,
-				  SBTSI_TIMEOUTCONFIG, SBTSI, timeout);
+	return esmi_oob_read_byte_h(handle,
+				    SBTSI_TIMEOUTCONFIG, SBTSI, timeout);
 }
 
-oob_status_t read_sbtsi_cputempoffset(uint8_t soc_num,
-				      float *temp_offset)
+oob_status_t read_sbtsi_cputempoffset_h(struct apml_handle *handle,
+					float *temp_offset)
 {
 	oob_status_t ret;
 	int8_t byte_int;
@@ -383,12 +620,12 @@ oob_status_t read_sbtsi_cputempoffset(uint8_t soc_num,
 	if (!temp_offset)
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_CPUTEMPOFFINT, SBTSI, &byte_int);
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_CPUTEMPOFFINT, SBTSI, &byte_int);
 	if (ret != OOB_SUCCESS)
 		return ret;
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_CPUTEMPOFFDEC, SBTSI, &byte_dec);
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_CPUTEMPOFFDEC, SBTSI, &byte_dec);
 	if (ret != OOB_SUCCESS)
 		return ret;
 	/* combining integer and decimal part to make float value
@@ -399,8 +636,8 @@ oob_status_t read_sbtsi_cputempoffset(uint8_t soc_num,
 	return OOB_SUCCESS;
 }
 
-oob_status_t write_sbtsi_cputempoffset(uint8_t soc_num,
-				       float temp_offset)
+oob_status_t write_sbtsi_cputempoffset_h(struct apml_handle *handle,
+					 float temp_offset)
 {
 	oob_status_t ret;
 	int8_t byte_int, byte_dec;
@@ -415,28 +652,28 @@ oob_status_t write_sbtsi_cputempoffset(uint8_t soc_num,
 
 	byte_dec = (temp_offset - byte_int) / TEMP_INC;
 
-	ret = esmi_oob_write_byte(soc_num,
-				  SBTSI_CPUTEMPOFFINT,
-				  SBTSI, byte_int);
+	ret = esmi_oob_write_byte_h(handle,
+				    SBTSI_CPUTEMPOFFINT,
+				    SBTSI, byte_int);
 	if (ret != OOB_SUCCESS)
 		return ret;
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_CPUTEMPOFFDEC, SBTSI, &prev);
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_CPUTEMPOFFDEC, SBTSI, &prev);
 	if (ret != OOB_SUCCESS)
 		return ret;
 	current = ((prev & 0x1F) | (byte_dec << 5));
-	return esmi_oob_write_byte(soc_num, SBTSI_CPUTEMPOFFDEC,
-				   SBTSI, current);
+	return esmi_oob_write_byte_h(handle, SBTSI_CPUTEMPOFFDEC,
+				     SBTSI, current);
 }
 
-oob_status_t read_sbtsi_alertthreshold(uint8_t soc_num,
-				       uint8_t *samples)
+oob_status_t read_sbtsi_alertthreshold_h(struct apml_handle *handle,
+					 uint8_t *samples)
 {
 	oob_status_t ret;
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_ALERTTHRESHOLD, SBTSI, samples);
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_ALERTTHRESHOLD, SBTSI, samples);
 	if (ret != OOB_SUCCESS)
 		return ret;
 	/**
@@ -451,13 +688,13 @@ oob_status_t read_sbtsi_alertthreshold(uint8_t soc_num,
 	return OOB_SUCCESS;
 }
 
-oob_status_t read_sbtsi_alertconfig(uint8_t soc_num,
-				    uint8_t *mode)
+oob_status_t read_sbtsi_alertconfig_h(struct apml_handle *handle,
+				      uint8_t *mode)
 {
 	oob_status_t ret;
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_ALERTCONFIG, SBTSI, mode);
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_ALERTCONFIG, SBTSI, mode);
 	if (ret != OOB_SUCCESS)
 		return ret;
 	/* [7:1] reserved, [0] Alert Comparator mode enable */
@@ -466,13 +703,13 @@ oob_status_t read_sbtsi_alertconfig(uint8_t soc_num,
 	return OOB_SUCCESS;
 }
 
-oob_status_t read_sbtsi_manufid(uint8_t soc_num,
-				uint8_t *man_id)
+oob_status_t read_sbtsi_manufid_h(struct apml_handle *handle,
+				  uint8_t *man_id)
 {
 	oob_status_t ret;
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_MANUFID, SBTSI, man_id);
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_MANUFID, SBTSI, man_id);
 	if (ret != OOB_SUCCESS)
 		return ret;
 	/* [7:1] reserved, [0] Manufacture ID */
@@ -481,15 +718,80 @@ oob_status_t read_sbtsi_manufid(uint8_t soc_num,
 	return OOB_SUCCESS;
 }
 
-oob_status_t read_sbtsi_revision(uint8_t soc_num,
-				 uint8_t *rivision)
+oob_status_t read_sbtsi_revision_h(struct apml_handle *handle,
+				   uint8_t *rivision)
 {
-	return esmi_oob_read_byte(soc_num,
-				  SBTSI_REVISION, SBTSI, rivision);
+	return esmi_oob_read_byte_h(handle,
+				    SBTSI_REVISION, SBTSI, rivision);
 }
 
-oob_status_t sbtsi_get_cputemp(uint8_t soc_num,
-			       float *cpu_temp)
+oob_status_t sbtsi_get_cputemp_fixed_h(struct apml_handle *handle,
+				       uint16_t *cpu_temp)
+{
+	struct apml_message msgs[2] = {0};
+	oob_status_t status[2];
+	oob_status_t ret;
+	uint8_t rd_order;
+	uint8_t byte_int, byte_dec;
+	int i;
+
+	if (!cpu_temp)
+		return OOB_ARG_PTR_NULL;
+
+	ret = tsi_read_order(handle, &rd_order);
+	if (ret != OOB_SUCCESS)
+		return ret;
+
+	/*
+	 * The first byte read latches the other one, so both are read back
+	 * to back without waiting in between
+	 */
+	msgs[0].data_in.reg_in[0] = rd_order ? SBTSI_CPUTEMPDEC :
+					       SBTSI_CPUTEMPINT;
+	msgs[1].data_in.reg_in[0] = rd_order ? SBTSI_CPUTEMPINT :
+					       SBTSI_CPUTEMPDEC;
+	for (i = 0; i < 2; i++) {
+		msgs[i].cmd = APML_REG;
+		/* Read operation */
+		msgs[i].data_in.reg_in[7] = 1;
+	}
+
+	ret = apml_xfer_batch(handle, SBTSI, msgs, 2, status);
+	if (ret != OOB_SUCCESS)
+		return ret;
+	byte_int = msgs[!!rd_order].data_out.reg_out[0];
+	byte_dec = msgs[!rd_order].data_out.reg_out[0];
+	/* [7:5] decimal value in byte, in steps of TEMP_INC */
+	*cpu_temp = byte_int << 3 | byte_dec >> 5;
+
+	return OOB_SUCCESS;
+}
+
+oob_status_t sbtsi_get_cputemp_fixed_sockets(uint8_t num_sockets,
+					     uint16_t *cpu_temp,
+					     oob_status_t *status)
+{
+	oob_status_t ret, first_err = OOB_SUCCESS;
+	int i;
+
+	if (!cpu_temp)
+		return OOB_ARG_PTR_NULL;
+
+	/* Two back to back reads per socket, not worth a thread each */
+	for (i = 0; i < num_sockets; i++) {
+		ret = sbtsi_get_cputemp_fixed_h(apml_socket_handle(i),
+						&cpu_temp[i]);
+		if (status)
+			status[i] = ret;
+		if (!first_err)
+			first_err = ret;
+	}
+
+	return first_err;
+}
+
+oob_status_t sbtsi_get_cputemp_h(struct apml_handle *handle,
+				 float *cpu_temp)
 {
 	oob_status_t ret;
 	uint8_t byte_int, byte_dec;
@@ -498,29 +800,33 @@ oob_status_t sbtsi_get_cputemp(uint8_t soc_num,
 	if (!cpu_temp)
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_CONFIGURATION, SBTSI, &rd_order);
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_CONFIGURATION, SBTSI, &rd_order);
 	if (ret != OOB_SUCCESS)
 		return ret;
 	rd_order &= READORDER_MASK;
 	if (rd_order) {
-		ret = esmi_oob_read_byte(soc_num,
-					 SBTSI_CPUTEMPDEC, SBTSI, &byte_dec);
+		ret = esmi_oob_read_byte_h(handle,
+					   SBTSI_CPUTEMPDEC, SBTSI, &byte_dec);
 		if (ret != OOB_SUCCESS)
 			return ret;
-		usleep(1000);
-		ret = esmi_oob_read_byte(soc_num,
-					 SBTSI_CPUTEMPINT, SBTSI, &byte_int);
+		ret = apml_handle_usleep(handle, 1000);
+		if (ret != OOB_SUCCESS)
+			return ret;
+		ret = esmi_oob_read_byte_h(handle,
+					   SBTSI_CPUTEMPINT, SBTSI, &byte_int);
 		if (ret != OOB_SUCCESS)
 			return ret;
 	} else {
-		ret = esmi_oob_read_byte(soc_num,
-					 SBTSI_CPUTEMPINT, SBTSI, &byte_int);
+		ret = esmi_oob_read_byte_h(handle,
+					   SBTSI_CPUTEMPINT, SBTSI, &byte_int);
+		if (ret != OOB_SUCCESS)
+			return ret;
+		ret = apml_handle_usleep(handle, 1000);
 		if (ret != OOB_SUCCESS)
 			return ret;
-		usleep(1000);
-		ret = esmi_oob_read_byte(soc_num,
-					 SBTSI_CPUTEMPDEC, SBTSI, &byte_dec);
+		ret = esmi_oob_read_byte_h(handle,
+					   SBTSI_CPUTEMPDEC, SBTSI, &byte_dec);
 		if (ret != OOB_SUCCESS)
 			return ret;
 	}
@@ -529,8 +835,8 @@ oob_status_t sbtsi_get_cputemp(uint8_t soc_num,
 	return OOB_SUCCESS;
 }
 
-oob_status_t sbtsi_get_hitemp_threshold(uint8_t soc_num,
-					float *hitemp_thr)
+oob_status_t sbtsi_get_hitemp_threshold_h(struct apml_handle *handle,
+					  float *hitemp_thr)
 {
 	oob_status_t ret;
 	uint8_t byte_int, byte_dec;
@@ -538,13 +844,15 @@ oob_status_t sbtsi_get_hitemp_threshold(uint8_t soc_num,
 	if (!hitemp_thr)
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_HITEMPINT, SBTSI, &byte_int);
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_HITEMPINT, SBTSI, &byte_int);
 	if (ret != OOB_SUCCESS)
 		return ret;
-	usleep(1000);
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_HITEMPDEC, SBTSI, &byte_dec);
+	ret = apml_handle_usleep(handle, 1000);
+	if (ret != OOB_SUCCESS)
+		return ret;
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_HITEMPDEC, SBTSI, &byte_dec);
 	if (ret != OOB_SUCCESS)
 		return ret;
 	/* combining integer and decimal part to make float value
@@ -555,8 +863,8 @@ oob_status_t sbtsi_get_hitemp_threshold(uint8_t soc_num,
 	return OOB_SUCCESS;
 }
 
-oob_status_t sbtsi_get_lotemp_threshold(uint8_t soc_num,
-					float *lotemp_thr)
+oob_status_t sbtsi_get_lotemp_threshold_h(struct apml_handle *handle,
+					  float *lotemp_thr)
 {
 	oob_status_t ret;
 	uint8_t byte_int, byte_dec;
@@ -564,13 +872,15 @@ oob_status_t sbtsi_get_lotemp_threshold(uint8_t soc_num,
 	if (!lotemp_thr)
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_LOTEMPINT, SBTSI, &byte_int);
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_LOTEMPINT, SBTSI, &byte_int);
 	if (ret != OOB_SUCCESS)
 		return ret;
-	usleep(1000);
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_LOTEMPDEC, SBTSI, &byte_dec);
+	ret = apml_handle_usleep(handle, 1000);
+	if (ret != OOB_SUCCESS)
+		return ret;
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_LOTEMPDEC, SBTSI, &byte_dec);
 	if (ret != OOB_SUCCESS)
 		return ret;
 	/* combining integer and decimal part to make float value
@@ -581,8 +891,8 @@ oob_status_t sbtsi_get_lotemp_threshold(uint8_t soc_num,
 	return OOB_SUCCESS;
 }
 
-oob_status_t sbtsi_get_temp_status(uint8_t soc_num,
-				   uint8_t *loalert, uint8_t *hialert)
+oob_status_t sbtsi_get_temp_status_h(struct apml_handle *handle,
+				     uint8_t *loalert, uint8_t *hialert)
 {
 	oob_status_t ret;
 	uint8_t rdbyte;
@@ -590,8 +900,8 @@ oob_status_t sbtsi_get_temp_status(uint8_t soc_num,
 	if ((!loalert) || (!hialert))
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_STATUS, SBTSI, &rdbyte);
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_STATUS, SBTSI, &rdbyte);
 	if (ret != OOB_SUCCESS)
 		return ret;
 	/* [4] temperature high alert, [3] temperature low alerti */
@@ -601,9 +911,9 @@ oob_status_t sbtsi_get_temp_status(uint8_t soc_num,
 	return OOB_SUCCESS;
 }
 
-oob_status_t sbtsi_get_config(uint8_t soc_num,
-			      uint8_t *al_mask, uint8_t *run_stop,
-			      uint8_t *read_ord, uint8_t *ara)
+oob_status_t sbtsi_get_config_h(struct apml_handle *handle,
+				uint8_t *al_mask, uint8_t *run_stop,
+				uint8_t *read_ord, uint8_t *ara)
 {
 	oob_status_t ret;
 	uint8_t rdbytes;
@@ -611,8 +921,9 @@ oob_status_t sbtsi_get_config(uint8_t soc_num,
 	if ((!al_mask) || (!run_stop) || (!read_ord) || (!ara))
 		return OOB_ARG_PTR_NULL;
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_CONFIGURATION, SBTSI, &rdbytes);
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_CONFIGURATION, SBTSI, &rdbytes);
+	tsi_read_order_seen(handle, rdbytes, ret);
 	if (ret != OOB_SUCCESS)
 		return ret;
 	*al_mask = rdbytes & ALERTMASK_MASK;
@@ -623,14 +934,14 @@ oob_status_t sbtsi_get_config(uint8_t soc_num,
 	return OOB_SUCCESS;
 }
 
-oob_status_t sbtsi_get_timeout(uint8_t soc_num,
-			       uint8_t *timeout_en)
+oob_status_t sbtsi_get_timeout_h(struct apml_handle *handle,
+				 uint8_t *timeout_en)
 {
 	oob_status_t ret;
 
-	ret = esmi_oob_read_byte(soc_num,
-				 SBTSI_TIMEOUTCONFIG, SBTSI,
-				 timeout_en);
+	ret = esmi_oob_read_byte_h(handle,
+				   SBTSI_TIMEOUTCONFIG, SBTSI,
+				   timeout_en);
 	if (ret != OOB_SUCCESS)
 		return ret;
 	/* [7] TimeoutEn and [6:0] Reserved */
@@ -638,3 +949,226 @@ oob_status_t sbtsi_get_timeout(uint8_t soc_num,
 
 	return OOB_SUCCESS;
 }
+
+/*
+ * Socket index based API, operating on the default handle of the socket
+ */
+oob_status_t read_sbtsi_cpuinttemp(uint8_t soc_num,
+				   uint8_t *buffer)
+{
+	return read_sbtsi_cpuinttemp_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_sbtsi_status(uint8_t soc_num,
+			       uint8_t *buffer)
+{
+	return read_sbtsi_status_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_sbtsi_config(uint8_t soc_num,
+			       uint8_t *buffer)
+{
+	return read_sbtsi_config_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_sbtsi_updaterate(uint8_t soc_num,
+				   float *buffer)
+{
+	return read_sbtsi_updaterate_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t write_sbtsi_updaterate(uint8_t soc_num,
+				    float uprate)
+{
+	return write_sbtsi_updaterate_h(apml_socket_handle(soc_num), uprate);
+}
+
+oob_status_t sbtsi_set_hitemp_threshold(uint8_t soc_num,
+					float hitemp_thr)
+{
+	return sbtsi_set_hitemp_threshold_h(apml_socket_handle(soc_num),
+					    hitemp_thr);
+}
+
+oob_status_t sbtsi_set_lotemp_threshold(uint8_t soc_num,
+					float lotemp_thr)
+{
+	return sbtsi_set_lotemp_threshold_h(apml_socket_handle(soc_num),
+					    lotemp_thr);
+}
+
+oob_status_t sbtsi_set_timeout_config(uint8_t soc_num,
+				      uint8_t mode)
+{
+	return sbtsi_set_timeout_config_h(apml_socket_handle(soc_num), mode);
+}
+
+oob_status_t sbtsi_set_alert_threshold(uint8_t soc_num,
+				       uint8_t samples)
+{
+	return sbtsi_set_alert_threshold_h(apml_socket_handle(soc_num),
+					   samples);
+}
+
+oob_status_t sbtsi_set_alert_config(uint8_t soc_num,
+				    uint8_t mode)
+{
+	return sbtsi_set_alert_config_h(apml_socket_handle(soc_num), mode);
+}
+
+oob_status_t sbtsi_set_configwr(uint8_t soc_num,
+				uint8_t mode, uint8_t config_mask)
+{
+	return sbtsi_set_configwr_h(apml_socket_handle(soc_num), mode,
+				    config_mask);
+}
+
+oob_status_t sbtsi_apply_profile(uint8_t soc_num,
+				 const struct sbtsi_profile *profile)
+{
+	return sbtsi_apply_profile_h(apml_socket_handle(soc_num), profile);
+}
+
+oob_status_t read_sbtsi_hitempint(uint8_t soc_num,
+				  uint8_t *buffer)
+{
+	return read_sbtsi_hitempint_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_sbtsi_lotempint(uint8_t soc_num,
+				  uint8_t *buffer)
+{
+	return read_sbtsi_lotempint_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_sbtsi_configwrite(uint8_t soc_num,
+				    uint8_t *buffer)
+{
+	return read_sbtsi_configwrite_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_sbtsi_cputempdecimal(uint8_t soc_num,
+				       float *buffer)
+{
+	return read_sbtsi_cputempdecimal_h(apml_socket_handle(soc_num), buffer);
+}
+
+oob_status_t read_sbtsi_cputempoffint(uint8_t soc_num,
+				      uint8_t *temp_int)
+{
+	return read_sbtsi_cputempoffint_h(apml_socket_handle(soc_num),
+					  temp_int);
+}
+
+oob_status_t read_sbtsi_cputempoffdec(uint8_t soc_num,
+				      float *temp_dec)
+{
+	return read_sbtsi_cputempoffdec_h(apml_socket_handle(soc_num),
+					  temp_dec);
+}
+
+oob_status_t read_sbtsi_hitempdecimal(uint8_t soc_num,
+				      float *temp_dec)
+{
+	return read_sbtsi_hitempdecimal_h(apml_socket_handle(soc_num),
+					  temp_dec);
+}
+
+oob_status_t read_sbtsi_lotempdecimal(uint8_t soc_num,
+				      float *temp_dec)
+{
+	return read_sbtsi_lotempdecimal_h(apml_socket_handle(soc_num),
+					  temp_dec);
+}
+
+oob_status_t read_sbtsi_timeoutconfig(uint8_t soc_num,
+				      uint8_t *timeout)
+{
+	return read_sbtsi_timeoutconfig_h(apml_socket_handle(soc_num), timeout);
+}
+
+oob_status_t read_sbtsi_cputempoffset(uint8_t soc_num,
+				      float *temp_offset)
+{
+	return read_sbtsi_cputempoffset_h(apml_socket_handle(soc_num),
+					  temp_offset);
+}
+
+oob_status_t write_sbtsi_cputempoffset(uint8_t soc_num,
+				       float temp_offset)
+{
+	return write_sbtsi_cputempoffset_h(apml_socket_handle(soc_num),
+					   temp_offset);
+}
+
+oob_status_t read_sbtsi_alertthreshold(uint8_t soc_num,
+				       uint8_t *samples)
+{
+	return read_sbtsi_alertthreshold_h(apml_socket_handle(soc_num),
+					   samples);
+}
+
+oob_status_t read_sbtsi_alertconfig(uint8_t soc_num,
+				    uint8_t *mode)
+{
+	return read_sbtsi_alertconfig_h(apml_socket_handle(soc_num), mode);
+}
+
+oob_status_t read_sbtsi_manufid(uint8_t soc_num,
+				uint8_t *man_id)
+{
+	return read_sbtsi_manufid_h(apml_socket_handle(soc_num), man_id);
+}
+
+oob_status_t read_sbtsi_revision(uint8_t soc_num,
+				 uint8_t *rivision)
+{
+	return read_sbtsi_revision_h(apml_socket_handle(soc_num), rivision);
+}
+
+oob_status_t sbtsi_get_cputemp(uint8_t soc_num,
+			       float *cpu_temp)
+{
+	return sbtsi_get_cputemp_h(apml_socket_handle(soc_num), cpu_temp);
+}
+
+oob_status_t sbtsi_get_cputemp_fixed(uint8_t soc_num, uint16_t *cpu_temp)
+{
+	return sbtsi_get_cputemp_fixed_h(apml_socket_handle(soc_num),
+					 cpu_temp);
+}
+
+oob_status_t sbtsi_get_hitemp_threshold(uint8_t soc_num,
+					float *hitemp_thr)
+{
+	return sbtsi_get_hitemp_threshold_h(apml_socket_handle(soc_num),
+					    hitemp_thr);
+}
+
+oob_status_t sbtsi_get_lotemp_threshold(uint8_t soc_num,
+					float *lotemp_thr)
+{
+	return sbtsi_get_lotemp_threshold_h(apml_socket_handle(soc_num),
+					    lotemp_thr);
+}
+
+oob_status_t sbtsi_get_temp_status(uint8_t soc_num,
+				   uint8_t *loalert, uint8_t *hialert)
+{
+	return sbtsi_get_temp_status_h(apml_socket_handle(soc_num), loalert,
+				       hialert);
+}
+
+oob_status_t sbtsi_get_config(uint8_t soc_num,
+			      uint8_t *al_mask, uint8_t *run_stop,
+			      uint8_t *read_ord, uint8_t *ara)
+{
+	return sbtsi_get_config_h(apml_socket_handle(soc_num), al_mask,
+				  run_stop, read_ord, ara);
+}
+
+oob_status_t sbtsi_get_timeout(uint8_t soc_num,
+			       uint8_t *timeout_en)
+{
+	return sbtsi_get_timeout_h(apml_socket_handle(soc_num), timeout_en);
+}
@@ -0,0 +1,203 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * The requests of a class are issued in submission order, apml_cancel()
+ * drops only the requests of its handle, the eventfd tells when there are
+ * completions to dispatch, and several threads can submit on one handle.
+ */
+#include "test_common.h"
+
+#include <pthread.h>
+
+#include <esmi_oob/esmi_mailbox.h>
+
+#include "../src/esmi_oob/common.h"
+
+#define QUEUED		8
+#define THREADS		4
+#define PER_THREAD	16
+#define MAX_REQS	(THREADS * PER_THREAD)
+
+/* Completions of a handle, in dispatch order */
+struct log {
+	struct apml_message msgs[MAX_REQS];
+	oob_status_t status[MAX_REQS];
+	unsigned int order[MAX_REQS];
+	unsigned int n;
+};
+
+static struct log held, first, second;
+
+static void done(struct apml_handle *handle, struct apml_message *msg,
+		 oob_status_t status, void *ctx)
+{
+	struct log *log = ctx;
+	unsigned int i = msg - log->msgs;
+
+	(void)handle;
+	log->status[i] = status;
+	if (log->n < MAX_REQS)
+		log->order[log->n] = i;
+	log->n++;
+}
+
+/* Submit the power reads [from, to) of a log */
+static void submit_reads(struct apml_handle *handle, struct log *log,
+			 unsigned int from, unsigned int to)
+{
+	unsigned int i;
+
+	for (i = from; i < to; i++) {
+		apml_mailbox_read_msg(&log->msgs[i],
+				      READ_PACKAGE_POWER_CONSUMPTION, 0);
+		CHECK_EQ(apml_submit(handle, SBRMI, &log->msgs[i], done,
+				     log), 0);
+	}
+}
+
+static bool readable(struct apml_handle *handle)
+{
+	struct pollfd pfd = { .events = POLLIN };
+
+	CHECK_EQ(apml_get_event_fd(handle, &pfd.fd), 0);
+
+	return poll(&pfd, 1, 0) == 1;
+}
+
+struct submitter {
+	pthread_t thread;
+	struct apml_handle *handle;
+	unsigned int idx;
+};
+
+static void *submit_thread(void *arg)
+{
+	struct submitter *s = arg;
+
+	submit_reads(s->handle, &first, s->idx * PER_THREAD,
+		     (s->idx + 1) * PER_THREAD);
+
+	return NULL;
+}
+
+int main(void)
+{
+	struct submitter threads[THREADS];
+	struct apml_handle *handle, *other;
+	unsigned int i, n, pos[MAX_REQS];
+	uint64_t calls;
+
+	test_use_emulator();
+	CHECK_EQ(apml_open(0, APML_OPEN_ASYNC, &handle), 0);
+	CHECK_EQ(apml_open(0, APML_OPEN_ASYNC, &other), 0);
+
+	/* Same class requests queued behind a slow one keep their order */
+	apml_mailbox_read_msg(&held.msgs[0], READ_PACKAGE_POWER_LIMIT, 0);
+	test_hold_worker(handle, &held.msgs[0], done, &held);
+	submit_reads(handle, &first, 0, QUEUED);
+	/* Nothing to dispatch while the slow request holds the worker */
+	CHECK(!readable(handle));
+	test_wait_completions(handle, &held.n, 1);
+	test_wait_completions(handle, &first.n, QUEUED);
+	for (i = 0; i < QUEUED; i++) {
+		CHECK_EQ(first.order[i], i);
+		CHECK_EQ(first.status[i], 0);
+	}
+	/* Dispatching the completions clears the eventfd */
+	CHECK(!readable(handle));
+
+	/* The eventfd becomes readable once a request completed */
+	first.n = 0;
+	submit_reads(handle, &first, 0, 1);
+	test_wait_completions(handle, &first.n, 1);
+	CHECK(!readable(handle));
+
+	/* apml_cancel() drops the queued requests of its handle only */
+	held.n = 0;
+	first.n = 0;
+	calls = test_calls(0, READ_PACKAGE_POWER_CONSUMPTION);
+	test_hold_worker(handle, &held.msgs[0], done, &held);
+	submit_reads(handle, &first, 0, QUEUED);
+	submit_reads(other, &second, 0, QUEUED);
+	CHECK_EQ(apml_cancel(handle), 0);
+	test_wait_completions(handle, &held.n, 1);
+	test_wait_completions(handle, &first.n, QUEUED);
+	test_wait_completions(other, &second.n, QUEUED);
+	CHECK_EQ(held.status[0], 0);
+	for (i = 0; i < QUEUED; i++) {
+		CHECK_EQ(first.status[i], OOB_INTERRUPTED);
+		CHECK_EQ(second.status[i], 0);
+	}
+	CHECK_EQ(test_calls(0, READ_PACKAGE_POWER_CONSUMPTION) - calls,
+		 QUEUED);
+	CHECK_EQ(apml_set_hooks(NULL), 0);
+
+	/* Requests submitted from several threads all complete once */
+	first.n = 0;
+	calls = test_calls(0, READ_PACKAGE_POWER_CONSUMPTION);
+	for (i = 0; i < THREADS; i++) {
+		threads[i].handle = handle;
+		threads[i].idx = i;
+		CHECK_EQ(pthread_create(&threads[i].thread, NULL,
+					submit_thread, &threads[i]), 0);
+	}
+	for (i = 0; i < THREADS; i++)
+		pthread_join(threads[i].thread, NULL);
+	test_wait_completions(handle, &first.n, MAX_REQS);
+	CHECK_EQ(test_calls(0, READ_PACKAGE_POWER_CONSUMPTION) - calls,
+		 MAX_REQS);
+	memset(pos, 0xff, sizeof(pos));
+	for (n = 0; n < MAX_REQS; n++) {
+		CHECK_EQ(pos[first.order[n]], ~0U);
+		pos[first.order[n]] = n;
+		CHECK_EQ(first.status[first.order[n]], 0);
+	}
+	/* In the order each thread submitted them */
+	for (i = 0; i < MAX_REQS; i++)
+		if (i % PER_THREAD)
+			CHECK(pos[i] > pos[i - 1]);
+
+	CHECK_EQ(apml_close(other), 0);
+	CHECK_EQ(apml_close(handle), 0);
+
+	return test_result("test_async");
+}
@@ -0,0 +1,129 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * With coalescing enabled, identical reads waiting for the bus of a socket
+ * are issued once and all the callers get its result.
+ */
+#include "test_common.h"
+
+#include <pthread.h>
+
+#include <esmi_oob/esmi_mailbox.h>
+
+#define READERS		8
+/* The bus is held this long while the readers queue up behind it */
+#define HOLD_NS		200000000U
+#define QUEUE_NS	20000000U
+/* Default emulated READ_PACKAGE_POWER_CONSUMPTION */
+#define EMUL_POWER	150000
+
+static pthread_barrier_t start;
+static uint32_t power[READERS];
+static oob_status_t status[READERS];
+
+/* Holds the SB-RMI bus of socket 0 for HOLD_NS */
+static void *hold_bus(void *arg)
+{
+	uint32_t limit;
+
+	(void)arg;
+	pthread_barrier_wait(&start);
+	read_socket_power_limit(0, &limit);
+
+	return NULL;
+}
+
+static void *read_power(void *arg)
+{
+	int id = (int)(intptr_t)arg;
+
+	pthread_barrier_wait(&start);
+	test_sleep_ns(QUEUE_NS);
+	status[id] = read_socket_power(0, &power[id]);
+
+	return NULL;
+}
+
+int main(void)
+{
+	pthread_t holder, readers[READERS];
+	struct apml_cmd_stats st;
+	uint64_t calls, coalesced;
+	int i;
+
+	test_use_emulator();
+	CHECK_EQ(apml_set_coalescing(true), 0);
+	CHECK_EQ(apml_emul_set_latency(READ_PACKAGE_POWER_LIMIT, HOLD_NS,
+				       HOLD_NS), 0);
+	CHECK_EQ(apml_get_stats(0, READ_PACKAGE_POWER_CONSUMPTION, &st), 0);
+	calls = st.calls;
+	coalesced = st.coalesced;
+
+	pthread_barrier_init(&start, NULL, READERS + 1);
+	CHECK_EQ(pthread_create(&holder, NULL, hold_bus, NULL), 0);
+	for (i = 0; i < READERS; i++)
+		CHECK_EQ(pthread_create(&readers[i], NULL, read_power,
+					(void *)(intptr_t)i), 0);
+	pthread_join(holder, NULL);
+	for (i = 0; i < READERS; i++)
+		pthread_join(readers[i], NULL);
+	pthread_barrier_destroy(&start);
+
+	/* One transaction, whose result every reader got */
+	for (i = 0; i < READERS; i++) {
+		CHECK_EQ(status[i], 0);
+		CHECK_EQ(power[i], EMUL_POWER);
+	}
+	CHECK_EQ(apml_get_stats(0, READ_PACKAGE_POWER_CONSUMPTION, &st), 0);
+	CHECK_EQ(st.calls - calls, 1);
+	CHECK_EQ(st.coalesced - coalesced, READERS - 1);
+
+	/* Each read is issued once coalescing is disabled */
+	CHECK_EQ(apml_set_coalescing(false), 0);
+	CHECK_EQ(apml_emul_set_latency(READ_PACKAGE_POWER_LIMIT, 0, 0), 0);
+	CHECK_EQ(read_socket_power(0, &power[0]), 0);
+	CHECK_EQ(read_socket_power(0, &power[0]), 0);
+	CHECK_EQ(apml_get_stats(0, READ_PACKAGE_POWER_CONSUMPTION, &st), 0);
+	CHECK_EQ(st.calls - calls, 3);
+
+	return test_result("test_coalescing");
+}
@@ -0,0 +1,233 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * Helpers of the tests, which run the library against the device emulator
+ * of apml_emul.h. A test is a program exiting non-zero on failure.
+ */
+#ifndef TESTS_TEST_COMMON_H_
+#define TESTS_TEST_COMMON_H_
+
+#include <poll.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <esmi_oob/apml.h>
+#include <esmi_oob/apml_emul.h>
+#include <esmi_oob/esmi_mailbox.h>
+
+static int test_failures;
+
+#define CHECK(cond)							\
+	do {								\
+		if (!(cond)) {						\
+			fprintf(stderr, "%s:%d: check failed: %s\n",	\
+				__FILE__, __LINE__, #cond);		\
+			test_failures++;				\
+		}							\
+	} while (0)
+
+#define CHECK_EQ(a, b)							\
+	do {								\
+		long long _a = (a), _b = (b);				\
+		if (_a != _b) {						\
+			fprintf(stderr, "%s:%d: %s == %lld, expected %lld\n", \
+				__FILE__, __LINE__, #a, _a, _b);	\
+			test_failures++;				\
+		}							\
+	} while (0)
+
+/* Select the emulator on both interfaces, from its default state */
+static inline void test_use_emulator(void)
+{
+	apml_set_transport(SBRMI, APML_TRANSPORT_EMUL);
+	apml_set_transport(SBTSI, APML_TRANSPORT_EMUL);
+	apml_emul_reset();
+}
+
+/* Transactions of a command issued on a socket so far */
+static inline uint64_t test_calls(uint8_t soc_num, uint32_t cmd)
+{
+	struct apml_cmd_stats st;
+
+	if (apml_get_stats(soc_num, cmd, &st))
+		return 0;
+
+	return st.calls;
+}
+
+/* Transactions of all the commands issued on a socket so far */
+static inline uint64_t test_all_calls(uint8_t soc_num)
+{
+	uint64_t n = 0;
+	uint32_t cmd;
+
+	for (cmd = 0; cmd < APML_STATS_MAX_CMD; cmd++)
+		n += test_calls(soc_num, cmd);
+
+	return n;
+}
+
+static inline uint64_t test_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void test_sleep_ns(uint64_t ns)
+{
+	struct timespec ts = { ns / 1000000000, ns % 1000000000 };
+
+	nanosleep(&ts, NULL);
+}
+
+/* SB-TSI register accesses seen by test_tsi_hook, in issue order */
+#define TEST_TSI_XFERS	16
+
+struct test_tsi_xfer {
+	uint8_t reg;
+	bool read;
+};
+
+static struct test_tsi_xfer test_tsi_xfers[TEST_TSI_XFERS];
+static unsigned int test_tsi_n;
+/* Register whose writes fail with a firmware error, -1 for none */
+static int test_tsi_fail_reg = -1;
+
+static inline void test_tsi_record(const struct apml_xfer_info *info,
+				   void *ctx)
+{
+	const struct apml_message *msg = info->msg;
+	uint8_t reg = msg->data_in.reg_in[0];
+	bool read = msg->data_in.reg_in[7];
+
+	(void)ctx;
+	if (!info->file_name || strcmp(info->file_name, SBTSI) ||
+	    msg->cmd != APML_REG)
+		return;
+	if (test_tsi_n < TEST_TSI_XFERS) {
+		test_tsi_xfers[test_tsi_n].reg = reg;
+		test_tsi_xfers[test_tsi_n].read = read;
+		test_tsi_n++;
+	}
+	apml_emul_set_fw_error(info->soc_num, APML_REG,
+			       !read && reg == test_tsi_fail_reg ? 0x1 : 0);
+}
+
+static const struct apml_hooks test_tsi_hook = { .pre = test_tsi_record };
+
+static inline unsigned int test_tsi_reads(void)
+{
+	unsigned int i, n = 0;
+
+	for (i = 0; i < test_tsi_n; i++)
+		n += test_tsi_xfers[i].read;
+
+	return n;
+}
+
+/* Latency of the slow read that test_hold_worker() leaves on the bus */
+#define TEST_HOLD_NS	100000000U
+#define TEST_POLL_MS	1000
+
+static atomic_bool test_holding;
+
+static inline void test_hold_record(const struct apml_xfer_info *info,
+				    void *ctx)
+{
+	(void)ctx;
+	if (info->msg->cmd == READ_PACKAGE_POWER_LIMIT)
+		atomic_store(&test_holding, true);
+}
+
+static const struct apml_hooks test_hold_hook = { .pre = test_hold_record };
+
+/*
+ * Submit msg, a READ_PACKAGE_POWER_LIMIT read, and return once the worker
+ * of the socket issued it: what is submitted next queues behind it.
+ */
+static inline void test_hold_worker(struct apml_handle *handle,
+				    struct apml_message *msg,
+				    apml_callback_t callback, void *ctx)
+{
+	atomic_store(&test_holding, false);
+	CHECK_EQ(apml_emul_set_latency(READ_PACKAGE_POWER_LIMIT, TEST_HOLD_NS,
+				       TEST_HOLD_NS), 0);
+	CHECK_EQ(apml_set_hooks(&test_hold_hook), 0);
+	CHECK_EQ(apml_submit(handle, SBRMI, msg, callback, ctx), 0);
+	while (!atomic_load(&test_holding))
+		;
+}
+
+/* Dispatch the completions of handle until *completed reaches n */
+static inline void test_wait_completions(struct apml_handle *handle,
+					 const unsigned int *completed,
+					 unsigned int n)
+{
+	struct pollfd pfd = { .events = POLLIN };
+
+	CHECK_EQ(apml_get_event_fd(handle, &pfd.fd), 0);
+	while (*completed < n && poll(&pfd, 1, TEST_POLL_MS) > 0)
+		CHECK_EQ(apml_process_completions(handle, NULL), 0);
+	CHECK_EQ(*completed, n);
+}
+
+static inline int test_result(const char *name)
+{
+	if (test_failures) {
+		fprintf(stderr, "%s: %d check(s) failed\n", name,
+			test_failures);
+		return EXIT_FAILURE;
+	}
+	printf("%s: passed\n", name);
+
+	return EXIT_SUCCESS;
+}
+
+#endif  // TESTS_TEST_COMMON_H_
@@ -0,0 +1,108 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * esmi_oob_cpuid() reads a leaf in two transactions, EAX/EBX and ECX/EDX,
+ * and the CPUID cache serves it until the socket is invalidated.
+ */
+#include "test_common.h"
+
+#include <esmi_oob/esmi_cpuid_msr.h>
+
+/* Default emulated CPUID Fn0000_0000: "AuthenticAMD" */
+#define EMUL_FN0_EAX	0x10
+#define EMUL_FN0_EBX	0x68747541
+#define EMUL_FN0_ECX	0x444d4163
+#define EMUL_FN0_EDX	0x69746e65
+
+/* Transactions of one read of CPUID Fn0000_0000 of thread 0 */
+static uint64_t read_fn0(uint32_t *eax, uint32_t *ebx, uint32_t *ecx,
+			 uint32_t *edx)
+{
+	uint64_t calls = test_calls(0, APML_STATS_CMD_CPUID);
+
+	*eax = 0;
+	*ecx = 0;
+	CHECK_EQ(esmi_oob_cpuid(0, 0, eax, ebx, ecx, edx), 0);
+
+	return test_calls(0, APML_STATS_CMD_CPUID) - calls;
+}
+
+int main(void)
+{
+	uint32_t eax, ebx, ecx, edx;
+
+	test_use_emulator();
+
+	/* One transaction per register pair */
+	CHECK_EQ(read_fn0(&eax, &ebx, &ecx, &edx), 2);
+	CHECK_EQ(eax, EMUL_FN0_EAX);
+	CHECK_EQ(ebx, EMUL_FN0_EBX);
+	CHECK_EQ(ecx, EMUL_FN0_ECX);
+	CHECK_EQ(edx, EMUL_FN0_EDX);
+	CHECK_EQ(read_fn0(&eax, &ebx, &ecx, &edx), 2);
+
+	/* Cached, the leaf is read once */
+	CHECK_EQ(apml_set_cpuid_cache(true), 0);
+	CHECK_EQ(read_fn0(&eax, &ebx, &ecx, &edx), 2);
+	CHECK_EQ(read_fn0(&eax, &ebx, &ecx, &edx), 0);
+	CHECK_EQ(eax, EMUL_FN0_EAX);
+	CHECK_EQ(ebx, EMUL_FN0_EBX);
+	CHECK_EQ(ecx, EMUL_FN0_ECX);
+	CHECK_EQ(edx, EMUL_FN0_EDX);
+
+	/* and read again once the socket is invalidated */
+	CHECK_EQ(apml_invalidate_socket_cache(0), 0);
+	CHECK_EQ(read_fn0(&eax, &ebx, &ecx, &edx), 2);
+	CHECK_EQ(read_fn0(&eax, &ebx, &ecx, &edx), 0);
+
+	/* A change of the emulated processor drops the cached leaves too */
+	CHECK_EQ(apml_emul_set_cpuid(0, 0x0, 0, EMUL_FN0_EAX + 1, EMUL_FN0_EBX,
+				     EMUL_FN0_ECX, EMUL_FN0_EDX), 0);
+	CHECK_EQ(read_fn0(&eax, &ebx, &ecx, &edx), 2);
+	CHECK_EQ(eax, EMUL_FN0_EAX + 1);
+
+	/* Issued again once the cache is disabled */
+	CHECK_EQ(apml_set_cpuid_cache(false), 0);
+	CHECK_EQ(read_fn0(&eax, &ebx, &ecx, &edx), 2);
+
+	return test_result("test_cpuid");
+}
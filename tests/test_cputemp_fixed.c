@@ -0,0 +1,103 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * sbtsi_get_cputemp_fixed() reads the two temperature bytes in the order
+ * of Config[ReadOrder], with no other transaction once the order is known.
+ */
+#include "test_common.h"
+
+#include <esmi_oob/esmi_tsi.h>
+
+/* 50.375 degree C */
+#define TEMP_INT	50
+#define TEMP_DEC	(3 << 5)
+#define TEMP_FIXED	(TEMP_INT * 8 + 3)
+
+/* Transactions of one read, checking the temperature */
+static unsigned int read_temp(void)
+{
+	uint16_t temp = 0;
+
+	test_tsi_n = 0;
+	CHECK_EQ(sbtsi_get_cputemp_fixed(0, &temp), 0);
+	CHECK_EQ(temp, TEMP_FIXED);
+
+	return test_tsi_n;
+}
+
+int main(void)
+{
+	uint64_t calls;
+
+	test_use_emulator();
+	CHECK_EQ(apml_emul_set_reg(0, SBTSI, SBTSI_CPUTEMPINT, TEMP_INT), 0);
+	CHECK_EQ(apml_emul_set_reg(0, SBTSI, SBTSI_CPUTEMPDEC, TEMP_DEC), 0);
+	CHECK_EQ(apml_emul_set_reg(0, SBTSI, SBTSI_CONFIGURATION, 0), 0);
+	CHECK_EQ(apml_set_hooks(&test_tsi_hook), 0);
+
+	/* The read order is read once, then the integer byte goes first */
+	CHECK_EQ(read_temp(), 3);
+	CHECK_EQ(test_tsi_xfers[0].reg, SBTSI_CONFIGURATION);
+	calls = test_calls(0, APML_STATS_CMD_SBTSI_REG);
+	CHECK_EQ(read_temp(), 2);
+	CHECK_EQ(test_tsi_xfers[0].reg, SBTSI_CPUTEMPINT);
+	CHECK_EQ(test_tsi_xfers[1].reg, SBTSI_CPUTEMPDEC);
+	CHECK_EQ(test_calls(0, APML_STATS_CMD_SBTSI_REG) - calls, 2);
+
+	/* A ReadOrder written by the library is followed without a read */
+	CHECK_EQ(sbtsi_set_configwr(0, 1, READORDER_MASK), 0);
+	CHECK_EQ(read_temp(), 2);
+	CHECK_EQ(test_tsi_xfers[0].reg, SBTSI_CPUTEMPDEC);
+	CHECK_EQ(test_tsi_xfers[1].reg, SBTSI_CPUTEMPINT);
+
+	/* Read again once invalidated, the decimal byte going first */
+	CHECK_EQ(apml_invalidate_socket_cache(0), 0);
+	CHECK_EQ(read_temp(), 3);
+	CHECK_EQ(test_tsi_xfers[0].reg, SBTSI_CONFIGURATION);
+	CHECK_EQ(read_temp(), 2);
+	CHECK_EQ(test_tsi_xfers[0].reg, SBTSI_CPUTEMPDEC);
+	CHECK_EQ(test_tsi_xfers[1].reg, SBTSI_CPUTEMPINT);
+
+	CHECK_EQ(apml_set_hooks(NULL), 0);
+
+	return test_result("test_cputemp_fixed");
+}
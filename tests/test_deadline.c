@@ -0,0 +1,115 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * A call past the deadline of its handle issues no transaction, and
+ * apml_cancel() completes the queued requests without issuing them.
+ */
+#include "test_common.h"
+
+#include <esmi_oob/esmi_mailbox.h>
+
+#include "../src/esmi_oob/common.h"
+
+#define QUEUED		8
+
+static oob_status_t results[QUEUED + 1];
+static unsigned int completed;
+
+static void done(struct apml_handle *handle, struct apml_message *msg,
+		 oob_status_t status, void *ctx)
+{
+	(void)handle;
+	(void)msg;
+	results[(intptr_t)ctx] = status;
+	completed++;
+}
+
+int main(void)
+{
+	struct apml_message msgs[QUEUED + 1];
+	struct apml_call_opts opts = {0};
+	struct apml_handle *handle;
+	uint64_t calls;
+	uint32_t power;
+	int i;
+
+	test_use_emulator();
+
+	/* A deadline already passed fails before reaching the bus */
+	CHECK_EQ(apml_open(0, 0, &handle), 0);
+	opts.deadline_ns = test_now_ns() - 1;
+	CHECK_EQ(apml_set_call_opts(handle, &opts), 0);
+	calls = test_all_calls(0);
+	CHECK_EQ(read_socket_power_h(handle, &power), OOB_CMD_TIMEOUT);
+	CHECK_EQ(test_all_calls(0), calls);
+	CHECK_EQ(apml_set_call_opts(handle, NULL), 0);
+	CHECK_EQ(read_socket_power_h(handle, &power), 0);
+	CHECK_EQ(apml_close(handle), 0);
+
+	/* Requests queued behind a slow one are dropped by apml_cancel() */
+	CHECK_EQ(apml_open(0, APML_OPEN_ASYNC, &handle), 0);
+	apml_mailbox_read_msg(&msgs[0], READ_PACKAGE_POWER_LIMIT, 0);
+	test_hold_worker(handle, &msgs[0], done, (void *)0);
+	calls = test_calls(0, READ_PACKAGE_POWER_CONSUMPTION);
+	for (i = 1; i <= QUEUED; i++) {
+		apml_mailbox_read_msg(&msgs[i], READ_PACKAGE_POWER_CONSUMPTION,
+				      0);
+		CHECK_EQ(apml_submit(handle, SBRMI, &msgs[i], done,
+				     (void *)(intptr_t)i), 0);
+	}
+	CHECK_EQ(apml_cancel(handle), 0);
+	test_wait_completions(handle, &completed, QUEUED + 1);
+	CHECK_EQ(results[0], 0);
+	for (i = 1; i <= QUEUED; i++)
+		CHECK_EQ(results[i], OOB_INTERRUPTED);
+	CHECK_EQ(test_calls(0, READ_PACKAGE_POWER_CONSUMPTION), calls);
+
+	/* Requests submitted after the cancel are issued */
+	CHECK_EQ(apml_submit(handle, SBRMI, &msgs[1], done, (void *)1), 0);
+	test_wait_completions(handle, &completed, QUEUED + 2);
+	CHECK_EQ(results[1], 0);
+	CHECK_EQ(test_calls(0, READ_PACKAGE_POWER_CONSUMPTION) - calls, 1);
+	CHECK_EQ(apml_close(handle), 0);
+	CHECK_EQ(apml_set_hooks(NULL), 0);
+
+	return test_result("test_deadline");
+}
@@ -0,0 +1,130 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * A process started with the record of apml_set_disk_cache() reads none of
+ * the static facts of the socket again, and checks the fingerprint of the
+ * record only when it has to read a fact the record lacks.
+ */
+#include "test_common.h"
+
+#include <unistd.h>
+
+#include <esmi_oob/esmi_cpuid_msr.h>
+#include <esmi_oob/esmi_mailbox.h>
+
+#include "../src/esmi_oob/common.h"
+
+/* The static facts, but the frequency range and the base frequency */
+static void read_facts(void)
+{
+	struct processor_static_info info;
+	uint32_t power, tdp;
+	uint8_t tu, esu, rev;
+
+	CHECK_EQ(apml_rmi_revision(apml_socket_handle(0), &rev), 0);
+	CHECK_EQ(esmi_get_processor_static_info(0, &info), 0);
+	CHECK_EQ(read_bmc_rapl_units(0, &tu, &esu), 0);
+	CHECK_EQ(read_max_socket_power_limit(0, &power), 0);
+	CHECK_EQ(read_max_tdp(0, &tdp), 0);
+	CHECK_EQ(read_min_tdp(0, &tdp), 0);
+}
+
+/* Drop the values cached in the process, as a new process starts */
+static void restart(void)
+{
+	CHECK_EQ(apml_set_transport(SBRMI, APML_TRANSPORT_EMUL), 0);
+}
+
+int main(void)
+{
+	char dir[] = "/tmp/test_disk_cacheXXXXXX";
+	char path[sizeof(dir) + 8];
+	uint16_t fmax, fmin, freq;
+	uint64_t calls;
+	uint32_t power;
+	uint8_t rev;
+
+	CHECK(mkdtemp(dir) != NULL);
+	snprintf(path, sizeof(path), "%s/cache", dir);
+	test_use_emulator();
+	CHECK_EQ(apml_set_disk_cache(path), 0);
+
+	/* The first process reads the facts */
+	calls = test_all_calls(0);
+	read_facts();
+	CHECK(test_all_calls(0) > calls);
+
+	/* The next ones neither read them nor check the record */
+	restart();
+	calls = test_all_calls(0);
+	CHECK_EQ(read_socket_power(0, &power), 0);
+	CHECK_EQ(test_all_calls(0) - calls, 1);
+	read_facts();
+	CHECK_EQ(test_all_calls(0) - calls, 1);
+
+	/* A fact the record lacks is read after checking its fingerprint */
+	calls = test_all_calls(0);
+	CHECK_EQ(read_socket_freq_range(0, &fmax, &fmin), 0);
+	CHECK_EQ(test_all_calls(0) - calls, 3);
+	restart();
+	calls = test_all_calls(0);
+	read_facts();
+	CHECK_EQ(read_socket_freq_range(0, &fmax, &fmin), 0);
+	CHECK_EQ(test_all_calls(0), calls);
+
+	/* A record of another processor is started over */
+	CHECK_EQ(apml_emul_set_rmi_revision(0, 0x10), 0);
+	calls = test_all_calls(0);
+	CHECK_EQ(read_bmc_cpu_base_frequency(0, &freq), 0);
+	CHECK_EQ(test_all_calls(0) - calls, 3);
+	CHECK_EQ(apml_rmi_revision(apml_socket_handle(0), &rev), 0);
+	CHECK_EQ(rev, 0x10);
+	calls = test_all_calls(0);
+	CHECK_EQ(read_socket_freq_range(0, &fmax, &fmin), 0);
+	CHECK_EQ(test_all_calls(0) - calls, 1);
+
+	CHECK_EQ(apml_set_disk_cache(NULL), 0);
+	unlink(path);
+	rmdir(dir);
+
+	return test_result("test_disk_cache");
+}
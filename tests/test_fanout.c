@@ -0,0 +1,113 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * apml_for_each_socket() runs the calls of the sockets in parallel and
+ * stores the result of each socket in its own slot.
+ */
+#include "test_common.h"
+
+#include <esmi_oob/esmi_mailbox.h>
+
+#include "../src/esmi_oob/common.h"
+
+#define SOCKETS		2
+/* Socket 0 reads the power limit, socket 1 the TDP, each this slow */
+#define LIMIT_NS	100000000U
+#define TDP_NS		60000000U
+
+static int arg_token;
+
+struct result {
+	uint8_t soc_num;
+	uint32_t value;
+};
+
+static oob_status_t read_slow(struct apml_handle *handle, void *result,
+			      void *arg)
+{
+	struct result *r = result;
+	uint32_t cmd = handle->soc_num ? READ_TDP : READ_PACKAGE_POWER_LIMIT;
+
+	CHECK(arg == &arg_token);
+	r->soc_num = handle->soc_num;
+
+	return esmi_oob_read_mailbox_h(handle, cmd, 0, &r->value);
+}
+
+int main(void)
+{
+	struct result results[SOCKETS] = {0};
+	oob_status_t status[SOCKETS];
+	uint64_t start, elapsed;
+	int i;
+
+	test_use_emulator();
+	CHECK_EQ(apml_emul_set_mailbox(0, READ_PACKAGE_POWER_LIMIT, 150000), 0);
+	CHECK_EQ(apml_emul_set_mailbox(1, READ_TDP, 240000), 0);
+	CHECK_EQ(apml_emul_set_latency(READ_PACKAGE_POWER_LIMIT, LIMIT_NS,
+				       LIMIT_NS), 0);
+	CHECK_EQ(apml_emul_set_latency(READ_TDP, TDP_NS, TDP_NS), 0);
+
+	start = test_now_ns();
+	CHECK_EQ(apml_for_each_socket(SOCKETS, read_slow, &arg_token, results,
+				      sizeof(results[0]), status), 0);
+	elapsed = test_now_ns() - start;
+
+	for (i = 0; i < SOCKETS; i++) {
+		CHECK_EQ(status[i], 0);
+		CHECK_EQ(results[i].soc_num, i);
+	}
+	CHECK_EQ(results[0].value, 150000);
+	CHECK_EQ(results[1].value, 240000);
+	/* The slower socket sets the pace, the other one overlaps it */
+	CHECK(elapsed >= LIMIT_NS);
+	CHECK(elapsed < LIMIT_NS + TDP_NS);
+
+	/* The first failing socket is returned, each one in its slot */
+	CHECK_EQ(apml_emul_set_fw_error(1, READ_TDP, 0x4), 0);
+	CHECK_EQ(apml_for_each_socket(SOCKETS, read_slow, &arg_token, results,
+				      sizeof(results[0]), status), status[1]);
+	CHECK_EQ(status[0], 0);
+	CHECK(status[1] != 0);
+
+	return test_result("test_fanout");
+}
@@ -0,0 +1,134 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * Moving an interface to another I2C adapter reopens its cached device
+ * node. The adapters are faked by interposing open() and ioctl().
+ */
+#include "test_common.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#define MAX_FDS		1024
+#define TSI_REVISION	0xff
+
+/* Adapter each fd was opened on, -1 for other files */
+static int fd_bus[MAX_FDS];
+static int last_bus = -1;
+static int last_addr = -1;
+
+int open(const char *path, int flags, ...)
+{
+	mode_t mode = 0;
+	va_list ap;
+	int fd, bus = -1;
+
+	if (sscanf(path, "/dev/i2c-%d", &bus) == 1)
+		path = "/dev/null";
+	if (flags & O_CREAT) {
+		va_start(ap, flags);
+		mode = va_arg(ap, mode_t);
+		va_end(ap);
+	}
+
+	fd = openat(AT_FDCWD, path, flags, mode);
+	if (fd >= 0 && fd < MAX_FDS)
+		fd_bus[fd] = bus;
+
+	return fd;
+}
+
+int ioctl(int fd, unsigned long request, ...)
+{
+	struct i2c_rdwr_ioctl_data *data;
+	va_list ap;
+
+	if (request != I2C_RDWR || fd < 0 || fd >= MAX_FDS || fd_bus[fd] < 0) {
+		errno = ENOTTY;
+		return -1;
+	}
+	va_start(ap, request);
+	data = va_arg(ap, struct i2c_rdwr_ioctl_data *);
+	va_end(ap);
+
+	last_bus = fd_bus[fd];
+	last_addr = data->msgs[0].addr;
+	if (data->nmsgs == 2)
+		data->msgs[1].buf[0] = 0;
+
+	return 0;
+}
+
+int main(void)
+{
+	uint8_t byte;
+
+	memset(fd_bus, -1, sizeof(fd_bus));
+	CHECK_EQ(apml_set_persistent_fd(true), 0);
+	CHECK_EQ(apml_set_transport(SBTSI, APML_TRANSPORT_I2C_DEV), 0);
+
+	CHECK_EQ(apml_set_i2c_device(0, SBTSI, 3, 0x4c), 0);
+	CHECK_EQ(esmi_oob_read_byte(0, TSI_REVISION, SBTSI, &byte), 0);
+	CHECK_EQ(last_bus, 3);
+	CHECK_EQ(last_addr, 0x4c);
+
+	/* The cached fd of adapter 3 is not used for the new target */
+	CHECK_EQ(apml_set_i2c_device(0, SBTSI, 5, 0x4d), 0);
+	CHECK_EQ(esmi_oob_read_byte(0, TSI_REVISION, SBTSI, &byte), 0);
+	CHECK_EQ(last_bus, 5);
+	CHECK_EQ(last_addr, 0x4d);
+
+	/* Setting the same device again keeps the fd */
+	CHECK_EQ(apml_set_i2c_device(0, SBTSI, 5, 0x4d), 0);
+	CHECK_EQ(esmi_oob_read_byte(0, TSI_REVISION, SBTSI, &byte), 0);
+	CHECK_EQ(last_bus, 5);
+
+	CHECK_EQ(apml_set_persistent_fd(false), 0);
+
+	return test_result("test_i2c_device");
+}
@@ -0,0 +1,123 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * Mailbox commands the firmware reports unknown fail without a transaction
+ * from then on, until the socket cache is invalidated, and in the later
+ * processes sharing the apml_set_disk_cache() file.
+ */
+#include "test_common.h"
+
+#include <unistd.h>
+
+#include <esmi_oob/esmi_mailbox.h>
+
+/* Not implemented by the emulated firmware */
+#define UNKNOWN_CMD	0xEE
+
+int main(void)
+{
+	char path[] = "/tmp/test_mailbox_caps.XXXXXX";
+	apml_cmd_support_t support;
+	uint32_t buffer;
+	uint64_t calls;
+	int fd;
+
+	test_use_emulator();
+
+	CHECK_EQ(apml_get_mailbox_support(0, UNKNOWN_CMD, &support), 0);
+	CHECK_EQ(support, APML_CMD_UNPROBED);
+
+	calls = test_calls(0, UNKNOWN_CMD);
+	CHECK_EQ(esmi_oob_read_mailbox(0, UNKNOWN_CMD, 0, &buffer),
+		 OOB_MAILBOX_CMD_UNKNOWN);
+	CHECK_EQ(test_calls(0, UNKNOWN_CMD) - calls, 1);
+	CHECK_EQ(apml_get_mailbox_support(0, UNKNOWN_CMD, &support), 0);
+	CHECK_EQ(support, APML_CMD_UNSUPPORTED);
+
+	/* Short-circuited from now on */
+	calls = test_calls(0, UNKNOWN_CMD);
+	CHECK_EQ(esmi_oob_read_mailbox(0, UNKNOWN_CMD, 0, &buffer),
+		 OOB_MAILBOX_CMD_UNKNOWN);
+	CHECK_EQ(esmi_oob_read_mailbox(0, UNKNOWN_CMD, 0, &buffer),
+		 OOB_MAILBOX_CMD_UNKNOWN);
+	CHECK_EQ(test_calls(0, UNKNOWN_CMD) - calls, 0);
+
+	/* Known commands are learnt as supported and still issued */
+	calls = test_calls(0, READ_TDP);
+	CHECK_EQ(esmi_oob_read_mailbox(0, READ_TDP, 0, &buffer), 0);
+	CHECK_EQ(esmi_oob_read_mailbox(0, READ_TDP, 0, &buffer), 0);
+	CHECK_EQ(test_calls(0, READ_TDP) - calls, 2);
+	CHECK_EQ(apml_get_mailbox_support(0, READ_TDP, &support), 0);
+	CHECK_EQ(support, APML_CMD_SUPPORTED);
+
+	/* Other sockets learn on their own */
+	CHECK_EQ(apml_get_mailbox_support(1, UNKNOWN_CMD, &support), 0);
+	CHECK_EQ(support, APML_CMD_UNPROBED);
+
+	/* A firmware update may implement it, invalidation forgets it */
+	CHECK_EQ(apml_invalidate_socket_cache(0), 0);
+	CHECK_EQ(apml_get_mailbox_support(0, UNKNOWN_CMD, &support), 0);
+	CHECK_EQ(support, APML_CMD_UNPROBED);
+	calls = test_calls(0, UNKNOWN_CMD);
+	esmi_oob_read_mailbox(0, UNKNOWN_CMD, 0, &buffer);
+	CHECK_EQ(test_calls(0, UNKNOWN_CMD) - calls, 1);
+
+	/* Kept in the disk cache for the next runs of a tool */
+	fd = mkstemp(path);
+	CHECK(fd >= 0);
+	close(fd);
+	test_use_emulator();
+	CHECK_EQ(apml_set_disk_cache(path), 0);
+	esmi_oob_read_mailbox(0, UNKNOWN_CMD, 0, &buffer);
+	/* As a new process, with only the record */
+	CHECK_EQ(apml_set_transport(SBRMI, APML_TRANSPORT_EMUL), 0);
+	calls = test_all_calls(0);
+	CHECK_EQ(apml_get_mailbox_support(0, UNKNOWN_CMD, &support), 0);
+	CHECK_EQ(support, APML_CMD_UNSUPPORTED);
+	CHECK_EQ(esmi_oob_read_mailbox(0, UNKNOWN_CMD, 0, &buffer),
+		 OOB_MAILBOX_CMD_UNKNOWN);
+	CHECK_EQ(test_all_calls(0), calls);
+	CHECK_EQ(apml_set_disk_cache(NULL), 0);
+	unlink(path);
+
+	return test_result("test_mailbox_caps");
+}
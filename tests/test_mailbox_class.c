@@ -0,0 +1,91 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * The RAS, BIST and error log mailbox commands are reads: they keep the
+ * priority class of the handle and do not drop the read cache.
+ */
+#include "test_common.h"
+
+#include <esmi_oob/esmi_mailbox.h>
+
+#include "../src/esmi_oob/common.h"
+
+#define MAX_AGE_NS	1000000000ULL
+
+int main(void)
+{
+	const struct apml_call_opts opts = { .max_age_ns = MAX_AGE_NS };
+	struct apml_handle *handle = apml_socket_handle(0);
+	struct apml_message msg, msgs[2];
+	oob_status_t status[2];
+	uint32_t power, reason;
+	uint64_t calls;
+
+	/* Reads in the class of the handle, writes in the control class */
+	apml_mailbox_read_msg(&msg, READ_BMC_RAS_FCH_RESET_REASON, 0);
+	CHECK(apml_msg_is_read(&msg));
+	CHECK_EQ(apml_msgs_prio(handle, &msg, 1), APML_PRIO_INTERACTIVE);
+	apml_mailbox_read_msg(&msg, READ_BMC_RAS_MCA_MSR_DUMP, 0);
+	CHECK_EQ(apml_msgs_prio(handle, &msg, 1), APML_PRIO_INTERACTIVE);
+	apml_mailbox_read_msg(&msg, WRITE_PACKAGE_POWER_LIMIT, 0);
+	CHECK(!apml_msg_is_read(&msg));
+	CHECK_EQ(apml_msgs_prio(handle, &msg, 1), APML_PRIO_CONTROL);
+
+	/* Missing messages or status are refused before being classified */
+	CHECK_EQ(apml_xfer_batch(handle, SBRMI, NULL, 1, status),
+		 OOB_ARG_PTR_NULL);
+	CHECK_EQ(apml_xfer_batch(handle, SBRMI, msgs, 2, NULL),
+		 OOB_ARG_PTR_NULL);
+
+	/* A RAS poll between two telemetry reads keeps the cached result */
+	test_use_emulator();
+	CHECK_EQ(apml_open(0, 0, &handle), 0);
+	CHECK_EQ(apml_set_call_opts(handle, &opts), 0);
+	calls = test_calls(0, READ_PACKAGE_POWER_CONSUMPTION);
+	CHECK_EQ(read_socket_power_h(handle, &power), 0);
+	CHECK_EQ(read_bmc_ras_fch_reset_reason_h(handle, 0, &reason), 0);
+	CHECK_EQ(read_socket_power_h(handle, &power), 0);
+	CHECK_EQ(test_calls(0, READ_PACKAGE_POWER_CONSUMPTION) - calls, 1);
+	CHECK_EQ(apml_close(handle), 0);
+
+	return test_result("test_mailbox_class");
+}
@@ -0,0 +1,133 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * read_rapl_core_energy_all(): one sample per enabled core, in core order,
+ * matching the per-core reads.
+ */
+#include "test_common.h"
+
+#include <esmi_oob/esmi_mailbox.h>
+#include <esmi_oob/esmi_rmi.h>
+
+/* Default emulated processor */
+#define EMUL_CORES	96
+#define EMUL_THREADS	(2 * EMUL_CORES)
+
+int main(void)
+{
+	struct rapl_core_energy energy[EMUL_CORES];
+	struct rapl_energy single;
+	uint32_t num_cores, i;
+	uint64_t calls;
+	uint8_t esu;
+
+	test_use_emulator();
+
+	CHECK_EQ(read_rapl_core_energy_all(0, NULL, EMUL_CORES, &num_cores,
+					   &esu), OOB_ARG_PTR_NULL);
+
+	/* Too small an array reports the size needed and reads nothing */
+	CHECK_EQ(read_rapl_core_energy_all(0, energy, 4, &num_cores, &esu),
+		 OOB_INVALID_INPUT);
+	CHECK_EQ(num_cores, EMUL_CORES);
+
+	calls = test_calls(0, READ_BMC_RAPL_CORE_LO_COUNTER) +
+		test_calls(0, READ_BMC_RAPL_CORE_HI_COUNTER);
+	CHECK_EQ(read_rapl_core_energy_all(0, energy, EMUL_CORES, &num_cores,
+					   &esu), 0);
+	CHECK_EQ(num_cores, EMUL_CORES);
+	/* hi, lo, hi per core while the high half does not move */
+	CHECK_EQ(test_calls(0, READ_BMC_RAPL_CORE_LO_COUNTER) +
+		 test_calls(0, READ_BMC_RAPL_CORE_HI_COUNTER) - calls,
+		 3 * EMUL_CORES);
+	for (i = 0; i < num_cores; i++) {
+		CHECK_EQ(energy[i].status, 0);
+		CHECK_EQ(energy[i].core_id, i);
+		CHECK(energy[i].timestamp_ns);
+		if (i)
+			CHECK(energy[i].timestamp_ns >=
+			      energy[i - 1].timestamp_ns);
+	}
+
+	/* Same unit and a counter that only moves forward */
+	CHECK_EQ(read_rapl_core_energy_raw(0, 5, &single), 0);
+	CHECK_EQ(single.esu, esu);
+	CHECK(single.counter >= energy[5].counter);
+
+	/* Threads 4 to 15 disabled */
+	CHECK_EQ(apml_emul_set_reg(0, SBRMI, 0x4, 0x0f), 0);
+	CHECK_EQ(apml_emul_set_reg(0, SBRMI, 0x5, 0x00), 0);
+	CHECK_EQ(read_rapl_core_energy_all(0, energy, EMUL_CORES, &num_cores,
+					   &esu), 0);
+	CHECK_EQ(num_cores, EMUL_CORES - 12);
+	CHECK_EQ(energy[3].core_id, 3);
+	CHECK_EQ(energy[4].core_id, 16);
+
+	/* A failing core is reported and does not stop the sweep */
+	CHECK_EQ(apml_emul_set_fw_error(0, READ_BMC_RAPL_CORE_LO_COUNTER, 0x4),
+		 0);
+	CHECK(read_rapl_core_energy_all(0, energy, EMUL_CORES, &num_cores,
+					&esu) != 0);
+	CHECK_EQ(num_cores, EMUL_CORES - 12);
+	CHECK(energy[0].status != 0);
+	CHECK(energy[num_cores - 1].status != 0);
+	CHECK_EQ(apml_emul_set_fw_error(0, READ_BMC_RAPL_CORE_LO_COUNTER, 0),
+		 0);
+
+	/* 256 threads wrap the 8-bit count of CPUID Fn01 to 0 */
+	CHECK_EQ(apml_emul_set_cpuid(0, 0x1, 0, 0x00a10f11, 0x800,
+				     0x7ef8320b, 0x178bfbff), 0);
+	CHECK_EQ(apml_invalidate_socket_cache(0), 0);
+	CHECK_EQ(read_rapl_core_energy_all(0, energy, EMUL_CORES, &num_cores,
+					   &esu), 0);
+	CHECK_EQ(num_cores, EMUL_CORES - 12);
+
+	/* No core reported is an error, not an empty sweep */
+	CHECK_EQ(apml_emul_set_cpuid(0, 0xb, 1, 0x7, 0, 0x201, 0), 0);
+	CHECK_EQ(apml_invalidate_socket_cache(0), 0);
+	CHECK_EQ(read_rapl_core_energy_all(0, energy, EMUL_CORES, &num_cores,
+					   &esu), OOB_UNEXPECTED_SIZE);
+	CHECK_EQ(apml_emul_set_cpuid(0, 0xb, 1, 0x7, EMUL_THREADS, 0x201, 0),
+		 0);
+
+	return test_result("test_rapl_bulk");
+}
@@ -0,0 +1,172 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * rapl_energy_to_uj(): exact values at the edges of the energy status unit
+ * range, and the _raw and _uj reads against the emulator energy model.
+ */
+#include "test_common.h"
+
+#include <stdint.h>
+#include <time.h>
+
+#include <esmi_oob/esmi_mailbox.h>
+
+/* Emulator energy model, see apml_emul.c */
+#define EMUL_ESU		14
+#define EMUL_PKG_UW		200000000ULL	/* 200 W */
+#define EMUL_CORE_UW		5000000ULL	/* 5 W, plus core_id / 2^14 W */
+#define SLEEP_NS		100000000ULL
+/* Timer and truncation slack of the model, in us */
+#define SLACK_US		1000
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t to_uj(uint64_t counter, uint8_t esu)
+{
+	struct rapl_energy energy = { .counter = counter, .esu = esu };
+	uint64_t uj = 0;
+
+	CHECK_EQ(rapl_energy_to_uj(&energy, &uj), 0);
+	return uj;
+}
+
+/* floor(counter * 10^6 / 2^esu) modulo 2^64 */
+static uint64_t ref_uj(uint64_t counter, uint8_t esu)
+{
+	return (uint64_t)(((unsigned __int128)counter * 1000000) >> esu);
+}
+
+/*
+ * Energy gained over [before first read, after second read] is the upper
+ * bound, over [after first read, before second read] the lower one.
+ */
+static void check_rate(uint64_t uj1, uint64_t uj2, uint64_t uw,
+		       uint64_t a1, uint64_t b1, uint64_t a2, uint64_t b2)
+{
+	uint64_t lo = (a2 - b1) / 1000, hi = (b2 - a1) / 1000;
+
+	lo = lo > SLACK_US ? lo - SLACK_US : 0;
+	hi += SLACK_US;
+	CHECK(uj2 - uj1 >= lo * (uw / 1000000));
+	CHECK(uj2 - uj1 <= hi * (uw / 1000000 + 1));
+}
+
+int main(void)
+{
+	static const uint64_t counters[] = {
+		0, 1, 0x3fff, 0x4000, 0xffffffff, 1ULL << 50,
+		(1ULL << 50) + 1, 0x8000000000000000ULL, UINT64_MAX,
+	};
+	struct rapl_energy raw1, raw2, bad = { .counter = 1, .esu = 32 };
+	uint64_t uj, a1, b1, a2, b2, pkg1, pkg2, core1, core2;
+	unsigned int i;
+	uint8_t esu;
+
+	/* esu 0: the counter is in Joules */
+	CHECK_EQ(to_uj(0, 0), 0);
+	CHECK_EQ(to_uj(7, 0), 7000000);
+
+	/* esu 31: the widest fraction, still scaled without overflow */
+	CHECK_EQ(to_uj(1, 31), 0);
+	CHECK_EQ(to_uj(3ULL << 30, 31), 1500000);
+	CHECK_EQ(to_uj((1ULL << 31) - 1, 31), 999999);
+	CHECK_EQ(to_uj(1ULL << 31, 31), 1000000);
+
+	/* Fractional Joules are floored, not rounded */
+	CHECK_EQ(to_uj((5ULL << 14) + (1ULL << 13), 14), 5500000);
+	CHECK_EQ(to_uj((5ULL << 14) + 1, 14), 5000061);
+	CHECK_EQ(to_uj((5ULL << 14) - 1, 14), 4999938);
+
+	/* Large counters: 2^36 J, then wrapping after 2^64 uJ */
+	CHECK_EQ(to_uj(1ULL << 50, 14), 68719476736000000ULL);
+	CHECK_EQ(to_uj(UINT64_MAX, 14), ref_uj(UINT64_MAX, 14));
+	for (esu = 0; esu <= 31; esu++)
+		for (i = 0; i < sizeof(counters) / sizeof(counters[0]); i++)
+			CHECK_EQ(to_uj(counters[i], esu),
+				 ref_uj(counters[i], esu));
+
+	CHECK_EQ(rapl_energy_to_uj(&bad, &uj), OOB_INVALID_INPUT);
+	CHECK_EQ(rapl_energy_to_uj(NULL, &uj), OOB_ARG_PTR_NULL);
+	CHECK_EQ(rapl_energy_to_uj(&raw1, NULL), OOB_ARG_PTR_NULL);
+
+	test_use_emulator();
+
+	CHECK_EQ(read_rapl_pckg_energy_uj(0, NULL), OOB_ARG_PTR_NULL);
+	CHECK_EQ(read_rapl_core_energy_uj(0, 5, NULL), OOB_ARG_PTR_NULL);
+
+	/* The uj reads convert a counter taken between two raw reads */
+	CHECK_EQ(read_rapl_pckg_energy_raw(0, &raw1), 0);
+	CHECK_EQ(read_rapl_pckg_energy_uj(0, &uj), 0);
+	CHECK_EQ(read_rapl_pckg_energy_raw(0, &raw2), 0);
+	CHECK_EQ(raw1.esu, EMUL_ESU);
+	CHECK_EQ(raw2.esu, EMUL_ESU);
+	CHECK(to_uj(raw1.counter, raw1.esu) <= uj);
+	CHECK(uj <= to_uj(raw2.counter, raw2.esu));
+
+	CHECK_EQ(read_rapl_core_energy_raw(0, 5, &raw1), 0);
+	CHECK_EQ(read_rapl_core_energy_uj(0, 5, &uj), 0);
+	CHECK_EQ(read_rapl_core_energy_raw(0, 5, &raw2), 0);
+	CHECK_EQ(raw1.esu, EMUL_ESU);
+	CHECK(to_uj(raw1.counter, raw1.esu) <= uj);
+	CHECK(uj <= to_uj(raw2.counter, raw2.esu));
+
+	/* 200 W package and 5 W core over a timed window */
+	a1 = now_ns();
+	CHECK_EQ(read_rapl_pckg_energy_uj(0, &pkg1), 0);
+	CHECK_EQ(read_rapl_core_energy_uj(0, 5, &core1), 0);
+	b1 = now_ns();
+	nanosleep(&(struct timespec){ .tv_nsec = SLEEP_NS }, NULL);
+	a2 = now_ns();
+	CHECK_EQ(read_rapl_pckg_energy_uj(0, &pkg2), 0);
+	CHECK_EQ(read_rapl_core_energy_uj(0, 5, &core2), 0);
+	b2 = now_ns();
+	check_rate(pkg1, pkg2, EMUL_PKG_UW, a1, b1, a2, b2);
+	check_rate(core1, core2, EMUL_CORE_UW, a1, b1, a2, b2);
+
+	return test_result("test_rapl_energy");
+}
@@ -0,0 +1,111 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * The read cache serves mailbox telemetry no older than the maximum age
+ * asked for, and never the reads made of several parts.
+ */
+#include "test_common.h"
+
+#include <esmi_oob/esmi_mailbox.h>
+
+#define MAX_AGE_NS	50000000ULL
+
+int main(void)
+{
+	const struct apml_call_opts opts = { .max_age_ns = MAX_AGE_NS };
+	struct apml_cmd_stats st;
+	struct apml_handle *handle;
+	struct rapl_energy energy;
+	uint32_t power;
+	uint64_t calls, cached;
+	uint8_t byte;
+
+	test_use_emulator();
+	CHECK_EQ(apml_open(0, 0, &handle), 0);
+	CHECK_EQ(apml_set_call_opts(handle, &opts), 0);
+
+	/* Served from the cache while younger than the maximum age */
+	CHECK_EQ(apml_get_stats(0, READ_PACKAGE_POWER_CONSUMPTION, &st), 0);
+	cached = st.cached;
+	calls = test_calls(0, READ_PACKAGE_POWER_CONSUMPTION);
+	CHECK_EQ(read_socket_power_h(handle, &power), 0);
+	CHECK_EQ(read_socket_power_h(handle, &power), 0);
+	CHECK_EQ(test_calls(0, READ_PACKAGE_POWER_CONSUMPTION) - calls, 1);
+	CHECK_EQ(apml_get_stats(0, READ_PACKAGE_POWER_CONSUMPTION, &st), 0);
+	CHECK_EQ(st.cached - cached, 1);
+
+	/* Issued again once older than the maximum age */
+	test_sleep_ns(2 * MAX_AGE_NS);
+	CHECK_EQ(read_socket_power_h(handle, &power), 0);
+	CHECK_EQ(test_calls(0, READ_PACKAGE_POWER_CONSUMPTION) - calls, 2);
+
+	/* A write on the interface drops the cached results */
+	CHECK_EQ(read_socket_power_h(handle, &power), 0);
+	CHECK_EQ(write_socket_power_limit_h(handle, 200000), 0);
+	CHECK_EQ(read_socket_power_h(handle, &power), 0);
+	CHECK_EQ(test_calls(0, READ_PACKAGE_POWER_CONSUMPTION) - calls, 3);
+
+	/* Counters and registers read in several parts are always issued */
+	calls = test_calls(0, READ_BMC_RAPL_CORE_LO_COUNTER);
+	CHECK_EQ(read_rapl_core_energy_raw_h(handle, 0, &energy), 0);
+	CHECK_EQ(read_rapl_core_energy_raw_h(handle, 0, &energy), 0);
+	CHECK_EQ(test_calls(0, READ_BMC_RAPL_CORE_LO_COUNTER) - calls, 2);
+	calls = test_calls(0, APML_STATS_CMD_SBRMI_REG);
+	CHECK_EQ(esmi_oob_read_byte_h(handle, 0x1, SBRMI, &byte), 0);
+	CHECK_EQ(esmi_oob_read_byte_h(handle, 0x1, SBRMI, &byte), 0);
+	CHECK_EQ(test_calls(0, APML_STATS_CMD_SBRMI_REG) - calls, 2);
+	CHECK_EQ(apml_close(handle), 0);
+
+	/* The socket index API only uses the cache when asked to */
+	calls = test_calls(0, READ_PACKAGE_POWER_CONSUMPTION);
+	CHECK_EQ(read_socket_power(0, &power), 0);
+	CHECK_EQ(read_socket_power(0, &power), 0);
+	CHECK_EQ(test_calls(0, READ_PACKAGE_POWER_CONSUMPTION) - calls, 2);
+	CHECK_EQ(apml_set_read_cache_max_age(MAX_AGE_NS), 0);
+	test_sleep_ns(2 * MAX_AGE_NS);
+	CHECK_EQ(read_socket_power(0, &power), 0);
+	CHECK_EQ(read_socket_power(0, &power), 0);
+	CHECK_EQ(test_calls(0, READ_PACKAGE_POWER_CONSUMPTION) - calls, 3);
+	CHECK_EQ(apml_set_read_cache_max_age(0), 0);
+
+	return test_result("test_read_cache");
+}
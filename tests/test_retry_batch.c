@@ -0,0 +1,116 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * A batch with a member failing transiently is retried as a whole and in
+ * order, so that the torn read detection of the RAPL counters holds.
+ */
+#include "test_common.h"
+
+#include <esmi_oob/esmi_mailbox.h>
+
+/* Default emulated processor */
+#define EMUL_CORES	96
+/* Firmware return code of an aborted mailbox command */
+#define FW_ABORTED	0x1
+#define MAX_SEQ		16
+
+static uint32_t seq[MAX_SEQ];
+static unsigned int n_seq;
+static unsigned int lo_reads;
+
+/* Records the counter reads of core 0, the first low half read aborts */
+static void record(const struct apml_xfer_info *info, void *ctx)
+{
+	const struct apml_message *msg = info->msg;
+
+	(void)ctx;
+	if (msg->cmd != READ_BMC_RAPL_CORE_HI_COUNTER &&
+	    msg->cmd != READ_BMC_RAPL_CORE_LO_COUNTER)
+		return;
+	if (msg->data_in.mb_in[0] != 0 || n_seq >= MAX_SEQ)
+		return;
+	seq[n_seq++] = msg->cmd;
+
+	if (msg->cmd == READ_BMC_RAPL_CORE_LO_COUNTER)
+		apml_emul_set_fw_error(info->soc_num, msg->cmd,
+				       lo_reads++ ? 0 : FW_ABORTED);
+}
+
+int main(void)
+{
+	static const struct apml_hooks hooks = { .pre = record };
+	const struct apml_retry_policy policy = { .max_attempts = 3 };
+	struct rapl_core_energy energy[EMUL_CORES];
+	struct apml_cmd_stats st;
+	struct apml_handle *handle;
+	uint32_t num_cores;
+	uint8_t esu;
+
+	test_use_emulator();
+	CHECK_EQ(apml_open(0, 0, &handle), 0);
+	CHECK_EQ(apml_set_retry_policy(handle, &policy), 0);
+	CHECK_EQ(apml_set_hooks(&hooks), 0);
+
+	CHECK_EQ(read_rapl_core_energy_all_h(handle, energy, EMUL_CORES,
+					     &num_cores, &esu), 0);
+	CHECK_EQ(apml_set_hooks(NULL), 0);
+	CHECK_EQ(energy[0].status, 0);
+
+	/* The retry read both halves again, between two high half reads */
+	CHECK_EQ(lo_reads, 2);
+	CHECK(n_seq >= 5);
+	CHECK_EQ(seq[0], READ_BMC_RAPL_CORE_HI_COUNTER);
+	CHECK_EQ(seq[1], READ_BMC_RAPL_CORE_LO_COUNTER);
+	CHECK_EQ(seq[n_seq - 3], READ_BMC_RAPL_CORE_HI_COUNTER);
+	CHECK_EQ(seq[n_seq - 2], READ_BMC_RAPL_CORE_LO_COUNTER);
+	CHECK_EQ(seq[n_seq - 1], READ_BMC_RAPL_CORE_HI_COUNTER);
+
+	/* Every member of the batch is counted as retried */
+	CHECK_EQ(apml_get_stats(0, READ_BMC_RAPL_CORE_HI_COUNTER, &st), 0);
+	CHECK_EQ(st.retries, 2);
+	CHECK_EQ(apml_get_stats(0, READ_BMC_RAPL_CORE_LO_COUNTER, &st), 0);
+	CHECK_EQ(st.retries, 1);
+
+	CHECK_EQ(apml_close(handle), 0);
+
+	return test_result("test_retry_batch");
+}
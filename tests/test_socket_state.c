@@ -0,0 +1,123 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * Threads polling different sockets at the same time each see the state
+ * of their own socket: the RAPL units and processor info are kept per
+ * socket and read from the device once.
+ */
+#include "test_common.h"
+
+#include <pthread.h>
+
+#include <esmi_oob/esmi_cpuid_msr.h>
+#include <esmi_oob/esmi_mailbox.h>
+
+#define SOCKETS		4
+#define THREADS		4
+#define ITERATIONS	1000
+/* Time unit of the emulated READ_BMC_RAPL_UNITS */
+#define EMUL_TU		0xA
+
+static pthread_barrier_t start;
+static int thread_failures[SOCKETS * THREADS];
+
+/* A different energy status unit per socket */
+static uint8_t socket_esu(uint8_t soc_num)
+{
+	return 10 + soc_num;
+}
+
+static void *poll_socket(void *arg)
+{
+	int id = (int)(intptr_t)arg;
+	uint8_t soc_num = id / THREADS;
+	struct processor_info info;
+	struct rapl_energy energy;
+	uint8_t tu, esu;
+	int i;
+
+	pthread_barrier_wait(&start);
+	for (i = 0; i < ITERATIONS; i++) {
+		if (read_bmc_rapl_units(soc_num, &tu, &esu) ||
+		    tu != EMUL_TU || esu != socket_esu(soc_num))
+			thread_failures[id]++;
+		if (read_rapl_core_energy_raw(soc_num, i % 8, &energy) ||
+		    energy.esu != socket_esu(soc_num))
+			thread_failures[id]++;
+		if (esmi_get_processor_info(soc_num, &info))
+			thread_failures[id]++;
+	}
+
+	return NULL;
+}
+
+int main(void)
+{
+	pthread_t threads[SOCKETS * THREADS];
+	uint64_t units_calls;
+	int i;
+
+	test_use_emulator();
+	for (i = 0; i < SOCKETS; i++)
+		CHECK_EQ(apml_emul_set_mailbox(i, READ_BMC_RAPL_UNITS,
+					       EMUL_TU << 16 |
+					       socket_esu(i) << 8), 0);
+
+	pthread_barrier_init(&start, NULL, SOCKETS * THREADS);
+	for (i = 0; i < SOCKETS * THREADS; i++)
+		CHECK_EQ(pthread_create(&threads[i], NULL, poll_socket,
+					(void *)(intptr_t)i), 0);
+	for (i = 0; i < SOCKETS * THREADS; i++)
+		pthread_join(threads[i], NULL);
+	pthread_barrier_destroy(&start);
+
+	for (i = 0; i < SOCKETS * THREADS; i++)
+		CHECK_EQ(thread_failures[i], 0);
+
+	/* Read once per socket, by as many of its threads as raced for it */
+	for (i = 0; i < SOCKETS; i++) {
+		units_calls = test_calls(i, READ_BMC_RAPL_UNITS);
+		CHECK(units_calls >= 1 && units_calls <= THREADS);
+	}
+
+	return test_result("test_socket_state");
+}
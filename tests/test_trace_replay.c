@@ -0,0 +1,207 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * A replay issues the writes of a trace only on the emulator, unless asked
+ * to, and paces the requests of concurrent sockets from the earliest one.
+ * The hardware transport is faked by interposing open() and ioctl().
+ */
+#define _GNU_SOURCE
+#include "test_common.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/amd-apml.h>
+
+#include <esmi_oob/esmi_mailbox.h>
+
+#define POWER_LIMIT	200000
+#define GAP_US		20000
+#define SLOW_NS		50000000U
+
+static unsigned int hw_xfers;
+static unsigned int hw_writes;
+
+/* The apml_modules devices are backed by /dev/null */
+int open(const char *path, int flags, ...)
+{
+	mode_t mode = 0;
+	va_list ap;
+
+	if (!strncmp(path, "/dev/sbrmi", 10) ||
+	    !strncmp(path, "/dev/sbtsi", 10))
+		path = "/dev/null";
+	if (flags & O_CREAT) {
+		va_start(ap, flags);
+		mode = va_arg(ap, mode_t);
+		va_end(ap);
+	}
+
+	return openat(AT_FDCWD, path, flags, mode);
+}
+
+int ioctl(int fd, unsigned long request, ...)
+{
+	struct apml_message *msg;
+	va_list ap;
+
+	(void)fd;
+	if (request != SBRMI_IOCTL_CMD) {
+		errno = ENOTTY;
+		return -1;
+	}
+	va_start(ap, request);
+	msg = va_arg(ap, struct apml_message *);
+	va_end(ap);
+
+	hw_xfers++;
+	if (msg->cmd == WRITE_PACKAGE_POWER_LIMIT)
+		hw_writes++;
+	memset(&msg->data_out, 0, sizeof(msg->data_out));
+	msg->fw_ret_code = 0;
+
+	return 0;
+}
+
+/* Slow socket 0 read, recorded after the socket 1 read it overlaps */
+static void *read_slow(void *arg)
+{
+	uint32_t limit;
+
+	(void)arg;
+	CHECK_EQ(read_socket_power_limit(0, &limit), 0);
+
+	return NULL;
+}
+
+int main(void)
+{
+	pthread_t thread;
+	struct apml_replay_stats st;
+	char path[] = "/tmp/test_trace_replay.XXXXXX";
+	uint64_t calls;
+	uint32_t power;
+	int fd;
+
+	fd = mkstemp(path);
+	CHECK(fd >= 0);
+	close(fd);
+
+	/* Record reads and a write on the emulator */
+	test_use_emulator();
+	CHECK_EQ(apml_trace_start(path), 0);
+	CHECK_EQ(read_socket_power(0, &power), 0);
+	CHECK_EQ(write_socket_power_limit(0, POWER_LIMIT), 0);
+	CHECK_EQ(read_socket_power(0, &power), 0);
+	CHECK_EQ(apml_trace_stop(), 0);
+
+	/* On the hardware transport only the reads are issued */
+	CHECK_EQ(apml_set_transport(SBRMI, APML_TRANSPORT_MODULE), 0);
+	CHECK_EQ(apml_trace_replay(path, 0, 0, &st), 0);
+	CHECK(st.transactions > 0);
+	CHECK_EQ(st.skipped, 1);
+	CHECK_EQ(hw_xfers, st.transactions);
+	CHECK_EQ(hw_writes, 0);
+
+	/* Unless the caller asks for the writes too */
+	CHECK_EQ(apml_trace_replay(path, 0, APML_REPLAY_WRITES, &st), 0);
+	CHECK_EQ(st.skipped, 0);
+	CHECK_EQ(hw_writes, 1);
+
+	/* The emulator replays everything */
+	hw_xfers = 0;
+	hw_writes = 0;
+	test_use_emulator();
+	CHECK_EQ(apml_trace_replay(path, 0, 0, &st), 0);
+	CHECK_EQ(st.skipped, 0);
+	CHECK_EQ(hw_xfers, 0);
+
+	/* The read cache of the default handles serves none of the reads */
+	CHECK_EQ(apml_set_read_cache_max_age(1000000000ULL), 0);
+	CHECK_EQ(read_socket_power(0, &power), 0);
+	calls = test_calls(0, READ_PACKAGE_POWER_CONSUMPTION);
+	CHECK_EQ(apml_trace_replay(path, 0, 0, &st), 0);
+	CHECK_EQ(test_calls(0, READ_PACKAGE_POWER_CONSUMPTION) - calls, 2);
+	CHECK_EQ(apml_set_read_cache_max_age(0), 0);
+
+	/* The writes not replayed still count in the recorded time span */
+	CHECK_EQ(apml_trace_start(path), 0);
+	CHECK_EQ(write_socket_power_limit(0, POWER_LIMIT), 0);
+	usleep(GAP_US);
+	CHECK_EQ(write_socket_power_limit(0, POWER_LIMIT), 0);
+	CHECK_EQ(apml_trace_stop(), 0);
+	CHECK_EQ(apml_set_transport(SBRMI, APML_TRANSPORT_MODULE), 0);
+	CHECK_EQ(apml_trace_replay(path, 0, 0, &st), 0);
+	CHECK_EQ(st.transactions, 0);
+	CHECK_EQ(st.skipped, 2);
+	CHECK(st.recorded_ns >= GAP_US * 1000ULL);
+
+	/* Overlapping requests of two sockets, recorded in completion order */
+	test_use_emulator();
+	CHECK_EQ(apml_emul_set_latency(READ_PACKAGE_POWER_LIMIT, SLOW_NS,
+				       SLOW_NS), 0);
+	CHECK_EQ(apml_set_hooks(&test_hold_hook), 0);
+	atomic_store(&test_holding, false);
+	CHECK_EQ(apml_trace_start(path), 0);
+	CHECK_EQ(pthread_create(&thread, NULL, read_slow, NULL), 0);
+	while (!atomic_load(&test_holding))
+		;
+	CHECK_EQ(read_socket_power(1, &power), 0);
+	pthread_join(thread, NULL);
+	CHECK_EQ(apml_trace_stop(), 0);
+	CHECK_EQ(apml_set_hooks(NULL), 0);
+	/* Killed by SIGALRM if the replay waits for a wrapped delay */
+	alarm(10);
+	CHECK_EQ(apml_trace_replay(path, 2.0, 0, &st), 0);
+	alarm(0);
+	CHECK_EQ(st.transactions, 2);
+	CHECK(st.recorded_ns >= SLOW_NS);
+	CHECK(st.recorded_ns < 10 * (uint64_t)SLOW_NS);
+
+	unlink(path);
+
+	return test_result("test_trace_replay");
+}
@@ -0,0 +1,147 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * With the SB-TSI shadow enabled the setters skip the read of the register
+ * and the writes of the value it already holds, and sbtsi_apply_profile()
+ * writes what changes in one batch.
+ */
+#include "test_common.h"
+
+#include <esmi_oob/esmi_tsi.h>
+
+#include "../src/esmi_oob/common.h"
+
+int main(void)
+{
+	struct sbtsi_profile profile = {0};
+	struct apml_socket *sock = apml_socket_handle(0)->sock;
+	uint8_t config;
+
+	test_use_emulator();
+	CHECK_EQ(apml_set_hooks(&test_tsi_hook), 0);
+
+	/* Without the shadow every setter reads the register first */
+	CHECK_EQ(sbtsi_set_alert_threshold(0, 3), 0);
+	CHECK_EQ(sbtsi_set_alert_threshold(0, 4), 0);
+	CHECK_EQ(test_tsi_n, 4);
+	CHECK_EQ(test_tsi_reads(), 2);
+
+	/* With it the register is read once */
+	CHECK_EQ(apml_set_tsi_shadow(true), 0);
+	test_tsi_n = 0;
+	CHECK_EQ(sbtsi_set_alert_threshold(0, 5), 0);
+	CHECK_EQ(sbtsi_set_alert_threshold(0, 6), 0);
+	CHECK_EQ(test_tsi_n, 3);
+	CHECK_EQ(test_tsi_reads(), 1);
+
+	/* and the write of the value it holds is left out */
+	test_tsi_n = 0;
+	CHECK_EQ(sbtsi_set_alert_threshold(0, 6), 0);
+	CHECK_EQ(test_tsi_n, 0);
+
+	/* A failed write drops the register from the shadow */
+	test_tsi_fail_reg = SBTSI_ALERTTHRESHOLD;
+	CHECK(sbtsi_set_alert_threshold(0, 7) != 0);
+	test_tsi_fail_reg = -1;
+	test_tsi_n = 0;
+	CHECK_EQ(sbtsi_set_alert_threshold(0, 7), 0);
+	CHECK_EQ(test_tsi_n, 2);
+	CHECK(test_tsi_xfers[0].read);
+
+	/* Config and ConfigWr are one register, shadowed in one word */
+	test_tsi_n = 0;
+	CHECK_EQ(sbtsi_set_configwr(0, 1, ALERTMASK_MASK), 0);
+	CHECK_EQ(sbtsi_set_configwr(0, 1, RUNSTOP_MASK), 0);
+	CHECK_EQ(test_tsi_n, 3);
+	CHECK_EQ(test_tsi_reads(), 1);
+	CHECK_EQ(apml_emul_get_reg(0, SBTSI, SBTSI_CONFIGURATION, &config), 0);
+	CHECK_EQ(config & (ALERTMASK_MASK | RUNSTOP_MASK),
+		 ALERTMASK_MASK | RUNSTOP_MASK);
+	CHECK_EQ((uint8_t)atomic_load(&sock->tsi_shadow[0]), config);
+
+	/* A profile writes the registers that change, reads none */
+	CHECK_EQ(sbtsi_set_alert_config(0, 0), 0);
+	CHECK_EQ(sbtsi_set_timeout_config(0, 0), 0);
+	profile.fields = SBTSI_PROFILE_ALERT_THRESHOLD |
+			 SBTSI_PROFILE_ALERT_CONFIG | SBTSI_PROFILE_TIMEOUT |
+			 SBTSI_PROFILE_CONFIG;
+	profile.alert_samples = 7;
+	profile.alert_comp = 1;
+	profile.timeout_en = 1;
+	profile.config_mask = ALERTMASK_MASK;
+	profile.config = ALERTMASK_MASK;
+	test_tsi_n = 0;
+	CHECK_EQ(sbtsi_apply_profile(0, &profile), 0);
+	CHECK_EQ(test_tsi_n, 2);
+	CHECK_EQ(test_tsi_reads(), 0);
+	CHECK_EQ(test_tsi_xfers[0].reg, SBTSI_ALERTCONFIG);
+	CHECK_EQ(test_tsi_xfers[1].reg, SBTSI_TIMEOUTCONFIG);
+
+	/*
+	 * In one batch: the writes after a failing one are still issued, and
+	 * only the failed register is read again afterwards.
+	 */
+	profile.fields = SBTSI_PROFILE_ALERT_THRESHOLD |
+			 SBTSI_PROFILE_ALERT_CONFIG | SBTSI_PROFILE_TIMEOUT;
+	profile.alert_samples = 2;
+	profile.alert_comp = 0;
+	profile.timeout_en = 0;
+	test_tsi_fail_reg = SBTSI_ALERTTHRESHOLD;
+	test_tsi_n = 0;
+	CHECK(sbtsi_apply_profile(0, &profile) != 0);
+	test_tsi_fail_reg = -1;
+	CHECK_EQ(test_tsi_n, 3);
+	CHECK_EQ(test_tsi_reads(), 0);
+	CHECK_EQ(test_tsi_xfers[0].reg, SBTSI_ALERTTHRESHOLD);
+	CHECK_EQ(test_tsi_xfers[1].reg, SBTSI_ALERTCONFIG);
+	CHECK_EQ(test_tsi_xfers[2].reg, SBTSI_TIMEOUTCONFIG);
+	test_tsi_n = 0;
+	CHECK_EQ(sbtsi_apply_profile(0, &profile), 0);
+	CHECK_EQ(test_tsi_n, 2);
+	CHECK(test_tsi_xfers[0].read);
+	CHECK_EQ(test_tsi_xfers[1].reg, SBTSI_ALERTTHRESHOLD);
+
+	CHECK_EQ(apml_set_tsi_shadow(false), 0);
+	CHECK_EQ(apml_set_hooks(NULL), 0);
+
+	return test_result("test_tsi_shadow");
+}
@@ -0,0 +1,318 @@
+/*
+ * University of Illinois/NCSA Open Source License
+ *
+ * Copyright (c) 2020, Advanced Micro Devices, Inc.
+ * All rights reserved.
+ *
+ * Developed by:
+ *
+ *                 AMD Research and AMD Software Development
+ *
+ *                 Advanced Micro Devices, Inc.
+ *
+ *                 www.amd.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal with the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimers.
+ *  - Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimers in
+ *    the documentation and/or other materials provided with the distribution.
+ *  - Neither the names of <Name of Development Group, Name of Institution>,
+ *    nor the names of its contributors may be used to endorse or promote
+ *    products derived from this Software without specific prior written
+ *    permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS WITH THE SOFTWARE.
+ *
+ */
+
+/*
+ * Stress benchmark of the library: a growing number of threads poll a set
+ * of metrics of the sockets in parallel, and the throughput is reported
+ * per thread count. With -e the devices are emulated in process, so the
+ * scaling of the library itself is measured without hardware.
+ */
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <esmi_oob/apml.h>
+#include <esmi_oob/apml_emul.h>
+#include <esmi_oob/esmi_mailbox.h>
+#include <esmi_oob/esmi_tsi.h>
+
+/* Latency of every emulated transaction, microseconds */
+#define EMUL_LATENCY_US	50
+
+struct metric {
+	const char *name;
+	oob_status_t (*read)(struct apml_handle *handle);
+};
+
+struct worker {
+	pthread_t tid;
+	uint8_t soc_num;
+	const struct metric *metric;
+	uint64_t ops;
+	uint64_t errors;
+};
+
+static pthread_barrier_t start_barrier;
+static atomic_bool stop;
+
+static oob_status_t read_power(struct apml_handle *handle)
+{
+	uint32_t power;
+
+	return read_socket_power_h(handle, &power);
+}
+
+static oob_status_t read_power_limit(struct apml_handle *handle)
+{
+	uint32_t limit;
+
+	return read_socket_power_limit_h(handle, &limit);
+}
+
+static oob_status_t read_boost_fmax(struct apml_handle *handle)
+{
+	uint32_t fmax;
+
+	return read_bios_boost_fmax_h(handle, 0, &fmax);
+}
+
+static oob_status_t read_pkg_energy(struct apml_handle *handle)
+{
+	double energy;
+
+	return read_rapl_pckg_energy_counters_h(handle, &energy);
+}
+
+static oob_status_t read_cputemp(struct apml_handle *handle)
+{
+	float temp;
+
+	return sbtsi_get_cputemp_h(handle, &temp);
+}
+
+static const struct metric metrics[] = {
+	{"power",	read_power},
+	{"power_limit",	read_power_limit},
+	{"boost_fmax",	read_boost_fmax},
+	{"pkg_energy",	read_pkg_energy},
+	{"cputemp",	read_cputemp},
+};
+
+#define NUM_METRICS	(sizeof(metrics) / sizeof(metrics[0]))
+
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Transactions issued on the sockets since their stats were reset */
+static uint64_t total_xfers(uint8_t num_sockets)
+{
+	struct apml_cmd_stats stats;
+	uint64_t calls = 0;
+	uint32_t cmd;
+	uint8_t soc;
+
+	for (soc = 0; soc < num_sockets && soc < APML_MAX_SOCKETS; soc++)
+		for (cmd = 0; cmd < APML_STATS_MAX_CMD; cmd++)
+			if (!apml_get_stats(soc, cmd, &stats))
+				calls += stats.calls;
+	return calls;
+}
+
+static void *worker_fn(void *arg)
+{
+	struct worker *w = arg;
+	struct apml_handle *handle;
+
+	if (apml_open(w->soc_num, APML_OPEN_PERSISTENT, &handle)) {
+		w->errors++;
+		pthread_barrier_wait(&start_barrier);
+		return NULL;
+	}
+
+	pthread_barrier_wait(&start_barrier);
+	while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+		if (w->metric->read(handle))
+			w->errors++;
+		else
+			w->ops++;
+	}
+
+	apml_close(handle);
+	return NULL;
+}
+
+/*
+ * Run @nthreads pollers for @duration seconds, return the reads per second
+ * and the transactions per second in @xfers
+ */
+static double run(unsigned int nthreads, uint8_t num_sockets,
+		  unsigned int duration, double *xfers, uint64_t *errors)
+{
+	struct worker *workers;
+	uint64_t ops = 0;
+	double start, elapsed;
+	unsigned int i;
+
+	workers = calloc(nthreads, sizeof(*workers));
+	if (!workers)
+		return 0;
+
+	*errors = 0;
+	for (i = 0; i < num_sockets && i < APML_MAX_SOCKETS; i++)
+		apml_reset_stats(i);
+	atomic_store(&stop, false);
+	pthread_barrier_init(&start_barrier, NULL, nthreads + 1);
+	for (i = 0; i < nthreads; i++) {
+		/* Spread over the sockets first, then over the metrics */
+		workers[i].soc_num = i % num_sockets;
+		workers[i].metric = &metrics[(i / num_sockets) % NUM_METRICS];
+		pthread_create(&workers[i].tid, NULL, worker_fn, &workers[i]);
+	}
+
+	pthread_barrier_wait(&start_barrier);
+	start = now_sec();
+	sleep(duration);
+	atomic_store(&stop, true);
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(workers[i].tid, NULL);
+		ops += workers[i].ops;
+		*errors += workers[i].errors;
+	}
+	elapsed = now_sec() - start;
+	*xfers = total_xfers(num_sockets) / elapsed;
+
+	pthread_barrier_destroy(&start_barrier);
+	free(workers);
+
+	return ops / elapsed;
+}
+
+static void setup_emulator(void)
+{
+	uint32_t ns = EMUL_LATENCY_US * 1000;
+	uint32_t cmd;
+
+	apml_set_transport(SBRMI, APML_TRANSPORT_EMUL);
+	apml_set_transport(SBTSI, APML_TRANSPORT_EMUL);
+	apml_emul_reset();
+
+	/* Commands the emulator does not know are rejected, ignore them */
+	for (cmd = 0; cmd <= UINT8_MAX; cmd++)
+		apml_emul_set_latency(cmd, ns, ns);
+	apml_emul_set_latency(APML_CPUID, ns, ns);
+	apml_emul_set_latency(APML_REG, ns, ns);
+}
+
+static void show_usage(char *exe_name)
+{
+	unsigned int i;
+
+	printf("Usage: %s [-e] [-s sockets] [-t threads] [-d seconds]\n"
+	       "Where:  -e : use the device emulator\n"
+	       "        -s : number of sockets to poll, default 1\n"
+	       "        -t : maximum number of threads, default 8\n"
+	       "        -d : duration of each run in seconds, default 1\n"
+	       "Thread i polls socket i %% sockets, cycling through:",
+	       exe_name);
+	for (i = 0; i < NUM_METRICS; i++)
+		printf(" %s", metrics[i].name);
+	printf("\n");
+}
+
+/**
+Main program.
+@param argc number of command line parameters
+@param argv list of command line parameters
+*/
+int main(int argc, char **argv)
+{
+	unsigned int max_threads = 8, duration = 1, nthreads;
+	uint8_t num_sockets = 1;
+	bool emulate = false;
+	double base = 0, rate, xfers;
+	uint64_t errors;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "hes:t:d:")) != -1) {
+		switch (opt) {
+		case 'e':
+			emulate = true;
+			break;
+		case 's':
+			num_sockets = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			max_threads = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			duration = strtoul(optarg, NULL, 0);
+			break;
+		case 'h':
+			show_usage(argv[0]);
+			return OOB_SUCCESS;
+		default:
+			show_usage(argv[0]);
+			return OOB_INVALID_INPUT;
+		}
+	}
+
+	if (!num_sockets || !max_threads || !duration ||
+	    (emulate && num_sockets > APML_MAX_SOCKETS)) {
+		show_usage(argv[0]);
+		return OOB_INVALID_INPUT;
+	}
+
+	if (emulate)
+		setup_emulator();
+
+	printf("%8s %14s %14s %9s %10s\n", "threads", "reads/s", "xfers/s",
+	       "speedup", "errors");
+	for (nthreads = 1; ; nthreads *= 2) {
+		if (nthreads > max_threads)
+			nthreads = max_threads;
+
+		rate = run(nthreads, num_sockets, duration, &xfers, &errors);
+		if (!base)
+			base = xfers;
+		printf("%8u %14.0f %14.0f %8.2fx %10llu\n", nthreads, rate,
+		       xfers, base ? xfers / base : 0,
+		       (unsigned long long)errors);
+
+		if (nthreads == max_threads)
+			break;
+	}
+
+	return 0;
+}
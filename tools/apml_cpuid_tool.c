@@ -48,6 +48,7 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <esmi_oob/apml.h>
 #include <esmi_oob/esmi_cpuid_msr.h>
 #define ARGS_MAX 64
 
@@ -237,6 +238,9 @@ int main(int argc, char **argv)
 		}
 	}
 
+	/* Reuse the device node across the CPUID transactions */
+	apml_set_persistent_fd(true);
+
 	ret = read_cupid_fn00000000(soc_num, core_id);
 	if (ret != OOB_SUCCESS) {
 		printf("Failed: to get addr[0x0] cpuid info, Err[%d]: %s\n",
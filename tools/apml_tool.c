@@ -1838,6 +1838,9 @@ static void show_module_commands(char *exe_name, char *command)
 			"\n< MAILBOX COMMANDS [params] >:\n"
 			"  --showmailboxsummary\t\t\t\t\t\t\t\t "
 			"Get summary of the mailbox commands\n"
+			"  --showsockettelemetry\t\t\t\t\t\t\t\t "
+			"Get telemetry of sockets 0 to SOC_NUM, read in "
+			"parallel\n"
 			"  -p, (--showpower)\t\t\t\t\t\t\t\t "
 			"Get Power for a given socket in Watts\n"
 			"  -t, (--showtdp)\t\t\t\t\t\t\t\t "
@@ -2012,6 +2015,15 @@ static void show_module_commands(char *exe_name, char *command)
 			esmi_get_err_msg(OOB_INVALID_INPUT));
 }
 
+/* Commands the firmware of the socket reported unknown are left out */
+static bool mailbox_cmd_unsupported(uint8_t soc_num, uint32_t cmd)
+{
+	apml_cmd_support_t support;
+
+	return !apml_get_mailbox_support(soc_num, cmd, &support) &&
+	       support == APML_CMD_UNSUPPORTED;
+}
+
 static oob_status_t show_apml_mailbox_cmds(uint8_t soc_num)
 {
 	struct max_ddr_bw max_ddr;
@@ -2186,60 +2198,73 @@ static oob_status_t show_apml_mailbox_cmds(uint8_t soc_num)
 		printf(" Err[%d]:%s", ret, esmi_get_err_msg(ret));
 	else
 		printf(" 0x%-15x", ccx_res);
-	usleep(APML_SLEEP);
-	printf("\n| Curr_Active_Freq_Limit\t\t |");
-	ret = read_pwr_current_active_freq_limit_socket(soc_num,
-							&freq, source_type);
-
-	if (ret)
-		printf(" Err[%d]:%s", ret, esmi_get_err_msg(ret));
-	else {
-		printf("\n| \tFreqlimit (MHz)\t\t\t | %u", freq);
-		printf("\n| \tSource \t\t\t\t |");
-		display_freq_limit_src_names(source_type);
+	if (!mailbox_cmd_unsupported(soc_num,
+		READ_PWR_CURRENT_ACTIVE_FREQ_LIMIT_SOCKET)) {
+		usleep(APML_SLEEP);
+		printf("\n| Curr_Active_Freq_Limit\t\t |");
+		ret = read_pwr_current_active_freq_limit_socket(soc_num, &freq,
+								source_type);
+
+		if (ret)
+			printf(" Err[%d]:%s", ret, esmi_get_err_msg(ret));
+		else {
+			printf("\n| \tFreqlimit (MHz)\t\t\t | %u", freq);
+			printf("\n| \tSource \t\t\t\t |");
+			display_freq_limit_src_names(source_type);
+		}
 	}
-	usleep(APML_SLEEP);
-	printf("\n| Power_Telemetry (Watts)\t\t |");
-	ret = read_pwr_svi_telemetry_all_rails(soc_num, &power);
-	if (ret)
-		printf(" Err[%d]:%s", ret, esmi_get_err_msg(ret));
-	else
-		printf(" %-17.3f", (float)power / 1000);
-
-	usleep(APML_SLEEP);
-	printf("\n| Socket_Freq_Range (MHz)\t\t |");
-	ret = read_socket_freq_range(soc_num, &fmax, &fmin);
-	if (ret)
-		printf(" Err[%d]:%s", ret, esmi_get_err_msg(ret));
-	else {
-		printf("\n| \tFmax \t\t\t\t | %u", fmax);
-		printf("\n| \tFmin \t\t\t\t | %u", fmin);
+	if (!mailbox_cmd_unsupported(soc_num,
+				     READ_PWR_SVI_TELEMETRY_ALL_RAILS)) {
+		usleep(APML_SLEEP);
+		printf("\n| Power_Telemetry (Watts)\t\t |");
+		ret = read_pwr_svi_telemetry_all_rails(soc_num, &power);
+		if (ret)
+			printf(" Err[%d]:%s", ret, esmi_get_err_msg(ret));
+		else
+			printf(" %-17.3f", (float)power / 1000);
+	}
+	if (!mailbox_cmd_unsupported(soc_num, READ_SOCKET_FREQ_RANGE)) {
+		usleep(APML_SLEEP);
+		printf("\n| Socket_Freq_Range (MHz)\t\t |");
+		ret = read_socket_freq_range(soc_num, &fmax, &fmin);
+		if (ret)
+			printf(" Err[%d]:%s", ret, esmi_get_err_msg(ret));
+		else {
+			printf("\n| \tFmax \t\t\t\t | %u", fmax);
+			printf("\n| \tFmin \t\t\t\t | %u", fmin);
+		}
 	}
-	usleep(APML_SLEEP);
-	printf("\n| Data_Fabric_Freq\t\t\t |");
-	ret = read_current_dfpstate_frequency(soc_num, &df_pstate);
-	if (ret)
-		printf(" Err[%d]:%s", ret, esmi_get_err_msg(ret));
-	else {
-		printf("\n| \tFclk \t\t\t\t | %u", df_pstate.fclk);
-		printf("\n| \tMclk \t\t\t\t | %u", df_pstate.mem_clk);
-		printf("\n| \tUclk \t\t\t\t | %u", df_pstate.uclk);
+	if (!mailbox_cmd_unsupported(soc_num,
+				     READ_CURRENT_DFPSTATE_FREQUENCY)) {
+		usleep(APML_SLEEP);
+		printf("\n| Data_Fabric_Freq\t\t\t |");
+		ret = read_current_dfpstate_frequency(soc_num, &df_pstate);
+		if (ret)
+			printf(" Err[%d]:%s", ret, esmi_get_err_msg(ret));
+		else {
+			printf("\n| \tFclk \t\t\t\t | %u", df_pstate.fclk);
+			printf("\n| \tMclk \t\t\t\t | %u", df_pstate.mem_clk);
+			printf("\n| \tUclk \t\t\t\t | %u", df_pstate.uclk);
+		}
+	}
+	if (!mailbox_cmd_unsupported(soc_num, READ_BMC_CPU_BASE_FREQUENCY)) {
+		usleep(APML_SLEEP);
+		printf("\n| CPU_Base_Freq (MHz)\t\t\t |");
+		ret = read_bmc_cpu_base_frequency(soc_num, &freq);
+		if (ret)
+			printf(" Err[%d]:%s", ret, esmi_get_err_msg(ret));
+		else
+			printf(" %-17u", freq);
+	}
+	if (!mailbox_cmd_unsupported(soc_num, READ_BMC_RAPL_PKG_COUNTER)) {
+		usleep(APML_SLEEP);
+		printf("\n| Package_Energy (MJ)\t\t\t |");
+		ret = read_rapl_pckg_energy_counters(soc_num, &energy);
+		if (ret)
+			printf(" Err[%d]:%s\n", ret, esmi_get_err_msg(ret));
+		else
+			printf(" %-17f", energy);
 	}
-	usleep(APML_SLEEP);
-	printf("\n| CPU_Base_Freq (MHz)\t\t\t |");
-	ret = read_bmc_cpu_base_frequency(soc_num, &freq);
-	if (ret)
-		printf(" Err[%d]:%s", ret, esmi_get_err_msg(ret));
-	else
-		printf(" %-17u", freq);
-
-	usleep(APML_SLEEP);
-	printf("\n| Package_Energy (MJ)\t\t\t |");
-	ret = read_rapl_pckg_energy_counters(soc_num, &energy);
-	if (ret)
-		printf(" Err[%d]:%s\n", ret, esmi_get_err_msg(ret));
-	else
-		printf(" %-17f", energy);
 
 	usleep(APML_SLEEP);
 	printf("\n| THREADS_PER_CORE\t\t\t |");
@@ -2262,6 +2287,115 @@ static oob_status_t show_apml_mailbox_cmds(uint8_t soc_num)
 	return OOB_SUCCESS;
 }
 
+/* Rows of the socket telemetry sweep */
+enum {
+	TEL_POWER,
+	TEL_POWER_LIMIT,
+	TEL_TDP,
+	TEL_CPU_TEMP,
+	TEL_BOOST_LIMIT,
+	TEL_DDR_BW,
+	TEL_ROWS
+};
+
+/* Telemetry of one socket, read by read_socket_telemetry() */
+struct socket_telemetry {
+	uint32_t power;
+	uint32_t power_limit;
+	uint32_t tdp;
+	uint32_t boost_limit;
+	float cpu_temp;
+	struct max_ddr_bw ddr;
+	oob_status_t ret[TEL_ROWS];
+};
+
+static oob_status_t read_socket_telemetry(struct apml_handle *handle,
+					  void *result, void *arg)
+{
+	struct socket_telemetry *tel = result;
+
+	(void)arg;
+	tel->ret[TEL_POWER] = read_socket_power_h(handle, &tel->power);
+	tel->ret[TEL_POWER_LIMIT] = read_socket_power_limit_h(handle,
+							      &tel->power_limit);
+	tel->ret[TEL_TDP] = read_tdp_h(handle, &tel->tdp);
+	tel->ret[TEL_CPU_TEMP] = sbtsi_get_cputemp_h(handle, &tel->cpu_temp);
+	tel->ret[TEL_BOOST_LIMIT] = read_bios_boost_fmax_h(handle, 0,
+							   &tel->boost_limit);
+	tel->ret[TEL_DDR_BW] = read_ddr_bandwidth_h(handle, &tel->ddr);
+
+	return OOB_SUCCESS;
+}
+
+/* Telemetry of the sockets 0 to max_soc, one column per socket */
+static void show_socket_telemetry(uint8_t max_soc)
+{
+	static const char * const rows[TEL_ROWS] = {
+		[TEL_POWER] = "Power (Watts)",
+		[TEL_POWER_LIMIT] = "PowerLimit (Watts)",
+		[TEL_TDP] = "TDP Avg (Watts)",
+		[TEL_CPU_TEMP] = "CPU Temp (Degree C)",
+		[TEL_BOOST_LIMIT] = "BIOS Boostlimit [0x0] (MHz)",
+		[TEL_DDR_BW] = "DDR Utilized BW (GB/s)",
+	};
+	struct socket_telemetry tel[APML_MAX_SOCKETS] = {0};
+	struct socket_telemetry *t;
+	uint8_t soc, num_sockets = max_soc + 1;
+	char err[17];
+	int row;
+
+	if (max_soc >= APML_MAX_SOCKETS) {
+		printf("Failed: Invalid socket, Err[%d]: %s\n",
+		       OOB_INVALID_INPUT, esmi_get_err_msg(OOB_INVALID_INPUT));
+		return;
+	}
+
+	/* Each socket is on its own bus, all of them are read at once */
+	apml_for_each_socket(num_sockets, read_socket_telemetry, NULL, tel,
+			     sizeof(tel[0]), NULL);
+
+	printf("\n\t\t *** SOCKET TELEMETRY ***\n");
+	printf("| %-30s |", "Function (UNITS)");
+	for (soc = 0; soc < num_sockets; soc++)
+		printf(" Socket %-9u|", soc);
+	printf("\n");
+	for (row = 0; row < TEL_ROWS; row++) {
+		printf("| %-30s |", rows[row]);
+		for (soc = 0; soc < num_sockets; soc++) {
+			t = &tel[soc];
+			if (t->ret[row]) {
+				snprintf(err, sizeof(err), "Err[%d]",
+					 t->ret[row]);
+				printf(" %-16s|", err);
+				continue;
+			}
+			switch (row) {
+			case TEL_POWER:
+				printf(" %-16.3f|", (double)t->power / 1000);
+				break;
+			case TEL_POWER_LIMIT:
+				printf(" %-16.3f|",
+				       (double)t->power_limit / 1000);
+				break;
+			case TEL_TDP:
+				printf(" %-16.3f|", (double)t->tdp / 1000);
+				break;
+			case TEL_CPU_TEMP:
+				printf(" %-16.3f|", t->cpu_temp);
+				break;
+			case TEL_BOOST_LIMIT:
+				printf(" %-16u|", t->boost_limit);
+				break;
+			case TEL_DDR_BW:
+				printf(" %-16u|",
+				       (uint32_t)t->ddr.utilized_bw);
+				break;
+			}
+		}
+		printf("\n");
+	}
+}
+
 static void show_smi_parameters(uint8_t soc_num)
 {
 	oob_status_t ret;
@@ -2414,6 +2548,7 @@ static oob_status_t parseesb_args(int argc, char **argv)
 		{"showSMTstatus",		no_argument,		&flag,	31},
 		{"showthreadspercoreandsocket",	no_argument,		&flag,	32},
 		{"showccxinfo",			no_argument,		&flag,	33},
+		{"showsockettelemetry",		no_argument,		&flag,	34},
 		{0,			0,			0,	0},
 	};
 
@@ -2765,6 +2900,9 @@ static oob_status_t parseesb_args(int argc, char **argv)
 			 * and logical ccx instance numbers
 			 */
 			apml_get_ccx_info(soc_num);
+		} else if (*(long_options[long_index].flag) == 34) {
+			/* Sweep all the sockets up to soc_num at once */
+			show_socket_telemetry(soc_num);
 		} else {
 			printf(RED "Try `%s --help' for more "
 			       "information."RESET "\n\n", argv[0]);
@@ -3037,6 +3175,11 @@ int main(int argc, char **argv)
 
 	show_smi_message();
 
+	/* Reuse the device nodes across the transactions of this run */
+	apml_set_persistent_fd(true);
+	/* Start from the static facts read by the previous runs */
+	apml_set_disk_cache(APML_DISK_CACHE_PATH);
+
 	/* Parse command arguments */
 	ret = parseesb_args(argc, argv);
 	if (ret)